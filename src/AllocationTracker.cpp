@@ -0,0 +1,142 @@
+#include "AllocationTracker.h"
+
+static const char *const kStageNames[kNAllocationStages] = {
+    "outside events", "primaries", "decays", "weights", "selection",
+    "particle histograms", "pairs", "correlations", "sparse histogram growth"};
+
+const char *AllocationTracker::GetStageName(int stage)
+{
+  return kStageNames[stage];
+}
+
+#ifdef PARTICLE_SIM_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+thread_local int AllocationTracker::fStage = kAllocOutsideEvent;
+thread_local bool AllocationTracker::fArmed = false;
+
+// Contatori condivisi dai thread
+static std::atomic<long long> gCount[kNAllocationStages];
+static std::atomic<long long> gBytes[kNAllocationStages];
+
+void AllocationTracker::Record(size_t bytes)
+{
+  if (!fArmed || fStage == kAllocOutsideEvent)
+    return;
+  gCount[fStage].fetch_add(1, std::memory_order_relaxed);
+  gBytes[fStage].fetch_add((long long)bytes, std::memory_order_relaxed);
+}
+
+void AllocationTracker::Reset()
+{
+  for (int stage = 0; stage < kNAllocationStages; ++stage)
+  {
+    gCount[stage] = 0;
+    gBytes[stage] = 0;
+  }
+}
+
+long long AllocationTracker::GetCount(int stage)
+{
+  return gCount[stage];
+}
+
+long long AllocationTracker::GetBytes(int stage)
+{
+  return gBytes[stage];
+}
+
+long long AllocationTracker::GetTotal()
+{
+  long long total = 0;
+  for (int stage = 0; stage < kNAllocationStages; ++stage)
+    total += gCount[stage];
+  return total;
+}
+
+// Sostituzione globale di operator new e delete: ogni allocazione è registrata e delegata a malloc
+static void *Allocate(size_t bytes)
+{
+  AllocationTracker::Record(bytes);
+  void *pointer = std::malloc(bytes ? bytes : 1);
+  if (!pointer)
+    throw std::bad_alloc();
+  return pointer;
+}
+
+void *operator new(size_t bytes)
+{
+  return Allocate(bytes);
+}
+
+void *operator new[](size_t bytes)
+{
+  return Allocate(bytes);
+}
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept
+{
+  AllocationTracker::Record(bytes);
+  return std::malloc(bytes ? bytes : 1);
+}
+
+void *operator new[](size_t bytes, const std::nothrow_t &) noexcept
+{
+  AllocationTracker::Record(bytes);
+  return std::malloc(bytes ? bytes : 1);
+}
+
+void operator delete(void *pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+  std::free(pointer);
+}
+
+// Deallocazione con dimensione (da C++14), usata dal compilatore quando la dimensione è nota
+#ifdef __cpp_sized_deallocation
+void operator delete(void *pointer, std::size_t) noexcept
+{
+  ::operator delete(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+  ::operator delete[](pointer);
+}
+#endif
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+  std::free(pointer);
+}
+
+#endif // PARTICLE_SIM_TRACK_ALLOCATIONS
+
+void AllocationTracker::Print(std::ostream &out)
+{
+  if (!kEnabled)
+  {
+    out << "Allocation tracking not compiled in (build with -DPARTICLE_SIM_TRACK_ALLOCATIONS)" << std::endl;
+    return;
+  }
+  const long long total = GetTotal();
+  out << "Event-loop allocations after warm-up: " << total << std::endl;
+  for (int stage = 0; stage < kNAllocationStages; ++stage)
+  {
+    if (GetCount(stage) > 0)
+      out << "  " << GetStageName(stage) << ": " << GetCount(stage) << " allocations, " << GetBytes(stage)
+          << " bytes" << std::endl;
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <cstddef>
+#include <ostream>
+
+// Fasi della generazione di un evento in cui sono contate le allocazioni dinamiche
+enum AllocationStage
+{
+  kAllocOutsideEvent,       // Fuori dalla generazione degli eventi (non contata)
+  kAllocPrimaries,          // Molteplicità e cinematica delle primarie, impostazione delle particelle
+  kAllocDecays,             // Decadimenti delle risonanze
+  kAllocWeights,            // Pesi delle variazioni dei parametri
+  kAllocSelection,          // Cinematica SoA e maschere delle particelle
+  kAllocParticleHistograms, // Istogrammi delle particelle
+  kAllocPairs,              // Loop delle coppie e istogrammi delle coppie
+  kAllocCorrelations,       // Correlazioni e mescolamento degli eventi
+  kAllocHistogramGrowth,    // Crescita della tabella delle celle degli istogrammi sparsi (per raddoppi, non un errore)
+  kNAllocationStages
+};
+
+// La classe AllocationTracker conta le allocazioni dinamiche (operator new) fatte durante la
+// generazione degli eventi, per fase, per verificare che il loop degli eventi non allochi memoria
+// dopo il riscaldamento (i buffer per evento crescono solo fino all'evento più grande visto).
+// Il conteggio esiste solo nelle build di debug compilate con -DPARTICLE_SIM_TRACK_ALLOCATIONS,
+// che sostituiscono operator new e delete; altrimenti tutti i metodi sono vuoti e il loop
+// non ha alcun costo aggiuntivo.
+// Fase e attivazione del conteggio sono per thread: le allocazioni sono contate solo nei thread
+// attivati con SetArmed e fuori da kAllocOutsideEvent.
+
+class AllocationTracker
+{
+public:
+#ifdef PARTICLE_SIM_TRACK_ALLOCATIONS
+  static const bool kEnabled = true;
+
+  // Metodo per impostare la fase del thread corrente
+  // stage: fase (AllocationStage)
+  // return: fase precedente
+  static int SetStage(int stage)
+  {
+    const int previous = fStage;
+    fStage = stage;
+    return previous;
+  }
+
+  // Metodo per registrare un'allocazione (chiamato da operator new)
+  // bytes: dimensione richiesta
+  static void Record(size_t bytes);
+
+  // Metodo per attivare o sospendere il conteggio nel thread corrente
+  static void SetArmed(bool armed) { fArmed = armed; }
+
+  // Metodo per azzerare i contatori di tutti i thread
+  static void Reset();
+
+  // Metodi di accesso ai contatori di una fase
+  static long long GetCount(int stage);
+  static long long GetBytes(int stage);
+
+  // Metodo per ottenere il numero totale di allocazioni contate
+  static long long GetTotal();
+
+private:
+  static thread_local int fStage;  // Fase del thread corrente
+  static thread_local bool fArmed; // Conteggio attivo nel thread corrente
+#else
+  static const bool kEnabled = false;
+
+  static int SetStage(int) { return kAllocOutsideEvent; }
+  static void SetArmed(bool) {}
+  static void Reset() {}
+  static long long GetCount(int) { return 0; }
+  static long long GetBytes(int) { return 0; }
+  static long long GetTotal() { return 0; }
+#endif
+
+public:
+  // Metodo per stampare i contatori delle fasi con allocazioni
+  // out: stream di uscita
+  static void Print(std::ostream &out);
+
+  // Metodo per ottenere il nome di una fase
+  static const char *GetStageName(int stage);
+};
+
+// Classe di appoggio che imposta la fase del thread corrente per la durata di un blocco
+// e ripristina la precedente all'uscita
+class AllocationStageScope
+{
+private:
+  int fPrevious; // Fase da ripristinare
+
+public:
+  explicit AllocationStageScope(int stage) : fPrevious(AllocationTracker::SetStage(stage)) {}
+  ~AllocationStageScope() { AllocationTracker::SetStage(fPrevious); }
+
+  AllocationStageScope(const AllocationStageScope &) = delete;
+  AllocationStageScope &operator=(const AllocationStageScope &) = delete;
+};
+
+#endif // ALLOCATIONTRACKER_H
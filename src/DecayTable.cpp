@@ -0,0 +1,131 @@
+#include "DecayTable.h"
+#include "Diagnostics.h"
+#include "TRandom.h"
+
+void AliasSampler::Build(const double *weights, int n)
+{
+  fProb.assign(n, 1.0);
+  fAlias.assign(n, 0);
+
+  double sum = 0;
+  for (int i = 0; i < n; ++i)
+  {
+    sum += weights[i];
+  }
+
+  // Le colonne con probabilità scalata minore di 1 ("piccole") vengono completate
+  // con la massa in eccesso delle colonne "grandi".
+  std::vector<double> scaled(n);
+  std::vector<int> small, large;
+  for (int i = 0; i < n; ++i)
+  {
+    fAlias[i] = i;
+    scaled[i] = weights[i] * n / sum;
+    if (scaled[i] < 1.0)
+      small.push_back(i);
+    else
+      large.push_back(i);
+  }
+
+  while (!small.empty() && !large.empty())
+  {
+    int s = small.back();
+    int l = large.back();
+    small.pop_back();
+    fProb[s] = scaled[s];
+    fAlias[s] = l;
+    scaled[l] -= 1.0 - scaled[s];
+    if (scaled[l] < 1.0)
+    {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // Le colonne rimaste (per errori di arrotondamento) sono accettate sempre
+  for (size_t i = 0; i < small.size(); ++i)
+    fProb[small[i]] = 1.0;
+  for (size_t i = 0; i < large.size(); ++i)
+    fProb[large[i]] = 1.0;
+}
+
+void DecayTable::AddChannel(const DecayChannel &channel, SpeciesTable &species)
+{
+  // Inserimento dopo l'ultimo canale della stessa madre, per mantenere i canali contigui
+  std::vector<DecayChannel>::iterator it = fChannels.begin();
+  while (it != fChannels.end() && it->parent <= channel.parent)
+  {
+    ++it;
+  }
+  fChannels.insert(it, channel);
+
+  // Aggiornamento degli intervalli di canali nella tabella delle specie
+  for (int s = 0; s < species.size; ++s)
+  {
+    species.data[s].firstChannel = 0;
+    species.data[s].nChannels = 0;
+  }
+  for (int c = (int)fChannels.size() - 1; c >= 0; --c)
+  {
+    SpeciesProperties &parent = species.data[fChannels[c].parent];
+    parent.firstChannel = (unsigned char)c;
+    ++parent.nChannels;
+  }
+
+  // Ricostruzione del campionatore della madre con i rapporti di decadimento
+  if ((int)fSamplers.size() < SpeciesTable::kMaxSpecies)
+  {
+    fSamplers.resize(SpeciesTable::kMaxSpecies);
+  }
+  const SpeciesProperties &parent = species[channel.parent];
+  std::vector<double> weights(parent.nChannels);
+  for (int c = 0; c < parent.nChannels; ++c)
+  {
+    weights[c] = fChannels[parent.firstChannel + c].branchingRatio;
+  }
+  fSamplers[channel.parent].Build(weights.data(), parent.nChannels);
+}
+
+int DecayTable::DecayAll(Particle *particles, int &count, int capacity, int *mother, TRandom &random,
+                         const SpeciesTable &species) const
+{
+  int failures = 0;
+
+  // Il limite del loop cresce con le figlie aggiunte: in questo modo anche le figlie
+  // instabili vengono decadute nello stesso passaggio.
+  for (int i = 0; i < count; ++i)
+  {
+    const int type = particles[i].GetParticleTypeIndex();
+    if (type == -1 || species[type].nChannels == 0)
+      continue;
+
+    const DecayChannel &channel = fChannels[SampleChannel(type, random.Rndm(), species)];
+    if (count + channel.nDaughters > capacity)
+    {
+      Diagnostics::Report(kDiagDecayOverflow);
+      ++failures;
+      continue;
+    }
+
+    Particle *dau = particles + count;
+    for (int d = 0; d < channel.nDaughters; ++d)
+    {
+      dau[d].SetParticleTypeIndex(channel.daughters[d]);
+    }
+
+    int status = (channel.nDaughters == 2) ? particles[i].Decay2Body(dau[0], dau[1], random)
+                                           : particles[i].Decay3Body(dau[0], dau[1], dau[2], random);
+    if (status != 0)
+    {
+      ++failures;
+      continue;
+    }
+
+    for (int d = 0; d < channel.nDaughters; ++d)
+    {
+      mother[count++] = i;
+    }
+  }
+
+  return failures;
+}
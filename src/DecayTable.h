@@ -0,0 +1,96 @@
+#ifndef DECAYTABLE_H
+#define DECAYTABLE_H
+
+#include "Particle.h"
+#include <vector>
+
+// Canale di decadimento di una risonanza: specie madre, rapporto di decadimento
+// e lista delle figlie (2 o 3 corpi).
+struct DecayChannel
+{
+  static const int kMaxDaughters = 3; // Numero massimo di figlie per canale
+
+  int parent;                 // Indice della specie che decade
+  double branchingRatio;      // Rapporto di decadimento (normalizzato tra i canali della madre)
+  int nDaughters;             // Numero di figlie (2 o 3)
+  int daughters[kMaxDaughters]; // Indici delle specie figlie
+  double threshold;           // Somma delle masse delle figlie
+};
+
+// Campionatore con il metodo degli alias di Walker: estrae un indice da una distribuzione
+// discreta in tempo costante con un solo numero casuale uniforme e senza rami dipendenti
+// dal numero di canali.
+class AliasSampler
+{
+private:
+  std::vector<double> fProb; // Probabilità di accettazione per ogni colonna
+  std::vector<int> fAlias;   // Indice alternativo per ogni colonna
+
+public:
+  // Metodo per costruire le tabelle a partire dai pesi (non necessariamente normalizzati)
+  // weights: pesi delle categorie
+  // n: numero di categorie
+  void Build(const double *weights, int n);
+
+  // Metodo per estrarre una categoria
+  // u: numero casuale uniforme in [0, 1)
+  // return: indice della categoria estratta
+  int Sample(double u) const
+  {
+    const int n = (int)fProb.size();
+    double x = u * n;
+    int column = (int)x;
+    if (column >= n) // Protezione per u == 1
+      column = n - 1;
+    return (x - column < fProb[column]) ? column : fAlias[column];
+  }
+};
+
+// La classe DecayTable contiene i canali di decadimento di tutte le risonanze.
+// I canali di una stessa madre sono contigui; l'intervallo di canali di ogni specie
+// è riportato nella tabella piatta delle specie (firstChannel, nChannels).
+// I decadimenti di un evento sono eseguiti in un unico passaggio dopo la generazione
+// delle particelle primarie, compresi i decadimenti a cascata delle figlie instabili.
+
+class DecayTable
+{
+private:
+  std::vector<DecayChannel> fChannels;  // Canali ordinati per specie madre
+  std::vector<AliasSampler> fSamplers;  // Campionatore dei canali per ogni specie madre
+
+public:
+  // Metodo per aggiungere un canale e ricostruire i campionatori.
+  // Aggiorna anche l'intervallo di canali nella tabella delle specie.
+  // channel: canale da aggiungere
+  // species: tabella delle specie da aggiornare
+  void AddChannel(const DecayChannel &channel, SpeciesTable &species);
+
+  // Metodo per accedere a un canale dato il suo indice
+  const DecayChannel &GetChannel(int index) const { return fChannels[index]; }
+
+  // Metodo per ottenere il numero totale di canali
+  int GetNChannels() const { return (int)fChannels.size(); }
+
+  // Metodo per scegliere un canale di decadimento di una specie
+  // parent: indice della specie madre (deve avere almeno un canale)
+  // u: numero casuale uniforme in [0, 1)
+  // return: indice del canale scelto
+  int SampleChannel(int parent, double u, const SpeciesTable &species) const
+  {
+    return species[parent].firstChannel + fSamplers[parent].Sample(u);
+  }
+
+  // Metodo per decadere tutte le risonanze di un evento in un unico passaggio.
+  // Le figlie sono aggiunte in coda all'array e, se instabili, decadono a loro volta.
+  // particles: array delle particelle dell'evento
+  // count: numero di particelle nell'array, aggiornato con le figlie aggiunte
+  // capacity: dimensione massima dell'array
+  // mother: per ogni particella, indice della madre (-1 per le primarie), aggiornato per le figlie
+  // random: generatore di numeri casuali del thread che esegue i decadimenti
+  // species: tabella delle specie (quella di Particle o una sua copia sul nodo NUMA del thread)
+  // return: numero di decadimenti non riusciti
+  int DecayAll(Particle *particles, int &count, int capacity, int *mother, TRandom &random,
+               const SpeciesTable &species) const;
+};
+
+#endif // DECAYTABLE_H
@@ -0,0 +1,248 @@
+#include "Diagnostics.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const char *const kMessages[kNDiagnosticKinds] = {
+    "Particle type not found", "Invalid particle index", "Decayment cannot be performed if mass is zero",
+    "Decayment cannot be performed because mass is too low in this channel",
+    "Decay discarded: event capacity reached"};
+
+const char *Diagnostics::GetMessage(int kind)
+{
+  return kMessages[kind];
+}
+
+// Registro dei contatori dei thread attivi e totali dei thread terminati
+struct DiagnosticRegistry
+{
+  std::mutex mutex;
+  std::vector<Diagnostics::ThreadCounters *> threads;
+  long long retired[kNDiagnosticKinds];
+
+  DiagnosticRegistry()
+  {
+    for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+      retired[kind] = 0;
+  }
+};
+
+static DiagnosticRegistry &GetRegistry()
+{
+  static DiagnosticRegistry registry;
+  return registry;
+}
+
+Diagnostics::ThreadCounters::ThreadCounters()
+{
+  for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+    count[kind] = 0;
+  DiagnosticRegistry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.threads.push_back(this);
+}
+
+Diagnostics::ThreadCounters::~ThreadCounters()
+{
+  DiagnosticRegistry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+    registry.retired[kind] += count[kind];
+  for (size_t k = 0; k < registry.threads.size(); ++k)
+  {
+    if (registry.threads[k] == this)
+    {
+      registry.threads.erase(registry.threads.begin() + k);
+      break;
+    }
+  }
+}
+
+long long Diagnostics::GetTotal(int kind)
+{
+  DiagnosticRegistry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  long long total = registry.retired[kind];
+  for (size_t k = 0; k < registry.threads.size(); ++k)
+    total += registry.threads[k]->count[kind].load(std::memory_order_relaxed);
+  return total;
+}
+
+// Messaggio in coda: memoria fissa, nessuna allocazione all'accodamento
+struct DiagnosticMessage
+{
+  int kind;
+  long long occurrence;
+  char detail[Diagnostics::kDetailLength];
+};
+
+// Coda circolare dei messaggi e thread di scrittura, avviato alla prima segnalazione registrata
+class DiagnosticSink
+{
+private:
+  std::mutex fMutex;
+  std::condition_variable fAvailable, fIdle;
+  DiagnosticMessage fQueue[Diagnostics::kQueueSize];
+  int fHead, fCount;
+  bool fWriting, fStop;
+  std::atomic<long long> fDropped;  // Messaggi scartati per coda piena o occupata
+  long long fSuppressed;            // Messaggi scartati per il limite di frequenza
+  std::thread fThread;
+
+  void WriterLoop()
+  {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point windowStart = Clock::now();
+    int windowLines = 0;
+    std::unique_lock<std::mutex> lock(fMutex);
+    for (;;)
+    {
+      fAvailable.wait(lock, [this]() { return fStop || fCount > 0; });
+      if (fCount == 0)
+        return;
+      const DiagnosticMessage message = fQueue[fHead];
+      fHead = (fHead + 1) % Diagnostics::kQueueSize;
+      --fCount;
+      fWriting = true;
+      lock.unlock();
+
+      // Limite di frequenza a finestre di un secondo
+      const Clock::time_point now = Clock::now();
+      if (now - windowStart >= std::chrono::seconds(1))
+      {
+        windowStart = now;
+        windowLines = 0;
+      }
+      const bool write = windowLines < Diagnostics::kMaxLinesPerSecond;
+      if (write)
+      {
+        ++windowLines;
+        std::cerr << "Warning: " << Diagnostics::GetMessage(message.kind);
+        if (message.detail[0])
+          std::cerr << " (" << message.detail << ")";
+        std::cerr << " [occurrence " << message.occurrence << " in this thread";
+        if (message.occurrence == Diagnostics::kLoggedPerThread)
+          std::cerr << ", further occurrences only counted";
+        std::cerr << "]" << std::endl;
+      }
+
+      lock.lock();
+      if (!write)
+        ++fSuppressed;
+      fWriting = false;
+      if (fCount == 0)
+        fIdle.notify_all();
+    }
+  }
+
+public:
+  DiagnosticSink() : fHead(0), fCount(0), fWriting(false), fStop(false), fDropped(0), fSuppressed(0)
+  {
+    fThread = std::thread(&DiagnosticSink::WriterLoop, this);
+  }
+
+  ~DiagnosticSink()
+  {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStop = true;
+    }
+    fAvailable.notify_all();
+    fThread.join();
+  }
+
+  void Push(int kind, const char *detail, long long occurrence)
+  {
+    std::unique_lock<std::mutex> lock(fMutex, std::try_to_lock);
+    if (!lock.owns_lock() || fCount == Diagnostics::kQueueSize)
+    {
+      fDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    DiagnosticMessage &message = fQueue[(fHead + fCount) % Diagnostics::kQueueSize];
+    message.kind = kind;
+    message.occurrence = occurrence;
+    message.detail[0] = '\0';
+    if (detail)
+    {
+      std::strncpy(message.detail, detail, Diagnostics::kDetailLength - 1);
+      message.detail[Diagnostics::kDetailLength - 1] = '\0';
+    }
+    ++fCount;
+    lock.unlock();
+    fAvailable.notify_one();
+  }
+
+  void Flush()
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fIdle.wait(lock, [this]() { return fCount == 0 && !fWriting; });
+  }
+
+  long long GetDiscarded()
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fDropped + fSuppressed;
+  }
+};
+
+static std::mutex gSinkMutex;
+static DiagnosticSink *gSink = 0;
+
+// Metodo per ottenere il thread di scrittura, creandolo se richiesto
+static DiagnosticSink *GetSink(bool create)
+{
+  std::lock_guard<std::mutex> lock(gSinkMutex);
+  if (!gSink && create)
+  {
+    static DiagnosticSink sink;
+    gSink = &sink;
+  }
+  return gSink;
+}
+
+void Diagnostics::Log(int kind, const char *detail, long long occurrence)
+{
+  GetSink(true)->Push(kind, detail, occurrence);
+}
+
+void Diagnostics::Flush()
+{
+  DiagnosticSink *sink = GetSink(false);
+  if (sink)
+    sink->Flush();
+}
+
+void Diagnostics::GetTotals(long long *totals)
+{
+  for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+    totals[kind] = GetTotal(kind);
+}
+
+void Diagnostics::PrintSummary(std::ostream &out, const long long *since)
+{
+  long long totals[kNDiagnosticKinds];
+  long long sum = 0;
+  GetTotals(totals);
+  for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+  {
+    if (since)
+      totals[kind] -= since[kind];
+    sum += totals[kind];
+  }
+  if (sum == 0)
+    return;
+  out << "Diagnostics:" << std::endl;
+  for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+  {
+    if (totals[kind] > 0)
+      out << "  " << GetMessage(kind) << ": " << totals[kind] << std::endl;
+  }
+  DiagnosticSink *sink = GetSink(false);
+  if (sink && sink->GetDiscarded() > 0)
+    out << "  " << sink->GetDiscarded() << " messages not printed (queue full or rate limit)" << std::endl;
+}
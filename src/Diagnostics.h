@@ -0,0 +1,89 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <atomic>
+#include <ostream>
+
+// Tipi di errore segnalati dal nucleo della simulazione
+enum DiagnosticKind
+{
+  kDiagTypeNotFound,        // Specie cercata per nome non trovata
+  kDiagInvalidIndex,        // Indice di specie non valido
+  kDiagDecayZeroMass,       // Decadimento di una particella di massa nulla
+  kDiagDecayBelowThreshold, // Massa estratta sotto la soglia del canale
+  kDiagDecayOverflow,       // Decadimento scartato per la capacità dell'evento
+  kNDiagnosticKinds
+};
+
+// La classe Diagnostics raccoglie gli errori del nucleo (Particle, DecayTable) senza scrivere
+// su std::cout o std::cerr dal loop degli eventi: ogni thread ha i propri contatori per tipo,
+// incrementati senza lock né operazioni atomiche con lock (un solo thread scrive ogni contatore).
+// Solo le prime kLoggedPerThread occorrenze di ogni tipo in ogni thread producono un messaggio,
+// accodato senza attese in una coda di dimensione fissa e scritto su std::cerr da un thread
+// dedicato, al più kMaxLinesPerSecond righe al secondo; i messaggi in eccesso (coda piena,
+// coda occupata o limite di frequenza) sono scartati e contati. Dopo le prime occorrenze il
+// costo di una segnalazione è l'incremento di un contatore. I totali di tutti i thread sono
+// riportati con PrintSummary.
+
+class Diagnostics
+{
+public:
+  static const int kLoggedPerThread = 5;      // Occorrenze con messaggio per tipo e per thread
+  static const int kQueueSize = 256;          // Messaggi in attesa di scrittura
+  static const int kMaxLinesPerSecond = 20;   // Righe scritte al secondo
+  static const int kDetailLength = 64;        // Lunghezza massima del dettaglio di un messaggio
+
+  // Contatori di un thread, registrati per la somma dei totali
+  struct ThreadCounters
+  {
+    std::atomic<long long> count[kNDiagnosticKinds];
+
+    ThreadCounters();
+    ~ThreadCounters(); // Aggiunge i conteggi ai totali dei thread terminati
+  };
+
+private:
+  // Metodo per accedere ai contatori del thread corrente
+  static ThreadCounters &GetThreadCounters()
+  {
+    static thread_local ThreadCounters counters;
+    return counters;
+  }
+
+  // Metodo per accodare il messaggio di un'occorrenza (senza attese: scartato se la coda è occupata)
+  static void Log(int kind, const char *detail, long long occurrence);
+
+public:
+  // Metodo per segnalare un errore
+  // kind: tipo di errore (DiagnosticKind)
+  // detail: informazione aggiuntiva per il messaggio (es. nome della specie), copiata solo se registrata
+  static void Report(int kind, const char *detail = 0)
+  {
+    std::atomic<long long> &counter = GetThreadCounters().count[kind];
+    const long long occurrence = counter.load(std::memory_order_relaxed) + 1;
+    counter.store(occurrence, std::memory_order_relaxed);
+    if (occurrence <= kLoggedPerThread)
+      Log(kind, detail, occurrence);
+  }
+
+  // Metodo per ottenere il totale di un tipo di errore, sommato su tutti i thread
+  static long long GetTotal(int kind);
+
+  // Metodo per leggere i totali di tutti i tipi di errore
+  // totals: array di kNDiagnosticKinds valori
+  static void GetTotals(long long *totals);
+
+  // Metodo per attendere la scrittura dei messaggi accodati
+  static void Flush();
+
+  // Metodo per stampare i totali dei tipi di errore segnalati e i messaggi scartati (nulla se non
+  // ci sono stati errori)
+  // out: stream di uscita
+  // since: totali da sottrarre, letti con GetTotals all'inizio di una simulazione (nullo: nessuno)
+  static void PrintSummary(std::ostream &out, const long long *since = 0);
+
+  // Metodo per ottenere la descrizione di un tipo di errore
+  static const char *GetMessage(int kind);
+};
+
+#endif // DIAGNOSTICS_H
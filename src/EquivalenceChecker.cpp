@@ -0,0 +1,169 @@
+#include "EquivalenceChecker.h"
+#include "HistogramComparison.h"
+#include "SignalExtractor.h"
+#include <cmath>
+#include <cstring>
+#include "TH1F.h"
+
+// Campioni del picco della K*, come in analyze_invariant_mass: istogramma di carica opposta e
+// della stessa carica da sottrarre (nullo per i prodotti di decadimento, fittati direttamente)
+struct SignalSample
+{
+  const char *label;
+  const char *oppositeCharge;
+  const char *sameCharge;
+};
+
+static const SignalSample kSignalSamples[] = {
+    {"all pairs", "hInvMassOppositeCharge", "hInvMassSameCharge"},
+    {"pion-kaon", "hInvMassPionKaon", "hInvMassPionKaonSC"},
+    {"decay products", "hInvMassDecayProducts", 0},
+};
+
+// Metodo per estrarre il picco della K* di un campione da un archivio
+// store: archivio degli istogrammi
+// sample: campione
+// fit: parametri del picco
+// return: false se mancano gli istogrammi
+static bool ExtractSignal(const HistogramStore &store, const SignalSample &sample, SignalFit &fit)
+{
+  const SignalExtractor extractor;
+  TH1F *oppositeCharge = store.MakeTH1F(sample.oppositeCharge);
+  TH1F *sameCharge = sample.sameCharge ? store.MakeTH1F(sample.sameCharge) : 0;
+  if (!oppositeCharge || (sample.sameCharge && !sameCharge))
+  {
+    delete oppositeCharge;
+    delete sameCharge;
+    return false;
+  }
+  if (sameCharge)
+  {
+    TH1F *subtracted = extractor.Subtract(oppositeCharge, sameCharge, "hEquivalenceSubtracted", "");
+    fit = extractor.Fit(subtracted);
+    delete subtracted;
+  }
+  else
+    fit = extractor.Fit(oppositeCharge);
+  delete oppositeCharge;
+  delete sameCharge;
+  return true;
+}
+
+// Prefissi dei nomi degli istogrammi riempiti con le coppie di un evento
+static const char *const kPairHistogramPrefixes[] = {"hInvariantMass", "hInvMassOppositeCharge", "hInvMassSameCharge",
+                                                     "hInvMassPionKaon", "hPionKaon", "hDeltaPhiDeltaEta", "hQinv"};
+
+bool EquivalenceChecker::IsPairHistogram(const char *name)
+{
+  for (const char *prefix : kPairHistogramPrefixes)
+  {
+    if (std::strncmp(name, prefix, std::strlen(prefix)) == 0)
+      return true;
+  }
+  return false;
+}
+
+EquivalenceChecker::EquivalenceChecker(double minProb, double maxPull) : fMinProb(minProb), fMaxPull(maxPull)
+{
+}
+
+int EquivalenceChecker::CompareHistograms(const HistogramStore &reference, const HistogramStore &candidate,
+                                          std::ostream &out) const
+{
+  int nFailures = 0;
+  for (long long k = 0; k < reference.GetNHistograms(); ++k)
+  {
+    const HistogramStoreEntry &entry = reference.GetEntry(k);
+    const char *name = reference.GetName(entry);
+    const HistogramStoreEntry *other = candidate.Find(name);
+    if (!other)
+    {
+      out << "FAIL " << name << ": missing in the candidate" << std::endl;
+      ++nFailures;
+      continue;
+    }
+    ComparisonResult chi2;
+    if (!HistogramComparison::Chi2Test(reference, entry, candidate, *other, chi2))
+    {
+      out << "FAIL " << name << ": binning differs" << std::endl;
+      ++nFailures;
+      continue;
+    }
+    KolmogorovResult kolmogorov;
+    const bool kolmogorovTest = !IsPairHistogram(name) &&
+                                HistogramComparison::KolmogorovTest(reference, entry, candidate, *other, kolmogorov);
+    const bool pass = chi2.prob >= fMinProb && (!kolmogorovTest || kolmogorov.prob >= fMinProb);
+    out << (pass ? "PASS " : "FAIL ") << name << ": chi2/ndf " << chi2.chi2 << "/" << chi2.ndf << " (prob "
+        << chi2.prob << ")";
+    if (kolmogorovTest)
+      out << ", KS distance " << kolmogorov.distance << " (prob " << kolmogorov.prob << ")";
+    out << std::endl;
+    if (!pass)
+      ++nFailures;
+  }
+
+  for (long long k = 0; k < candidate.GetNHistograms(); ++k)
+  {
+    const char *name = candidate.GetName(candidate.GetEntry(k));
+    if (!reference.Find(name))
+    {
+      out << "FAIL " << name << ": missing in the reference" << std::endl;
+      ++nFailures;
+    }
+  }
+  return nFailures;
+}
+
+int EquivalenceChecker::CompareSignal(const HistogramStore &reference, const HistogramStore &candidate,
+                                      std::ostream &out) const
+{
+  int nFailures = 0;
+  for (const SignalSample &sample : kSignalSamples)
+  {
+    SignalFit fits[2];
+    if (!ExtractSignal(reference, sample, fits[0]) || !ExtractSignal(candidate, sample, fits[1]))
+    {
+      out << "FAIL K* " << sample.label << ": histograms missing" << std::endl;
+      ++nFailures;
+      continue;
+    }
+    if (!fits[0].valid || !fits[1].valid)
+    {
+      out << "FAIL K* " << sample.label << ": fit not converged in the " << (fits[0].valid ? "candidate" : "reference")
+          << std::endl;
+      ++nFailures;
+      continue;
+    }
+
+    // Differenza di ogni parametro in unità dell'errore combinato dei due campioni indipendenti
+    const char *const names[] = {"mass", "width", "yield"};
+    const double values[2][3] = {{fits[0].mass, fits[0].width, fits[0].yield},
+                                 {fits[1].mass, fits[1].width, fits[1].yield}};
+    const double errors[2][3] = {{fits[0].massError, fits[0].widthError, fits[0].yieldError},
+                                 {fits[1].massError, fits[1].widthError, fits[1].yieldError}};
+    for (int p = 0; p < 3; ++p)
+    {
+      const double error = std::sqrt(errors[0][p] * errors[0][p] + errors[1][p] * errors[1][p]);
+      const double pull = error > 0 ? (values[1][p] - values[0][p]) / error : 0;
+      const bool pass = error > 0 && std::fabs(pull) <= fMaxPull;
+      out << (pass ? "PASS " : "FAIL ") << "K* " << sample.label << " " << names[p] << ": " << values[0][p] << " ± "
+          << errors[0][p] << " vs " << values[1][p] << " ± " << errors[1][p] << " (pull " << pull << ")" << std::endl;
+      if (!pass)
+        ++nFailures;
+    }
+  }
+  return nFailures;
+}
+
+bool EquivalenceChecker::Check(const HistogramStore &reference, const HistogramStore &candidate,
+                               std::ostream &out) const
+{
+  const int histogramFailures = CompareHistograms(reference, candidate, out);
+  const int signalFailures = CompareSignal(reference, candidate, out);
+  out << "Histograms: " << reference.GetNHistograms() << " compared, " << histogramFailures
+      << " failures (minimum probability " << fMinProb << ")" << std::endl;
+  out << "K* fit parameters: " << signalFailures << " failures (maximum pull " << fMaxPull << ")" << std::endl;
+  const bool equivalent = histogramFailures == 0 && signalFailures == 0;
+  out << (equivalent ? "Equivalence check passed" : "Equivalence check FAILED") << std::endl;
+  return equivalent;
+}
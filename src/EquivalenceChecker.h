@@ -0,0 +1,59 @@
+#ifndef EQUIVALENCECHECKER_H
+#define EQUIVALENCECHECKER_H
+
+#include "HistogramStore.h"
+#include <ostream>
+
+// La classe EquivalenceChecker decide se una configurazione veloce della simulazione (precisione float,
+// FastMath, altri semi, più thread) è statisticamente equivalente a quella di riferimento, confrontando
+// gli archivi nativi di istogrammi delle due simulazioni:
+// - ogni coppia di istogrammi con lo stesso nome deve superare il test del chi quadro e, per quelli a
+//   una dimensione riempiti per particella o per decadimento, il test di Kolmogorov-Smirnov con una
+//   probabilità minima. Le coppie di uno stesso evento condividono le particelle e non sono entrate
+//   indipendenti: sugli istogrammi delle coppie il test di Kolmogorov-Smirnov non è applicato e il
+//   chi quadro risulta leggermente più alto del valore atteso, da cui la soglia bassa di default;
+// - i parametri del picco della K* (massa, larghezza, resa) estratti come in analyze_invariant_mass
+//   (tutte le coppie e pione-kaone dopo la sottrazione delle coppie della stessa carica, prodotti di
+//   decadimento diretti) devono coincidere entro un numero massimo di deviazioni standard.
+// I due archivi devono venire da campioni indipendenti (semi diversi) con lo stesso numero di eventi.
+
+class EquivalenceChecker
+{
+public:
+  static constexpr double kDefaultMinProb = 1e-6; // Probabilità minima dei test sugli istogrammi (come RunMonitor)
+  static constexpr double kDefaultMaxPull = 5;    // Massima differenza dei parametri del fit in deviazioni standard
+
+  // Metodo per sapere se un istogramma è riempito con le coppie di particelle di un evento
+  // name: nome dell'istogramma (anche con il suffisso di un insieme di tagli o di una variazione)
+  static bool IsPairHistogram(const char *name);
+
+private:
+  double fMinProb; // Probabilità minima dei test sugli istogrammi
+  double fMaxPull; // Massima differenza dei parametri del fit in deviazioni standard
+
+public:
+  // Costruttore
+  // minProb: probabilità minima del chi quadro e di Kolmogorov-Smirnov
+  // maxPull: massima differenza dei parametri del fit della K* in deviazioni standard
+  EquivalenceChecker(double minProb = kDefaultMinProb, double maxPull = kDefaultMaxPull);
+
+  // Metodo per confrontare tutti gli istogrammi dei due archivi
+  // reference: archivio della configurazione di riferimento
+  // candidate: archivio della configurazione da verificare
+  // out: stream del resoconto (una riga per istogramma)
+  // return: numero di istogrammi non equivalenti, mancanti o in più
+  int CompareHistograms(const HistogramStore &reference, const HistogramStore &candidate, std::ostream &out) const;
+
+  // Metodo per confrontare i parametri del picco della K* estratti dai due archivi
+  // reference: archivio della configurazione di riferimento
+  // candidate: archivio della configurazione da verificare
+  // out: stream del resoconto (una riga per parametro)
+  // return: numero di parametri non compatibili o di fit non riusciti
+  int CompareSignal(const HistogramStore &reference, const HistogramStore &candidate, std::ostream &out) const;
+
+  // Metodo per eseguire entrambi i confronti e stampare l'esito complessivo
+  // return: true se le due configurazioni sono equivalenti
+  bool Check(const HistogramStore &reference, const HistogramStore &candidate, std::ostream &out) const;
+};
+
+#endif // EQUIVALENCECHECKER_H
@@ -0,0 +1,390 @@
+#include "EventGenerator.h"
+#include "DecayTable.h"
+#include "AllocationTracker.h"
+#include <chrono>
+#include <cmath>
+#include "TH1F.h"
+
+EventGenerator::EventGenerator(const GeneratorConfig &config, unsigned int seed, const SpeciesTable *species,
+                               const DecayTable *decays)
+    : fConfig(config), fSpecies(species ? species : &Particle::GetSpeciesTable()),
+      fDecays(decays ? decays : &Particle::GetDecayTable()),
+      fPrimaries(config.primaries, config.primaryType, config.abundance, config.nPrimaryTypes),
+      fRandom(seed), fValidator(1000, 0, 3), fNEvents(0), fNPrimaries(0), fNParticles(0), fNPairs(0),
+      fBusyNanoseconds(0), fSelection(config.selections), fPairMask(config.selections.size()),
+      fReweighter(config.primaries, config.primaryType, config.abundance, config.nPrimaryTypes, config.variations),
+      fSumWeights(config.variations.size()),
+      fSumWeights2(config.variations.size()), fCorrelations(config.mixingStride)
+{
+  // Un insieme di istogrammi per ogni insieme di tagli, con il nome dell'insieme come suffisso,
+  // e uno per ogni variazione dei parametri, riempito con i pesi per primaria (le coppie con il prodotto
+  // dei pesi delle due primarie di origine)
+  for (size_t cut = 0; cut < config.selections.size(); ++cut)
+    fHistograms.push_back(new HistogramSet(config.selections[cut].name));
+  for (size_t v = 0; v < config.variations.size(); ++v)
+    fHistograms.push_back(new HistogramSet(config.variations[v].name, true));
+
+  // Indici delle specie usate nella classificazione delle coppie, risolti una sola volta
+  // in fase di configurazione; il loop delle coppie legge solo la tabella piatta.
+  fPionPlus = Particle::FindParticleType("Pion+");
+  fPionMinus = Particle::FindParticleType("Pion-");
+  fKaonPlus = Particle::FindParticleType("Kaon+");
+  fKaonMinus = Particle::FindParticleType("Kaon-");
+
+  Reserve(fPrimaries.GetMultiplicityBound());
+}
+
+void EventGenerator::Reserve(int maxPrimaries)
+{
+  // Stessa capacità per evento di GenerateEvent: le primarie più i prodotti di decadimento
+  const int capacity = 3 * maxPrimaries;
+  fBatch.Reserve(maxPrimaries);
+  fParticles.resize(capacity);
+  fMother.resize(capacity);
+  const int nVariations = fReweighter.GetNVariations();
+  if (nVariations > 0)
+  {
+    fAncestor.resize(capacity);
+    fPrimaryWeights.resize(maxPrimaries * nVariations);
+    fParticleWeights.resize(capacity * nVariations);
+  }
+  fKinematics.Reserve(capacity);
+  fPairMasses.resize(capacity);
+  fSelection.Reserve(capacity);
+  if (fConfig.correlations)
+    fCorrelations.Reserve(capacity);
+  if (fConfig.validatePrecision)
+  {
+    fRefKinematics.Reserve(capacity);
+    fTestKinematics.Reserve(capacity);
+    fRefMasses.resize(capacity);
+    fTestMasses.resize(capacity);
+  }
+
+  // Le tabelle degli istogrammi sparsi non sono dimensionate qui: crescono per raddoppi con le celle
+  // effettivamente riempite, che per gli insiemi di tagli stretti restano molte meno di tutte le celle
+}
+
+EventGenerator::~EventGenerator()
+{
+  for (size_t cut = 0; cut < fHistograms.size(); ++cut)
+    delete fHistograms[cut];
+}
+
+void EventGenerator::Generate(int nEvents)
+{
+  std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+  for (int event = 0; event < nEvents; ++event)
+  {
+    // Dopo il riscaldamento i buffer per evento hanno raggiunto la dimensione di regime:
+    // le allocazioni rimaste sono contate (solo nelle build con AllocationTracker)
+    AllocationTracker::SetArmed(fConfig.allocationWarmUp >= 0 && fNEvents + event >= fConfig.allocationWarmUp);
+    GenerateEvent();
+
+    // Contatori di avanzamento pubblicati durante il blocco, senza lock
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    fBusyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+    last = now;
+    fMetrics.Update(fNEvents + event + 1, fNParticles, fNPairs, fBusyNanoseconds);
+  }
+  AllocationTracker::SetArmed(false);
+  fNEvents += nEvents;
+
+  // Trasferimento degli accumulatori nativi delle variazioni, così gli istogrammi sono completi tra un blocco e l'altro
+  for (size_t set = fSelection.GetNCuts(); set < fHistograms.size(); ++set)
+    fHistograms[set]->Flush();
+}
+
+void EventGenerator::GenerateEvent()
+{
+  const SpeciesTable &species = *fSpecies;
+  const DecayTable &decayTable = *fDecays;
+  AllocationStageScope stage(kAllocPrimaries);
+
+  // Numero di primarie secondo il modello di molteplicità e generazione in blocco della loro cinematica.
+  const int nPrimaries = fPrimaries.SampleMultiplicity(fRandom);
+  fPrimaries.Generate(fRandom, nPrimaries, fBatch);
+
+  fNPrimaries += nPrimaries;
+
+  // Capacità dell'evento: le primarie più un ampio margine per i prodotti di decadimento;
+  // i decadimenti oltre la capacità vengono scartati da DecayAll.
+  const int capacity = 3 * nPrimaries;
+  if ((int)fParticles.size() < capacity)
+  {
+    fParticles.resize(capacity);
+    fMother.resize(capacity);
+  }
+  const int nVariations = fReweighter.GetNVariations();
+  if (nVariations > 0 && (int)fAncestor.size() < capacity)
+  {
+    fAncestor.resize(capacity);
+    fPrimaryWeights.resize(nPrimaries * nVariations);
+    fParticleWeights.resize(capacity * nVariations);
+  }
+  Particle *particles = fParticles.data();
+  int *mother = fMother.data();
+
+  // Conta il numero di particelle totali nell'evento, inizialmente le primarie.
+  // Questo contatore aumenta con l'aggiunta di prodotti di decadimento.
+  int particleCount = nPrimaries;
+  for (int i = 0; i < nPrimaries; ++i)
+    mother[i] = -1;
+
+  // Loop sulle particelle primarie dell'evento.
+  for (int i = 0; i < nPrimaries; ++i)
+  {
+    // Imposta tipo e quantità di moto della particella generata.
+    particles[i].Set(fBatch.type[i], fBatch.px[i], fBatch.py[i], fBatch.pz[i]);
+
+    // I monitor controllano il generatore e ricevono tutte le primarie, senza tagli.
+    fMonitor.Fill(fBatch.type[i], fBatch.momentum[i], fBatch.phi[i], fBatch.polar[i]);
+  }
+
+  // Decadimento in blocco di tutte le risonanze dell'evento secondo la tabella dei canali.
+  // I prodotti sono aggiunti in coda all'array e le figlie instabili decadono a loro volta.
+  AllocationTracker::SetStage(kAllocDecays);
+  decayTable.DecayAll(particles, particleCount, capacity, mother, fRandom, species);
+
+  // Numero totale di particelle nell'evento, incluse quelle da decadimenti.
+  int totalParticles = particleCount;
+
+  // Pesi delle variazioni dei parametri: ogni particella eredita il peso della primaria da cui
+  // discende (le figlie seguono sempre la madre nell'array).
+  const int weightStride = (int)fAncestor.size();
+  AllocationTracker::SetStage(kAllocWeights);
+  if (nVariations > 0)
+  {
+    fReweighter.Compute(fBatch, fPrimaryWeights.data());
+    for (int i = 0; i < totalParticles; ++i)
+    {
+      const int ancestor = mother[i] == -1 ? i : fAncestor[mother[i]];
+      fAncestor[i] = ancestor;
+      for (int v = 0; v < nVariations; ++v)
+        fParticleWeights[v * weightStride + i] = fPrimaryWeights[ancestor * nVariations + v];
+    }
+    for (int i = 0; i < nPrimaries * nVariations; ++i)
+    {
+      fSumWeights[i % nVariations] += fPrimaryWeights[i];
+      fSumWeights2[i % nVariations] += fPrimaryWeights[i] * fPrimaryWeights[i];
+    }
+  }
+
+  // Cinematica in formato SoA e maschere di selezione delle particelle per tutti gli insiemi di tagli.
+  AllocationTracker::SetStage(kAllocSelection);
+  fKinematics.Load(particles, totalParticles);
+  fSelection.EvaluateParticles(fKinematics, particles);
+  const int nCuts = fSelection.GetNCuts();
+  if (fConfig.correlations)
+    fCorrelations.BeginEvent(fKinematics, particles);
+
+  // Riempimento degli istogrammi delle particelle di ogni insieme di tagli.
+  AllocationTracker::SetStage(kAllocParticleHistograms);
+  for (int cut = 0; cut < nCuts; ++cut)
+    FillParticles(*fHistograms[cut], fSelection.GetParticleMask(cut), nPrimaries, totalParticles, 0);
+  for (int v = 0; v < nVariations; ++v)
+    FillParticles(*fHistograms[nCuts + v], fSelection.GetParticleMask(0), nPrimaries, totalParticles,
+                  &fParticleWeights[v * weightStride]);
+
+  // Calcolo delle masse invarianti tra tutte le coppie di particelle dell'evento,
+  // una riga (i, j > i) alla volta.
+  AllocationTracker::SetStage(kAllocPairs);
+  if ((int)fPairMasses.size() < totalParticles)
+    fPairMasses.resize(totalParticles);
+  fNParticles += totalParticles;
+  fNPairs += NumPairs(totalParticles);
+
+  if (fConfig.validatePrecision)
+  {
+    fRefKinematics.Load(particles, totalParticles);
+    fTestKinematics.Load(particles, totalParticles);
+    if ((int)fRefMasses.size() < totalParticles)
+    {
+      fRefMasses.resize(totalParticles);
+      fTestMasses.resize(totalParticles);
+    }
+  }
+
+  for (int i = 0; i < totalParticles; ++i)
+  {
+    PairInvariantMassesRow(fKinematics, i, fPairMasses.data());
+    if (fConfig.validatePrecision)
+    {
+      PairInvariantMassesRow(fRefKinematics, i, fRefMasses.data());
+      PairInvariantMassesRow(fTestKinematics, i, fTestMasses.data());
+      fValidator.Fill(fRefMasses.data(), fTestMasses.data(), totalParticles - i - 1);
+    }
+
+    // Maschere della riga di coppie per tutti gli insiemi di tagli, in un solo passaggio.
+    fSelection.EvaluatePairRow(fKinematics, i, fPairMasses.data());
+    for (int cut = 0; cut < nCuts; ++cut)
+      fPairMask[cut] = fSelection.GetPairMask(cut);
+
+    // Correlazioni della stessa riga, con le masse e la maschera degli istogrammi principali.
+    if (fConfig.correlations)
+      fCorrelations.FillSameEventRow(i, fPairMasses.data(), fPairMask[0]);
+
+    const int typeI = particles[i].GetParticleTypeIndex();
+    for (int j = i + 1; j < totalParticles; ++j)
+    {
+      double invMass = fPairMasses[j - i - 1];
+
+      // Classificazione della coppia, fatta una sola volta per tutti gli insiemi di tagli.
+      int category = 0;
+      const int typeJ = particles[j].GetParticleTypeIndex();
+      if (typeI != -1 && typeJ != -1)
+      {
+        // Prodotto delle cariche letto dalla tabella piatta delle specie.
+        const int chargeProduct = species[typeI].charge * species[typeJ].charge;
+
+        // Coppie di carica opposta e della stessa carica.
+        if (chargeProduct < 0)
+          category |= kPairOppositeCharge;
+        if (chargeProduct > 0)
+          category |= kPairSameCharge;
+
+        // Coppie Pion+/Kaon- e Pion-/Kaon+.
+        const bool pionKaonOC = (typeI == fPionPlus && typeJ == fKaonMinus) ||
+                                (typeI == fPionMinus && typeJ == fKaonPlus);
+        if (pionKaonOC)
+          category |= kPairPionKaon;
+
+        // Coppie Pion+/Kaon+ e Pion-/Kaon-.
+        if ((typeI == fPionPlus && typeJ == fKaonPlus) ||
+            (typeI == fPionMinus && typeJ == fKaonMinus))
+          category |= kPairPionKaonSC;
+
+        // Prodotti di decadimento della stessa K*.
+        if (mother[i] != -1 && mother[i] == mother[j] && pionKaonOC)
+          category |= kPairDecayProducts;
+      }
+
+      // Massa, pT e rapidità della coppia per gli istogrammi a più dimensioni, solo per le coppie pione-kaone.
+      double pair[3] = {invMass, 0, 0};
+      if (category & (kPairPionKaon | kPairPionKaonSC))
+      {
+        const LorentzVector<double> total =
+            LorentzVector<double>(fKinematics.px[i], fKinematics.py[i], fKinematics.pz[i], fKinematics.e[i]) +
+            LorentzVector<double>(fKinematics.px[j], fKinematics.py[j], fKinematics.pz[j], fKinematics.e[j]);
+        pair[1] = total.Pt();
+        pair[2] = total.Rapidity();
+      }
+
+      for (int cut = 0; cut < nCuts; ++cut)
+      {
+        if (!fPairMask[cut] || fPairMask[cut][j - i - 1])
+          FillPair(*fHistograms[cut], pair, category);
+      }
+
+      // Variazioni dei parametri: stessa coppia, con i tagli degli istogrammi principali; il peso è
+      // il prodotto dei pesi delle due primarie di origine, o uno solo se l'origine è comune.
+      if (nVariations > 0 && (!fPairMask[0] || fPairMask[0][j - i - 1]))
+      {
+        const int massBin = HistogramSet::FindMassBin(invMass);
+        const bool common = fAncestor[i] == fAncestor[j];
+        for (int v = 0; v < nVariations; ++v)
+        {
+          const double *weights = &fParticleWeights[v * weightStride];
+          FillWeightedPair(*fHistograms[nCuts + v], massBin, pair, category,
+                           common ? weights[i] : weights[i] * weights[j]);
+        }
+      }
+    }
+  }
+
+  // Coppie mescolate con l'evento precedente per la normalizzazione delle correlazioni.
+  AllocationTracker::SetStage(kAllocCorrelations);
+  if (fConfig.correlations)
+    fCorrelations.EndEvent(fKinematics, fSelection);
+}
+
+void EventGenerator::FillParticles(HistogramSet &histograms, const unsigned char *mask, int nPrimaries, int totalParticles,
+                                   const double *weights)
+{
+  // Primarie: angoli e quantità di moto generati, senza ricalcolarli.
+  for (int i = 0; i < nPrimaries; ++i)
+  {
+    if (mask && !mask[i])
+      continue;
+    const double weight = weights ? weights[i] : 1;
+    double px = fBatch.px[i];
+    double py = fBatch.py[i];
+    histograms[kHParticleTypes]->Fill(fParticles[i].GetParticleTypeIndex(), weight);
+    histograms[kHAzimuthalAngle]->Fill(fBatch.phi[i], weight);
+    histograms[kHPolarAngle]->Fill(fBatch.theta[i], weight);
+    histograms[kHMomentum]->Fill(fBatch.momentum[i], weight);
+    histograms[kHTransverseMomentum]->Fill(sqrt(px * px + py * py), weight); // Momento trasversale
+    histograms[kHEnergy]->Fill(fParticles[i].GetEnergy(), weight);            // Energia totale
+  }
+
+  // Particelle aggiunte dopo i decadimenti.
+  for (int i = nPrimaries; i < totalParticles; ++i)
+  {
+    if (mask && !mask[i])
+      continue;
+    const double weight = weights ? weights[i] : 1;
+    histograms[kHParticleTypes]->Fill(fParticles[i].GetParticleTypeIndex(), weight);
+    const LorentzVector<double> momentum(fParticles[i].GetFourMomentum());
+    histograms[kHMomentum]->Fill(momentum.P(), weight);            // Quantità di moto
+    histograms[kHTransverseMomentum]->Fill(momentum.Pt(), weight); // Quantità di moto trasversale
+    histograms[kHEnergy]->Fill(momentum.E(), weight);              // Energia
+  }
+}
+
+void EventGenerator::FillPair(HistogramSet &histograms, const double *pair, int category)
+{
+  const double invMass = pair[0];
+
+  // Riempimento dell'istogramma per tutte le masse invarianti.
+  histograms[kHInvariantMass]->Fill(invMass);
+  if (category & kPairOppositeCharge)
+    histograms[kHInvMassOppositeCharge]->Fill(invMass);
+  if (category & kPairSameCharge)
+    histograms[kHInvMassSameCharge]->Fill(invMass);
+  if (category & kPairPionKaon)
+  {
+    const double massRapidity[2] = {invMass, pair[2]};
+    histograms[kHInvMassPionKaon]->Fill(invMass);
+    histograms.GetND(kHPionKaonMassPt)->Fill(pair);
+    histograms.GetND(kHPionKaonMassRapidity)->Fill(massRapidity);
+    histograms.GetND(kHPionKaonMassPtRapidity)->Fill(pair);
+  }
+  if (category & kPairPionKaonSC)
+  {
+    const double massRapidity[2] = {invMass, pair[2]};
+    histograms[kHInvMassPionKaonSC]->Fill(invMass);
+    histograms.GetND(kHPionKaonSCMassPt)->Fill(pair);
+    histograms.GetND(kHPionKaonSCMassRapidity)->Fill(massRapidity);
+    histograms.GetND(kHPionKaonSCMassPtRapidity)->Fill(pair);
+  }
+  if (category & kPairDecayProducts)
+    histograms[kHInvMassDecayProducts]->Fill(invMass);
+}
+
+void EventGenerator::FillWeightedPair(HistogramSet &histograms, int massBin, const double *pair, int category,
+                                      double weight)
+{
+  histograms.FillMassBin(kHInvariantMass, massBin, weight);
+  if (category & kPairOppositeCharge)
+    histograms.FillMassBin(kHInvMassOppositeCharge, massBin, weight);
+  if (category & kPairSameCharge)
+    histograms.FillMassBin(kHInvMassSameCharge, massBin, weight);
+  if (category & kPairPionKaon)
+  {
+    const double massRapidity[2] = {pair[0], pair[2]};
+    histograms.FillMassBin(kHInvMassPionKaon, massBin, weight);
+    histograms.GetND(kHPionKaonMassPt)->Fill(pair, weight);
+    histograms.GetND(kHPionKaonMassRapidity)->Fill(massRapidity, weight);
+    histograms.GetND(kHPionKaonMassPtRapidity)->Fill(pair, weight);
+  }
+  if (category & kPairPionKaonSC)
+  {
+    const double massRapidity[2] = {pair[0], pair[2]};
+    histograms.FillMassBin(kHInvMassPionKaonSC, massBin, weight);
+    histograms.GetND(kHPionKaonSCMassPt)->Fill(pair, weight);
+    histograms.GetND(kHPionKaonSCMassRapidity)->Fill(massRapidity, weight);
+    histograms.GetND(kHPionKaonSCMassPtRapidity)->Fill(pair, weight);
+  }
+  if (category & kPairDecayProducts)
+    histograms.FillMassBin(kHInvMassDecayProducts, massBin, weight);
+}
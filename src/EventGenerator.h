@@ -0,0 +1,163 @@
+#ifndef EVENTGENERATOR_H
+#define EVENTGENERATOR_H
+
+#include "Particle.h"
+#include "PairKernel.h"
+#include "HistogramSet.h"
+#include "RunMonitor.h"
+#include "PrecisionValidator.h"
+#include "PrimaryGenerator.h"
+#include "EventSelection.h"
+#include "EventReweighter.h"
+#include "PairCorrelations.h"
+#include "SpeciesTable.h"
+#include "RunMetrics.h"
+#include <vector>
+#include "TRandom3.h"
+
+class DecayTable;
+
+// Configurazione della generazione condivisa da tutti i thread
+struct GeneratorConfig
+{
+  int nPrimaryTypes;                                // Numero di specie primarie
+  int primaryType[SpeciesTable::kMaxSpecies];       // Indici delle specie primarie
+  double abundance[SpeciesTable::kMaxSpecies];      // Abbondanze delle specie primarie (somma 1)
+  bool validatePrecision;                           // Confronto delle masse invarianti in float e double
+  bool correlations;                                // Correlazioni (Δφ, Δη) e q_inv nel loop delle coppie
+  int mixingStride;                                 // Passo delle particelle usate nel mescolamento degli eventi
+  long long allocationWarmUp;                       // Eventi per thread prima del conteggio delle allocazioni
+                                                    // (AllocationTracker; -1: nessun conteggio)
+  PrimaryModel primaries;                           // Modelli di molteplicità e cinematica delle primarie
+  std::vector<SelectionCut> selections;             // Insiemi di tagli: il primo riempie gli istogrammi
+                                                    // principali, gli altri insiemi di istogrammi con nome
+  std::vector<ParameterVariation> variations;       // Variazioni dei parametri, ciascuna con un insieme di
+                                                    // istogrammi pesati (tagli degli istogrammi principali)
+};
+
+// Categorie di una coppia di particelle, combinabili, usate per scegliere gli istogrammi da riempire
+enum PairCategory
+{
+  kPairOppositeCharge = 1 << 0, // Carica opposta
+  kPairSameCharge = 1 << 1,     // Stessa carica
+  kPairPionKaon = 1 << 2,       // Pione-kaone di carica opposta
+  kPairPionKaonSC = 1 << 3,     // Pione-kaone della stessa carica
+  kPairDecayProducts = 1 << 4   // Figlie della stessa K*
+};
+
+// La classe EventGenerator genera eventi di collisione e riempie i propri istogrammi,
+// i propri accumulatori dei monitor e il proprio validatore di precisione.
+// Ogni thread di generazione usa un'istanza distinta con un seme distinto, quindi nessuno
+// stato viene condiviso durante la generazione; le tabelle statiche di Particle (o le loro
+// copie sul nodo NUMA del thread) sono solo lette. A parità di numero di thread e di suddivisione degli eventi il risultato
+// è riproducibile.
+
+class EventGenerator
+{
+private:
+  GeneratorConfig fConfig;                          // Configurazione della generazione
+  const SpeciesTable *fSpecies;                     // Tabella delle specie letta nel loop degli eventi
+  const DecayTable *fDecays;                        // Canali di decadimento letti nel loop degli eventi
+  PrimaryGenerator fPrimaries;                      // Generatore delle particelle primarie
+  int fPionPlus, fPionMinus, fKaonPlus, fKaonMinus; // Specie usate nella classificazione delle coppie
+  TRandom3 fRandom;                                 // Generatore di numeri casuali del thread
+  std::vector<HistogramSet *> fHistograms;          // Istogrammi del thread: uno per insieme di tagli,
+                                                    // poi uno per variazione dei parametri
+  MonitorAccumulator fMonitor;                      // Statistiche per i monitor
+  PrecisionValidator fValidator;                    // Confronto float/double delle masse invarianti
+  long long fNEvents;                               // Eventi generati
+  long long fNPrimaries;                            // Particelle primarie generate
+  long long fNParticles;                            // Particelle generate, inclusi i prodotti di decadimento
+  long long fNPairs;                                // Coppie processate dal kernel delle coppie
+  long long fBusyNanoseconds;                       // Tempo passato nella generazione degli eventi
+  WorkerMetrics fMetrics;                           // Contatori di avanzamento letti da RunMetrics
+  EventSelection fSelection;                        // Maschere di selezione degli insiemi di tagli
+  std::vector<const unsigned char *> fPairMask;     // Maschere della riga di coppie corrente, per insieme
+  EventReweighter fReweighter;                      // Pesi delle variazioni dei parametri
+  std::vector<double> fSumWeights, fSumWeights2;    // Somma dei pesi delle primarie e dei loro quadrati, per variazione
+  PairCorrelations fCorrelations;                   // Correlazioni a due particelle (se abilitate)
+
+  // Buffer dell'evento, riutilizzati tra un evento e l'altro; crescono fino alla
+  // molteplicità massima incontrata e poi non vengono più riallocati
+  PrimaryBatch fBatch;                          // Primarie generate in blocco
+  std::vector<Particle> fParticles;             // Particelle dell'evento
+  std::vector<int> fMother;                     // Indice della madre (-1 per le primarie)
+  std::vector<int> fAncestor;                   // Indice della primaria di origine (variazioni)
+  std::vector<double> fPrimaryWeights;          // Pesi delle primarie, [i * variazioni + v]
+  std::vector<double> fParticleWeights;         // Pesi delle particelle, [v * capacità + i]
+  EventSoA<Real> fKinematics;                   // Cinematica in formato SoA nella precisione selezionata
+  std::vector<Real> fPairMasses;                // Masse invarianti di una riga di coppie
+  EventSoA<double> fRefKinematics;              // Cinematica in precisione doppia (validazione)
+  EventSoA<float> fTestKinematics;              // Cinematica in precisione singola (validazione)
+  std::vector<double> fRefMasses;               // Masse in precisione doppia (validazione)
+  std::vector<float> fTestMasses;               // Masse in precisione singola (validazione)
+
+  // Metodo per allocare in anticipo i buffer dell'evento e le tabelle degli istogrammi sparsi,
+  // così che il loop degli eventi non allochi memoria
+  // maxPrimaries: molteplicità per cui dimensionare i buffer
+  void Reserve(int maxPrimaries);
+
+  // Metodo per generare un evento e riempire istogrammi e monitor
+  void GenerateEvent();
+
+  // Metodo per riempire gli istogrammi delle particelle di un insieme di tagli
+  // histograms: istogrammi dell'insieme
+  // mask: maschera delle particelle selezionate (nulla: tutte)
+  // nPrimaries: numero di primarie, all'inizio dell'array
+  // totalParticles: numero totale di particelle dell'evento
+  // weights: peso di ogni particella (nullo: tutti 1)
+  void FillParticles(HistogramSet &histograms, const unsigned char *mask, int nPrimaries, int totalParticles,
+                     const double *weights);
+
+  // Metodo per riempire gli istogrammi di massa invariante di una coppia
+  // histograms: istogrammi dell'insieme di tagli
+  // pair: massa invariante, pT e rapidità della coppia (pT e rapidità solo per le coppie pione-kaone)
+  // category: combinazione di PairCategory
+  static void FillPair(HistogramSet &histograms, const double *pair, int category);
+
+  // Metodo per riempire gli istogrammi di una coppia in un insieme pesato (variazioni dei parametri)
+  // histograms: istogrammi della variazione
+  // massBin: bin della massa invariante (HistogramSet::FindMassBin)
+  // pair: massa invariante, pT e rapidità della coppia
+  // category: combinazione di PairCategory
+  // weight: peso della coppia
+  static void FillWeightedPair(HistogramSet &histograms, int massBin, const double *pair, int category, double weight);
+
+public:
+  // Costruttore
+  // config: configurazione della generazione
+  // seed: seme del generatore di numeri casuali del thread
+  // species, decays: copie delle tabelle di Particle sul nodo NUMA del thread (nulle: quelle di Particle)
+  EventGenerator(const GeneratorConfig &config, unsigned int seed, const SpeciesTable *species = 0,
+                 const DecayTable *decays = 0);
+
+  // Il distruttore elimina gli istogrammi
+  ~EventGenerator();
+
+  EventGenerator(const EventGenerator &) = delete;
+  EventGenerator &operator=(const EventGenerator &) = delete;
+
+  // Metodo per generare un blocco di eventi
+  // nEvents: numero di eventi da generare
+  void Generate(int nEvents);
+
+  // Metodi per accedere ai risultati accumulati
+  // set: indice dell'insieme di istogrammi (0: istogrammi principali; poi gli insiemi di tagli
+  //      con nome e infine le variazioni dei parametri)
+  HistogramSet &GetHistograms(int set = 0) { return *fHistograms[set]; }
+  int GetNHistogramSets() const { return (int)fHistograms.size(); }
+  int GetNSelections() const { return fSelection.GetNCuts(); }
+  int GetNVariations() const { return fReweighter.GetNVariations(); }
+  double GetSumWeights(int variation) const { return fSumWeights[variation]; }
+  double GetSumWeights2(int variation) const { return fSumWeights2[variation]; }
+  const MonitorAccumulator &GetMonitor() const { return fMonitor; }
+  const PrecisionValidator &GetPrecisionValidator() const { return fValidator; }
+  const PairCorrelations &GetCorrelations() const { return fCorrelations; }
+  long long GetNEvents() const { return fNEvents; }
+  long long GetNPrimaries() const { return fNPrimaries; }
+  long long GetNParticles() const { return fNParticles; }
+  long long GetNPairs() const { return fNPairs; }
+  const WorkerMetrics &GetMetrics() const { return fMetrics; }
+};
+
+#endif // EVENTGENERATOR_H
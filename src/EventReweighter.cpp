@@ -0,0 +1,85 @@
+#include "EventReweighter.h"
+#include "Particle.h"
+#include "FastMath.h"
+#include <cmath>
+
+// Metodo per calcolare la normalizzazione dello spettro in k = mT - m
+// kinematics: modello cinematico (termico o Boltzmann)
+// m: massa della specie
+// t: temperatura
+// return: integrale di (k + m) e^(-k/T) o di (k + m)^2 e^(-k/T) su k in [0, ∞)
+static double ThermalNormalization(KinematicsModel kinematics, double m, double t)
+{
+  if (kinematics == kBoltzmannKinematics)
+    return 2 * t * t * t + 2 * m * t * t + m * m * t;
+  return t * t + m * t;
+}
+
+EventReweighter::EventReweighter(const PrimaryModel &model, const int *types, const double *abundance, int nTypes,
+                                 const std::vector<ParameterVariation> &variations)
+    : fNTypes(nTypes), fNVariations((int)variations.size()),
+      fThermal(model.kinematics == kThermalKinematics || model.kinematics == kBoltzmannKinematics),
+      fLogSlotWeight(variations.size() * nTypes), fSlopeCoefficient(variations.size())
+{
+  const SpeciesTable &species = Particle::GetSpeciesTable();
+  for (int s = 0; s < SpeciesTable::kMaxSpecies; ++s)
+    fSlot[s] = -1;
+  for (int k = 0; k < nTypes; ++k)
+  {
+    fSlot[types[k]] = k;
+    fMass[k] = species[types[k]].mass;
+  }
+
+  for (int v = 0; v < fNVariations; ++v)
+  {
+    const ParameterVariation &variation = variations[v];
+
+    // Abbondanze alternative rinormalizzate
+    double sum = 0;
+    for (int k = 0; k < nTypes; ++k)
+      sum += abundance[k] * variation.abundanceScale[k];
+
+    // Pendenza nominale: impulso medio 1 GeV/c per i modelli esponenziali, temperatura per quelli termici.
+    // Il rapporto delle densità per particella è (Z_n / Z_a) exp(-x (1/s_a - 1/s_n)).
+    const double nominal = fThermal ? model.temperature : 1.0;
+    const double alternative = nominal * variation.slopeScale;
+    fSlopeCoefficient[v] = 1 / alternative - 1 / nominal;
+    for (int k = 0; k < nTypes; ++k)
+    {
+      double logWeight = std::log(variation.abundanceScale[k] / sum);
+      if (fThermal)
+        logWeight += std::log(ThermalNormalization(model.kinematics, fMass[k], nominal) /
+                              ThermalNormalization(model.kinematics, fMass[k], alternative));
+      else
+        logWeight += std::log(nominal / alternative);
+      fLogSlotWeight[v * nTypes + k] = logWeight;
+    }
+  }
+}
+
+void EventReweighter::Compute(const PrimaryBatch &batch, double *weights) const
+{
+  const int nVariations = fNVariations;
+  if (nVariations == 0)
+    return;
+
+  // Logaritmi dei pesi di tutte le primarie e variazioni, poi un solo esponenziale in blocco
+  for (int i = 0; i < batch.n; ++i)
+  {
+    const int slot = fSlot[batch.type[i]];
+    double x;
+    if (fThermal)
+    {
+      // mT - m = pT^2 / (mT + m), senza cancellazioni per pT piccolo
+      const double pt2 = batch.px[i] * batch.px[i] + batch.py[i] * batch.py[i];
+      const double m = fMass[slot];
+      x = pt2 / (std::sqrt(pt2 + m * m) + m);
+    }
+    else
+      x = batch.momentum[i];
+    double *particleWeights = weights + i * nVariations;
+    for (int v = 0; v < nVariations; ++v)
+      particleWeights[v] = fLogSlotWeight[v * fNTypes + slot] - fSlopeCoefficient[v] * x;
+  }
+  FastMath::Exp(weights, weights, batch.n * nVariations);
+}
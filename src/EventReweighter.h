@@ -0,0 +1,67 @@
+#ifndef EVENTREWEIGHTER_H
+#define EVENTREWEIGHTER_H
+
+#include "PrimaryGenerator.h"
+#include "SpeciesTable.h"
+#include <string>
+#include <vector>
+
+// Insieme alternativo di parametri di generazione delle primarie, applicato come peso
+// per primaria invece che con una nuova simulazione
+struct ParameterVariation
+{
+  std::string name;                                  // Nome della variazione (suffisso degli istogrammi)
+  double abundanceScale[SpeciesTable::kMaxSpecies];  // Fattore sull'abbondanza di ogni specie primaria
+                                                     // (le abbondanze sono poi rinormalizzate)
+  double slopeScale;                                 // Fattore sulla pendenza dello spettro: impulso medio
+                                                     // per i modelli esponenziali, temperatura per quelli termici
+
+  ParameterVariation() : slopeScale(1)
+  {
+    for (int k = 0; k < SpeciesTable::kMaxSpecies; ++k)
+      abundanceScale[k] = 1;
+  }
+};
+
+// La classe EventReweighter calcola per ogni evento il vettore dei pesi di ogni variazione dei
+// parametri: per ogni primaria, il rapporto tra la probabilità di specie e spettro con i parametri
+// alternativi e quella con i parametri nominali con cui è stata effettivamente generata.
+// Le primarie sono generate indipendentemente, quindi una distribuzione di singole particelle si
+// ripesa con il peso della particella (o della primaria da cui discende) e una distribuzione di
+// coppie con il prodotto dei pesi delle due primarie di origine (un solo peso se coincidono).
+// Il peso dell'intero evento, prodotto di tutti i pesi, darebbe lo stesso valore atteso con una
+// varianza enormemente maggiore. La variabile dello spettro è |p| per i modelli esponenziali e
+// mT - m per quelli termici; molteplicità e variabili angolari non cambiano.
+
+class EventReweighter
+{
+private:
+  int fNTypes;                                  // Numero di specie primarie
+  int fNVariations;                             // Numero di variazioni
+  bool fThermal;                                // Spettro termico (variabile mT - m) o esponenziale (|p|)
+  int fSlot[SpeciesTable::kMaxSpecies];         // Posizione tra le primarie di ogni specie (-1 se assente)
+  double fMass[SpeciesTable::kMaxSpecies];      // Masse delle specie primarie
+  std::vector<double> fLogSlotWeight;           // Logaritmo del peso per particella di ogni specie, per variazione
+  std::vector<double> fSlopeCoefficient;        // Coefficiente della variabile dello spettro, per variazione
+
+public:
+  // Costruttore
+  // model: modello nominale delle primarie
+  // types: indici delle specie primarie
+  // abundance: abbondanze nominali (somma 1)
+  // nTypes: numero di specie primarie
+  // variations: variazioni dei parametri
+  EventReweighter(const PrimaryModel &model, const int *types, const double *abundance, int nTypes,
+                  const std::vector<ParameterVariation> &variations);
+
+  // Metodo per ottenere il numero di variazioni
+  int GetNVariations() const { return fNVariations; }
+
+  // Metodo per calcolare i pesi delle primarie dell'evento
+  // batch: primarie dell'evento
+  // weights: peso di ogni primaria per ogni variazione, weights[i * GetNVariations() + v]
+  //          (batch.n * GetNVariations() valori)
+  void Compute(const PrimaryBatch &batch, double *weights) const;
+};
+
+#endif // EVENTREWEIGHTER_H
@@ -0,0 +1,257 @@
+#include "EventSelection.h"
+#include "FastMath.h"
+#include <cmath>
+#include <cstring>
+
+EventSelection::EventSelection(const std::vector<SelectionCut> &cuts)
+    : fCuts(cuts), fParticleVariables(0), fPairVariables(0),
+      fParticleMask(cuts.size()), fPairMask(cuts.size())
+{
+  for (size_t c = 0; c < fCuts.size(); ++c)
+  {
+    for (int v = 0; v < kNParticleVariables; ++v)
+    {
+      if (fCuts[c].particle.UsesVariable(v))
+        fParticleVariables |= 1u << v;
+    }
+    for (int v = 0; v < kNPairVariables; ++v)
+    {
+      if (fCuts[c].pair.UsesVariable(v))
+        fPairVariables |= 1u << v;
+    }
+  }
+  for (int v = 0; v < kNParticleVariables; ++v)
+    fParticlePointers[v] = 0;
+  for (int v = 0; v < kNPairVariables; ++v)
+    fPairPointers[v] = 0;
+}
+
+void EventSelection::Reserve(int n)
+{
+  if ((int)fWork.size() < n)
+  {
+    fWork.resize(n);
+    for (size_t c = 0; c < fCuts.size(); ++c)
+    {
+      fParticleMask[c].resize(n);
+      fPairMask[c].resize(n);
+    }
+    for (int v = 0; v < kNParticleVariables; ++v)
+    {
+      if ((fParticleVariables >> v) & 1u)
+        fParticleColumns[v].resize(n);
+    }
+    for (int v = 0; v < kNPairVariables; ++v)
+    {
+      if ((fPairVariables >> v) & 1u)
+        fPairColumns[v].resize(n);
+    }
+  }
+  if ((int)fMixedMask.size() < n)
+    fMixedMask.resize(n);
+}
+
+void EventSelection::EvaluateParticles(const EventSoA<Real> &ev, const Particle *particles)
+{
+  const int n = ev.n;
+
+  // Buffer dimensionati sulla molteplicità massima incontrata
+  if ((int)fWork.size() < n)
+    Reserve(n);
+  for (int v = 0; v < kNParticleVariables; ++v)
+    fParticlePointers[v] = fParticleColumns[v].data();
+  for (int v = 0; v < kNPairVariables; ++v)
+    fPairPointers[v] = fPairColumns[v].data();
+  if (fParticleVariables == 0)
+  {
+    for (size_t c = 0; c < fCuts.size(); ++c)
+    {
+      if (!fCuts[c].particle.IsEmpty())
+        fCuts[c].particle.Evaluate(fParticlePointers, n, fParticleMask[c].data());
+    }
+    return;
+  }
+
+  // Calcolo delle sole variabili usate dalle espressioni, una colonna alla volta
+  const Real *px = ev.px.data();
+  const Real *py = ev.py.data();
+  const Real *pz = ev.pz.data();
+  const Real *e = ev.e.data();
+  const unsigned used = fParticleVariables;
+  double *work = fWork.data();
+  if (used & ((1u << kVarPt) | (1u << kVarTheta)))
+  {
+    double *pt = fParticleColumns[kVarPt].empty() ? work : fParticleColumns[kVarPt].data();
+    for (int i = 0; i < n; ++i)
+      pt[i] = std::sqrt(LorentzVector<double>::TransverseMomentum2(px[i], py[i]));
+    if (used & (1u << kVarTheta))
+    {
+      double *theta = fParticleColumns[kVarTheta].data();
+      for (int i = 0; i < n; ++i)
+        theta[i] = std::atan2(pt[i], (double)pz[i]);
+    }
+  }
+  if (used & ((1u << kVarMomentum) | (1u << kVarEta)))
+  {
+    double *p = fParticleColumns[kVarMomentum].empty() ? work : fParticleColumns[kVarMomentum].data();
+    for (int i = 0; i < n; ++i)
+      p[i] = std::sqrt(LorentzVector<double>::Momentum2(px[i], py[i], pz[i]));
+    if (used & (1u << kVarEta))
+    {
+      double *eta = fParticleColumns[kVarEta].data();
+      for (int i = 0; i < n; ++i)
+        eta[i] = LorentzVector<double>::RapidityRatio(p[i], pz[i]);
+      FastMath::Log(eta, eta, n);
+      for (int i = 0; i < n; ++i)
+        eta[i] *= 0.5;
+    }
+  }
+  if (used & (1u << kVarRapidity))
+  {
+    double *y = fParticleColumns[kVarRapidity].data();
+    for (int i = 0; i < n; ++i)
+      y[i] = LorentzVector<double>::RapidityRatio(e[i], pz[i]);
+    FastMath::Log(y, y, n);
+    for (int i = 0; i < n; ++i)
+      y[i] *= 0.5;
+  }
+  if (used & (1u << kVarPhi))
+  {
+    // Angolo azimutale riportato in [0, 2π), come nella generazione
+    double *phi = fParticleColumns[kVarPhi].data();
+    for (int i = 0; i < n; ++i)
+    {
+      double angle = std::atan2((double)py[i], (double)px[i]);
+      phi[i] = angle + 2 * M_PI * (angle < 0);
+    }
+  }
+  if (used & (1u << kVarEnergy))
+  {
+    double *energy = fParticleColumns[kVarEnergy].data();
+    for (int i = 0; i < n; ++i)
+      energy[i] = e[i];
+  }
+  if (used & ((1u << kVarMass) | (1u << kVarCharge)))
+  {
+    const SpeciesTable &species = Particle::GetSpeciesTable();
+    for (int i = 0; i < n; ++i)
+    {
+      const SpeciesProperties &properties = species[particles[i].GetParticleTypeIndex()];
+      if (used & (1u << kVarMass))
+        fParticleColumns[kVarMass][i] = properties.mass;
+      if (used & (1u << kVarCharge))
+        fParticleColumns[kVarCharge][i] = properties.charge;
+    }
+  }
+
+  for (size_t c = 0; c < fCuts.size(); ++c)
+  {
+    if (!fCuts[c].particle.IsEmpty())
+      fCuts[c].particle.Evaluate(fParticlePointers, n, fParticleMask[c].data());
+  }
+}
+
+void EventSelection::ComputePairColumns(const EventSoA<Real> &ev, int first, const Real *px, const Real *py,
+                                        const Real *pz, const Real *e, int count, const Real *masses)
+{
+  // Variabili delle coppie della riga, calcolate solo se qualche taglio le usa
+  const unsigned used = fPairVariables;
+  if (used & (1u << kVarPairMass))
+  {
+    double *m = fPairColumns[kVarPairMass].data();
+    for (int j = 0; j < count; ++j)
+      m[j] = masses[j];
+  }
+  if (used & ((1u << kVarPairPt) | (1u << kVarPairRapidity)))
+  {
+    const double pxi = ev.px[first], pyi = ev.py[first], pzi = ev.pz[first], ei = ev.e[first];
+    if (used & (1u << kVarPairPt))
+    {
+      double *pt = fPairColumns[kVarPairPt].data();
+      for (int j = 0; j < count; ++j)
+      {
+        pt[j] = std::sqrt(LorentzVector<double>::TransverseMomentum2(pxi + px[j], pyi + py[j]));
+      }
+    }
+    if (used & (1u << kVarPairRapidity))
+    {
+      double *y = fPairColumns[kVarPairRapidity].data();
+      for (int j = 0; j < count; ++j)
+      {
+        y[j] = LorentzVector<double>::RapidityRatio(ei + e[j], pzi + pz[j]);
+      }
+      FastMath::Log(y, y, count);
+      for (int j = 0; j < count; ++j)
+        y[j] *= 0.5;
+    }
+  }
+}
+
+void EventSelection::EvaluatePairRow(const EventSoA<Real> &ev, int i, const Real *masses)
+{
+  const int count = ev.n - i - 1;
+  if (count <= 0)
+    return;
+
+  ComputePairColumns(ev, i, ev.px.data() + i + 1, ev.py.data() + i + 1, ev.pz.data() + i + 1, ev.e.data() + i + 1,
+                     count, masses);
+
+  for (size_t c = 0; c < fCuts.size(); ++c)
+  {
+    SelectionCut &cut = fCuts[c];
+    if (cut.IsEmpty())
+      continue;
+    unsigned char *row = fPairMask[c].data();
+    const unsigned char *particleMask = cut.particle.IsEmpty() ? 0 : fParticleMask[c].data();
+    if (particleMask && !particleMask[i])
+    {
+      std::memset(row, 0, count);
+      continue;
+    }
+    cut.pair.Evaluate(fPairPointers, count, row);
+    if (particleMask)
+    {
+      const unsigned char *partner = particleMask + i + 1;
+      for (int j = 0; j < count; ++j)
+        row[j] &= partner[j];
+    }
+  }
+}
+
+const unsigned char *EventSelection::EvaluateMixedRow(int cut, const EventSoA<Real> &ev, int i,
+                                                      const EventSoA<Real> &partners,
+                                                      const unsigned char *partnerMask, const Real *masses)
+{
+  SelectionCut &selection = fCuts[cut];
+  if (selection.IsEmpty())
+    return 0;
+  const int count = partners.n;
+
+  // Maschera e colonne dimensionate anche sulla molteplicità dell'altro evento
+  if ((int)fMixedMask.size() < count)
+    fMixedMask.resize(count);
+  for (int v = 0; v < kNPairVariables; ++v)
+  {
+    if (((fPairVariables >> v) & 1u) && (int)fPairColumns[v].size() < count)
+    {
+      fPairColumns[v].resize(count);
+      fPairPointers[v] = fPairColumns[v].data();
+    }
+  }
+  unsigned char *row = fMixedMask.data();
+  if (!selection.particle.IsEmpty() && !fParticleMask[cut][i])
+  {
+    std::memset(row, 0, count);
+    return row;
+  }
+
+  ComputePairColumns(ev, i, partners.px.data(), partners.py.data(), partners.pz.data(), partners.e.data(), count,
+                     masses);
+  selection.pair.Evaluate(fPairPointers, count, row);
+  if (partnerMask)
+  {
+    for (int j = 0; j < count; ++j)
+      row[j] &= partnerMask[j];
+  }
+  return row;
+}
@@ -0,0 +1,105 @@
+#ifndef EVENTSELECTION_H
+#define EVENTSELECTION_H
+
+#include "SelectionExpression.h"
+#include "PairKernel.h"
+#include <string>
+#include <vector>
+
+// Insieme di tagli con nome: taglio sulle particelle e taglio sulle coppie.
+// Una coppia è selezionata se entrambe le particelle passano il taglio sulle particelle
+// e la coppia passa il taglio sulle coppie.
+struct SelectionCut
+{
+  std::string name;             // Nome dell'insieme (vuoto per gli istogrammi principali)
+  SelectionExpression particle; // Taglio sulle particelle (vuoto: tutte)
+  SelectionExpression pair;     // Taglio sulle coppie (vuoto: tutte)
+
+  // Metodo per sapere se l'insieme accetta tutto
+  bool IsEmpty() const { return particle.IsEmpty() && pair.IsEmpty(); }
+};
+
+// La classe EventSelection valuta in un solo passaggio per evento tutti gli insiemi di tagli:
+// le variabili usate dalle espressioni sono calcolate una sola volta in colonne (SoA),
+// poi ogni espressione produce la propria maschera. Le maschere delle coppie sono prodotte
+// una riga (i, j > i) alla volta, come le masse invarianti del kernel delle coppie.
+
+class EventSelection
+{
+private:
+  std::vector<SelectionCut> fCuts;                            // Insiemi di tagli
+  unsigned fParticleVariables;                                // Variabili delle particelle usate
+  unsigned fPairVariables;                                    // Variabili delle coppie usate
+  std::vector<double> fParticleColumns[kNParticleVariables];  // Variabili delle particelle dell'evento
+  std::vector<double> fPairColumns[kNPairVariables];          // Variabili delle coppie della riga corrente
+  const double *fParticlePointers[kNParticleVariables];       // Puntatori alle colonne delle particelle
+  const double *fPairPointers[kNPairVariables];               // Puntatori alle colonne delle coppie
+  std::vector<std::vector<unsigned char> > fParticleMask;     // Maschere delle particelle, per insieme
+  std::vector<std::vector<unsigned char> > fPairMask;         // Maschere della riga di coppie, per insieme
+  std::vector<unsigned char> fMixedMask;                      // Maschera della riga di coppie tra eventi diversi
+  std::vector<double> fWork;                                  // Buffer di lavoro
+
+  // Metodo per calcolare le variabili usate dai tagli sulle coppie formate da una particella
+  // e da un array di partner
+  // first: indice della prima particella in ev
+  // px, py, pz, e: cinematica dei partner
+  // count: numero di partner
+  // masses: masse invarianti delle coppie
+  void ComputePairColumns(const EventSoA<Real> &ev, int first, const Real *px, const Real *py, const Real *pz,
+                          const Real *e, int count, const Real *masses);
+
+public:
+  // Costruttore
+  // cuts: insiemi di tagli già compilati
+  EventSelection(const std::vector<SelectionCut> &cuts);
+
+  // Metodo per ottenere il numero di insiemi di tagli
+  int GetNCuts() const { return (int)fCuts.size(); }
+
+  // Metodo per accedere a un insieme di tagli
+  const SelectionCut &GetCut(int cut) const { return fCuts[cut]; }
+
+  // Metodo per allocare maschere e colonne per eventi (ed eventi mescolati) fino a n particelle;
+  // la capacità non diminuisce mai
+  void Reserve(int n);
+
+  // Metodo per calcolare le maschere delle particelle di tutti gli insiemi
+  // ev: cinematica dell'evento
+  // particles: particelle dell'evento (per massa e carica)
+  void EvaluateParticles(const EventSoA<Real> &ev, const Particle *particles);
+
+  // Metodo per calcolare le maschere di una riga di coppie (i, j > i) di tutti gli insiemi,
+  // combinando il taglio sulle coppie con le maschere delle particelle i e j
+  // ev: cinematica dell'evento
+  // i: indice della prima particella
+  // masses: masse invarianti della riga, calcolate dal kernel delle coppie
+  void EvaluatePairRow(const EventSoA<Real> &ev, int i, const Real *masses);
+
+  // Metodo per calcolare la maschera di una riga di coppie tra eventi diversi per un insieme di tagli
+  // (mescolamento degli eventi): la particella i dell'evento corrente con tutte le particelle di un altro evento
+  // cut: indice dell'insieme di tagli
+  // ev: cinematica dell'evento corrente (con maschere delle particelle già calcolate)
+  // i: indice della prima particella
+  // partners: cinematica dell'altro evento
+  // partnerMask: maschera delle particelle dell'altro evento per lo stesso insieme (nulla: tutte)
+  // masses: masse invarianti della riga (PairInvariantMassesCross)
+  // return: maschera della riga, o puntatore nullo se l'insieme accetta tutte le coppie
+  const unsigned char *EvaluateMixedRow(int cut, const EventSoA<Real> &ev, int i, const EventSoA<Real> &partners,
+                                        const unsigned char *partnerMask, const Real *masses);
+
+  // Metodo per accedere alla maschera delle particelle di un insieme
+  // return: maschera, o puntatore nullo se l'insieme accetta tutte le particelle
+  const unsigned char *GetParticleMask(int cut) const
+  {
+    return fCuts[cut].particle.IsEmpty() ? 0 : fParticleMask[cut].data();
+  }
+
+  // Metodo per accedere alla maschera della riga di coppie di un insieme (indice j - i - 1)
+  // return: maschera, o puntatore nullo se l'insieme accetta tutte le coppie
+  const unsigned char *GetPairMask(int cut) const
+  {
+    return fCuts[cut].IsEmpty() ? 0 : fPairMask[cut].data();
+  }
+};
+
+#endif // EVENTSELECTION_H
@@ -0,0 +1,49 @@
+#include "FastMath.h"
+
+// Approssimazioni polinomiali attive di default
+bool FastMath::fEnabled = true;
+
+void FastMath::SinCos(const double *x, double *s, double *c, int n)
+{
+  if (fEnabled)
+  {
+    for (int i = 0; i < n; ++i)
+      FastSinCos(x[i], s[i], c[i]);
+  }
+  else
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      s[i] = std::sin(x[i]);
+      c[i] = std::cos(x[i]);
+    }
+  }
+}
+
+void FastMath::Exp(const double *x, double *y, int n)
+{
+  if (fEnabled)
+  {
+    for (int i = 0; i < n; ++i)
+      y[i] = FastExp(x[i]);
+  }
+  else
+  {
+    for (int i = 0; i < n; ++i)
+      y[i] = std::exp(x[i]);
+  }
+}
+
+void FastMath::Log(const double *x, double *y, int n)
+{
+  if (fEnabled)
+  {
+    for (int i = 0; i < n; ++i)
+      y[i] = FastLog(x[i]);
+  }
+  else
+  {
+    for (int i = 0; i < n; ++i)
+      y[i] = std::log(x[i]);
+  }
+}
@@ -0,0 +1,169 @@
+#include "HistogramComparison.h"
+#include "HistogramFitter.h"
+#include <cmath>
+
+// Metodo per aggiungere byte all'impronta FNV-1a
+static uint64_t Fnv1a(uint64_t hash, const void *data, uint64_t size)
+{
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (uint64_t k = 0; k < size; ++k)
+  {
+    hash ^= bytes[k];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t HistogramComparison::Checksum(const HistogramStore &store, const HistogramStoreEntry &entry)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  hash = Fnv1a(hash, store.GetSumw(entry), entry.nCells * sizeof(double));
+  const double *sumw2 = store.GetSumw2(entry);
+  if (sumw2)
+    hash = Fnv1a(hash, sumw2, entry.nCells * sizeof(double));
+  return Fnv1a(hash, &entry.entries, sizeof(entry.entries));
+}
+
+bool HistogramComparison::SameBinning(const HistogramStoreEntry &a, const HistogramStoreEntry &b)
+{
+  if (a.nDim != b.nDim || a.nCells != b.nCells)
+    return false;
+  for (int d = 0; d < a.nDim; ++d)
+  {
+    if (a.nBins[d] != b.nBins[d] || a.min[d] != b.min[d] || a.max[d] != b.max[d])
+      return false;
+  }
+  return true;
+}
+
+bool HistogramComparison::Chi2Test(const HistogramStore &storeA, const HistogramStoreEntry &a,
+                                   const HistogramStore &storeB, const HistogramStoreEntry &b,
+                                   ComparisonResult &result)
+{
+  if (!SameBinning(a, b))
+    return false;
+  const double *sumwA = storeA.GetSumw(a), *sumw2A = storeA.GetSumw2(a);
+  const double *sumwB = storeB.GetSumw(b), *sumw2B = storeB.GetSumw2(b);
+  result.chi2 = 0;
+  result.ndf = 0;
+  for (uint64_t cell = 0; cell < a.nCells; ++cell)
+  {
+    const double variance = (sumw2A ? sumw2A[cell] : sumwA[cell]) + (sumw2B ? sumw2B[cell] : sumwB[cell]);
+    if (!(variance > 0))
+      continue;
+    const double difference = sumwA[cell] - sumwB[cell];
+    result.chi2 += difference * difference / variance;
+    ++result.ndf;
+  }
+  result.prob = result.ndf > 0 ? HistogramFitter::Prob(result.chi2, result.ndf) : 1;
+  return true;
+}
+
+bool HistogramComparison::KolmogorovTest(const HistogramStore &storeA, const HistogramStoreEntry &a,
+                                         const HistogramStore &storeB, const HistogramStoreEntry &b,
+                                         KolmogorovResult &result)
+{
+  if (a.nDim != 1 || !SameBinning(a, b))
+    return false;
+  const double *sumwA = storeA.GetSumw(a), *sumw2A = storeA.GetSumw2(a);
+  const double *sumwB = storeB.GetSumw(b), *sumw2B = storeB.GetSumw2(b);
+
+  // Integrali e somme dei pesi al quadrato nell'intervallo (underflow e overflow esclusi)
+  const int nBins = a.nBins[0];
+  double sumA = 0, sumB = 0, sum2A = 0, sum2B = 0;
+  for (int bin = 1; bin <= nBins; ++bin)
+  {
+    sumA += sumwA[bin];
+    sumB += sumwB[bin];
+    sum2A += sumw2A ? sumw2A[bin] : sumwA[bin];
+    sum2B += sumw2B ? sumw2B[bin] : sumwB[bin];
+  }
+  result.distance = 0;
+  if (!(sumA > 0) || !(sumB > 0))
+  {
+    result.prob = sumA == sumB ? 1 : 0;
+    return true;
+  }
+
+  double cumulativeA = 0, cumulativeB = 0;
+  for (int bin = 1; bin <= nBins; ++bin)
+  {
+    cumulativeA += sumwA[bin] / sumA;
+    cumulativeB += sumwB[bin] / sumB;
+    result.distance = std::fmax(result.distance, std::fabs(cumulativeA - cumulativeB));
+  }
+  const double entriesA = sum2A > 0 ? sumA * sumA / sum2A : sumA;
+  const double entriesB = sum2B > 0 ? sumB * sumB / sum2B : sumB;
+  result.prob = KolmogorovProb(result.distance * std::sqrt(entriesA * entriesB / (entriesA + entriesB)));
+  return true;
+}
+
+double HistogramComparison::KolmogorovProb(double z)
+{
+  if (z < 0.2)
+    return 1;
+  if (z < 0.755)
+  {
+    // Serie per piccoli z: P = 1 - sqrt(2π)/z Σ exp(-(2j - 1)^2 π^2 / (8 z^2))
+    const double v = std::exp(-M_PI * M_PI / (8 * z * z));
+    const double v8 = std::pow(v, 8);
+    return 1 - std::sqrt(2 * M_PI) / z * (v + std::pow(v, 9) + std::pow(v8, 3) * v + std::pow(v8, 6) * v);
+  }
+  if (z >= 6.8116)
+    return 0;
+  // Serie alternata per grandi z: P = 2 Σ (-1)^(j-1) exp(-2 j^2 z^2)
+  double sum = 0;
+  for (int j = 1; j <= 4; ++j)
+    sum += (j % 2 ? 2 : -2) * std::exp(-2.0 * j * j * z * z);
+  return sum;
+}
+
+// Metodo per calcolare la frazione continua della funzione beta incompleta (algoritmo di Lentz)
+static double BetaContinuedFraction(double a, double b, double x)
+{
+  const double tiny = 1e-300, epsilon = 1e-15;
+  double c = 1;
+  double d = 1 - (a + b) * x / (a + 1);
+  d = 1 / (std::fabs(d) < tiny ? tiny : d);
+  double fraction = d;
+  for (int m = 1; m < 1000; ++m)
+  {
+    // Termine pari
+    double numerator = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+    d = 1 + numerator * d;
+    d = 1 / (std::fabs(d) < tiny ? tiny : d);
+    c = 1 + numerator / c;
+    c = std::fabs(c) < tiny ? tiny : c;
+    fraction *= d * c;
+    // Termine dispari
+    numerator = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+    d = 1 + numerator * d;
+    d = 1 / (std::fabs(d) < tiny ? tiny : d);
+    c = 1 + numerator / c;
+    c = std::fabs(c) < tiny ? tiny : c;
+    const double delta = d * c;
+    fraction *= delta;
+    if (std::fabs(delta - 1) < epsilon)
+      break;
+  }
+  return fraction;
+}
+
+double HistogramComparison::StudentProb(double t, int ndf)
+{
+  if (ndf <= 0)
+    return 0;
+  if (t == 0)
+    return 1;
+
+  // Funzione beta incompleta regolarizzata I_x(ν/2, 1/2) con x = ν / (ν + t^2)
+  const double a = 0.5 * ndf, b = 0.5;
+  const double x = ndf / (ndf + t * t);
+  if (!(x > 0))
+    return 0;
+  const double logPrefactor =
+      std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log1p(-x);
+  if (x < (a + 1) / (a + b + 2))
+    return std::exp(logPrefactor) * BetaContinuedFraction(a, b, x) / a;
+  return 1 - std::exp(logPrefactor) * BetaContinuedFraction(b, a, 1 - x) / b;
+}
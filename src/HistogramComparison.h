@@ -0,0 +1,76 @@
+#ifndef HISTOGRAMCOMPARISON_H
+#define HISTOGRAMCOMPARISON_H
+
+#include "HistogramStore.h"
+#include <cstdint>
+
+// Esito del confronto statistico di due istogrammi
+struct ComparisonResult
+{
+  double chi2; // Chi quadro delle differenze bin per bin
+  int ndf;     // Gradi di libertà (celle non vuote in almeno uno dei due istogrammi)
+  double prob; // Probabilità del chi quadro
+};
+
+// Esito del test di Kolmogorov-Smirnov di due istogrammi a una dimensione
+struct KolmogorovResult
+{
+  double distance; // Massima distanza tra le distribuzioni cumulative normalizzate
+  double prob;     // Probabilità di Kolmogorov
+};
+
+// La classe HistogramComparison confronta istogrammi di due archivi nativi (HistogramStore),
+// direttamente sugli array di bin mappati in memoria:
+// - Checksum riassume contenuto, somme dei pesi al quadrato e numero di riempimenti in un valore
+//   a 64 bit (FNV-1a sui byte), per i confronti esatti;
+// - Chi2Test confronta due istogrammi con la stessa binnatura e lo stesso numero di eventi:
+//   χ² = Σ (w1 - w2)^2 / (σ1^2 + σ2^2) sulle celle non vuote, underflow e overflow inclusi,
+//   con σ^2 la somma dei pesi al quadrato (o il contenuto se assente);
+// - KolmogorovTest confronta la forma di due istogrammi a una dimensione con la stessa binnatura
+//   (bin nell'intervallo, come TH1::KolmogorovTest): la distanza massima D tra le cumulative
+//   normalizzate dà la probabilità di Kolmogorov di z = D sqrt(n1 n2 / (n1 + n2)), con n1 e n2
+//   i numeri di entrate efficaci (Σw)^2 / Σw^2. Sui dati binnati la probabilità è conservativa;
+// - StudentProb dà la probabilità bilaterale della t di Student, per confrontare le medie di due
+//   campioni di blocchi indipendenti con la varianza stimata dai blocchi stessi.
+
+class HistogramComparison
+{
+public:
+  // Metodo per calcolare l'impronta di un istogramma
+  // store: archivio dell'istogramma
+  // entry: voce dell'indice
+  // return: impronta di contenuto, errori e riempimenti
+  static uint64_t Checksum(const HistogramStore &store, const HistogramStoreEntry &entry);
+
+  // Metodo per sapere se due istogrammi hanno la stessa binnatura
+  static bool SameBinning(const HistogramStoreEntry &a, const HistogramStoreEntry &b);
+
+  // Metodo per confrontare due istogrammi con il test del chi quadro
+  // storeA, a: primo istogramma e suo archivio
+  // storeB, b: secondo istogramma e suo archivio
+  // result: esito del confronto
+  // return: false se le binnature sono diverse
+  static bool Chi2Test(const HistogramStore &storeA, const HistogramStoreEntry &a, const HistogramStore &storeB,
+                       const HistogramStoreEntry &b, ComparisonResult &result);
+
+  // Metodo per confrontare due istogrammi a una dimensione con il test di Kolmogorov-Smirnov
+  // storeA, a: primo istogramma e suo archivio
+  // storeB, b: secondo istogramma e suo archivio
+  // result: esito del confronto
+  // return: false se gli istogrammi non sono a una dimensione o le binnature sono diverse
+  static bool KolmogorovTest(const HistogramStore &storeA, const HistogramStoreEntry &a, const HistogramStore &storeB,
+                             const HistogramStoreEntry &b, KolmogorovResult &result);
+
+  // Metodo per calcolare la probabilità di Kolmogorov (equivalente a TMath::KolmogorovProb)
+  // z: distanza scalata
+  // return: probabilità che la distanza superi z per distribuzioni uguali
+  static double KolmogorovProb(double z);
+
+  // Metodo per calcolare la probabilità bilaterale della t di Student (equivalente a 2 * TMath::StudentI(-|t|, ndf))
+  // t: valore della variabile
+  // ndf: gradi di libertà
+  // return: probabilità che |t| superi il valore per medie uguali
+  static double StudentProb(double t, int ndf);
+};
+
+#endif // HISTOGRAMCOMPARISON_H
@@ -0,0 +1,529 @@
+#include "HistogramFitter.h"
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// Parametri del minimizzatore di Levenberg-Marquardt
+static const int kMaxIterations = 500;     // Numero massimo di iterazioni
+static const double kTolerance = 1e-10;    // Variazione relativa minima della funzione obiettivo
+static const double kInitialLambda = 1e-3; // Smorzamento iniziale
+static const double kMaxLambda = 1e12;     // Smorzamento oltre il quale il minimo è considerato raggiunto
+
+// Risoluzione del sistema lineare a * x = b con eliminazione di Gauss e pivoting parziale
+// n: dimensione del sistema
+// a: matrice n x n per righe (viene modificata)
+// b: termine noto, sostituito dalla soluzione
+// return: false se la matrice è singolare
+static bool SolveLinear(int n, double *a, double *b)
+{
+  for (int col = 0; col < n; ++col)
+  {
+    int pivot = col;
+    for (int row = col + 1; row < n; ++row)
+    {
+      if (std::fabs(a[row * n + col]) > std::fabs(a[pivot * n + col]))
+        pivot = row;
+    }
+    if (a[pivot * n + col] == 0)
+      return false;
+    if (pivot != col)
+    {
+      for (int k = 0; k < n; ++k)
+        std::swap(a[col * n + k], a[pivot * n + k]);
+      std::swap(b[col], b[pivot]);
+    }
+    for (int row = col + 1; row < n; ++row)
+    {
+      double factor = a[row * n + col] / a[col * n + col];
+      for (int k = col; k < n; ++k)
+        a[row * n + k] -= factor * a[col * n + k];
+      b[row] -= factor * b[col];
+    }
+  }
+  for (int row = n - 1; row >= 0; --row)
+  {
+    double sum = b[row];
+    for (int k = row + 1; k < n; ++k)
+      sum -= a[row * n + k] * b[k];
+    b[row] = sum / a[row * n + row];
+  }
+  return true;
+}
+
+// Inversione di una matrice risolvendo un sistema per ogni colonna dell'identità
+// n: dimensione della matrice
+// a: matrice n x n per righe
+// inverse: matrice inversa
+// return: false se la matrice è singolare
+static bool InvertMatrix(int n, const double *a, double *inverse)
+{
+  const int kMax = FitOutput::kMaxPar;
+  for (int col = 0; col < n; ++col)
+  {
+    double work[kMax * kMax];
+    double column[kMax];
+    for (int k = 0; k < n * n; ++k)
+      work[k] = a[k];
+    for (int k = 0; k < n; ++k)
+      column[k] = (k == col) ? 1.0 : 0.0;
+    if (!SolveLinear(n, work, column))
+      return false;
+    for (int k = 0; k < n; ++k)
+      inverse[k * n + col] = column[k];
+  }
+  return true;
+}
+
+HistogramFitter::HistogramFitter(FitModel model, FitMethod method) : fModel(model), fMethod(method) {}
+
+int HistogramFitter::GetNPar(FitModel model)
+{
+  switch (model)
+  {
+  case kFitConstant:
+    return 1;
+  case kFitExponential:
+    return 2;
+  case kFitGaussian:
+    return 3;
+  case kFitGaussianPol2:
+    return 6;
+  }
+  return 0;
+}
+
+const char *HistogramFitter::GetFormula(FitModel model)
+{
+  switch (model)
+  {
+  case kFitConstant:
+    return "[0]";
+  case kFitExponential:
+    return "[0]*exp(-x/[1])";
+  case kFitGaussian:
+    return "gaus";
+  case kFitGaussianPol2:
+    return "gaus(0)+pol2(3)";
+  }
+  return "";
+}
+
+double HistogramFitter::Evaluate(FitModel model, double x, const double *par, double *gradient)
+{
+  switch (model)
+  {
+  case kFitConstant:
+    if (gradient)
+      gradient[0] = 1;
+    return par[0];
+  case kFitExponential:
+  {
+    double e = std::exp(-x / par[1]);
+    if (gradient)
+    {
+      gradient[0] = e;
+      gradient[1] = par[0] * e * x / (par[1] * par[1]);
+    }
+    return par[0] * e;
+  }
+  case kFitGaussian:
+  case kFitGaussianPol2:
+  {
+    double t = (x - par[1]) / par[2];
+    double e = std::exp(-0.5 * t * t);
+    double value = par[0] * e;
+    if (gradient)
+    {
+      gradient[0] = e;
+      gradient[1] = value * t / par[2];
+      gradient[2] = value * t * t / par[2];
+    }
+    if (model == kFitGaussianPol2)
+    {
+      value += par[3] + x * (par[4] + x * par[5]);
+      if (gradient)
+      {
+        gradient[3] = 1;
+        gradient[4] = x;
+        gradient[5] = x * x;
+      }
+    }
+    return value;
+  }
+  }
+  return 0;
+}
+
+int HistogramFitter::CountPoints(const FitData &data) const
+{
+  if (fMethod == kFitLikelihood)
+    return data.GetNBins();
+  int count = 0;
+  for (int i = 0; i < data.GetNBins(); ++i)
+  {
+    if (data.error[i] > 0)
+      ++count;
+  }
+  return count;
+}
+
+double HistogramFitter::Objective(const FitData &data, const double *par, double *gradient, double *hessian) const
+{
+  const int nPar = GetNPar(fModel);
+  if (gradient)
+  {
+    for (int k = 0; k < nPar; ++k)
+      gradient[k] = 0;
+  }
+  if (hessian)
+  {
+    for (int k = 0; k < nPar * nPar; ++k)
+      hessian[k] = 0;
+  }
+
+  double value = 0;
+  double derivatives[FitOutput::kMaxPar];
+  for (int i = 0; i < data.GetNBins(); ++i)
+  {
+    double y = data.y[i];
+    double residualWeight; // Derivata del termine del bin rispetto al modello, divisa per 2
+    double curvature;      // Peso del termine di Gauss-Newton, diviso per 2
+    double f;
+    if (fMethod == kFitChi2)
+    {
+      if (!(data.error[i] > 0)) // Bin vuoti esclusi come in ROOT
+        continue;
+      f = Evaluate(fModel, data.x[i], par, (gradient || hessian) ? derivatives : 0);
+      double weight = 1.0 / (data.error[i] * data.error[i]);
+      double residual = y - f;
+      value += residual * residual * weight;
+      residualWeight = -residual * weight;
+      curvature = weight;
+    }
+    else
+    {
+      f = Evaluate(fModel, data.x[i], par, (gradient || hessian) ? derivatives : 0);
+      if (!(f > 0)) // Il valore atteso di Poisson deve essere positivo
+        return std::numeric_limits<double>::infinity();
+      // Chi quadro di Baker-Cousins: 2 * sum(f - y + y * ln(y / f))
+      value += 2 * (f - y);
+      if (y > 0)
+        value += 2 * y * std::log(y / f);
+      residualWeight = 1 - y / f;
+      curvature = 1.0 / f; // Informazione di Fisher attesa
+    }
+    if (gradient)
+    {
+      for (int k = 0; k < nPar; ++k)
+        gradient[k] += 2 * residualWeight * derivatives[k];
+    }
+    if (hessian)
+    {
+      for (int k = 0; k < nPar; ++k)
+      {
+        for (int l = 0; l <= k; ++l)
+          hessian[k * nPar + l] += 2 * curvature * derivatives[k] * derivatives[l];
+      }
+    }
+  }
+  if (hessian)
+  {
+    for (int k = 0; k < nPar; ++k)
+    {
+      for (int l = 0; l < k; ++l)
+        hessian[l * nPar + k] = hessian[k * nPar + l];
+    }
+  }
+  return value;
+}
+
+void HistogramFitter::InitialParameters(const FitData &data, double *par) const
+{
+  const int n = data.GetNBins();
+  for (int k = 0; k < GetNPar(fModel); ++k)
+    par[k] = 0;
+  if (n == 0)
+    return;
+
+  switch (fModel)
+  {
+  case kFitConstant:
+  {
+    double sum = 0;
+    for (int i = 0; i < n; ++i)
+      sum += data.y[i];
+    par[0] = sum / n;
+    break;
+  }
+  case kFitExponential:
+  {
+    // Retta pesata su ln(y) in funzione di x (la varianza di ln(y) è circa 1/y)
+    double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < n; ++i)
+    {
+      if (data.y[i] <= 0)
+        continue;
+      double w = data.y[i];
+      double ly = std::log(data.y[i]);
+      sw += w;
+      sx += w * data.x[i];
+      sy += w * ly;
+      sxx += w * data.x[i] * data.x[i];
+      sxy += w * data.x[i] * ly;
+    }
+    double denominator = sw * sxx - sx * sx;
+    double slope = denominator != 0 ? (sw * sxy - sx * sy) / denominator : 0;
+    if (slope >= 0 || sw == 0)
+    {
+      par[0] = data.y[0];
+      par[1] = 1.0;
+    }
+    else
+    {
+      par[1] = -1.0 / slope;
+      par[0] = std::exp((sy - slope * sx) / sw);
+    }
+    break;
+  }
+  case kFitGaussian:
+  case kFitGaussianPol2:
+  {
+    // Fondo lineare stimato dalle code dell'intervallo (solo per il modello con fondo)
+    double b0 = 0, b1 = 0;
+    if (fModel == kFitGaussianPol2)
+    {
+      int side = n / 5 > 0 ? n / 5 : 1;
+      double xl = 0, yl = 0, xr = 0, yr = 0;
+      for (int i = 0; i < side; ++i)
+      {
+        xl += data.x[i];
+        yl += data.y[i];
+        xr += data.x[n - 1 - i];
+        yr += data.y[n - 1 - i];
+      }
+      if (xr != xl)
+        b1 = (yr - yl) / (xr - xl);
+      b0 = yl / side - b1 * xl / side;
+      par[3] = b0;
+      par[4] = b1;
+    }
+    // Media, deviazione standard e massimo del segnale
+    double sw = 0, sx = 0, sxx = 0, peak = 0;
+    for (int i = 0; i < n; ++i)
+    {
+      double signal = data.y[i] - (b0 + b1 * data.x[i]);
+      if (signal <= 0)
+        continue;
+      sw += signal;
+      sx += signal * data.x[i];
+      sxx += signal * data.x[i] * data.x[i];
+      if (signal > peak)
+        peak = signal;
+    }
+    double width = n > 1 ? (data.x[n - 1] - data.x[0]) / (n - 1) : 1.0;
+    double mean = sw > 0 ? sx / sw : 0.5 * (data.x[0] + data.x[n - 1]);
+    double variance = sw > 0 ? sxx / sw - mean * mean : 0;
+    par[0] = peak;
+    par[1] = mean;
+    par[2] = variance > width * width ? std::sqrt(variance) : width;
+    break;
+  }
+  }
+}
+
+FitOutput HistogramFitter::Fit(const FitData &data, const double *initial) const
+{
+  const int nPar = GetNPar(fModel);
+  FitOutput output;
+  output.nPar = nPar;
+  output.nIterations = 0;
+  output.converged = false;
+  for (int k = 0; k < FitOutput::kMaxPar; ++k)
+  {
+    output.par[k] = 0;
+    output.err[k] = 0;
+  }
+  for (int k = 0; k < FitOutput::kMaxPar * FitOutput::kMaxPar; ++k)
+    output.cov[k] = 0;
+
+  double par[FitOutput::kMaxPar];
+  if (initial)
+  {
+    for (int k = 0; k < nPar; ++k)
+      par[k] = initial[k];
+  }
+  else
+  {
+    InitialParameters(data, par);
+  }
+
+  // **Minimizzazione con Levenberg-Marquardt**
+  double gradient[FitOutput::kMaxPar];
+  double hessian[FitOutput::kMaxPar * FitOutput::kMaxPar];
+  double value = Objective(data, par, gradient, hessian);
+  double lambda = kInitialLambda;
+  bool converged = false;
+  int iteration = 0;
+  while (iteration < kMaxIterations && std::isfinite(value))
+  {
+    ++iteration;
+    double damped[FitOutput::kMaxPar * FitOutput::kMaxPar];
+    double step[FitOutput::kMaxPar];
+    for (int k = 0; k < nPar * nPar; ++k)
+      damped[k] = hessian[k];
+    for (int k = 0; k < nPar; ++k)
+    {
+      double diagonal = hessian[k * nPar + k];
+      damped[k * nPar + k] = diagonal > 0 ? diagonal * (1 + lambda) : lambda;
+      step[k] = -gradient[k];
+    }
+    double trial[FitOutput::kMaxPar];
+    double trialValue = std::numeric_limits<double>::infinity();
+    if (SolveLinear(nPar, damped, step))
+    {
+      for (int k = 0; k < nPar; ++k)
+        trial[k] = par[k] + step[k];
+      trialValue = Objective(data, trial, 0, 0);
+    }
+
+    if (trialValue < value)
+    {
+      double decrease = value - trialValue;
+      for (int k = 0; k < nPar; ++k)
+        par[k] = trial[k];
+      value = Objective(data, par, gradient, hessian);
+      lambda = lambda > 1e-12 ? lambda * 0.1 : lambda;
+      if (decrease < kTolerance * (1 + value))
+      {
+        converged = true;
+        break;
+      }
+    }
+    else
+    {
+      lambda *= 10;
+      if (lambda > kMaxLambda) // Nessun passo riduce la funzione: siamo nel minimo
+      {
+        converged = true;
+        break;
+      }
+    }
+  }
+  output.nIterations = iteration;
+
+  // **Errori dall'Hessiana completa**, calcolata per differenze centrali del gradiente analitico
+  double fullHessian[FitOutput::kMaxPar * FitOutput::kMaxPar] = {0};
+  for (int l = 0; l < nPar; ++l)
+  {
+    double h = 1e-5 * (std::fabs(par[l]) > 1e-3 ? std::fabs(par[l]) : 1e-3);
+    double shifted[FitOutput::kMaxPar];
+    double gradientUp[FitOutput::kMaxPar], gradientDown[FitOutput::kMaxPar];
+    for (int k = 0; k < nPar; ++k)
+      shifted[k] = par[k];
+    shifted[l] = par[l] + h;
+    Objective(data, shifted, gradientUp, 0);
+    shifted[l] = par[l] - h;
+    Objective(data, shifted, gradientDown, 0);
+    for (int k = 0; k < nPar; ++k)
+      fullHessian[k * nPar + l] = (gradientUp[k] - gradientDown[k]) / (2 * h);
+  }
+  for (int k = 0; k < nPar; ++k)
+  {
+    for (int l = 0; l < k; ++l)
+    {
+      double symmetric = 0.5 * (fullHessian[k * nPar + l] + fullHessian[l * nPar + k]);
+      fullHessian[k * nPar + l] = fullHessian[l * nPar + k] = symmetric;
+    }
+  }
+
+  // La funzione obiettivo vale chi quadro (o 2 volte la -log likelihood):
+  // la covarianza è 2 volte l'inversa della sua Hessiana
+  double covariance[FitOutput::kMaxPar * FitOutput::kMaxPar];
+  bool validCovariance = InvertMatrix(nPar, fullHessian, covariance);
+  for (int k = 0; k < nPar && validCovariance; ++k)
+  {
+    if (!(covariance[k * nPar + k] > 0))
+      validCovariance = false;
+  }
+  if (!validCovariance) // Ripiego sull'approssimazione di Gauss-Newton
+  {
+    validCovariance = InvertMatrix(nPar, hessian, covariance);
+  }
+
+  for (int k = 0; k < nPar; ++k)
+  {
+    output.par[k] = par[k];
+    output.err[k] = validCovariance && covariance[k * nPar + k] > 0 ? std::sqrt(2 * covariance[k * nPar + k]) : 0;
+    for (int l = 0; l < nPar && validCovariance; ++l)
+      output.cov[k * nPar + l] = 2 * covariance[k * nPar + l];
+  }
+  if ((fModel == kFitGaussian || fModel == kFitGaussianPol2) && output.par[2] < 0)
+  {
+    // La sigma è definita a meno del segno: si cambia segno anche alle sue covarianze
+    output.par[2] = -output.par[2];
+    for (int k = 0; k < nPar; ++k)
+    {
+      if (k == 2)
+        continue;
+      output.cov[2 * nPar + k] = -output.cov[2 * nPar + k];
+      output.cov[k * nPar + 2] = -output.cov[k * nPar + 2];
+    }
+  }
+
+  output.chi2 = value;
+  output.ndf = CountPoints(data) - nPar;
+  output.prob = Prob(output.chi2, output.ndf);
+  output.converged = converged && validCovariance && std::isfinite(value);
+  return output;
+}
+
+double HistogramFitter::Prob(double chi2, int ndf)
+{
+  if (ndf <= 0)
+    return 0;
+  if (chi2 <= 0)
+    return 1;
+
+  // Funzione gamma incompleta superiore regolarizzata Q(a, x) con a = ndf / 2 e x = chi2 / 2
+  const double a = 0.5 * ndf;
+  const double x = 0.5 * chi2;
+  const double logPrefactor = a * std::log(x) - x - std::lgamma(a);
+  const double epsilon = 1e-15;
+  if (x < a + 1)
+  {
+    // Serie per P(a, x)
+    double term = 1.0 / a;
+    double sum = term;
+    for (int n = 1; n < 1000; ++n)
+    {
+      term *= x / (a + n);
+      sum += term;
+      if (std::fabs(term) < std::fabs(sum) * epsilon)
+        break;
+    }
+    return 1 - sum * std::exp(logPrefactor);
+  }
+  // Frazione continua per Q(a, x) (algoritmo di Lentz)
+  const double tiny = 1e-300;
+  double b = x + 1 - a;
+  double c = 1.0 / tiny;
+  double d = 1.0 / b;
+  double h = d;
+  for (int n = 1; n < 1000; ++n)
+  {
+    double an = -n * (n - a);
+    b += 2;
+    d = an * d + b;
+    if (std::fabs(d) < tiny)
+      d = tiny;
+    c = b + an / c;
+    if (std::fabs(c) < tiny)
+      c = tiny;
+    d = 1.0 / d;
+    double delta = d * c;
+    h *= delta;
+    if (std::fabs(delta - 1) < epsilon)
+      break;
+  }
+  return std::exp(logPrefactor) * h;
+}
@@ -0,0 +1,117 @@
+#ifndef HISTOGRAMFITTER_H
+#define HISTOGRAMFITTER_H
+
+#include <vector>
+
+// Famiglie di modelli supportate dal fitter, con la stessa parametrizzazione delle formule ROOT
+enum FitModel
+{
+  kFitConstant,     // [0]
+  kFitExponential,  // [0]*exp(-x/[1])
+  kFitGaussian,     // gaus: [0]*exp(-0.5*((x-[1])/[2])^2)
+  kFitGaussianPol2  // gaus(0)+pol2(3): gaussiana più fondo polinomiale di secondo grado
+};
+
+// Metodo di stima dei parametri
+enum FitMethod
+{
+  kFitChi2,      // Chi quadro con gli errori dei bin (i bin vuoti sono esclusi, come in ROOT)
+  kFitLikelihood // Likelihood di Poisson sui conteggi dei bin (opzione "L" di ROOT)
+};
+
+// Dati binnati da fittare: centri, contenuti ed errori dei bin nell'intervallo del fit
+struct FitData
+{
+  std::vector<double> x;     // Centri dei bin
+  std::vector<double> y;     // Contenuti dei bin
+  std::vector<double> error; // Errori dei bin
+
+  // Metodo per aggiungere un bin
+  void AddBin(double center, double content, double binError)
+  {
+    x.push_back(center);
+    y.push_back(content);
+    error.push_back(binError);
+  }
+
+  // Metodo per ottenere il numero di bin
+  int GetNBins() const { return (int)x.size(); }
+};
+
+// Risultato di un fit
+struct FitOutput
+{
+  static const int kMaxPar = 6; // Numero massimo di parametri dei modelli
+
+  int nPar;                      // Numero di parametri
+  double par[kMaxPar];           // Valori dei parametri
+  double err[kMaxPar];           // Errori dei parametri (dalla matrice di covarianza)
+  double cov[kMaxPar * kMaxPar]; // Matrice di covarianza, nPar x nPar per righe
+  double chi2;                   // Chi quadro (o chi quadro di Baker-Cousins per la likelihood)
+  int ndf;                       // Gradi di libertà
+  double prob;                   // Probabilità del chi quadro
+  int nIterations;               // Iterazioni del minimizzatore
+  bool converged;                // Convergenza del minimizzatore e matrice di covarianza valida
+};
+
+// La classe HistogramFitter esegue fit binnati di istogrammi con modelli fissati, senza dipendere
+// da ROOT. I gradienti dei modelli sono analitici; il minimo è cercato con il metodo di
+// Levenberg-Marquardt e gli errori sono ricavati dall'inversa dell'Hessiana completa nel minimo,
+// come fa HESSE in Minuit.
+
+class HistogramFitter
+{
+private:
+  FitModel fModel;   // Modello del fit
+  FitMethod fMethod; // Metodo di stima
+
+  // Metodo per calcolare la funzione obiettivo, il gradiente e l'approssimazione
+  // di Gauss-Newton dell'Hessiana
+  // data: dati del fit
+  // par: parametri
+  // gradient: gradiente della funzione obiettivo (può essere nullo)
+  // hessian: Hessiana approssimata, nPar x nPar per righe (può essere nulla)
+  // return: valore della funzione obiettivo (chi quadro o 2 volte la -log likelihood)
+  double Objective(const FitData &data, const double *par, double *gradient, double *hessian) const;
+
+  // Metodo per contare i bin che entrano nella funzione obiettivo
+  int CountPoints(const FitData &data) const;
+
+public:
+  // Costruttore
+  // model: modello del fit
+  // method: metodo di stima
+  HistogramFitter(FitModel model, FitMethod method = kFitChi2);
+
+  // Metodo per ottenere il numero di parametri di un modello
+  static int GetNPar(FitModel model);
+
+  // Metodo per ottenere la formula ROOT equivalente a un modello (per disegnare il risultato)
+  static const char *GetFormula(FitModel model);
+
+  // Metodo per valutare un modello
+  // model: modello
+  // x: ascissa
+  // par: parametri
+  // gradient: derivate rispetto ai parametri (può essere nullo)
+  // return: valore del modello
+  static double Evaluate(FitModel model, double x, const double *par, double *gradient = 0);
+
+  // Metodo per stimare i parametri iniziali a partire dai dati
+  // data: dati del fit
+  // par: parametri stimati
+  void InitialParameters(const FitData &data, double *par) const;
+
+  // Metodo per eseguire il fit
+  // data: dati del fit
+  // initial: parametri iniziali (nullo per la stima automatica)
+  // return: risultato del fit
+  FitOutput Fit(const FitData &data, const double *initial = 0) const;
+
+  // Metodo per calcolare la probabilità di un chi quadro (equivalente a TMath::Prob)
+  // chi2: chi quadro
+  // ndf: gradi di libertà
+  static double Prob(double chi2, int ndf);
+};
+
+#endif // HISTOGRAMFITTER_H
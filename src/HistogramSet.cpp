@@ -0,0 +1,172 @@
+#include "HistogramSet.h"
+#include "HistogramStoreWriter.h"
+#include <cmath>
+#include "TH1F.h"
+
+// Binnatura e titoli degli istogrammi, nell'ordine di HistogramIndex
+struct HistogramSpec
+{
+  const char *name;   // Nome dell'istogramma nel file
+  const char *title;  // Titolo
+  int nBins;          // Numero di bin
+  double min, max;    // Estremi dell'asse x
+  const char *xTitle; // Titolo dell'asse x
+  bool sumw2;         // Abilita la somma dei pesi al quadrato
+};
+
+static const HistogramSpec kSpecs[kNHistograms] = {
+    {"hParticleTypes", "Particle Types", 7, 0, 7, "Particle Type Index", false},
+    {"hAzimuthalAngle", "Azimuthal Angle Distribution", 100, 0, 2 * M_PI, "Azimuthal Angle (rad)", false},
+    {"hPolarAngle", "Polar Angle Distribution", 100, 0, M_PI, "Polar Angle (rad)", false},
+    {"hMomentum", "Momentum Distribution", 100, 0, 5, "Momentum (GeV/c)", false},
+    {"hTransverseMomentum", "Transverse Momentum Distribution", 100, 0, 5, "Transverse Momentum (GeV/c)", false},
+    {"hEnergy", "Energy Distribution", 100, 0, 5, "Energy (GeV)", false},
+    {"hInvariantMass", "Invariant Mass Distribution (All Pairs)", HistogramSet::kMassBins, 0, HistogramSet::kMaxMass, "Invariant Mass (GeV/c^{2})", true},
+    {"hInvMassOppositeCharge", "Invariant Mass Opposite Charge", HistogramSet::kMassBins, 0, HistogramSet::kMaxMass, "Invariant Mass (GeV/c^{2})", true},
+    {"hInvMassSameCharge", "Invariant Mass Same Charge", HistogramSet::kMassBins, 0, HistogramSet::kMaxMass, "Invariant Mass (GeV/c^{2})", true},
+    {"hInvMassPionKaon", "Invariant Mass Pion-Kaon (Opposite Charge)", HistogramSet::kMassBins, 0, HistogramSet::kMaxMass, "Invariant Mass (GeV/c^{2})", true},
+    {"hInvMassPionKaonSC", "Invariant Mass Pion-Kaon (Same Charge)", HistogramSet::kMassBins, 0, HistogramSet::kMaxMass, "Invariant Mass (GeV/c^{2})", true},
+    {"hInvMassDecayProducts", "Invariant Mass Decay Products (K* daughters)", HistogramSet::kMassBins, 0, HistogramSet::kMaxMass, "Invariant Mass (GeV/c^{2})", true}};
+
+// Binnatura e titoli degli istogrammi a più dimensioni, nell'ordine di NDHistogramIndex
+struct NDHistogramSpec
+{
+  const char *name;                     // Nome dell'istogramma nel file
+  const char *title;                    // Titolo
+  int nDim;                             // Numero di assi
+  int nBins[3];                         // Bin di ogni asse
+  double min[3], max[3];                // Estremi di ogni asse
+  const char *axisTitle[3];             // Titoli degli assi
+  NDStorage storage;                    // Memorizzazione delle celle
+};
+
+static const NDHistogramSpec kNDSpecs[kNNDHistograms] = {
+    {"hPionKaonMassPt", "Invariant Mass vs p_{T} Pion-Kaon (Opposite Charge)", 2, {300, 20, 0}, {0, 0, 0}, {3, 5, 0},
+     {"Invariant Mass (GeV/c^{2})", "Pair p_{T} (GeV/c)", ""}, kDenseStorage},
+    {"hPionKaonSCMassPt", "Invariant Mass vs p_{T} Pion-Kaon (Same Charge)", 2, {300, 20, 0}, {0, 0, 0}, {3, 5, 0},
+     {"Invariant Mass (GeV/c^{2})", "Pair p_{T} (GeV/c)", ""}, kDenseStorage},
+    {"hPionKaonMassRapidity", "Invariant Mass vs y Pion-Kaon (Opposite Charge)", 2, {300, 20, 0}, {0, -2, 0}, {3, 2, 0},
+     {"Invariant Mass (GeV/c^{2})", "Pair Rapidity", ""}, kDenseStorage},
+    {"hPionKaonSCMassRapidity", "Invariant Mass vs y Pion-Kaon (Same Charge)", 2, {300, 20, 0}, {0, -2, 0}, {3, 2, 0},
+     {"Invariant Mass (GeV/c^{2})", "Pair Rapidity", ""}, kDenseStorage},
+    {"hPionKaonMassPtRapidity", "Invariant Mass vs p_{T} vs y Pion-Kaon (Opposite Charge)", 3, {300, 20, 20}, {0, 0, -2}, {3, 5, 2},
+     {"Invariant Mass (GeV/c^{2})", "Pair p_{T} (GeV/c)", "Pair Rapidity"}, kSparseStorage},
+    {"hPionKaonSCMassPtRapidity", "Invariant Mass vs p_{T} vs y Pion-Kaon (Same Charge)", 3, {300, 20, 20}, {0, 0, -2}, {3, 5, 2},
+     {"Invariant Mass (GeV/c^{2})", "Pair p_{T} (GeV/c)", "Pair Rapidity"}, kSparseStorage}};
+
+HistogramSet::HistogramSet(const std::string &selection, bool weighted) : fSelection(selection), fWeighted(weighted)
+{
+  for (int i = 0; i < kNHistograms; ++i)
+  {
+    const HistogramSpec &spec = kSpecs[i];
+    std::string name = spec.name;
+    std::string title = spec.title;
+    if (!selection.empty())
+    {
+      name += "_" + selection;
+      title += " [" + selection + "]";
+    }
+    fHist[i] = new TH1F(name.c_str(), title.c_str(), spec.nBins, spec.min, spec.max);
+    fHist[i]->SetDirectory(0);
+    fHist[i]->GetXaxis()->SetTitle(spec.xTitle);
+    fHist[i]->GetYaxis()->SetTitle("Counts");
+    if (spec.sumw2 || weighted)
+      fHist[i]->Sumw2();
+  }
+  for (int i = 0; i < kNNDHistograms; ++i)
+  {
+    const NDHistogramSpec &spec = kNDSpecs[i];
+    std::string name = spec.name;
+    std::string title = spec.title;
+    if (!selection.empty())
+    {
+      name += "_" + selection;
+      title += " [" + selection + "]";
+    }
+    fND[i] = new NDHistogram(name.c_str(), title.c_str(), spec.nDim, spec.nBins, spec.min, spec.max, spec.storage);
+    for (int d = 0; d < spec.nDim; ++d)
+      fND[i]->SetAxisTitle(d, spec.axisTitle[d]);
+  }
+  if (weighted)
+  {
+    fMassSumw.assign(kNMassHistograms * (kMassBins + 2), 0);
+    fMassSumw2.assign(kNMassHistograms * (kMassBins + 2), 0);
+  }
+  for (int i = 0; i < kNMassHistograms; ++i)
+    fMassEntries[i] = 0;
+}
+
+HistogramSet::~HistogramSet()
+{
+  for (int i = 0; i < kNHistograms; ++i)
+    delete fHist[i];
+  for (int i = 0; i < kNNDHistograms; ++i)
+    delete fND[i];
+}
+
+void HistogramSet::Flush()
+{
+  if (fMassSumw.empty())
+    return;
+  for (int i = 0; i < kNMassHistograms; ++i)
+  {
+    if (fMassEntries[i] == 0)
+      continue;
+    TH1F *histogram = fHist[kHInvariantMass + i];
+    const double entries = histogram->GetEntries() + fMassEntries[i];
+    double *sumw = &fMassSumw[i * (kMassBins + 2)];
+    double *sumw2 = &fMassSumw2[i * (kMassBins + 2)];
+    for (int bin = 0; bin < kMassBins + 2; ++bin)
+    {
+      if (sumw2[bin] == 0)
+        continue;
+      const double error = histogram->GetBinError(bin);
+      histogram->SetBinContent(bin, histogram->GetBinContent(bin) + sumw[bin]);
+      histogram->SetBinError(bin, std::sqrt(error * error + sumw2[bin]));
+      sumw[bin] = 0;
+      sumw2[bin] = 0;
+    }
+    histogram->SetEntries(entries); // SetBinContent incrementa il numero di entrate
+    fMassEntries[i] = 0;
+  }
+}
+
+void HistogramSet::Add(const HistogramSet &other)
+{
+  for (int i = 0; i < kNHistograms; ++i)
+    fHist[i]->Add(other.fHist[i]);
+  for (int i = 0; i < kNNDHistograms; ++i)
+    fND[i]->Add(*other.fND[i]);
+}
+
+long long HistogramSet::GetMemoryBytes() const
+{
+  long long bytes = (long long)((fMassSumw.capacity() + fMassSumw2.capacity()) * sizeof(double));
+  for (int i = 0; i < kNHistograms; ++i)
+    bytes += (long long)(fHist[i]->GetNbinsX() + 2) * sizeof(float) + (long long)fHist[i]->GetSumw2N() * sizeof(double);
+  for (int i = 0; i < kNNDHistograms; ++i)
+    bytes += fND[i]->GetMemoryBytes();
+  return bytes;
+}
+
+void HistogramSet::Write() const
+{
+  for (int i = 0; i < kNHistograms; ++i)
+    fHist[i]->Write();
+  for (int i = 0; i < kNNDHistograms; ++i)
+    fND[i]->WriteRoot();
+}
+
+void HistogramSet::WriteNative(std::ostream &out) const
+{
+  for (int i = 0; i < kNNDHistograms; ++i)
+    fND[i]->Write(out);
+}
+
+void HistogramSet::WriteStore(HistogramStoreWriter &writer) const
+{
+  for (int i = 0; i < kNHistograms; ++i)
+    writer.Add(*fHist[i]);
+  for (int i = 0; i < kNNDHistograms; ++i)
+    writer.Add(*fND[i]);
+}
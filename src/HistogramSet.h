@@ -0,0 +1,139 @@
+#ifndef HISTOGRAMSET_H
+#define HISTOGRAMSET_H
+
+#include "NDHistogram.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+class TH1F;
+class HistogramStoreWriter;
+
+// Indici degli istogrammi prodotti dalla simulazione, nell'ordine in cui sono scritti su file
+enum HistogramIndex
+{
+  kHParticleTypes,
+  kHAzimuthalAngle,
+  kHPolarAngle,
+  kHMomentum,
+  kHTransverseMomentum,
+  kHEnergy,
+  kHInvariantMass,
+  kHInvMassOppositeCharge,
+  kHInvMassSameCharge,
+  kHInvMassPionKaon,
+  kHInvMassPionKaonSC,
+  kHInvMassDecayProducts,
+  kNHistograms
+};
+
+// Indici degli istogrammi a più dimensioni delle coppie pione-kaone, per le rese della K*
+// in intervalli di quantità di moto trasversale e rapidità della coppia
+enum NDHistogramIndex
+{
+  kHPionKaonMassPt,              // Massa × pT, carica opposta (denso)
+  kHPionKaonSCMassPt,            // Massa × pT, stessa carica (denso)
+  kHPionKaonMassRapidity,        // Massa × y, carica opposta (denso)
+  kHPionKaonSCMassRapidity,      // Massa × y, stessa carica (denso)
+  kHPionKaonMassPtRapidity,      // Massa × pT × y, carica opposta (sparso)
+  kHPionKaonSCMassPtRapidity,    // Massa × pT × y, stessa carica (sparso)
+  kNNDHistograms
+};
+
+// La classe HistogramSet contiene una copia completa degli istogrammi della simulazione.
+// Ogni thread di generazione riempie il proprio insieme senza sincronizzazione;
+// gli insiemi vengono sommati prima della scrittura su file.
+// Gli istogrammi non sono associati ad alcuna directory di ROOT.
+
+class HistogramSet
+{
+public:
+  static const int kNMassHistograms = kHInvMassDecayProducts - kHInvariantMass + 1; // Istogrammi di massa invariante
+  static const int kMassBins = 1000;        // Bin degli istogrammi di massa invariante
+  static constexpr double kMaxMass = 3;     // Estremo superiore degli istogrammi di massa invariante (GeV/c^2)
+
+private:
+  std::string fSelection;             // Nome dell'insieme di tagli o della variazione (vuoto: principali)
+  bool fWeighted;                     // Insieme riempito con pesi
+  TH1F *fHist[kNHistograms];          // Istogrammi, indicizzati da HistogramIndex
+  NDHistogram *fND[kNNDHistograms];   // Istogrammi a più dimensioni, indicizzati da NDHistogramIndex
+
+  // Accumulatori nativi delle masse invarianti degli insiemi pesati, [istogramma][bin]:
+  // una coppia è riempita con un solo calcolo del bin per tutte le variazioni, e le somme
+  // sono trasferite negli istogrammi con Flush
+  std::vector<double> fMassSumw, fMassSumw2;
+  double fMassEntries[kNMassHistograms];
+
+public:
+  // Costruttore che crea gli istogrammi con binnatura, titoli degli assi e somma dei pesi al quadrato
+  // selection: nome dell'insieme di tagli o della variazione, aggiunto come suffisso ai nomi
+  //            ("hMomentum_<nome>") e ai titoli; vuoto per gli istogrammi principali
+  // weighted: insieme riempito con pesi, con la somma dei pesi al quadrato per tutti gli istogrammi
+  HistogramSet(const std::string &selection = "", bool weighted = false);
+
+  // Il distruttore elimina gli istogrammi
+  ~HistogramSet();
+
+  HistogramSet(const HistogramSet &) = delete;
+  HistogramSet &operator=(const HistogramSet &) = delete;
+
+  // Metodo per accedere a un istogramma
+  // index: indice dell'istogramma
+  TH1F *operator[](int index) const { return fHist[index]; }
+
+  // Metodo per accedere a un istogramma a più dimensioni
+  // index: indice dell'istogramma (NDHistogramIndex)
+  NDHistogram *GetND(int index) const { return fND[index]; }
+
+  // Metodi di accesso al nome dell'insieme e al tipo di riempimento, per creare un insieme vuoto
+  // equivalente (es. HistogramSet(other.GetSelection(), other.IsWeighted()))
+  const std::string &GetSelection() const { return fSelection; }
+  bool IsWeighted() const { return fWeighted; }
+
+  // Metodo per calcolare il bin degli istogrammi di massa invariante (come TAxis::FindBin)
+  static int FindMassBin(double mass)
+  {
+    if (!(mass >= 0))
+      return 0;
+    if (mass >= kMaxMass)
+      return kMassBins + 1;
+    return 1 + (int)(kMassBins * mass / kMaxMass);
+  }
+
+  // Metodo per riempire l'accumulatore nativo di un istogramma di massa invariante (solo insiemi pesati)
+  // index: indice dell'istogramma (da kHInvariantMass a kHInvMassDecayProducts)
+  // bin: bin calcolato con FindMassBin
+  // weight: peso
+  void FillMassBin(int index, int bin, double weight)
+  {
+    const int k = (index - kHInvariantMass) * (kMassBins + 2) + bin;
+    fMassSumw[k] += weight;
+    fMassSumw2[k] += weight * weight;
+    fMassEntries[index - kHInvariantMass] += 1;
+  }
+
+  // Metodo per trasferire gli accumulatori nativi negli istogrammi di massa invariante;
+  // va chiamato prima di leggere, sommare o scrivere un insieme pesato
+  void Flush();
+
+  // Metodo per ottenere la memoria allocata per i bin di tutti gli istogrammi (in byte)
+  long long GetMemoryBytes() const;
+
+  // Metodo per sommare bin per bin un altro insieme di istogrammi
+  // other: insieme da sommare
+  void Add(const HistogramSet &other);
+
+  // Metodo per scrivere tutti gli istogrammi nella directory corrente di ROOT
+  // (quelli a più dimensioni come TH2F, TH3F o THnSparseD)
+  void Write() const;
+
+  // Metodo per scrivere gli istogrammi a più dimensioni nel formato nativo
+  // out: stream di uscita (binario)
+  void WriteNative(std::ostream &out) const;
+
+  // Metodo per aggiungere tutti gli istogrammi a un archivio nativo (vedi HistogramStore)
+  // writer: archivio in preparazione
+  void WriteStore(HistogramStoreWriter &writer) const;
+};
+
+#endif // HISTOGRAMSET_H
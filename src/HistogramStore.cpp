@@ -0,0 +1,139 @@
+#include "HistogramStore.h"
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TH1F.h"
+
+const char HistogramStore::kMagic[4] = {'H', 'S', 'T', '1'};
+
+HistogramStore::HistogramStore() : fData(0), fSize(0), fHeader(0), fEntries(0)
+{
+}
+
+HistogramStore::~HistogramStore()
+{
+  Close();
+}
+
+bool HistogramStore::Open(const char *path)
+{
+  Close();
+  const int descriptor = open(path, O_RDONLY);
+  if (descriptor < 0)
+    return false;
+  struct stat status;
+  if (fstat(descriptor, &status) != 0 || status.st_size < (off_t)sizeof(HistogramStoreHeader))
+  {
+    close(descriptor);
+    return false;
+  }
+  void *data = mmap(0, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+  close(descriptor); // La mappatura resta valida dopo la chiusura del descrittore
+  if (data == MAP_FAILED)
+    return false;
+  fData = static_cast<const char *>(data);
+  fSize = (size_t)status.st_size;
+
+  // Controllo dell'intestazione e dell'indice: un file troncato o di un altro formato non è aperto
+  const HistogramStoreHeader *header = reinterpret_cast<const HistogramStoreHeader *>(fData);
+  const bool headerValid =
+      std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 && header->version == kVersion &&
+      header->fileSize == fSize && header->index % 8 == 0 && header->index <= fSize &&
+      header->nHistograms <= (fSize - header->index) / sizeof(HistogramStoreEntry) &&
+      header->strings <= fSize && header->stringsSize > 0 && header->stringsSize <= fSize - header->strings &&
+      fData[header->strings + header->stringsSize - 1] == '\0';
+  if (!headerValid)
+  {
+    Close();
+    return false;
+  }
+  fHeader = header;
+  fEntries = reinterpret_cast<const HistogramStoreEntry *>(fData + header->index);
+  for (uint64_t k = 0; k < header->nHistograms; ++k)
+  {
+    if (!IsValid(fEntries[k]))
+    {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void HistogramStore::Close()
+{
+  if (fData)
+    munmap(const_cast<char *>(fData), fSize);
+  fData = 0;
+  fSize = 0;
+  fHeader = 0;
+  fEntries = 0;
+}
+
+bool HistogramStore::IsValid(const HistogramStoreEntry &entry) const
+{
+  const uint64_t stringsSize = fHeader->stringsSize;
+  if (entry.name >= stringsSize || entry.title >= stringsSize)
+    return false;
+  if (entry.nDim < 1 || entry.nDim > HistogramStoreEntry::kMaxDimensions)
+    return false;
+  uint64_t nCells = 1;
+  for (int d = 0; d < entry.nDim; ++d)
+  {
+    if (entry.axisTitle[d] >= stringsSize || entry.nBins[d] < 1 || !(entry.max[d] > entry.min[d]))
+      return false;
+    nCells *= (uint64_t)entry.nBins[d] + 2;
+    if (nCells > fSize / sizeof(double))
+      return false;
+  }
+  const uint64_t arraySize = nCells * sizeof(double);
+  if (entry.nCells != nCells || entry.sumw % kAlignment != 0 || entry.sumw > fSize || arraySize > fSize - entry.sumw)
+    return false;
+  if (entry.hasSumw2 && (entry.sumw2 % kAlignment != 0 || entry.sumw2 > fSize || arraySize > fSize - entry.sumw2))
+    return false;
+  return true;
+}
+
+const HistogramStoreEntry *HistogramStore::Find(const char *name) const
+{
+  if (!fHeader)
+    return 0;
+  uint64_t low = 0, high = fHeader->nHistograms;
+  while (low < high)
+  {
+    const uint64_t middle = low + (high - low) / 2;
+    const int comparison = std::strcmp(GetName(fEntries[middle]), name);
+    if (comparison == 0)
+      return &fEntries[middle];
+    if (comparison < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return 0;
+}
+
+TH1F *HistogramStore::MakeTH1F(const char *name) const
+{
+  const HistogramStoreEntry *entry = Find(name);
+  if (!entry || entry->nDim != 1)
+    return 0;
+  TH1F *histogram = new TH1F(name, GetTitle(*entry), entry->nBins[0], entry->min[0], entry->max[0]);
+  histogram->SetDirectory(0);
+  histogram->GetXaxis()->SetTitle(GetString(entry->axisTitle[0]));
+  const double *sumw = GetSumw(*entry);
+  const double *sumw2 = GetSumw2(*entry);
+  if (sumw2)
+    histogram->Sumw2();
+  for (int bin = 0; bin < entry->nBins[0] + 2; ++bin)
+  {
+    histogram->SetBinContent(bin, sumw[bin]);
+    if (sumw2)
+      histogram->SetBinError(bin, std::sqrt(sumw2[bin]));
+  }
+  histogram->SetEntries(entry->entries); // SetBinContent incrementa il numero di entrate
+  return histogram;
+}
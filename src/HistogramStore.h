@@ -0,0 +1,111 @@
+#ifndef HISTOGRAMSTORE_H
+#define HISTOGRAMSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+class TH1F;
+
+// Intestazione di un archivio di istogrammi (all'inizio del file)
+struct HistogramStoreHeader
+{
+  char magic[4];         // "HST1"
+  uint32_t version;      // Versione del formato
+  uint64_t nHistograms;  // Numero di istogrammi
+  uint64_t index;        // Posizione dell'indice (array di HistogramStoreEntry ordinato per nome)
+  uint64_t strings;      // Posizione della tabella delle stringhe (terminate da zero)
+  uint64_t stringsSize;  // Dimensione della tabella delle stringhe
+  uint64_t fileSize;     // Dimensione totale del file
+};
+
+// Voce dell'indice: descrizione di un istogramma e posizione dei suoi array di bin.
+// Le celle includono underflow e overflow di ogni asse, con il primo asse che varia più
+// velocemente (cella = Σ bin[d] * stride[d], stride[0] = 1, stride[d + 1] = stride[d] * (nBins[d] + 2)),
+// come in TH1 e in NDHistogram.
+struct HistogramStoreEntry
+{
+  static const int kMaxDimensions = 4;
+
+  uint64_t name;                       // Nome (posizione nella tabella delle stringhe)
+  uint64_t title;                      // Titolo
+  uint64_t axisTitle[kMaxDimensions];  // Titoli degli assi
+  int32_t nDim;                        // Numero di assi
+  int32_t nBins[kMaxDimensions];       // Bin di ogni asse (esclusi underflow e overflow)
+  int32_t hasSumw2;                    // Presente l'array delle somme dei pesi al quadrato
+  double min[kMaxDimensions];          // Estremo inferiore di ogni asse
+  double max[kMaxDimensions];          // Estremo superiore di ogni asse
+  double entries;                      // Numero di riempimenti
+  uint64_t nCells;                     // Numero di celle
+  uint64_t sumw;                       // Posizione dell'array delle somme dei pesi (allineata a kAlignment)
+  uint64_t sumw2;                      // Posizione dell'array delle somme dei pesi al quadrato (0 se assente)
+};
+
+// La classe HistogramStore apre in sola lettura un archivio nativo di istogrammi scritto da
+// HistogramStoreWriter, mappandolo in memoria con mmap: l'apertura legge solo l'intestazione
+// e controlla l'indice, la ricerca per nome è binaria sull'indice ordinato e i bin sono letti
+// direttamente dagli array del file, senza copie né deserializzazione. I valori sono nel formato
+// binario della macchina che ha scritto il file.
+
+class HistogramStore
+{
+public:
+  static const char kMagic[4];          // Identificatore del formato
+  static const uint32_t kVersion = 1;   // Versione del formato
+  static const uint64_t kAlignment = 64; // Allineamento degli array di bin nel file
+
+private:
+  const char *fData;                    // Inizio del file mappato (nullo se chiuso)
+  size_t fSize;                         // Dimensione della mappatura
+  const HistogramStoreHeader *fHeader;  // Intestazione
+  const HistogramStoreEntry *fEntries;  // Indice ordinato per nome
+
+  // Metodo per controllare che una voce dell'indice sia coerente con il file
+  bool IsValid(const HistogramStoreEntry &entry) const;
+
+public:
+  HistogramStore();
+
+  // Il distruttore chiude l'archivio
+  ~HistogramStore();
+
+  HistogramStore(const HistogramStore &) = delete;
+  HistogramStore &operator=(const HistogramStore &) = delete;
+
+  // Metodo per aprire un archivio
+  // path: file da aprire
+  // return: false se il file non esiste o non è un archivio valido
+  bool Open(const char *path);
+
+  // Metodo per chiudere l'archivio; i puntatori ottenuti diventano non validi
+  void Close();
+
+  // Metodi di accesso all'indice
+  long long GetNHistograms() const { return fHeader ? (long long)fHeader->nHistograms : 0; }
+  const HistogramStoreEntry &GetEntry(long long k) const { return fEntries[k]; }
+
+  // Metodo per cercare un istogramma per nome
+  // name: nome dell'istogramma
+  // return: voce dell'indice o puntatore nullo se l'istogramma non c'è
+  const HistogramStoreEntry *Find(const char *name) const;
+
+  // Metodi per leggere stringhe e bin di una voce, direttamente dal file mappato
+  const char *GetName(const HistogramStoreEntry &entry) const { return GetString(entry.name); }
+  const char *GetTitle(const HistogramStoreEntry &entry) const { return GetString(entry.title); }
+  const char *GetString(uint64_t offset) const { return fData + fHeader->strings + offset; }
+  const double *GetSumw(const HistogramStoreEntry &entry) const
+  {
+    return reinterpret_cast<const double *>(fData + entry.sumw);
+  }
+  // return: puntatore nullo se l'istogramma non ha le somme dei pesi al quadrato (errori = radice del contenuto)
+  const double *GetSumw2(const HistogramStoreEntry &entry) const
+  {
+    return entry.hasSumw2 ? reinterpret_cast<const double *>(fData + entry.sumw2) : 0;
+  }
+
+  // Metodo per creare una copia TH1F di un istogramma a un asse, non associata a directory
+  // name: nome dell'istogramma nell'archivio
+  // return: nuovo istogramma (di proprietà del chiamante) o puntatore nullo se assente o non a un asse
+  TH1F *MakeTH1F(const char *name) const;
+};
+
+#endif // HISTOGRAMSTORE_H
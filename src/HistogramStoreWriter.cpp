@@ -0,0 +1,170 @@
+#include "HistogramStoreWriter.h"
+#include "NDHistogram.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TH1.h"
+
+void HistogramStoreWriter::Add(const TH1 &histogram)
+{
+  Item item;
+  item.name = histogram.GetName();
+  item.title = histogram.GetTitle();
+  item.axisTitle[0] = histogram.GetXaxis()->GetTitle();
+  item.nDim = 1;
+  item.nBins[0] = histogram.GetNbinsX();
+  item.min[0] = histogram.GetXaxis()->GetXmin();
+  item.max[0] = histogram.GetXaxis()->GetXmax();
+  item.entries = histogram.GetEntries();
+  item.hasSumw2 = histogram.GetSumw2N() > 0;
+  const int nCells = item.nBins[0] + 2;
+  item.sumw.resize(nCells);
+  for (int bin = 0; bin < nCells; ++bin)
+    item.sumw[bin] = histogram.GetBinContent(bin);
+  if (item.hasSumw2)
+  {
+    const double *sumw2 = histogram.GetSumw2()->GetArray();
+    item.sumw2.assign(sumw2, sumw2 + nCells);
+  }
+  fItems.push_back(item);
+}
+
+void HistogramStoreWriter::Add(const NDHistogram &histogram)
+{
+  Item item;
+  item.name = histogram.GetName();
+  item.title = histogram.GetTitle();
+  item.nDim = histogram.GetNDimensions();
+  for (int d = 0; d < item.nDim; ++d)
+  {
+    item.axisTitle[d] = histogram.GetAxisTitle(d);
+    item.nBins[d] = histogram.GetNBins(d);
+    item.min[d] = histogram.GetMin(d);
+    item.max[d] = histogram.GetMax(d);
+  }
+  item.entries = histogram.GetEntries();
+  item.hasSumw2 = true;
+  item.sumw.resize(histogram.GetNCells());
+  item.sumw2.resize(histogram.GetNCells());
+  histogram.GetCells(item.sumw.data(), item.sumw2.data());
+  fItems.push_back(item);
+}
+
+// Metodo per arrotondare una posizione nel file al multiplo successivo di alignment
+static uint64_t Align(uint64_t offset, uint64_t alignment)
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool HistogramStoreWriter::Write(const std::string &path) const
+{
+  // Ordinamento per nome, per la ricerca binaria in HistogramStore::Find
+  std::vector<const Item *> items(fItems.size());
+  for (size_t k = 0; k < fItems.size(); ++k)
+    items[k] = &fItems[k];
+  std::sort(items.begin(), items.end(), [](const Item *a, const Item *b) { return a->name < b->name; });
+  for (size_t k = 1; k < items.size(); ++k)
+  {
+    if (items[k]->name == items[k - 1]->name)
+      return false;
+  }
+
+  // Tabella delle stringhe (la posizione 0 è la stringa vuota) e voci dell'indice
+  std::string strings(1, '\0');
+  auto addString = [&strings](const std::string &text)
+  {
+    if (text.empty())
+      return (uint64_t)0;
+    const uint64_t offset = strings.size();
+    strings.append(text.c_str(), text.size() + 1);
+    return offset;
+  };
+  std::vector<HistogramStoreEntry> entries(items.size());
+  for (size_t k = 0; k < items.size(); ++k)
+  {
+    HistogramStoreEntry &entry = entries[k];
+    const Item &item = *items[k];
+    std::memset(&entry, 0, sizeof(entry));
+    entry.name = addString(item.name);
+    entry.title = addString(item.title);
+    entry.nDim = item.nDim;
+    for (int d = 0; d < item.nDim; ++d)
+    {
+      entry.axisTitle[d] = addString(item.axisTitle[d]);
+      entry.nBins[d] = item.nBins[d];
+      entry.min[d] = item.min[d];
+      entry.max[d] = item.max[d];
+    }
+    entry.hasSumw2 = item.hasSumw2;
+    entry.entries = item.entries;
+    entry.nCells = item.sumw.size();
+  }
+
+  // Disposizione del file: intestazione, indice, stringhe, array dei bin allineati
+  HistogramStoreHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, HistogramStore::kMagic, sizeof(header.magic));
+  header.version = HistogramStore::kVersion;
+  header.nHistograms = entries.size();
+  header.index = Align(sizeof(HistogramStoreHeader), 8);
+  header.strings = header.index + entries.size() * sizeof(HistogramStoreEntry);
+  header.stringsSize = strings.size();
+  uint64_t offset = header.strings + header.stringsSize;
+  for (size_t k = 0; k < entries.size(); ++k)
+  {
+    const uint64_t arraySize = entries[k].nCells * sizeof(double);
+    entries[k].sumw = Align(offset, HistogramStore::kAlignment);
+    offset = entries[k].sumw + arraySize;
+    if (entries[k].hasSumw2)
+    {
+      entries[k].sumw2 = Align(offset, HistogramStore::kAlignment);
+      offset = entries[k].sumw2 + arraySize;
+    }
+  }
+  header.fileSize = offset;
+
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    const std::string padding(HistogramStore::kAlignment, '\0');
+    out.write(padding.data(), header.index - sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(HistogramStoreEntry));
+    out.write(strings.data(), strings.size());
+    uint64_t position = header.strings + header.stringsSize;
+    for (size_t k = 0; k < entries.size(); ++k)
+    {
+      const uint64_t arraySize = entries[k].nCells * sizeof(double);
+      out.write(padding.data(), entries[k].sumw - position);
+      out.write(reinterpret_cast<const char *>(items[k]->sumw.data()), arraySize);
+      position = entries[k].sumw + arraySize;
+      if (entries[k].hasSumw2)
+      {
+        out.write(padding.data(), entries[k].sumw2 - position);
+        out.write(reinterpret_cast<const char *>(items[k]->sumw2.data()), arraySize);
+        position = entries[k].sumw2 + arraySize;
+      }
+    }
+    out.close();
+    if (!out)
+    {
+      std::remove(temporary.c_str());
+      return false;
+    }
+  }
+
+  // Sincronizzazione su disco e sostituzione atomica del file finale
+  const int descriptor = open(temporary.c_str(), O_RDONLY);
+  const bool synced = descriptor >= 0 && fsync(descriptor) == 0;
+  if (descriptor >= 0)
+    close(descriptor);
+  if (!synced || std::rename(temporary.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
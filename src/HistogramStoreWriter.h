@@ -0,0 +1,49 @@
+#ifndef HISTOGRAMSTOREWRITER_H
+#define HISTOGRAMSTOREWRITER_H
+
+#include "HistogramStore.h"
+#include <string>
+#include <vector>
+
+class TH1;
+class NDHistogram;
+
+// La classe HistogramStoreWriter raccoglie istogrammi (TH1 a un asse e NDHistogram) e li scrive
+// in un archivio nativo leggibile con HistogramStore: intestazione, indice ordinato per nome,
+// tabella delle stringhe e array dei bin allineati a HistogramStore::kAlignment.
+// Il file è scritto in <file>.tmp e poi rinominato, come il file ROOT.
+
+class HistogramStoreWriter
+{
+private:
+  // Istogramma raccolto, con la copia dei bin
+  struct Item
+  {
+    std::string name, title;
+    std::string axisTitle[HistogramStoreEntry::kMaxDimensions];
+    int nDim;
+    int nBins[HistogramStoreEntry::kMaxDimensions];
+    double min[HistogramStoreEntry::kMaxDimensions], max[HistogramStoreEntry::kMaxDimensions];
+    double entries;
+    bool hasSumw2;
+    std::vector<double> sumw, sumw2;
+  };
+
+  std::vector<Item> fItems; // Istogrammi raccolti, nell'ordine di inserimento
+
+public:
+  // Metodo per aggiungere un istogramma a un asse (bin, underflow e overflow)
+  // histogram: istogramma; le somme dei pesi al quadrato sono copiate solo se attive (Sumw2)
+  void Add(const TH1 &histogram);
+
+  // Metodo per aggiungere un istogramma a più dimensioni (al più HistogramStoreEntry::kMaxDimensions assi)
+  // histogram: istogramma, denso o sparso; nell'archivio le celle sono sempre dense
+  void Add(const NDHistogram &histogram);
+
+  // Metodo per scrivere l'archivio
+  // path: file di uscita
+  // return: false se il file non può essere scritto o due istogrammi hanno lo stesso nome
+  bool Write(const std::string &path) const;
+};
+
+#endif // HISTOGRAMSTOREWRITER_H
@@ -0,0 +1,78 @@
+#include "LineShape.h"
+#include <cmath>
+#include <algorithm>
+
+// Estensione della distribuzione attorno alla massa nominale, in unità di larghezza.
+// Le code della Breit-Wigner decrescono lentamente e richiedono un intervallo più ampio.
+static const double kGaussianRange = 5.0;
+static const double kBreitWignerRange = 15.0;
+
+// Densità di probabilità (non normalizzata) della forma di riga
+static double Density(LineShapeKind kind, double m, double mass, double width)
+{
+  switch (kind)
+  {
+  case kBreitWigner:
+    return 1.0 / ((m - mass) * (m - mass) + 0.25 * width * width);
+  case kRelativisticBreitWigner:
+  {
+    double d = m * m - mass * mass;
+    return m * mass * width / (d * d + mass * mass * width * width);
+  }
+  case kGaussian:
+  default:
+  {
+    double x = (m - mass) / width;
+    return std::exp(-0.5 * x * x);
+  }
+  }
+}
+
+LineShape::LineShape() {}
+
+void LineShape::Build(LineShapeKind kind, double mass, double width, double threshold)
+{
+  double range = (kind == kGaussian) ? kGaussianRange : kBreitWignerRange;
+  double mMin = std::max(threshold, std::max(0.0, mass - range * width));
+  double mMax = std::max(mMin, mass) + range * width;
+
+  // Integrazione della densità con il metodo dei trapezi su una griglia fine
+  const int nSteps = (kTablePoints - 1) * kOversampling;
+  const double step = (mMax - mMin) / nSteps;
+  std::vector<double> cdf(nSteps + 1);
+  cdf[0] = 0;
+  double previous = Density(kind, mMin, mass, width);
+  for (int i = 1; i <= nSteps; ++i)
+  {
+    double current = Density(kind, mMin + i * step, mass, width);
+    cdf[i] = cdf[i - 1] + 0.5 * (previous + current) * step;
+    previous = current;
+  }
+
+  // Inversione della funzione di ripartizione sui punti u = k / (kTablePoints - 1)
+  fInverseCdf.resize(kTablePoints);
+  fInverseCdf[0] = mMin;
+  fInverseCdf[kTablePoints - 1] = mMax;
+  int i = 0;
+  for (int k = 1; k < kTablePoints - 1; ++k)
+  {
+    double target = cdf[nSteps] * k / (kTablePoints - 1);
+    while (cdf[i + 1] < target)
+      ++i;
+    double fraction = (target - cdf[i]) / (cdf[i + 1] - cdf[i]);
+    fInverseCdf[k] = mMin + (i + fraction) * step;
+  }
+}
+
+double LineShape::Cdf(double m) const
+{
+  if (m <= fInverseCdf.front())
+    return 0;
+  if (m >= fInverseCdf.back())
+    return 1;
+
+  // Ricerca binaria dell'intervallo che contiene m
+  int k = (int)(std::upper_bound(fInverseCdf.begin(), fInverseCdf.end(), m) - fInverseCdf.begin()) - 1;
+  double fraction = (m - fInverseCdf[k]) / (fInverseCdf[k + 1] - fInverseCdf[k]);
+  return (k + fraction) / (kTablePoints - 1);
+}
@@ -0,0 +1,63 @@
+#ifndef LINESHAPE_H
+#define LINESHAPE_H
+
+#include <vector>
+
+// Forme di riga disponibili per la massa delle risonanze
+enum LineShapeKind
+{
+  kGaussian,               // Gaussiana con sigma pari alla larghezza
+  kBreitWigner,            // Breit-Wigner non relativistica
+  kRelativisticBreitWigner // Breit-Wigner relativistica a larghezza costante
+};
+
+// La classe LineShape campiona la massa di una risonanza tramite una tabella precalcolata
+// della funzione di ripartizione inversa, con interpolazione lineare tra i punti.
+// La distribuzione è troncata alla soglia di decadimento, quindi ogni estrazione
+// ha costo costante, non richiede cicli di rifiuto e non produce masse sotto soglia.
+
+class LineShape
+{
+private:
+  static const int kTablePoints = 1024; // Punti della tabella della funzione di ripartizione inversa
+  static const int kOversampling = 16;  // Punti di integrazione per ogni intervallo della tabella
+
+  std::vector<double> fInverseCdf; // Massa corrispondente ai valori u = k / (kTablePoints - 1)
+
+public:
+  // Costruttore di default: tabella vuota
+  LineShape();
+
+  // Metodo per costruire la tabella
+  // kind: forma di riga
+  // mass: massa nominale della risonanza
+  // width: larghezza della risonanza
+  // threshold: soglia di decadimento (la distribuzione è nulla sotto soglia)
+  void Build(LineShapeKind kind, double mass, double width, double threshold);
+
+  // Metodo per sapere se la tabella è stata costruita
+  bool IsBuilt() const { return !fInverseCdf.empty(); }
+
+  // Metodo per ottenere l'estremo inferiore della distribuzione
+  double GetMinMass() const { return fInverseCdf.front(); }
+
+  // Metodo per estrarre una massa
+  // u: numero casuale uniforme in [0, 1]
+  // return: massa estratta
+  double Sample(double u) const
+  {
+    double x = u * (kTablePoints - 1);
+    int k = (int)x;
+    if (k >= kTablePoints - 1)
+      k = kTablePoints - 2;
+    return fInverseCdf[k] + (x - k) * (fInverseCdf[k + 1] - fInverseCdf[k]);
+  }
+
+  // Metodo per calcolare la funzione di ripartizione, usato per troncare la distribuzione
+  // a soglie più alte di quella usata nella costruzione
+  // m: massa
+  // return: probabilità di estrarre una massa minore di m
+  double Cdf(double m) const;
+};
+
+#endif // LINESHAPE_H
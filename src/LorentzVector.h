@@ -0,0 +1,166 @@
+#ifndef LORENTZVECTOR_H
+#define LORENTZVECTOR_H
+
+#include <cmath>
+
+// Libreria di cinematica relativistica, solo header. Il tipo scalare T segue la politica di
+// precisione (float o double), come EventSoA.
+//
+// LorentzBoost contiene la velocità di un boost insieme a γ e (γ - 1) / β², calcolati una sola
+// volta e riusati per tutte le particelle boostate nello stesso sistema; Apply trasforma le
+// componenti di una particella e BoostArrays un intero blocco di colonne, con un loop
+// vettorizzabile (i decadimenti boostano così insieme le figlie nello stesso sistema). Le operazioni seguono l'ordine di calcolo del boost originale di Particle,
+// così che in precisione doppia i risultati restino identici bit per bit.
+//
+// LorentzVector è un quadrivettore (px, py, pz, E) con l'energia memorizzata. Le funzioni statiche
+// sulle componenti (massa al quadrato di una somma, pT², rapporto della rapidità) sono le stesse
+// usate dai kernel sulle colonne SoA, che non costruiscono quadrivettori; i metodi dei quadrivettori
+// le richiamano. Costruttori, accessori e operazioni senza radici o logaritmi sono constexpr.
+
+template <typename U>
+struct LorentzBoost
+{
+  U bx, by, bz; // Velocità del sistema (in unità di c)
+  U b2;         // β²
+  U gamma;      // Fattore di Lorentz γ
+  U gamma2;     // (γ - 1) / β², 0 per il boost nullo
+
+  // Costruttore da velocità e γ già noti
+  constexpr LorentzBoost(U x, U y, U z, U g)
+      : bx(x), by(y), bz(z), b2(x * x + y * y + z * z), gamma(g),
+        gamma2((x * x + y * y + z * z) > 0 ? (g - 1.0) / (x * x + y * y + z * z) : 0.0)
+  {
+  }
+
+  // Metodo per costruire il boost dalla velocità, con γ = 1 / sqrt(1 - β²)
+  // x, y, z: componenti della velocità
+  static LorentzBoost FromVelocity(U x, U y, U z)
+  {
+    return LorentzBoost(x, y, z, 1.0 / std::sqrt(1.0 - (x * x + y * y + z * z)));
+  }
+
+  // Metodo per boostare le componenti di una particella; l'energia trasformata è γ (E + β·p)
+  // px, py, pz, e: componenti del quadrimpulso, sostituite da quelle boostate
+  template <typename T>
+  void Apply(T &px, T &py, T &pz, T &e) const
+  {
+    const U bp = bx * px + by * py + bz * pz;
+    const U energy = e;
+    px += gamma2 * bp * bx + gamma * bx * energy;
+    py += gamma2 * bp * by + gamma * by * energy;
+    pz += gamma2 * bp * bz + gamma * bz * energy;
+    e = gamma * (energy + bp);
+  }
+};
+
+// Metodo per boostare un blocco di particelle memorizzate per colonne
+// boost: boost da applicare
+// px, py, pz, e: colonne delle componenti, sostituite da quelle boostate
+// n: numero di particelle
+template <typename U, typename T>
+void BoostArrays(const LorentzBoost<U> &boost, T *px, T *py, T *pz, T *e, int n)
+{
+  for (int i = 0; i < n; ++i)
+    boost.Apply(px[i], py[i], pz[i], e[i]);
+}
+
+template <typename T>
+class LorentzVector
+{
+private:
+  T fPx, fPy, fPz; // Componenti della quantità di moto
+  T fE;            // Energia
+
+public:
+  // Metodo per calcolare la quantità di moto al quadrato
+  static constexpr T Momentum2(T px, T py, T pz) { return px * px + py * py + pz * pz; }
+
+  // Metodo per calcolare la quantità di moto trasversale al quadrato
+  static constexpr T TransverseMomentum2(T px, T py) { return px * px + py * py; }
+
+  // Metodo per calcolare la massa al quadrato della somma di due quadrivettori dalle loro componenti,
+  // senza costruire la somma
+  static constexpr T MassSquaredOfSum(T e1, T px1, T py1, T pz1, T e2, T px2, T py2, T pz2)
+  {
+    return (e1 + e2) * (e1 + e2) - Momentum2(px1 + px2, py1 + py2, pz1 + pz2);
+  }
+
+  // Metodo per calcolare l'argomento del logaritmo della rapidità, y = log((E + pz) / (E - pz)) / 2;
+  // con il modulo della quantità di moto al posto dell'energia dà la pseudorapidità.
+  // Separato dal logaritmo per i kernel che calcolano i logaritmi in blocco.
+  static constexpr T RapidityRatio(T e, T pz) { return (e + pz) / (e - pz); }
+
+  // Costruttore di default: quadrivettore nullo
+  constexpr LorentzVector() : fPx(0), fPy(0), fPz(0), fE(0) {}
+
+  // Costruttore dalle componenti
+  constexpr LorentzVector(T px, T py, T pz, T e) : fPx(px), fPy(py), fPz(pz), fE(e) {}
+
+  // Costruttore di conversione da un quadrivettore di un'altra precisione
+  template <typename V>
+  constexpr explicit LorentzVector(const LorentzVector<V> &other)
+      : fPx(other.Px()), fPy(other.Py()), fPz(other.Pz()), fE(other.E())
+  {
+  }
+
+  // Metodo per costruire un quadrivettore sul guscio di massa, E = sqrt(m² + p²)
+  // px, py, pz: componenti della quantità di moto
+  // mass2: massa al quadrato
+  static LorentzVector FromMass2(T px, T py, T pz, T mass2)
+  {
+    return LorentzVector(px, py, pz, std::sqrt(mass2 + Momentum2(px, py, pz)));
+  }
+
+  // Metodi per accedere alle componenti
+  constexpr T Px() const { return fPx; }
+  constexpr T Py() const { return fPy; }
+  constexpr T Pz() const { return fPz; }
+  constexpr T E() const { return fE; }
+
+  // Metodo per impostare la quantità di moto lasciando invariata l'energia
+  void SetMomentum(T px, T py, T pz)
+  {
+    fPx = px;
+    fPy = py;
+    fPz = pz;
+  }
+
+  // Metodo per impostare l'energia
+  void SetE(T e) { fE = e; }
+
+  // Metodi per le grandezze derivate
+  constexpr T P2() const { return Momentum2(fPx, fPy, fPz); }
+  constexpr T Pt2() const { return TransverseMomentum2(fPx, fPy); }
+  constexpr T M2() const { return fE * fE - P2(); }
+  T P() const { return std::sqrt(P2()); }
+  T Pt() const { return std::sqrt(Pt2()); }
+  T M() const { return std::sqrt(M2()); }
+  T Phi() const { return std::atan2(fPy, fPx); }
+
+  // Rapidità y = log((E + pz) / (E - pz)) / 2
+  T Rapidity() const { return 0.5 * std::log(RapidityRatio(fE, fPz)); }
+
+  // Pseudorapidità η = asinh(pz / pT) (infinita lungo il fascio, 0 per la quantità di moto nulla)
+  T Eta() const { return fPz == 0 ? 0 : std::asinh(fPz / Pt()); }
+
+  // Somma di due quadrivettori
+  constexpr LorentzVector operator+(const LorentzVector &other) const
+  {
+    return LorentzVector(fPx + other.fPx, fPy + other.fPy, fPz + other.fPz, fE + other.fE);
+  }
+
+  // Metodo per calcolare la massa al quadrato della somma con un altro quadrivettore
+  constexpr T MassSquaredWith(const LorentzVector &other) const
+  {
+    return MassSquaredOfSum(fE, fPx, fPy, fPz, other.fE, other.fPx, other.fPy, other.fPz);
+  }
+
+  // Metodo per applicare un boost, con γ e β già calcolati
+  template <typename U>
+  void Boost(const LorentzBoost<U> &boost)
+  {
+    boost.Apply(fPx, fPy, fPz, fE);
+  }
+};
+
+#endif // LORENTZVECTOR_H
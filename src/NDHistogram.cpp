@@ -0,0 +1,364 @@
+#include "NDHistogram.h"
+#include "AllocationTracker.h"
+#include <cmath>
+#include <cstring>
+#include "TH2F.h"
+#include "TH3F.h"
+#include "THnSparse.h"
+
+// Intestazione del formato nativo
+static const char kMagic[4] = {'N', 'D', 'H', '1'};
+
+// Metodi per scrivere e leggere valori e stringhe nel formato nativo
+template <typename T>
+static void WriteValue(std::ostream &out, const T &value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool ReadValue(std::istream &in, T &value)
+{
+  return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(value));
+}
+
+static void WriteString(std::ostream &out, const std::string &text)
+{
+  WriteValue(out, (int)text.size());
+  out.write(text.data(), text.size());
+}
+
+static bool ReadString(std::istream &in, std::string &text)
+{
+  int length = 0;
+  if (!ReadValue(in, length) || length < 0 || length > (1 << 20))
+    return false;
+  text.resize(length);
+  return length == 0 || (bool)in.read(&text[0], length);
+}
+
+NDHistogram::NDHistogram(const char *name, const char *title, int nDim, const int *nBins, const double *min,
+                         const double *max, NDStorage storage)
+    : fName(name), fTitle(title), fNDim(nDim), fNCells(1), fStorage(storage), fNSparse(0), fEntries(0)
+{
+  for (int d = 0; d < kMaxDimensions; ++d)
+  {
+    fNBins[d] = d < nDim ? nBins[d] : 0;
+    fMin[d] = d < nDim ? min[d] : 0;
+    fMax[d] = d < nDim ? max[d] : 0;
+    fScale[d] = d < nDim ? nBins[d] / (max[d] - min[d]) : 0;
+    fStride[d] = 0;
+  }
+  for (int d = 0; d < nDim; ++d)
+  {
+    fStride[d] = fNCells;
+    fNCells *= fNBins[d] + 2;
+  }
+  if (fStorage == kAutoStorage)
+    fStorage = fNCells <= kMaxDenseCells ? kDenseStorage : kSparseStorage;
+  if (fStorage == kDenseStorage)
+    fDense.assign(fNCells, Cell());
+  else
+  {
+    fSparseKeys.assign(1024, -1);
+    fSparseCells.assign(1024, Cell());
+  }
+}
+
+void NDHistogram::GrowSparse()
+{
+  AllocationStageScope stage(kAllocHistogramGrowth);
+  std::vector<long long> keys(2 * fSparseKeys.size(), -1);
+  std::vector<Cell> cells(2 * fSparseCells.size(), Cell());
+  keys.swap(fSparseKeys);
+  cells.swap(fSparseCells);
+  for (size_t k = 0; k < keys.size(); ++k)
+  {
+    if (keys[k] == -1)
+      continue;
+    const size_t slot = FindSlot(keys[k]);
+    fSparseKeys[slot] = keys[k];
+    fSparseCells[slot] = cells[k];
+  }
+}
+
+const NDHistogram::Cell *NDHistogram::FindCellContent(long long cell) const
+{
+  if (fStorage == kDenseStorage)
+    return &fDense[cell];
+  const size_t slot = FindSlot(cell);
+  return fSparseKeys[slot] == -1 ? 0 : &fSparseCells[slot];
+}
+
+bool NDHistogram::Add(const NDHistogram &other)
+{
+  if (other.fNDim != fNDim)
+    return false;
+  for (int d = 0; d < fNDim; ++d)
+  {
+    if (other.fNBins[d] != fNBins[d] || other.fMin[d] != fMin[d] || other.fMax[d] != fMax[d])
+      return false;
+  }
+
+  if (other.fStorage == kDenseStorage)
+  {
+    for (long long cell = 0; cell < fNCells; ++cell)
+    {
+      const Cell &source = other.fDense[cell];
+      if (source.sumw == 0 && source.sumw2 == 0)
+        continue;
+      Cell &target = GetCell(cell);
+      target.sumw += source.sumw;
+      target.sumw2 += source.sumw2;
+    }
+  }
+  else
+  {
+    for (size_t slot = 0; slot < other.fSparseKeys.size(); ++slot)
+    {
+      if (other.fSparseKeys[slot] == -1)
+        continue;
+      Cell &target = GetCell(other.fSparseKeys[slot]);
+      target.sumw += other.fSparseCells[slot].sumw;
+      target.sumw2 += other.fSparseCells[slot].sumw2;
+    }
+  }
+  fEntries += other.fEntries;
+  return true;
+}
+
+double NDHistogram::GetBinContent(const int *bins) const
+{
+  long long cell = 0;
+  for (int d = 0; d < fNDim; ++d)
+    cell += bins[d] * fStride[d];
+  const Cell *content = FindCellContent(cell);
+  return content ? content->sumw : 0;
+}
+
+double NDHistogram::GetBinError(const int *bins) const
+{
+  long long cell = 0;
+  for (int d = 0; d < fNDim; ++d)
+    cell += bins[d] * fStride[d];
+  const Cell *content = FindCellContent(cell);
+  return content ? std::sqrt(content->sumw2) : 0;
+}
+
+long long NDHistogram::GetNFilledCells() const
+{
+  if (fStorage == kSparseStorage)
+    return fNSparse;
+  long long filled = 0;
+  for (long long cell = 0; cell < fNCells; ++cell)
+  {
+    if (fDense[cell].sumw != 0 || fDense[cell].sumw2 != 0)
+      ++filled;
+  }
+  return filled;
+}
+
+void NDHistogram::GetCells(double *sumw, double *sumw2) const
+{
+  if (fStorage == kDenseStorage)
+  {
+    for (long long cell = 0; cell < fNCells; ++cell)
+    {
+      sumw[cell] = fDense[cell].sumw;
+      sumw2[cell] = fDense[cell].sumw2;
+    }
+    return;
+  }
+  std::memset(sumw, 0, fNCells * sizeof(double));
+  std::memset(sumw2, 0, fNCells * sizeof(double));
+  for (size_t slot = 0; slot < fSparseKeys.size(); ++slot)
+  {
+    if (fSparseKeys[slot] == -1)
+      continue;
+    sumw[fSparseKeys[slot]] = fSparseCells[slot].sumw;
+    sumw2[fSparseKeys[slot]] = fSparseCells[slot].sumw2;
+  }
+}
+
+void NDHistogram::Write(std::ostream &out) const
+{
+  out.write(kMagic, sizeof(kMagic));
+  WriteString(out, fName);
+  WriteString(out, fTitle);
+  WriteValue(out, fNDim);
+  for (int d = 0; d < fNDim; ++d)
+  {
+    WriteValue(out, fNBins[d]);
+    WriteValue(out, fMin[d]);
+    WriteValue(out, fMax[d]);
+    WriteString(out, fAxisTitle[d]);
+  }
+  WriteValue(out, (int)fStorage);
+  WriteValue(out, fEntries);
+
+  // Solo le celle riempite, come coppie (indice globale, somme)
+  WriteValue(out, GetNFilledCells());
+  if (fStorage == kDenseStorage)
+  {
+    for (long long cell = 0; cell < fNCells; ++cell)
+    {
+      if (fDense[cell].sumw == 0 && fDense[cell].sumw2 == 0)
+        continue;
+      WriteValue(out, cell);
+      WriteValue(out, fDense[cell].sumw);
+      WriteValue(out, fDense[cell].sumw2);
+    }
+  }
+  else
+  {
+    for (size_t slot = 0; slot < fSparseKeys.size(); ++slot)
+    {
+      if (fSparseKeys[slot] == -1)
+        continue;
+      WriteValue(out, fSparseKeys[slot]);
+      WriteValue(out, fSparseCells[slot].sumw);
+      WriteValue(out, fSparseCells[slot].sumw2);
+    }
+  }
+}
+
+NDHistogram *NDHistogram::Read(std::istream &in)
+{
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+    return 0;
+  std::string name, title;
+  int nDim = 0;
+  if (!ReadString(in, name) || !ReadString(in, title) || !ReadValue(in, nDim) || nDim < 1 || nDim > kMaxDimensions)
+    return 0;
+  int nBins[kMaxDimensions];
+  double min[kMaxDimensions], max[kMaxDimensions];
+  std::string axisTitle[kMaxDimensions];
+  // Il numero di celle è controllato asse per asse, prima che il prodotto possa superare il limite
+  long long nCells = 1;
+  for (int d = 0; d < nDim; ++d)
+  {
+    if (!ReadValue(in, nBins[d]) || !ReadValue(in, min[d]) || !ReadValue(in, max[d]) || !ReadString(in, axisTitle[d]) ||
+        nBins[d] < 1 || nBins[d] > kMaxReadBins || !(max[d] > min[d]) || nBins[d] + 2 > kMaxReadCells / nCells)
+      return 0;
+    nCells *= nBins[d] + 2;
+  }
+  int storage = 0;
+  double entries = 0;
+  long long nFilled = 0;
+  if (!ReadValue(in, storage) || (storage != kDenseStorage && storage != kSparseStorage) || !ReadValue(in, entries) ||
+      !ReadValue(in, nFilled) || nFilled < 0 || nFilled > nCells)
+    return 0;
+  if (storage == kDenseStorage && nCells > kMaxReadDenseCells)
+    return 0;
+
+  NDHistogram *histogram = new NDHistogram(name.c_str(), title.c_str(), nDim, nBins, min, max, (NDStorage)storage);
+  for (int d = 0; d < nDim; ++d)
+    histogram->fAxisTitle[d] = axisTitle[d];
+  histogram->fEntries = entries;
+  for (long long k = 0; k < nFilled; ++k)
+  {
+    long long cell = 0;
+    Cell content;
+    if (!ReadValue(in, cell) || !ReadValue(in, content.sumw) || !ReadValue(in, content.sumw2) ||
+        cell < 0 || cell >= histogram->fNCells)
+    {
+      delete histogram;
+      return 0;
+    }
+    histogram->GetCell(cell) = content;
+  }
+  return histogram;
+}
+
+void NDHistogram::WriteRoot() const
+{
+  // Indici dei bin di ogni asse a partire dall'indice globale della cella
+  int bins[kMaxDimensions];
+  const bool dense = fStorage == kDenseStorage;
+  if (dense && (fNDim == 2 || fNDim == 3))
+  {
+    TH2F *h2 = 0;
+    TH3F *h3 = 0;
+    if (fNDim == 2)
+    {
+      h2 = new TH2F(fName.c_str(), fTitle.c_str(), fNBins[0], fMin[0], fMax[0], fNBins[1], fMin[1], fMax[1]);
+      h2->SetDirectory(0);
+      h2->Sumw2();
+      h2->GetXaxis()->SetTitle(fAxisTitle[0].c_str());
+      h2->GetYaxis()->SetTitle(fAxisTitle[1].c_str());
+    }
+    else
+    {
+      h3 = new TH3F(fName.c_str(), fTitle.c_str(), fNBins[0], fMin[0], fMax[0], fNBins[1], fMin[1], fMax[1],
+                    fNBins[2], fMin[2], fMax[2]);
+      h3->SetDirectory(0);
+      h3->Sumw2();
+      h3->GetXaxis()->SetTitle(fAxisTitle[0].c_str());
+      h3->GetYaxis()->SetTitle(fAxisTitle[1].c_str());
+      h3->GetZaxis()->SetTitle(fAxisTitle[2].c_str());
+    }
+    for (long long cell = 0; cell < fNCells; ++cell)
+    {
+      const Cell &content = fDense[cell];
+      if (content.sumw == 0 && content.sumw2 == 0)
+        continue;
+      for (int d = 0; d < fNDim; ++d)
+        bins[d] = (int)((cell / fStride[d]) % (fNBins[d] + 2));
+      if (h2)
+      {
+        h2->SetBinContent(bins[0], bins[1], content.sumw);
+        h2->SetBinError(bins[0], bins[1], std::sqrt(content.sumw2));
+      }
+      else
+      {
+        h3->SetBinContent(bins[0], bins[1], bins[2], content.sumw);
+        h3->SetBinError(bins[0], bins[1], bins[2], std::sqrt(content.sumw2));
+      }
+    }
+    if (h2)
+    {
+      h2->SetEntries(fEntries);
+      h2->Write();
+      delete h2;
+    }
+    else
+    {
+      h3->SetEntries(fEntries);
+      h3->Write();
+      delete h3;
+    }
+    return;
+  }
+
+  THnSparseD sparse(fName.c_str(), fTitle.c_str(), fNDim, fNBins, fMin, fMax);
+  sparse.Sumw2();
+  for (int d = 0; d < fNDim; ++d)
+    sparse.GetAxis(d)->SetTitle(fAxisTitle[d].c_str());
+  if (dense)
+  {
+    for (long long cell = 0; cell < fNCells; ++cell)
+    {
+      if (fDense[cell].sumw == 0 && fDense[cell].sumw2 == 0)
+        continue;
+      for (int d = 0; d < fNDim; ++d)
+        bins[d] = (int)((cell / fStride[d]) % (fNBins[d] + 2));
+      sparse.SetBinContent(bins, fDense[cell].sumw);
+      sparse.SetBinError(bins, std::sqrt(fDense[cell].sumw2));
+    }
+  }
+  else
+  {
+    for (size_t slot = 0; slot < fSparseKeys.size(); ++slot)
+    {
+      if (fSparseKeys[slot] == -1)
+        continue;
+      for (int d = 0; d < fNDim; ++d)
+        bins[d] = (int)((fSparseKeys[slot] / fStride[d]) % (fNBins[d] + 2));
+      sparse.SetBinContent(bins, fSparseCells[slot].sumw);
+      sparse.SetBinError(bins, std::sqrt(fSparseCells[slot].sumw2));
+    }
+  }
+  sparse.SetEntries(fEntries);
+  sparse.Write();
+}
@@ -0,0 +1,193 @@
+#ifndef NDHISTOGRAM_H
+#define NDHISTOGRAM_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Memorizzazione dei bin di un istogramma a N dimensioni
+enum NDStorage
+{
+  kAutoStorage,   // Densa se il numero di celle è piccolo, sparsa altrimenti
+  kDenseStorage,  // Array contiguo di tutte le celle
+  kSparseStorage  // Tabella hash (indirizzamento aperto) delle sole celle riempite
+};
+
+// La classe NDHistogram è un istogramma a N dimensioni (fino a kMaxDimensions) con binnatura
+// uniforme su ogni asse e bin di underflow e overflow come in ROOT. Le celle sono memorizzate
+// in un array denso per le forme piccole o in una tabella hash per quelle grandi e quasi vuote;
+// in entrambi i casi si tengono la somma dei pesi e la somma dei pesi al quadrato.
+// Ogni thread di generazione riempie la propria copia, sommata alla fine con Add.
+// Gli istogrammi si salvano nel formato nativo (Write/Read) o si convertono in TH2F, TH3F
+// o THnSparseD con WriteRoot.
+
+class NDHistogram
+{
+public:
+  static const int kMaxDimensions = 4;        // Numero massimo di assi
+  static const long long kMaxDenseCells = 1 << 20; // Celle massime per la memorizzazione densa automatica
+  static const int kMaxReadBins = 1 << 24;             // Bin massimi di un asse letto da file
+  static const long long kMaxReadDenseCells = 1 << 24; // Celle massime di un istogramma denso letto da file
+  static const long long kMaxReadCells = 1LL << 40;    // Celle massime di un istogramma sparso letto da file
+
+private:
+  // Contenuto di una cella
+  struct Cell
+  {
+    double sumw;  // Somma dei pesi
+    double sumw2; // Somma dei pesi al quadrato
+  };
+
+  std::string fName, fTitle;                // Nome e titolo
+  int fNDim;                                // Numero di assi
+  int fNBins[kMaxDimensions];               // Bin di ogni asse (esclusi underflow e overflow)
+  double fMin[kMaxDimensions];              // Estremo inferiore di ogni asse
+  double fMax[kMaxDimensions];              // Estremo superiore di ogni asse
+  double fScale[kMaxDimensions];            // Bin per unità di ogni asse
+  long long fStride[kMaxDimensions];        // Passo dell'indice globale per ogni asse
+  std::string fAxisTitle[kMaxDimensions];   // Titoli degli assi
+  long long fNCells;                        // Numero totale di celle, inclusi underflow e overflow
+  NDStorage fStorage;                       // Memorizzazione (densa o sparsa)
+  std::vector<Cell> fDense;                 // Celle (memorizzazione densa)
+  std::vector<long long> fSparseKeys;       // Indici globali delle celle riempite (-1: posizione libera)
+  std::vector<Cell> fSparseCells;           // Contenuto delle celle riempite, nella stessa posizione
+  long long fNSparse;                       // Celle riempite nella tabella sparsa
+  double fEntries;                          // Numero di riempimenti
+
+  // Metodo per calcolare l'indice globale della cella di un punto
+  long long FindCell(const double *x) const
+  {
+    long long cell = 0;
+    for (int d = 0; d < fNDim; ++d)
+    {
+      int bin;
+      if (!(x[d] >= fMin[d])) // Underflow, inclusi i NaN
+        bin = 0;
+      else if (x[d] >= fMax[d])
+        bin = fNBins[d] + 1;
+      else
+      {
+        bin = 1 + (int)((x[d] - fMin[d]) * fScale[d]);
+        if (bin > fNBins[d]) // Arrotondamento sull'estremo superiore
+          bin = fNBins[d];
+      }
+      cell += bin * fStride[d];
+    }
+    return cell;
+  }
+
+  // Metodo per calcolare la posizione di una cella nella tabella sparsa (scansione lineare)
+  size_t FindSlot(long long cell) const
+  {
+    const size_t mask = fSparseKeys.size() - 1;
+    size_t slot = (size_t)(cell * 0x9E3779B97F4A7C15ULL >> 20) & mask;
+    while (fSparseKeys[slot] != cell && fSparseKeys[slot] != -1)
+      slot = (slot + 1) & mask;
+    return slot;
+  }
+
+  // Metodo per raddoppiare la tabella sparsa
+  void GrowSparse();
+
+  // Metodo per accedere a una cella in scrittura
+  Cell &GetCell(long long cell)
+  {
+    if (fStorage == kDenseStorage)
+      return fDense[cell];
+    size_t slot = FindSlot(cell);
+    if (fSparseKeys[slot] == -1)
+    {
+      // Carico massimo 1/2: la tabella cresce prima di inserire
+      if (2 * (fNSparse + 1) > (long long)fSparseKeys.size())
+      {
+        GrowSparse();
+        slot = FindSlot(cell);
+      }
+      fSparseKeys[slot] = cell;
+      ++fNSparse;
+    }
+    return fSparseCells[slot];
+  }
+
+  // Metodo per leggere una cella (puntatore nullo se vuota)
+  const Cell *FindCellContent(long long cell) const;
+
+public:
+  // Costruttore
+  // name, title: nome e titolo
+  // nDim: numero di assi (da 1 a kMaxDimensions)
+  // nBins, min, max: binnatura di ogni asse
+  // storage: memorizzazione delle celle (kAutoStorage: densa fino a kMaxDenseCells celle)
+  NDHistogram(const char *name, const char *title, int nDim, const int *nBins, const double *min, const double *max,
+              NDStorage storage = kAutoStorage);
+
+  NDHistogram(const NDHistogram &) = delete;
+  NDHistogram &operator=(const NDHistogram &) = delete;
+
+  // Metodo per impostare il titolo di un asse
+  void SetAxisTitle(int axis, const char *title) { fAxisTitle[axis] = title; }
+
+  // Metodo per riempire l'istogramma
+  // x: coordinate del punto (una per asse)
+  // weight: peso
+  void Fill(const double *x, double weight = 1)
+  {
+    Cell &cell = GetCell(FindCell(x));
+    cell.sumw += weight;
+    cell.sumw2 += weight * weight;
+    fEntries += 1;
+  }
+
+  // Metodo per sommare cella per cella un altro istogramma con la stessa binnatura
+  // other: istogramma da sommare (anche con memorizzazione diversa)
+  // return: false se le binnature non coincidono
+  bool Add(const NDHistogram &other);
+
+  // Metodi per leggere il contenuto di una cella
+  // bins: indice del bin su ogni asse (0 underflow, nBins + 1 overflow)
+  double GetBinContent(const int *bins) const;
+  double GetBinError(const int *bins) const;
+
+  // Metodi di accesso
+  const char *GetName() const { return fName.c_str(); }
+  const char *GetTitle() const { return fTitle.c_str(); }
+  const char *GetAxisTitle(int axis) const { return fAxisTitle[axis].c_str(); }
+  int GetNDimensions() const { return fNDim; }
+  int GetNBins(int axis) const { return fNBins[axis]; }
+  double GetMin(int axis) const { return fMin[axis]; }
+  double GetMax(int axis) const { return fMax[axis]; }
+  long long GetNCells() const { return fNCells; }
+  long long GetNFilledCells() const;
+  NDStorage GetStorage() const { return fStorage; }
+  double GetEntries() const { return fEntries; }
+
+  // Metodo per ottenere la memoria allocata per le celle (in byte)
+  long long GetMemoryBytes() const
+  {
+    return (long long)((fDense.capacity() + fSparseCells.capacity()) * sizeof(Cell) +
+                       fSparseKeys.capacity() * sizeof(long long));
+  }
+
+  // Metodo per copiare il contenuto di tutte le celle in array densi, indicizzati dall'indice globale
+  // (primo asse più veloce, underflow e overflow inclusi)
+  // sumw, sumw2: array di GetNCells() valori
+  void GetCells(double *sumw, double *sumw2) const;
+
+  // Metodo per scrivere l'istogramma nel formato nativo (binario)
+  // out: stream di uscita
+  void Write(std::ostream &out) const;
+
+  // Metodo per leggere un istogramma scritto con Write
+  // in: stream di ingresso
+  // return: nuovo istogramma (di proprietà del chiamante) o puntatore nullo se il formato non è valido
+  //         o la binnatura supera kMaxReadBins bin per asse o kMaxReadDenseCells (densa) o kMaxReadCells
+  //         (sparsa) celle
+  static NDHistogram *Read(std::istream &in);
+
+  // Metodo per scrivere l'istogramma nella directory corrente di ROOT: TH2F o TH3F
+  // per 2 e 3 assi con memorizzazione densa, THnSparseD negli altri casi
+  void WriteRoot() const;
+};
+
+#endif // NDHISTOGRAM_H
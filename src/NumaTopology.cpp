@@ -0,0 +1,144 @@
+#include "NumaTopology.h"
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sched.h>
+#include <string>
+
+NodeTables *NodeTables::Create()
+{
+  // Allocazione allineata per la tabella delle specie; le copie sono scritte dal thread chiamante
+  void *memory = 0;
+  if (posix_memalign(&memory, 64, sizeof(NodeTables)) != 0)
+    throw std::bad_alloc();
+  NodeTables *tables = static_cast<NodeTables *>(memory);
+  new (&tables->species) SpeciesTable(Particle::GetSpeciesTable());
+  new (&tables->decays) DecayTable(Particle::GetDecayTable());
+  return tables;
+}
+
+void NodeTables::Deleter::operator()(NodeTables *tables) const
+{
+  tables->~NodeTables();
+  std::free(tables);
+}
+
+std::vector<int> NumaTopology::ParseCpuList(const char *text)
+{
+  std::vector<int> cpus;
+  const char *p = text;
+  while (*p)
+  {
+    char *end = 0;
+    const long first = std::strtol(p, &end, 10);
+    if (end == p)
+      break;
+    long last = first;
+    p = end;
+    if (*p == '-')
+    {
+      last = std::strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; ++cpu)
+      cpus.push_back((int)cpu);
+    if (*p == ',')
+      ++p;
+    else
+      break;
+  }
+  return cpus;
+}
+
+NumaTopology::NumaTopology()
+{
+  // CPU su cui il processo può essere eseguito
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      CPU_SET(cpu, &allowed);
+  }
+
+  // Nodi riportati da Linux, con le sole CPU utilizzabili
+  std::string online;
+  std::ifstream onlineFile("/sys/devices/system/node/online");
+  if (std::getline(onlineFile, online))
+  {
+    const std::vector<int> nodes = ParseCpuList(online.c_str());
+    for (size_t k = 0; k < nodes.size(); ++k)
+    {
+      std::string list;
+      std::ifstream cpuFile(("/sys/devices/system/node/node" + std::to_string(nodes[k]) + "/cpulist").c_str());
+      if (!std::getline(cpuFile, list))
+        continue;
+      const std::vector<int> cpus = ParseCpuList(list.c_str());
+      std::vector<int> usable;
+      for (size_t c = 0; c < cpus.size(); ++c)
+      {
+        if (cpus[c] < CPU_SETSIZE && CPU_ISSET(cpus[c], &allowed))
+          usable.push_back(cpus[c]);
+      }
+      if (!usable.empty())
+      {
+        fNodeIds.push_back(nodes[k]);
+        fCpus.push_back(usable);
+      }
+    }
+  }
+
+  // Senza topologia: un solo nodo con tutte le CPU utilizzabili
+  if (fCpus.empty())
+  {
+    std::vector<int> usable;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (CPU_ISSET(cpu, &allowed))
+        usable.push_back(cpu);
+    }
+    fNodeIds.push_back(0);
+    fCpus.push_back(usable);
+  }
+}
+
+bool NumaTopology::Restrict(int nNodes)
+{
+  if (nNodes < 1 || nNodes > GetNNodes())
+    return false;
+  fNodeIds.resize(nNodes);
+  fCpus.resize(nNodes);
+  return true;
+}
+
+int NumaTopology::GetNCpus() const
+{
+  int count = 0;
+  for (size_t node = 0; node < fCpus.size(); ++node)
+    count += (int)fCpus[node].size();
+  return count;
+}
+
+std::vector<int> NumaTopology::AssignCpus(int nThreads) const
+{
+  // Thread w sul nodo w % nodi; i thread di uno stesso nodo occupano le sue CPU in ordine
+  std::vector<int> cpus(nThreads);
+  const int nNodes = GetNNodes();
+  for (int w = 0; w < nThreads; ++w)
+  {
+    const std::vector<int> &nodeCpus = fCpus[w % nNodes];
+    cpus[w] = nodeCpus[(w / nNodes) % nodeCpus.size()];
+  }
+  return cpus;
+}
+
+void NumaTopology::Print(std::ostream &out) const
+{
+  out << "NUMA topology: " << GetNNodes() << (GetNNodes() == 1 ? " node" : " nodes");
+  for (int node = 0; node < GetNNodes(); ++node)
+  {
+    const std::vector<int> &cpus = fCpus[node];
+    out << (node == 0 ? " (" : ", ") << "node " << fNodeIds[node] << ": " << cpus.size() << " CPUs";
+  }
+  out << ")" << std::endl;
+}
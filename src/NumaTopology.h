@@ -0,0 +1,71 @@
+#ifndef NUMATOPOLOGY_H
+#define NUMATOPOLOGY_H
+
+#include "SpeciesTable.h"
+#include "DecayTable.h"
+#include <ostream>
+#include <vector>
+
+// Copia delle tabelle di sola lettura delle specie e dei canali di decadimento per un nodo NUMA.
+// È creata da un thread del nodo, così che la memoria sia allocata e toccata per la prima volta
+// sul nodo locale, e letta dai generatori dei thread dello stesso nodo.
+struct NodeTables
+{
+  SpeciesTable species; // Copia di Particle::GetSpeciesTable()
+  DecayTable decays;    // Copia di Particle::GetDecayTable()
+
+  // Metodo per creare una copia delle tabelle di Particle dal thread chiamante
+  // return: nuova copia, allineata a 64 byte, da distruggere con Deleter
+  static NodeTables *Create();
+
+  // Distruttore per std::unique_ptr
+  struct Deleter
+  {
+    void operator()(NodeTables *tables) const;
+  };
+};
+
+// La classe NumaTopology descrive i nodi NUMA e le CPU utilizzabili dal processo, letti da
+// /sys/devices/system/node e intersecati con l'affinità del processo. Se Linux non riporta
+// la topologia, tutte le CPU utilizzabili formano un solo nodo.
+// I thread di lavoro sono distribuiti a turno tra i nodi (thread w sul nodo w % nodi), così che
+// con pochi thread siano usati tutti i nodi scelti, e ogni thread è fissato a una CPU del proprio nodo.
+
+class NumaTopology
+{
+private:
+  std::vector<int> fNodeIds;            // Numeri dei nodi secondo Linux
+  std::vector<std::vector<int>> fCpus;  // CPU utilizzabili di ogni nodo
+
+  // Metodo per leggere una lista di CPU nel formato di Linux (es. "0-3,8-11")
+  static std::vector<int> ParseCpuList(const char *text);
+
+public:
+  // Costruttore che legge la topologia del sistema
+  NumaTopology();
+
+  // Metodo per limitare la topologia ai primi nNodes nodi
+  // return: false se nNodes non è tra 1 e il numero di nodi
+  bool Restrict(int nNodes);
+
+  // Metodi di accesso ai nodi
+  int GetNNodes() const { return (int)fCpus.size(); }
+  int GetNodeId(int node) const { return fNodeIds[node]; }
+  const std::vector<int> &GetCpus(int node) const { return fCpus[node]; }
+  int GetNCpus() const;
+
+  // Metodo per ottenere il nodo di un thread di lavoro
+  // worker: indice del thread
+  int GetWorkerNode(int worker) const { return worker % GetNNodes(); }
+
+  // Metodo per scegliere la CPU di ogni thread di lavoro
+  // nThreads: numero di thread
+  // return: CPU di ogni thread
+  std::vector<int> AssignCpus(int nThreads) const;
+
+  // Metodo per stampare nodi e CPU
+  // out: stream di uscita
+  void Print(std::ostream &out) const;
+};
+
+#endif // NUMATOPOLOGY_H
@@ -0,0 +1,221 @@
+#include "OutputWriter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Compression.h"
+#include "TFile.h"
+
+// Nomi e livelli di default degli algoritmi di compressione
+struct CompressionCodec
+{
+  const char *name;                                    // Nome sulla riga di comando
+  ROOT::RCompressionSetting::EAlgorithm::EValues algorithm; // Algoritmo di ROOT
+  int defaultLevel;                                    // Livello se non indicato
+};
+
+static const CompressionCodec kCodecs[] = {
+    {"zlib", ROOT::RCompressionSetting::EAlgorithm::kZLIB, ROOT::RCompressionSetting::ELevel::kDefaultZLIB},
+    {"lz4", ROOT::RCompressionSetting::EAlgorithm::kLZ4, ROOT::RCompressionSetting::ELevel::kDefaultLZ4},
+    {"zstd", ROOT::RCompressionSetting::EAlgorithm::kZSTD, ROOT::RCompressionSetting::ELevel::kDefaultZSTD}};
+static const int kNCodecs = sizeof(kCodecs) / sizeof(kCodecs[0]);
+
+OutputWriter::OutputWriter(const std::string &path, int compression)
+    : fPath(path), fCompression(compression), fPendingEvents(0), fPendingReplaced(0), fHasPending(false),
+      fWriting(false), fStop(false), fNSnapshots(0), fLastOk(true)
+{
+  fThread = std::thread(&OutputWriter::WriterLoop, this);
+}
+
+OutputWriter::~OutputWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fAvailable.notify_all();
+  fThread.join();
+}
+
+void OutputWriter::Submit(const std::function<void()> &write, long long events)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPendingReplaced = fHasPending ? fPendingReplaced + 1 : 0;
+    fPending = write;
+    fPendingEvents = events;
+    fHasPending = true;
+    ++fNSnapshots;
+  }
+  fAvailable.notify_one();
+}
+
+bool OutputWriter::Wait()
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  fIdle.wait(lock, [this]() { return !fHasPending && !fWriting; });
+  return fLastOk;
+}
+
+void OutputWriter::PrintReports(std::ostream &out)
+{
+  std::vector<OutputReport> reports;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    reports.swap(fReports);
+  }
+  for (size_t k = 0; k < reports.size(); ++k)
+  {
+    const OutputReport &report = reports[k];
+    if (!report.ok)
+    {
+      out << "Snapshot " << report.snapshot << " (" << report.events << " events): cannot write " << fPath
+          << std::endl;
+      continue;
+    }
+    const double megabytes = report.bytes / 1e6;
+    out << "Snapshot " << report.snapshot << " (" << report.events << " events): " << megabytes << " MB written to "
+        << fPath << " in " << report.seconds << " s";
+    if (report.seconds > 0)
+      out << " (" << megabytes / report.seconds << " MB/s)";
+    out << ", " << GetCompressionName(fCompression);
+    if (report.replaced > 0)
+      out << ", " << report.replaced << " older snapshots replaced";
+    out << std::endl;
+  }
+}
+
+void OutputWriter::WriterLoop()
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  for (;;)
+  {
+    fAvailable.wait(lock, [this]() { return fStop || fHasPending; });
+    if (!fHasPending)
+      return;
+
+    // L'istantanea in attesa passa in scrittura: il posto si libera per la successiva
+    std::function<void()> write;
+    write.swap(fPending);
+    OutputReport report;
+    report.snapshot = fNSnapshots;
+    report.events = fPendingEvents;
+    report.replaced = fPendingReplaced;
+    fHasPending = false;
+    fWriting = true;
+    lock.unlock();
+
+    WriteSnapshot(write, report);
+    write = std::function<void()>(); // Rilascia gli oggetti dell'istantanea
+
+    lock.lock();
+    fWriting = false;
+    fLastOk = report.ok;
+    fReports.push_back(report);
+    if (!fHasPending)
+      fIdle.notify_all();
+  }
+}
+
+void OutputWriter::WriteSnapshot(const std::function<void()> &write, OutputReport &report) const
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  report.bytes = 0;
+  report.ok = false;
+
+  // File temporaneo con nome unico nella stessa directory, così che due simulazioni che scrivono
+  // lo stesso file non usino lo stesso temporaneo e il rename resti nello stesso filesystem.
+  // mkstemp lo crea con permessi 0600: si usano quelli abituali di un file di uscita.
+  std::vector<char> temporary(fPath.begin(), fPath.end());
+  static const char kSuffix[] = ".XXXXXX";
+  temporary.insert(temporary.end(), kSuffix, kSuffix + sizeof(kSuffix));
+  const int created = mkstemp(temporary.data());
+  if (created < 0)
+  {
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return;
+  }
+  fchmod(created, 0644);
+  close(created);
+  {
+    TFile file(temporary.data(), "RECREATE", "", fCompression);
+    if (file.IsZombie())
+    {
+      std::remove(temporary.data());
+      report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return;
+    }
+    write();
+    file.Close();
+  }
+
+  // Sincronizzazione su disco prima del rename, così che dopo un crash il file finale sia
+  // quello precedente o quello nuovo completo
+  const int descriptor = open(temporary.data(), O_RDONLY);
+  if (descriptor >= 0)
+  {
+    struct stat status;
+    if (fstat(descriptor, &status) == 0)
+      report.bytes = (long long)status.st_size;
+    report.ok = fsync(descriptor) == 0 && report.bytes > 0;
+    close(descriptor);
+  }
+  if (report.ok)
+    report.ok = std::rename(temporary.data(), fPath.c_str()) == 0;
+  else
+    std::remove(temporary.data());
+
+  // Sincronizzazione della directory, che rende persistente il rename stesso
+  if (report.ok)
+  {
+    const size_t slash = fPath.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : fPath.substr(0, slash);
+    const int directoryDescriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    report.ok = directoryDescriptor >= 0 && fsync(directoryDescriptor) == 0;
+    if (directoryDescriptor >= 0)
+      close(directoryDescriptor);
+  }
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OutputWriter::ParseCompression(const char *spec, int &compression)
+{
+  if (std::strcmp(spec, "none") == 0)
+  {
+    compression = 0;
+    return true;
+  }
+  const char *colon = std::strchr(spec, ':');
+  const size_t length = colon ? (size_t)(colon - spec) : std::strlen(spec);
+  for (int k = 0; k < kNCodecs; ++k)
+  {
+    if (std::strlen(kCodecs[k].name) != length || std::strncmp(spec, kCodecs[k].name, length) != 0)
+      continue;
+    int level = kCodecs[k].defaultLevel;
+    if (colon)
+    {
+      char *end = 0;
+      level = (int)std::strtol(colon + 1, &end, 10);
+      if (end == colon + 1 || *end != '\0' || level < 1 || level > 9)
+        return false;
+    }
+    compression = ROOT::CompressionSettings(kCodecs[k].algorithm, level);
+    return true;
+  }
+  return false;
+}
+
+std::string OutputWriter::GetCompressionName(int compression)
+{
+  if (compression % 100 == 0)
+    return "uncompressed";
+  for (int k = 0; k < kNCodecs; ++k)
+  {
+    if (compression / 100 == kCodecs[k].algorithm)
+      return std::string(kCodecs[k].name) + ":" + std::to_string(compression % 100);
+  }
+  return "compression " + std::to_string(compression);
+}
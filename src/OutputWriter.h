@@ -0,0 +1,99 @@
+#ifndef OUTPUTWRITER_H
+#define OUTPUTWRITER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Esito della scrittura di un'istantanea
+struct OutputReport
+{
+  long long snapshot; // Numero progressivo dell'istantanea (da 1)
+  long long events;   // Eventi contenuti nell'istantanea
+  long long bytes;    // Dimensione del file scritto
+  double seconds;     // Tempo di serializzazione, compressione e scrittura
+  int replaced;       // Istantanee precedenti sostituite da questa prima di essere scritte
+  bool ok;            // File scritto e rinominato correttamente
+};
+
+// La classe OutputWriter scrive i risultati della simulazione su file ROOT in un thread dedicato,
+// così che la generazione non si fermi durante serializzazione e compressione.
+// Le istantanee sono doppiamente bufferizzate: mentre una è in scrittura ne può essere in attesa
+// al più un'altra; un'istantanea inviata quando ce n'è già una in attesa la sostituisce (conta solo
+// la più recente). Ogni istantanea è una funzione che scrive oggetti di sua proprietà nella directory
+// corrente di ROOT: è eseguita con un file temporaneo aperto (<file>.XXXXXX, unico anche tra
+// simulazioni concorrenti), che dopo la chiusura e la sincronizzazione su disco sostituisce il file
+// finale con un rename atomico, seguito dalla sincronizzazione della directory, così che un lettore
+// concorrente o un crash non vedano mai un file troncato.
+// La compressione usa gli algoritmi di ROOT (zlib, lz4, zstd) con il livello scelto.
+// I programmi che usano OutputWriter devono chiamare ROOT::EnableThreadSafety().
+
+class OutputWriter
+{
+private:
+  std::string fPath;                    // File di uscita
+  int fCompression;                     // Impostazione di compressione di ROOT (algoritmo * 100 + livello)
+  std::thread fThread;                  // Thread di scrittura
+  std::mutex fMutex;                    // Protegge istantanea in attesa, stato e resoconti
+  std::condition_variable fAvailable;   // Segnala una nuova istantanea o la chiusura
+  std::condition_variable fIdle;        // Segnala che nessuna istantanea è in attesa o in scrittura
+  std::function<void()> fPending;       // Istantanea in attesa di scrittura
+  long long fPendingEvents;             // Eventi dell'istantanea in attesa
+  int fPendingReplaced;                 // Istantanee sostituite da quella in attesa
+  bool fHasPending;                     // È presente un'istantanea in attesa
+  bool fWriting;                        // Un'istantanea è in scrittura
+  bool fStop;                           // Richiesta di chiusura del thread
+  long long fNSnapshots;                // Istantanee inviate
+  std::vector<OutputReport> fReports;   // Resoconti non ancora stampati
+  bool fLastOk;                         // Esito dell'ultima istantanea scritta
+
+  // Loop eseguito dal thread di scrittura
+  void WriterLoop();
+
+  // Metodo per scrivere un'istantanea nel file temporaneo e rinominarlo
+  // write: funzione che scrive gli oggetti nella directory corrente
+  // report: resoconto da completare con dimensione, tempo ed esito
+  void WriteSnapshot(const std::function<void()> &write, OutputReport &report) const;
+
+public:
+  // Costruttore che avvia il thread di scrittura
+  // path: file di uscita
+  // compression: impostazione di compressione di ROOT (vedi ParseCompression)
+  OutputWriter(const std::string &path, int compression);
+
+  // Il distruttore scrive l'eventuale istantanea in attesa e chiude il thread
+  ~OutputWriter();
+
+  OutputWriter(const OutputWriter &) = delete;
+  OutputWriter &operator=(const OutputWriter &) = delete;
+
+  // Metodo per inviare un'istantanea; ritorna subito
+  // write: funzione che scrive gli oggetti nella directory corrente di ROOT; gli oggetti devono
+  //        restare validi e non essere modificati finché la funzione non è stata eseguita
+  //        (di norma sono copie catturate con std::shared_ptr, rilasciate dopo la scrittura)
+  // events: eventi contenuti nell'istantanea
+  void Submit(const std::function<void()> &write, long long events);
+
+  // Metodo per attendere che tutte le istantanee inviate siano state scritte
+  // return: esito dell'ultima istantanea scritta
+  bool Wait();
+
+  // Metodo per stampare i resoconti delle istantanee scritte dall'ultima chiamata
+  // out: stream di uscita
+  void PrintReports(std::ostream &out);
+
+  // Metodo per leggere l'impostazione di compressione dalla riga di comando
+  // spec: none, zlib, lz4 o zstd, con livello opzionale (es. zstd:5)
+  // compression: impostazione di compressione di ROOT
+  // return: false se il formato non è valido
+  static bool ParseCompression(const char *spec, int &compression);
+
+  // Metodo per ottenere il nome di un'impostazione di compressione (es. "zstd:5")
+  static std::string GetCompressionName(int compression);
+};
+
+#endif // OUTPUTWRITER_H
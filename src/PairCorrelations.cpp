@@ -0,0 +1,318 @@
+#include "PairCorrelations.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "TH1F.h"
+#include "TH2F.h"
+
+// Estremi degli assi
+static const double kDeltaPhiMin = -M_PI / 2;
+static const double kDeltaEtaMax = 2;
+static const double kQinvMax = 2;
+
+// Limite della pseudorapidità delle particelle (ben fuori dall'asse di Δη): Δη in unità di bin
+// resta rappresentabile come intero
+static const double kEtaLimit = 100;
+
+PairCorrelations::PairCorrelations(int mixingStride)
+    : fMixingStride(mixingStride > 0 ? mixingStride : 1), fN(0), fHasPrevious(false), fPreviousMasked(false),
+      fSameDeltaPhiDeltaEta(kDeltaPhiBins * (kDeltaEtaBins + 2) + 1),
+      fMixedDeltaPhiDeltaEta(kDeltaPhiBins * (kDeltaEtaBins + 2) + 1), fSameQinv(kQinvBins + 3), fMixedQinv(kQinvBins + 3)
+{
+}
+
+void PairCorrelations::Reserve(int n)
+{
+  if ((int)fPhi.size() < n)
+  {
+    fPhi.resize(n);
+    fEta.resize(n);
+    fMass.resize(n);
+  }
+  if ((int)fPreviousPhi.size() < n)
+  {
+    fPreviousPhi.resize(n);
+    fPreviousEta.resize(n);
+    fPreviousMass.resize(n);
+  }
+  if ((int)fBin.size() < n)
+  {
+    fBin.resize(n);
+    fQinvBin.resize(n);
+    fQinv2.resize(n);
+  }
+  if ((int)fMixedMasses.size() < n)
+    fMixedMasses.resize(n);
+  if ((int)fPreviousMask.size() < n)
+    fPreviousMask.resize(n);
+  fPrevious.Reserve(n);
+}
+
+void PairCorrelations::BeginEvent(const EventSoA<Real> &ev, const Particle *particles)
+{
+  const int n = ev.n;
+  if ((int)fPhi.size() < n)
+  {
+    fPhi.resize(n);
+    fEta.resize(n);
+    fMass.resize(n);
+  }
+  if ((int)fBin.size() < n)
+  {
+    fBin.resize(n);
+    fQinvBin.resize(n);
+    fQinv2.resize(n);
+  }
+  fN = n;
+
+  // Angolo azimutale, pseudorapidità e massa di ogni particella, calcolati una sola volta per evento
+  const SpeciesTable &species = Particle::GetSpeciesTable();
+  for (int i = 0; i < n; ++i)
+  {
+    const LorentzVector<double> p(ev.px[i], ev.py[i], ev.pz[i], ev.e[i]);
+    fPhi[i] = p.Phi();
+    const double eta = p.Pt2() > 0 ? p.Eta() : (p.Pz() >= 0 ? kEtaLimit : -kEtaLimit); // Lungo il fascio
+    fEta[i] = std::min(std::max(eta, -kEtaLimit), kEtaLimit);
+    fMass[i] = species[particles[i].GetParticleTypeIndex()].mass;
+  }
+}
+
+void PairCorrelations::FillRow(double *deltaPhiDeltaEta, double *qinv, double phi, double eta, double mass,
+                               const double *partnerPhi, const double *partnerEta, const double *partnerMass,
+                               const Real *masses, const unsigned char *mask, int count)
+{
+  const double phiScale = kDeltaPhiBins / (2 * M_PI);
+  const double etaScale = kDeltaEtaBins / (2 * kDeltaEtaMax);
+  const double qinvScale = kQinvBins / kQinvMax;
+  const int discard = kDeltaPhiBins * (kDeltaEtaBins + 2); // Bin di scarto (Δφ, Δη)
+  const int qinvDiscard = kQinvBins + 2;                     // Bin di scarto q_inv
+  int *bin = fBin.data();
+  int *qinvBin = fQinvBin.data();
+  double *qinv2 = fQinv2.data();
+
+  // Bin (Δφ, Δη) e q_inv^2 di tutte le coppie della riga, senza rami: le coordinate in unità di bin
+  // sono convertite a intero e poi limitate ai bin di underflow e overflow
+  for (int j = 0; j < count; ++j)
+  {
+    // Δφ riportato in [-π/2, 3π/2)
+    double deltaPhi = phi - partnerPhi[j];
+    deltaPhi += deltaPhi < kDeltaPhiMin ? 2 * M_PI : 0;
+    deltaPhi -= deltaPhi >= kDeltaPhiMin + 2 * M_PI ? 2 * M_PI : 0;
+    int phiBin = (int)((deltaPhi - kDeltaPhiMin) * phiScale);
+    phiBin = phiBin < kDeltaPhiBins ? phiBin : kDeltaPhiBins - 1; // Arrotondamento sull'estremo superiore
+
+    // Bin di Δη in [0, kDeltaEtaBins + 1] (la troncatura verso zero manda (-1, 1) nell'underflow)
+    int etaBin = (int)((eta - partnerEta[j] + kDeltaEtaMax) * etaScale + 1);
+    etaBin = etaBin > 0 ? etaBin : 0;
+    etaBin = etaBin < kDeltaEtaBins + 1 ? etaBin : kDeltaEtaBins + 1;
+    bin[j] = phiBin * (kDeltaEtaBins + 2) + etaBin;
+
+    // q_inv^2 = (M^2 - (m1 + m2)^2) (M^2 - (m1 - m2)^2) / M^2, negativa sotto soglia
+    const double s = (double)masses[j] * masses[j];
+    const double sum = mass + partnerMass[j];
+    const double difference = mass - partnerMass[j];
+    qinv2[j] = (s - sum * sum) * (s - difference * difference) / s;
+  }
+
+  // Bin di q_inv in [0, kQinvBins + 1] (la radice non è vettorizzata, quindi è in un loop separato):
+  // la radice con il segno di q_inv^2 manda le coppie sotto soglia nell'underflow
+  for (int j = 0; j < count; ++j)
+  {
+    const double q = std::copysign(std::sqrt(std::fabs(qinv2[j])), qinv2[j]);
+    int b = (int)(q * qinvScale + 1);
+    b = b > 0 ? b : 0;
+    qinvBin[j] = b < kQinvBins + 1 ? b : kQinvBins + 1;
+  }
+
+  // Coppie non selezionate nei bin di scarto
+  if (mask)
+  {
+    for (int j = 0; j < count; ++j)
+    {
+      const int b = bin[j], qb = qinvBin[j];
+      bin[j] = mask[j] ? b : discard;
+      qinvBin[j] = mask[j] ? qb : qinvDiscard;
+    }
+  }
+
+  // Incremento dei conteggi
+  for (int j = 0; j < count; ++j)
+  {
+    deltaPhiDeltaEta[bin[j]] += 1;
+    qinv[qinvBin[j]] += 1;
+  }
+}
+
+void PairCorrelations::EndEvent(const EventSoA<Real> &ev, EventSelection &selection)
+{
+  // Coppie mescolate: una particella ogni fMixingStride dell'evento corrente con tutte
+  // le particelle dell'evento precedente, con i tagli degli istogrammi principali
+  if (fHasPrevious)
+  {
+    if ((int)fMixedMasses.size() < fPrevious.n)
+      fMixedMasses.resize(fPrevious.n);
+    if ((int)fBin.size() < fPrevious.n)
+    {
+      fBin.resize(fPrevious.n);
+      fQinvBin.resize(fPrevious.n);
+      fQinv2.resize(fPrevious.n);
+    }
+    const unsigned char *previousMask = fPreviousMasked ? fPreviousMask.data() : 0;
+    for (int i = 0; i < fN; i += fMixingStride)
+    {
+      PairInvariantMassesCross(ev, i, fPrevious, fMixedMasses.data());
+      const unsigned char *mask = selection.EvaluateMixedRow(0, ev, i, fPrevious, previousMask, fMixedMasses.data());
+      FillRow(fMixedDeltaPhiDeltaEta.data(), fMixedQinv.data(), fPhi[i], fEta[i], fMass[i], fPreviousPhi.data(),
+              fPreviousEta.data(), fPreviousMass.data(), fMixedMasses.data(), mask, fPrevious.n);
+    }
+  }
+
+  // L'evento corrente diventa l'evento precedente: le colonne sono scambiate, la cinematica copiata
+  fPhi.swap(fPreviousPhi);
+  fEta.swap(fPreviousEta);
+  fMass.swap(fPreviousMass);
+  fPrevious.n = ev.n;
+  fPrevious.Reserve(ev.n);
+  std::memcpy(fPrevious.px.data(), ev.px.data(), ev.n * sizeof(Real));
+  std::memcpy(fPrevious.py.data(), ev.py.data(), ev.n * sizeof(Real));
+  std::memcpy(fPrevious.pz.data(), ev.pz.data(), ev.n * sizeof(Real));
+  std::memcpy(fPrevious.e.data(), ev.e.data(), ev.n * sizeof(Real));
+  const unsigned char *mask = selection.GetParticleMask(0);
+  fPreviousMasked = mask != 0;
+  if (mask)
+  {
+    if ((int)fPreviousMask.size() < ev.n)
+      fPreviousMask.resize(ev.n);
+    std::memcpy(fPreviousMask.data(), mask, ev.n);
+  }
+  fHasPrevious = true;
+}
+
+void PairCorrelations::Add(const PairCorrelations &other)
+{
+  for (size_t k = 0; k < fSameDeltaPhiDeltaEta.size(); ++k)
+  {
+    fSameDeltaPhiDeltaEta[k] += other.fSameDeltaPhiDeltaEta[k];
+    fMixedDeltaPhiDeltaEta[k] += other.fMixedDeltaPhiDeltaEta[k];
+  }
+  for (size_t k = 0; k < fSameQinv.size(); ++k)
+  {
+    fSameQinv[k] += other.fSameQinv[k];
+    fMixedQinv[k] += other.fMixedQinv[k];
+  }
+}
+
+void PairCorrelations::GetSameEventDeltaPhi(double *counts) const
+{
+  for (int p = 0; p < kDeltaPhiBins; ++p)
+  {
+    counts[p] = 0;
+    for (int e = 0; e < kDeltaEtaBins + 2; ++e)
+      counts[p] += fSameDeltaPhiDeltaEta[p * (kDeltaEtaBins + 2) + e];
+  }
+}
+
+// Metodo per calcolare la funzione di correlazione di un bin: rapporto tra i conteggi dello stesso
+// evento e mescolati, ciascuno normalizzato al proprio totale, con l'errore statistico
+static void Correlation(double same, double mixed, double sameTotal, double mixedTotal, double &value, double &error)
+{
+  value = 0;
+  error = 0;
+  if (same <= 0 || mixed <= 0 || sameTotal <= 0 || mixedTotal <= 0)
+    return;
+  value = (same / sameTotal) / (mixed / mixedTotal);
+  error = value * std::sqrt(1 / same + 1 / mixed);
+}
+
+void PairCorrelations::Write() const
+{
+  // Simmetrizzazione in (-Δφ, -Δη): il bin p di Δφ corrisponde a (kDeltaPhiBins / 2 - 1 - p) modulo
+  // kDeltaPhiBins, il bin e di Δη a kDeltaEtaBins - 1 - e. Underflow, overflow e bin di scarto sono esclusi.
+  std::vector<double> sameSymmetric(kDeltaPhiBins * kDeltaEtaBins), mixedSymmetric(kDeltaPhiBins * kDeltaEtaBins);
+  double sameTotal = 0, mixedTotal = 0;
+  for (int p = 0; p < kDeltaPhiBins; ++p)
+  {
+    const int mirrorP = (kDeltaPhiBins / 2 - 1 - p + kDeltaPhiBins) % kDeltaPhiBins;
+    for (int e = 0; e < kDeltaEtaBins; ++e)
+    {
+      const int k = p * kDeltaEtaBins + e;
+      const int cell = p * (kDeltaEtaBins + 2) + e + 1;
+      const int mirror = mirrorP * (kDeltaEtaBins + 2) + (kDeltaEtaBins - e);
+      sameSymmetric[k] = fSameDeltaPhiDeltaEta[cell] + fSameDeltaPhiDeltaEta[mirror];
+      mixedSymmetric[k] = fMixedDeltaPhiDeltaEta[cell] + fMixedDeltaPhiDeltaEta[mirror];
+      sameTotal += sameSymmetric[k];
+      mixedTotal += mixedSymmetric[k];
+    }
+  }
+  TH2F same("hDeltaPhiDeltaEta", "Pair #Delta#phi-#Delta#eta (Same Event)", kDeltaPhiBins, kDeltaPhiMin,
+            kDeltaPhiMin + 2 * M_PI, kDeltaEtaBins, -kDeltaEtaMax, kDeltaEtaMax);
+  TH2F mixed("hDeltaPhiDeltaEtaMixed", "Pair #Delta#phi-#Delta#eta (Mixed Events)", kDeltaPhiBins, kDeltaPhiMin,
+             kDeltaPhiMin + 2 * M_PI, kDeltaEtaBins, -kDeltaEtaMax, kDeltaEtaMax);
+  TH2F correlation("hDeltaPhiDeltaEtaCorrelation", "Correlation Function C(#Delta#phi, #Delta#eta)", kDeltaPhiBins,
+                   kDeltaPhiMin, kDeltaPhiMin + 2 * M_PI, kDeltaEtaBins, -kDeltaEtaMax, kDeltaEtaMax);
+  TH2F *histograms2D[3] = {&same, &mixed, &correlation};
+  for (int h = 0; h < 3; ++h)
+  {
+    histograms2D[h]->SetDirectory(0);
+    histograms2D[h]->Sumw2();
+    histograms2D[h]->GetXaxis()->SetTitle("#Delta#phi (rad)");
+    histograms2D[h]->GetYaxis()->SetTitle("#Delta#eta");
+  }
+  for (int p = 0; p < kDeltaPhiBins; ++p)
+  {
+    for (int e = 0; e < kDeltaEtaBins; ++e)
+    {
+      const double s = sameSymmetric[p * kDeltaEtaBins + e];
+      const double m = mixedSymmetric[p * kDeltaEtaBins + e];
+      double value, error;
+      Correlation(s, m, sameTotal, mixedTotal, value, error);
+      same.SetBinContent(p + 1, e + 1, s);
+      same.SetBinError(p + 1, e + 1, std::sqrt(s));
+      mixed.SetBinContent(p + 1, e + 1, m);
+      mixed.SetBinError(p + 1, e + 1, std::sqrt(m));
+      correlation.SetBinContent(p + 1, e + 1, value);
+      correlation.SetBinError(p + 1, e + 1, error);
+    }
+  }
+  same.SetEntries(sameTotal);
+  mixed.SetEntries(mixedTotal);
+  same.Write();
+  mixed.Write();
+  correlation.Write();
+
+  double sameQinvTotal = 0, mixedQinvTotal = 0;
+  for (int k = 1; k <= kQinvBins; ++k)
+  {
+    sameQinvTotal += fSameQinv[k];
+    mixedQinvTotal += fMixedQinv[k];
+  }
+  TH1F sameQinv("hQinv", "Pair q_{inv} (Same Event)", kQinvBins, 0, kQinvMax);
+  TH1F mixedQinv("hQinvMixed", "Pair q_{inv} (Mixed Events)", kQinvBins, 0, kQinvMax);
+  TH1F correlationQinv("hQinvCorrelation", "Correlation Function C(q_{inv})", kQinvBins, 0, kQinvMax);
+  TH1F *histograms1D[3] = {&sameQinv, &mixedQinv, &correlationQinv};
+  for (int h = 0; h < 3; ++h)
+  {
+    histograms1D[h]->SetDirectory(0);
+    histograms1D[h]->Sumw2();
+    histograms1D[h]->GetXaxis()->SetTitle("q_{inv} (GeV/c)");
+  }
+  // Conteggi con la stessa numerazione dei bin di ROOT (underflow: coppie sotto soglia)
+  for (int k = 0; k <= kQinvBins + 1; ++k)
+  {
+    sameQinv.SetBinContent(k, fSameQinv[k]);
+    sameQinv.SetBinError(k, std::sqrt(fSameQinv[k]));
+    mixedQinv.SetBinContent(k, fMixedQinv[k]);
+    mixedQinv.SetBinError(k, std::sqrt(fMixedQinv[k]));
+    if (k == 0 || k == kQinvBins + 1)
+      continue;
+    double value, error;
+    Correlation(fSameQinv[k], fMixedQinv[k], sameQinvTotal, mixedQinvTotal, value, error);
+    correlationQinv.SetBinContent(k, value);
+    correlationQinv.SetBinError(k, error);
+  }
+  sameQinv.SetEntries(sameQinvTotal);
+  mixedQinv.SetEntries(mixedQinvTotal);
+  sameQinv.Write();
+  mixedQinv.Write();
+  correlationQinv.Write();
+}
@@ -0,0 +1,102 @@
+#ifndef PAIRCORRELATIONS_H
+#define PAIRCORRELATIONS_H
+
+#include "PairKernel.h"
+#include "EventSelection.h"
+#include <vector>
+
+// La classe PairCorrelations riempie le correlazioni a due particelle (Δφ, Δη) e la distribuzione
+// del momento relativo q_inv nello stesso passaggio del kernel delle masse invarianti:
+// per ogni riga di coppie riusa la cinematica SoA, le masse invarianti già calcolate
+// (q_inv = 2 k*, con k* impulso nel sistema di riposo della coppia, si ricava da M e dalle masse)
+// e le maschere di selezione degli istogrammi principali.
+// La normalizzazione usa il mescolamento degli eventi: una particella ogni fMixingStride dell'evento
+// corrente è accoppiata con tutte le particelle dell'evento precedente dello stesso thread,
+// con gli stessi tagli; la funzione di correlazione è il rapporto tra le distribuzioni dello
+// stesso evento e mescolata, ciascuna normalizzata al proprio numero di coppie.
+// L'ordine delle particelle nell'evento non è casuale (i prodotti di decadimento sono in coda),
+// quindi la distribuzione in (Δφ, Δη) è simmetrizzata rispetto a (-Δφ, -Δη) in scrittura.
+// Ogni riga è riempita in due passaggi: prima i bin di tutte le coppie (loop senza rami,
+// vettorizzabile; le coppie scartate o fuori dagli assi finiscono in un bin di scarto),
+// poi l'incremento dei conteggi.
+
+class PairCorrelations
+{
+public:
+  static const int kDeltaPhiBins = 36; // Bin in Δφ, in [-π/2, 3π/2)
+  static const int kDeltaEtaBins = 40; // Bin in Δη, in [-2, 2)
+  static const int kQinvBins = 200;    // Bin in q_inv, in [0, 2) GeV/c
+
+private:
+  int fMixingStride; // Passo delle particelle dell'evento corrente usate nel mescolamento
+  int fN;            // Particelle dell'evento corrente
+  bool fHasPrevious; // È disponibile un evento precedente per il mescolamento
+
+  // Colonne per particella dell'evento corrente e dell'evento precedente (mescolamento)
+  std::vector<double> fPhi, fEta, fMass;
+  std::vector<double> fPreviousPhi, fPreviousEta, fPreviousMass;
+  std::vector<unsigned char> fPreviousMask;   // Maschera delle particelle dell'evento precedente
+  bool fPreviousMasked;                       // L'evento precedente ha una maschera delle particelle
+  EventSoA<Real> fPrevious;                   // Cinematica dell'evento precedente
+  std::vector<Real> fMixedMasses;             // Masse invarianti di una riga mescolata
+  std::vector<int> fBin, fQinvBin;            // Bin delle coppie di una riga
+  std::vector<double> fQinv2;                 // q_inv^2 delle coppie di una riga
+
+  // Conteggi nei bin (senza underflow e overflow, più un bin di scarto finale): stesso evento e mescolati
+  std::vector<double> fSameDeltaPhiDeltaEta, fMixedDeltaPhiDeltaEta;
+  std::vector<double> fSameQinv, fMixedQinv;
+
+  // Metodo per riempire una riga di coppie (prima particella fissata, partner in array)
+  // deltaPhiDeltaEta, qinv: conteggi da riempire
+  // phi, eta, mass: colonne della prima particella
+  // partnerPhi, partnerEta, partnerMass: colonne dei partner
+  // masses: masse invarianti delle coppie
+  // mask: maschera della riga (nulla: tutte)
+  // count: numero di partner
+  void FillRow(double *deltaPhiDeltaEta, double *qinv, double phi, double eta, double mass,
+               const double *partnerPhi, const double *partnerEta, const double *partnerMass,
+               const Real *masses, const unsigned char *mask, int count);
+
+public:
+  // Costruttore
+  // mixingStride: una particella ogni mixingStride dell'evento corrente è usata nel mescolamento
+  PairCorrelations(int mixingStride = 8);
+
+  // Metodo per allocare le colonne per eventi fino a n particelle (la capacità non diminuisce mai)
+  void Reserve(int n);
+
+  // Metodo per preparare le colonne dell'evento corrente
+  // ev: cinematica dell'evento
+  // particles: particelle dell'evento (per le masse)
+  void BeginEvent(const EventSoA<Real> &ev, const Particle *particles);
+
+  // Metodo per riempire le coppie dello stesso evento di una riga (i, j > i)
+  // i: indice della prima particella
+  // masses: masse invarianti della riga, calcolate dal kernel delle coppie
+  // mask: maschera della riga degli istogrammi principali (nulla: tutte)
+  void FillSameEventRow(int i, const Real *masses, const unsigned char *mask)
+  {
+    FillRow(fSameDeltaPhiDeltaEta.data(), fSameQinv.data(), fPhi[i], fEta[i], fMass[i], fPhi.data() + i + 1,
+            fEta.data() + i + 1, fMass.data() + i + 1, masses, mask, fN - i - 1);
+  }
+
+  // Metodo per riempire le coppie mescolate con l'evento precedente e conservare l'evento corrente
+  // ev: cinematica dell'evento corrente
+  // selection: tagli, con le maschere delle particelle dell'evento corrente già calcolate
+  void EndEvent(const EventSoA<Real> &ev, EventSelection &selection);
+
+  // Metodo per sommare i conteggi di un altro thread
+  void Add(const PairCorrelations &other);
+
+  // Metodo per leggere i conteggi delle coppie dello stesso evento in Δφ, sommati su Δη (underflow e
+  // overflow compresi) e non simmetrizzati
+  // counts: array di kDeltaPhiBins valori
+  void GetSameEventDeltaPhi(double *counts) const;
+
+  // Metodo per scrivere distribuzioni e funzioni di correlazione nella directory corrente di ROOT
+  // (hDeltaPhiDeltaEta, hDeltaPhiDeltaEtaMixed, hDeltaPhiDeltaEtaCorrelation, hQinv, hQinvMixed,
+  // hQinvCorrelation)
+  void Write() const;
+};
+
+#endif // PAIRCORRELATIONS_H
@@ -0,0 +1,129 @@
+#ifndef PAIRKERNEL_H
+#define PAIRKERNEL_H
+
+#include "Particle.h"
+#include "Precision.h"
+#include "LorentzVector.h"
+#include <cmath>
+#include <vector>
+
+// Rappresentazione "structure of arrays" della cinematica di un evento.
+// Ogni componente è memorizzata in un array contiguo, in modo che il kernel
+// delle coppie possa essere vettorizzato dal compilatore. Il tipo scalare T
+// segue la politica di precisione (float o double).
+
+template <typename T>
+struct EventSoA
+{
+  std::vector<T> px, py, pz; // Componenti della quantità di moto
+  std::vector<T> e;          // Energia totale (calcolata una sola volta per particella)
+  int n;                     // Numero di particelle caricate
+
+  EventSoA() : n(0) {}
+
+  // Metodo per allocare le colonne per almeno count particelle (la capacità non diminuisce mai)
+  void Reserve(int count)
+  {
+    if ((int)px.size() < count)
+    {
+      px.resize(count);
+      py.resize(count);
+      pz.resize(count);
+      e.resize(count);
+    }
+  }
+
+  // Metodo per caricare la cinematica di un evento a partire dall'array di particelle
+  // particles: array di particelle dell'evento
+  // count: numero di particelle da caricare
+  void Load(const Particle *particles, int count)
+  {
+    Reserve(count);
+    n = count;
+    for (int i = 0; i < count; ++i)
+    {
+      // L'energia è quella memorizzata nel quadrimpulso della particella; in una colonna più precisa
+      // della cinematica (riferimento in doppia con -DPARTICLE_SIM_FLOAT) è ricalcolata in doppia
+      if (sizeof(T) > sizeof(Real))
+      {
+        const LorentzVector<double> p = particles[i].GetFourMomentumDouble();
+        px[i] = (T)p.Px();
+        py[i] = (T)p.Py();
+        pz[i] = (T)p.Pz();
+        e[i] = (T)p.E();
+        continue;
+      }
+      const LorentzVector<Real> &p = particles[i].GetFourMomentum();
+      px[i] = (T)p.Px();
+      py[i] = (T)p.Py();
+      pz[i] = (T)p.Pz();
+      e[i] = (T)p.E();
+    }
+  }
+};
+
+// Numero di coppie distinte (i < j) in un evento con n particelle
+inline int NumPairs(int n)
+{
+  return n * (n - 1) / 2;
+}
+
+// Kernel di una riga di coppie: calcola la massa invariante delle coppie (i, j) con j > i
+// e la scrive in masses nell'ordine (i, i+1), (i, i+2), ...
+// Il loop su j non ha dipendenze tra iterazioni e viene vettorizzato. Lavorando per righe
+// la memoria richiesta cresce linearmente con la molteplicità e non con il numero di coppie.
+// ev: cinematica dell'evento
+// i: indice della prima particella
+// masses: array di uscita, di dimensione almeno ev.n - i - 1
+template <typename T>
+void PairInvariantMassesRow(const EventSoA<T> &ev, int i, T *masses)
+{
+  const T *px = ev.px.data() + i + 1;
+  const T *py = ev.py.data() + i + 1;
+  const T *pz = ev.pz.data() + i + 1;
+  const T *e = ev.e.data() + i + 1;
+  const T pxi = ev.px[i], pyi = ev.py[i], pzi = ev.pz[i], ei = ev.e[i];
+  const int count = ev.n - i - 1;
+  for (int j = 0; j < count; ++j)
+  {
+    masses[j] = std::sqrt(LorentzVector<T>::MassSquaredOfSum(ei, pxi, pyi, pzi, e[j], px[j], py[j], pz[j]));
+  }
+}
+
+// Kernel di una riga di coppie tra eventi diversi: calcola la massa invariante delle coppie
+// formate dalla particella i di un evento e da tutte le particelle di un altro evento
+// (mescolamento degli eventi per le correlazioni)
+// ev: cinematica dell'evento della prima particella
+// i: indice della prima particella
+// partners: cinematica dell'altro evento
+// masses: array di uscita, di dimensione almeno partners.n
+template <typename T>
+void PairInvariantMassesCross(const EventSoA<T> &ev, int i, const EventSoA<T> &partners, T *masses)
+{
+  const T *px = partners.px.data();
+  const T *py = partners.py.data();
+  const T *pz = partners.pz.data();
+  const T *e = partners.e.data();
+  const T pxi = ev.px[i], pyi = ev.py[i], pzi = ev.pz[i], ei = ev.e[i];
+  const int count = partners.n;
+  for (int j = 0; j < count; ++j)
+  {
+    masses[j] = std::sqrt(LorentzVector<T>::MassSquaredOfSum(ei, pxi, pyi, pzi, e[j], px[j], py[j], pz[j]));
+  }
+}
+
+// Kernel delle coppie: calcola la massa invariante di tutte le coppie (i < j)
+// dell'evento e la scrive in masses nell'ordine (0,1), (0,2), ..., (1,2), ...
+// ev: cinematica dell'evento
+// masses: array di uscita, di dimensione almeno NumPairs(ev.n)
+template <typename T>
+void PairInvariantMasses(const EventSoA<T> &ev, T *masses)
+{
+  for (int i = 0; i < ev.n; ++i)
+  {
+    PairInvariantMassesRow(ev, i, masses);
+    masses += ev.n - i - 1;
+  }
+}
+
+#endif // PAIRKERNEL_H
@@ -1,9 +1,12 @@
 #include "Particle.h"
 #include "ResonanceType.h"
 #include "ParticleType.h"
+#include "DecayTable.h"
+#include "FastMath.h"
+#include "Diagnostics.h"
 #include <iostream>
 #include <cmath>
-#include <cstdlib>
+#include "TRandom.h"
 
 // Inizializzazione dell'array statico dei tipi di particelle
 ParticleType *Particle::fParticleType[Particle::fMaxNumParticleType] = {nullptr};
@@ -11,18 +14,37 @@ ParticleType *Particle::fParticleType[Particle::fMaxNumParticleType] = {nullptr}
 // Inizializzazione del numero di tipi di particelle registrati
 int Particle::fNParticleType = 0;
 
-// Costruttore di default: inizializza le componenti della quantità di moto a 0 e l'indice a -1
-Particle::Particle() : fPx(0), fPy(0), fPz(0), fIndex(-1) {}
+// Tabella piatta delle proprietà delle specie, inizialmente vuota
+SpeciesTable Particle::fSpecies = {};
+
+// Tabella dei canali di decadimento, inizialmente vuota
+DecayTable Particle::fDecayTable;
+
+// Forme di riga delle risonanze, gaussiane di default
+LineShapeKind Particle::fLineShapeKind[Particle::fMaxNumParticleType] = {kGaussian};
+LineShape Particle::fLineShape[Particle::fMaxNumParticleType];
+
+// Modulo della quantità di moto delle figlie nel sistema di riposo della madre
+// m: massa della madre
+// m1, m2: masse delle figlie
+static double TwoBodyMomentum(double m, double m1, double m2)
+{
+  return sqrt((m * m - (m1 + m2) * (m1 + m2)) * (m * m - (m1 - m2) * (m1 - m2))) / (m * 2.0);
+}
+
+// Costruttore di default: inizializza il quadrimpulso a 0 e l'indice a -1
+Particle::Particle() : fIndex(-1), fMomentum() {}
 
 Particle::Particle(const std::string &name, double px, double py, double pz)
-    : fPx(px), fPy(py), fPz(pz)
+    : fMomentum(px, py, pz, 0)
 {
   // La particella viene creata solo se il suo tipo è stato definito
   fIndex = FindParticleType(name);
   if (fIndex == -1)
   {
-    std::cout << "Particle type " << name << " not found!" << std::endl;
+    Diagnostics::Report(kDiagTypeNotFound, name.c_str());
   }
+  UpdateEnergy();
 }
 
 int Particle::FindParticleType(const std::string &name)
@@ -76,7 +98,85 @@ void Particle::AddParticleType(const std::string &name, double mass, int charge,
   {
     fParticleType[fNParticleType] = new ResonanceType(name, mass, charge, width);
   }
+
+  // Copia delle proprietà nella tabella piatta usata dai percorsi caldi
+  SpeciesProperties &species = fSpecies.data[fNParticleType];
+  species.mass = mass;
+  species.charge = (signed char)charge;
+  species.flags = (width == 0) ? 0 : kResonance;
+  species.firstChannel = 0;
+  species.nChannels = 0;
+
   ++fNParticleType;
+  fSpecies.size = fNParticleType;
+
+  if (width != 0)
+  {
+    BuildLineShape(fNParticleType - 1);
+  }
+}
+
+void Particle::AddDecayChannel(const std::string &parent, double branchingRatio,
+                               const std::string &dau1, const std::string &dau2, const std::string &dau3)
+{
+  DecayChannel channel;
+  channel.parent = FindParticleType(parent);
+  channel.branchingRatio = branchingRatio;
+  channel.nDaughters = dau3.empty() ? 2 : 3;
+  channel.daughters[0] = FindParticleType(dau1);
+  channel.daughters[1] = FindParticleType(dau2);
+  channel.daughters[2] = dau3.empty() ? -1 : FindParticleType(dau3);
+
+  if (channel.parent == -1 || !fSpecies.IsResonance(channel.parent))
+  {
+    std::cout << "Decay channel parent " << parent << " is not a resonance!" << std::endl;
+    return;
+  }
+
+  channel.threshold = 0;
+  for (int d = 0; d < channel.nDaughters; ++d)
+  {
+    if (channel.daughters[d] == -1)
+    {
+      std::cout << "Decay channel daughter of " << parent << " not found!" << std::endl;
+      return;
+    }
+    channel.threshold += fSpecies[channel.daughters[d]].mass;
+  }
+
+  fDecayTable.AddChannel(channel, fSpecies);
+  BuildLineShape(channel.parent);
+}
+
+void Particle::SetLineShape(const std::string &name, LineShapeKind kind)
+{
+  int index = FindParticleType(name);
+  if (index == -1 || !fSpecies.IsResonance(index))
+  {
+    std::cout << "Particle type " << name << " is not a resonance!" << std::endl;
+    return;
+  }
+  fLineShapeKind[index] = kind;
+  BuildLineShape(index);
+}
+
+void Particle::BuildLineShape(int index)
+{
+  // Soglia più bassa tra i canali di decadimento (0 se la risonanza non ha canali)
+  const SpeciesProperties &species = fSpecies[index];
+  double threshold = 0;
+  for (int c = 0; c < species.nChannels; ++c)
+  {
+    double channelThreshold = fDecayTable.GetChannel(species.firstChannel + c).threshold;
+    if (c == 0 || channelThreshold < threshold)
+      threshold = channelThreshold;
+  }
+  fLineShape[index].Build(fLineShapeKind[index], species.mass, fParticleType[index]->GetWidth(), threshold);
+}
+
+const DecayTable &Particle::GetDecayTable()
+{
+  return fDecayTable;
 }
 
 void Particle::SetParticleTypeIndex(const std::string &name)
@@ -84,8 +184,9 @@ void Particle::SetParticleTypeIndex(const std::string &name)
   fIndex = FindParticleType(name);
   if (fIndex == -1)
   {
-    std::cout << "Particle type " << name << " not found!" << std::endl;
+    Diagnostics::Report(kDiagTypeNotFound, name.c_str());
   }
+  UpdateEnergy();
 }
 
 void Particle::SetParticleTypeIndex(int index)
@@ -96,8 +197,9 @@ void Particle::SetParticleTypeIndex(int index)
   }
   else
   {
-    std::cout << "Invalid particle index!" << std::endl;
+    Diagnostics::Report(kDiagInvalidIndex);
   }
+  UpdateEnergy();
 }
 
 void Particle::Print() const
@@ -106,111 +208,211 @@ void Particle::Print() const
   {
     fParticleType[fIndex]->Print();
   }
-  std::cout << "Px: " << fPx << ", Py: " << fPy << ", Pz: " << fPz << std::endl;
+  std::cout << "Px: " << fMomentum.Px() << ", Py: " << fMomentum.Py() << ", Pz: " << fMomentum.Pz() << std::endl;
 }
 
 void Particle::SetPulse(double px, double py, double pz)
 {
-  fPx = px;
-  fPy = py;
-  fPz = pz;
+  fMomentum.SetMomentum(px, py, pz);
+  UpdateEnergy();
+}
+
+void Particle::Set(int index, double px, double py, double pz)
+{
+  if (index >= 0 && index < fNParticleType)
+  {
+    fIndex = index;
+  }
+  else
+  {
+    Diagnostics::Report(kDiagInvalidIndex);
+  }
+  fMomentum.SetMomentum(px, py, pz);
+  UpdateEnergy();
+}
+
+void Particle::UpdateEnergy()
+{
+  // Somma dei quadrati in precisione doppia, come nel calcolo originale dell'energia
+  const double mass = (fIndex != -1) ? fSpecies[fIndex].mass : 0;
+  double mass2 = mass * mass;
+  double p2 = LorentzVector<double>::Momentum2(fMomentum.Px(), fMomentum.Py(), fMomentum.Pz());
+  fMomentum.SetE(std::sqrt(mass2 + p2));
 }
 
 double Particle::GetMass() const
 {
-  return (fIndex != -1) ? fParticleType[fIndex]->GetMass() : 0;
+  return (fIndex != -1) ? fSpecies[fIndex].mass : 0;
 }
 
-double Particle::GetEnergy() const
+LorentzVector<double> Particle::GetFourMomentumDouble() const
 {
-  double mass = GetMass();
-  double p2 = fPx * fPx + fPy * fPy + fPz * fPz;
-  return std::sqrt(mass * mass + p2);
+  if (sizeof(Real) == sizeof(double))
+    return LorentzVector<double>(fMomentum);
+  const double mass = (fIndex != -1) ? fSpecies[fIndex].mass : 0;
+  return LorentzVector<double>::FromMass2(fMomentum.Px(), fMomentum.Py(), fMomentum.Pz(), mass * mass);
 }
 
 double Particle::InvariantMass(const Particle &other) const
 {
-  double e1 = GetEnergy();
-  double e2 = other.GetEnergy();
-  double px_total = fPx + other.GetPulseX();
-  double py_total = fPy + other.GetPulseY();
-  double pz_total = fPz + other.GetPulseZ();
-  double p2_total = px_total * px_total + py_total * py_total + pz_total * pz_total;
-  return std::sqrt((e1 + e2) * (e1 + e2) - p2_total);
+  const LorentzVector<double> p1 = GetFourMomentumDouble();
+  const LorentzVector<double> p2 = other.GetFourMomentumDouble();
+  return std::sqrt(p1.MassSquaredWith(p2));
 }
 
-int Particle::Decay2Body(Particle &dau1, Particle &dau2) const
+int Particle::Decay2Body(Particle &dau1, Particle &dau2, TRandom &random) const
 {
   if (GetMass() == 0.0)
   {
-    std::cerr << "Decayment cannot be performed if mass is zero\n";
+    Diagnostics::Report(kDiagDecayZeroMass);
     return 1;
   }
 
-  double massMot = GetMass();
   double massDau1 = dau1.GetMass();
   double massDau2 = dau2.GetMass();
+  double massMot = SampleDecayMass(massDau1 + massDau2, random);
 
-  // Effetto di larghezza per particelle di tipo ResonanceType
-  if (fIndex > -1)
+  if (massMot < massDau1 + massDau2)
   {
-    ResonanceType *resonance = dynamic_cast<ResonanceType *>(fParticleType[fIndex]);
-    if (resonance)
-    {
-      float x1, x2, w, y1;
-      double invnum = 1. / RAND_MAX;
-      do
-      {
-        x1 = 2.0 * rand() * invnum - 1.0;
-        x2 = 2.0 * rand() * invnum - 1.0;
-        w = x1 * x1 + x2 * x2;
-      } while (w >= 1.0);
-
-      w = sqrt((-2.0 * log(w)) / w);
-      y1 = x1 * w;
-      massMot += resonance->GetWidth() * y1;
-    }
+    Diagnostics::Report(kDiagDecayBelowThreshold);
+    return 2;
   }
 
-  if (massMot < massDau1 + massDau2)
+  double pout = TwoBodyMomentum(massMot, massDau1, massDau2);
+
+  double phi = 2 * M_PI * random.Rndm();
+  double theta = M_PI * random.Rndm() - M_PI / 2.;
+  double sinPhi, cosPhi, sinTheta, cosTheta;
+  FastMath::SinCos(phi, sinPhi, cosPhi);
+  FastMath::SinCos(theta, sinTheta, cosTheta);
+
+  // Assegna la quantità di moto ai prodotti del decadimento in direzioni opposte
+  dau1.SetPulse(pout * sinTheta * cosPhi, pout * sinTheta * sinPhi, pout * cosTheta);
+  dau2.SetPulse(-pout * sinTheta * cosPhi, -pout * sinTheta * sinPhi, -pout * cosTheta);
+
+  // Applica un boost relativistico ai decadimenti, con γ calcolato una sola volta
+  double energy = sqrt(fMomentum.P2() + massMot * massMot);
+  const LorentzBoost<double> boost = LorentzBoost<double>::FromVelocity(
+      fMomentum.Px() / energy, fMomentum.Py() / energy, fMomentum.Pz() / energy);
+  Particle *const daughters[2] = {&dau1, &dau2};
+  BoostDaughters(daughters, 2, boost);
+
+  return 0;
+}
+
+int Particle::Decay3Body(Particle &dau1, Particle &dau2, Particle &dau3, TRandom &random) const
+{
+  if (GetMass() == 0.0)
+  {
+    Diagnostics::Report(kDiagDecayZeroMass);
+    return 1;
+  }
+
+  double m1 = dau1.GetMass();
+  double m2 = dau2.GetMass();
+  double m3 = dau3.GetMass();
+  double massMot = SampleDecayMass(m1 + m2 + m3, random);
+
+  if (massMot < m1 + m2 + m3)
   {
-    std::cerr << "Decayment cannot be performed because mass is too low in this channel\n";
+    Diagnostics::Report(kDiagDecayBelowThreshold);
     return 2;
   }
 
-  double pout = sqrt((massMot * massMot - (massDau1 + massDau2) * (massDau1 + massDau2)) *
-                     (massMot * massMot - (massDau1 - massDau2) * (massDau1 - massDau2))) /
-                (massMot * 2.0);
+  // Estrazione della massa invariante m12 del sistema (1,2) con peso proporzionale
+  // allo spazio delle fasi: w = p*(M -> m12 + m3) * p*(m12 -> m1 + m2).
+  // Il primo fattore è massimo per m12 = m1 + m2, il secondo per m12 = M - m3.
+  double m12Min = m1 + m2;
+  double m12Max = massMot - m3;
+  double weightMax = TwoBodyMomentum(massMot, m12Min, m3) * TwoBodyMomentum(m12Max, m1, m2);
+  double m12, p3, p12;
+  do
+  {
+    m12 = m12Min + (m12Max - m12Min) * random.Rndm();
+    p3 = TwoBodyMomentum(massMot, m12, m3);
+    p12 = TwoBodyMomentum(m12, m1, m2);
+  } while (p3 * p12 < weightMax * random.Rndm());
 
-  double norm = 2 * M_PI / RAND_MAX;
-  double phi = rand() * norm;
-  double theta = rand() * norm * 0.5 - M_PI / 2.;
+  // Decadimento (1,2) -> 1 + 2 nel sistema di riposo di (1,2), in direzione isotropa (cosθ uniforme in [-1, 1])
+  double phi = 2 * M_PI * random.Rndm();
+  double cosTheta = 2 * random.Rndm() - 1;
+  double sinTheta = std::sqrt(1 - cosTheta * cosTheta);
+  double sinPhi, cosPhi;
+  FastMath::SinCos(phi, sinPhi, cosPhi);
+  dau1.SetPulse(p12 * sinTheta * cosPhi, p12 * sinTheta * sinPhi, p12 * cosTheta);
+  dau2.SetPulse(-p12 * sinTheta * cosPhi, -p12 * sinTheta * sinPhi, -p12 * cosTheta);
 
-  // Assegna la quantità di moto ai prodotti del decadimento in direzioni opposte
-  dau1.SetPulse(pout * sin(theta) * cos(phi), pout * sin(theta) * sin(phi), pout * cos(theta));
-  dau2.SetPulse(-pout * sin(theta) * cos(phi), -pout * sin(theta) * sin(phi), -pout * cos(theta));
+  // Direzione isotropa del sistema (1,2) e della terza figlia nel sistema di riposo della madre
+  phi = 2 * M_PI * random.Rndm();
+  cosTheta = 2 * random.Rndm() - 1;
+  sinTheta = std::sqrt(1 - cosTheta * cosTheta);
+  FastMath::SinCos(phi, sinPhi, cosPhi);
+  double nx = sinTheta * cosPhi;
+  double ny = sinTheta * sinPhi;
+  double nz = cosTheta;
+  dau3.SetPulse(-p3 * nx, -p3 * ny, -p3 * nz);
 
-  double energy = sqrt(fPx * fPx + fPy * fPy + fPz * fPz + massMot * massMot);
-  double bx = fPx / energy;
-  double by = fPy / energy;
-  double bz = fPz / energy;
+  // Boost delle figlie 1 e 2 nel sistema di riposo della madre
+  double e12 = sqrt(m12 * m12 + p3 * p3);
+  const LorentzBoost<double> boost12 =
+      LorentzBoost<double>::FromVelocity(p3 * nx / e12, p3 * ny / e12, p3 * nz / e12);
+  Particle *const daughters[3] = {&dau1, &dau2, &dau3};
+  BoostDaughters(daughters, 2, boost12);
 
-  // Applica un boost relativistico ai decadimenti
-  dau1.Boost(bx, by, bz);
-  dau2.Boost(bx, by, bz);
+  // Boost di tutte le figlie nel sistema del laboratorio
+  double energy = sqrt(fMomentum.P2() + massMot * massMot);
+  const LorentzBoost<double> boost = LorentzBoost<double>::FromVelocity(
+      fMomentum.Px() / energy, fMomentum.Py() / energy, fMomentum.Pz() / energy);
+  BoostDaughters(daughters, 3, boost);
 
   return 0;
 }
 
-void Particle::Boost(double bx, double by, double bz)
+double Particle::SampleDecayMass(double threshold, TRandom &random) const
 {
-  double energy = GetEnergy();
-  double b2 = bx * bx + by * by + bz * bz;
-  double gamma = 1.0 / sqrt(1.0 - b2);
-  double bp = bx * fPx + by * fPy + bz * fPz;
-  double gamma2 = (b2 > 0) ? (gamma - 1.0) / b2 : 0.0;
+  // Le particelle stabili decadono alla loro massa nominale
+  if (fIndex == -1 || !fSpecies.IsResonance(fIndex))
+  {
+    return GetMass();
+  }
 
-  fPx += gamma2 * bp * bx + gamma * bx * energy;
-  fPy += gamma2 * bp * by + gamma * by * energy;
-  fPz += gamma2 * bp * bz + gamma * bz * energy;
+  // Estrazione dalla tabella della forma di riga: un solo numero casuale, nessun rifiuto.
+  // Se la soglia del canale è più alta di quella della tabella, l'estrazione è
+  // ristretta alla parte della distribuzione sopra soglia.
+  const LineShape &shape = fLineShape[fIndex];
+  double u = random.Rndm();
+  if (threshold > shape.GetMinMass())
+  {
+    double uMin = shape.Cdf(threshold);
+    u = uMin + u * (1.0 - uMin);
+  }
+
+  // L'interpolazione può scendere sotto soglia solo per arrotondamento
+  double mass = shape.Sample(u);
+  return (mass > threshold) ? mass : threshold;
+}
+
+void Particle::BoostDaughters(Particle *const *daughters, int n, const LorentzBoost<double> &boost)
+{
+  // Quadrimpulsi in doppia, anche con la cinematica in float (energia ricalcolata in doppia),
+  // copiati in colonne e boostati insieme con BoostArrays
+  const int kMax = DecayChannel::kMaxDaughters;
+  double px[kMax], py[kMax], pz[kMax], e[kMax];
+  for (int i = 0; i < n; ++i)
+  {
+    const LorentzVector<double> momentum = daughters[i]->GetFourMomentumDouble();
+    px[i] = momentum.Px();
+    py[i] = momentum.Py();
+    pz[i] = momentum.Pz();
+    e[i] = momentum.E();
+  }
+  BoostArrays(boost, px, py, pz, e, n);
+
+  // L'energia boostata è riportata sul guscio di massa, per non accumulare arrotondamenti
+  // nei boost successivi dei decadimenti a tre corpi
+  for (int i = 0; i < n; ++i)
+  {
+    daughters[i]->fMomentum.SetMomentum(px[i], py[i], pz[i]);
+    daughters[i]->UpdateEnergy();
+  }
 }
\ No newline at end of file
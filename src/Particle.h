@@ -2,29 +2,56 @@
 #define PARTICLE_H
 
 #include "ParticleType.h"
+#include "Precision.h"
+#include "LorentzVector.h"
+#include "SpeciesTable.h"
+#include "LineShape.h"
 #include <string>
 
+class DecayTable;
+class TRandom;
+
 // La classe Particle rappresenta una particella fisica, caratterizzata
 // da un tipo, una quantità di moto e metodi per calcolare proprietà
 // relativistiche e interagire con altre particelle.
+// Il quadrimpulso è un LorentzVector con l'energia memorizzata: è ricalcolata sul guscio di massa
+// della specie quando cambiano la quantità di moto o il tipo, anche dopo un boost, come nel calcolo
+// originale dell'energia a ogni chiamata.
 
 class Particle
 {
 private:
-  static ParticleType *fParticleType[];      // Array statico per memorizzare i tipi di particelle definiti
-  static const int fMaxNumParticleType = 10; // Numero massimo di tipi di particelle che possono essere registrati
-  static int fNParticleType;                 // Numero corrente di tipi di particelle registrati
+  static ParticleType *fParticleType[];                               // Array statico per memorizzare i tipi di particelle definiti
+  static const int fMaxNumParticleType = SpeciesTable::kMaxSpecies;   // Numero massimo di tipi di particelle che possono essere registrati
+  static int fNParticleType;                                          // Numero corrente di tipi di particelle registrati
+  static SpeciesTable fSpecies;                                       // Tabella piatta delle proprietà, usata nei percorsi caldi
+  static DecayTable fDecayTable;                                      // Canali di decadimento delle risonanze
+  static LineShapeKind fLineShapeKind[];                              // Forma di riga di ogni risonanza
+  static LineShape fLineShape[];                                      // Campionatore della massa di ogni risonanza
   int fIndex;                                // Indice che identifica il tipo di particella
-  double fPx, fPy, fPz;                      // Componenti della quantità di moto (Px, Py, Pz)
-
-  // Metodo statico per trovare un tipo di particella dato il nome e restituendone l'indice
-  // name: nome del tipo di particella
-  // return: indice del tipo di particella o -1 se non trovato
-  static int FindParticleType(const std::string &name);
-
-  // Metodo per applicare un boost relativistico alla quantità di moto della particella
-  // bx, by, bz: componenti della velocità relativistica
-  void Boost(double bx, double by, double bz);
+  LorentzVector<Real> fMomentum;             // Quadrimpulso, nella precisione selezionata
+
+  // Metodo per ricalcolare l'energia dalla massa della specie e dalla quantità di moto
+  void UpdateEnergy();
+
+  // Metodo per applicare lo stesso boost relativistico alle figlie di un decadimento, in blocco
+  // daughters: figlie da boostare
+  // n: numero di figlie (al più DecayChannel::kMaxDaughters)
+  // boost: velocità del sistema, con γ già calcolato
+  static void BoostDaughters(Particle *const *daughters, int n, const LorentzBoost<double> &boost);
+
+  // Metodo per estrarre la massa della particella madre al momento del decadimento,
+  // includendo l'effetto di larghezza per le risonanze. La forma di riga è troncata
+  // alla soglia, quindi la massa estratta non è mai insufficiente per il canale.
+  // threshold: somma delle masse delle figlie
+  // random: generatore di numeri casuali del thread che esegue il decadimento
+  // return: massa della madre
+  double SampleDecayMass(double threshold, TRandom &random) const;
+
+  // Metodo statico per ricostruire la tabella della forma di riga di una risonanza,
+  // troncata alla soglia più bassa tra i suoi canali di decadimento
+  // index: indice della risonanza
+  static void BuildLineShape(int index);
 
 public:
   // Costruttore di default che inizializza una particella vuota
@@ -38,15 +65,31 @@ public:
   // Metodo per accedere all'indice del tipo di particella
   int GetParticleTypeIndex() const;
 
+  // Metodo statico per trovare un tipo di particella dato il nome e restituendone l'indice.
+  // Va usato in fase di configurazione, non nei loop caldi.
+  // name: nome del tipo di particella
+  // return: indice del tipo di particella o -1 se non trovato
+  static int FindParticleType(const std::string &name);
+
+  // Metodo statico per accedere alla tabella piatta delle proprietà delle specie
+  static const SpeciesTable &GetSpeciesTable() { return fSpecies; }
+
   // Metodo statico per accedere ad un tipo di particella dato il suo indice
   // index: indice del tipo di particella
   // return: puntatore al tipo di particella o nullptr se l'indice non è valido
   static const ParticleType *GetParticleType(int index);
 
   // Metodi per accedere alle componenti della quantità di moto
-  double GetPulseX() const { return fPx; } // Restituisce la componente Px
-  double GetPulseY() const { return fPy; } // Restituisce la componente Py
-  double GetPulseZ() const { return fPz; } // Restituisce la componente Pz
+  double GetPulseX() const { return fMomentum.Px(); } // Restituisce la componente Px
+  double GetPulseY() const { return fMomentum.Py(); } // Restituisce la componente Py
+  double GetPulseZ() const { return fMomentum.Pz(); } // Restituisce la componente Pz
+
+  // Metodo per accedere al quadrimpulso
+  const LorentzVector<Real> &GetFourMomentum() const { return fMomentum; }
+
+  // Metodo per ottenere il quadrimpulso in precisione doppia; con la cinematica in float l'energia
+  // è ricalcolata in doppia dalla massa e dalla quantità di moto invece di convertire quella arrotondata
+  LorentzVector<double> GetFourMomentumDouble() const;
 
   // Metodo statico per aggiungere un nuovo tipo di particella al sistema
   // name: nome del tipo di particella
@@ -55,6 +98,21 @@ public:
   // width: larghezza della risonanza (default 0 per particelle stabili)
   static void AddParticleType(const std::string &name, double mass, int charge, double width = 0);
 
+  // Metodo statico per aggiungere un canale di decadimento a una risonanza
+  // parent: nome della risonanza
+  // branchingRatio: rapporto di decadimento del canale
+  // dau1, dau2, dau3: nomi delle figlie (dau3 vuoto per i decadimenti a due corpi)
+  static void AddDecayChannel(const std::string &parent, double branchingRatio,
+                              const std::string &dau1, const std::string &dau2, const std::string &dau3 = "");
+
+  // Metodo statico per scegliere la forma di riga della massa di una risonanza (default gaussiana)
+  // name: nome della risonanza
+  // kind: forma di riga
+  static void SetLineShape(const std::string &name, LineShapeKind kind);
+
+  // Metodo statico per accedere alla tabella dei canali di decadimento
+  static const DecayTable &GetDecayTable();
+
   // Metodo per impostare il tipo di particella usando il nome
   // name: nome del tipo di particella
   void SetParticleTypeIndex(const std::string &name);
@@ -71,13 +129,18 @@ public:
   // px, py, pz: nuove componenti della quantità di moto
   void SetPulse(double px, double py, double pz);
 
+  // Metodo per impostare tipo e quantità di moto insieme, calcolando l'energia una sola volta
+  // index: indice del tipo di particella
+  // px, py, pz: componenti della quantità di moto
+  void Set(int index, double px, double py, double pz);
+
   // Metodo per ottenere la massa della particella in base al suo tipo
   // return: massa della particella o 0 se l'indice non è valido
   double GetMass() const;
 
-  // Metodo per ottenere l'energia totale della particella usando la relazione relativistica
+  // Metodo per ottenere l'energia totale della particella, E = sqrt(m² + p²)
   // return: energia totale della particella
-  double GetEnergy() const;
+  double GetEnergy() const { return fMomentum.E(); }
 
   // Calcola la massa invariante con un'altra particella
   // other: altra particella
@@ -86,8 +149,15 @@ public:
 
   // Simula il decadimento della particella in due particelle figlie
   // dau1, dau2: particelle figlie risultanti dal decadimento
+  // random: generatore di numeri casuali del thread che esegue il decadimento
+  // return: stato del decadimento (0: successo, 1: errore di massa zero, 2: massa insufficiente)
+  int Decay2Body(Particle &dau1, Particle &dau2, TRandom &random) const;
+
+  // Simula il decadimento a tre corpi della particella secondo lo spazio delle fasi
+  // dau1, dau2, dau3: particelle figlie risultanti dal decadimento
+  // random: generatore di numeri casuali del thread che esegue il decadimento
   // return: stato del decadimento (0: successo, 1: errore di massa zero, 2: massa insufficiente)
-  int Decay2Body(Particle &dau1, Particle &dau2) const;
+  int Decay3Body(Particle &dau1, Particle &dau2, Particle &dau3, TRandom &random) const;
 };
 
 #endif // PARTICLE_H
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+// Politica di precisione a tempo di compilazione per la cinematica delle particelle
+// e per il kernel delle coppie. Gli istogrammi di output sono TH1F con 1000 bin su 3 GeV,
+// quindi la precisione singola è sufficiente nel loop caldo: i loop delle coppie sono vettorizzati
+// dal compilatore, e in float ogni registro vettoriale contiene il doppio degli elementi.
+//
+// La modalità float si abilita compilando con -DPARTICLE_SIM_FLOAT.
+
+template <typename T>
+struct PrecisionPolicy
+{
+  typedef T Real; // Tipo scalare usato per la cinematica
+};
+
+#ifdef PARTICLE_SIM_FLOAT
+typedef PrecisionPolicy<float> DefaultPrecision;
+#else
+typedef PrecisionPolicy<double> DefaultPrecision;
+#endif
+
+// Tipo scalare selezionato per la cinematica (float o double)
+typedef DefaultPrecision::Real Real;
+
+#endif // PRECISION_H
@@ -0,0 +1,95 @@
+#include "PrecisionTargets.h"
+#include "RunMonitor.h"
+#include "SignalExtractor.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+// Nomi delle osservabili usati sulla riga di comando, nell'ordine di PrecisionObservable
+static const char *kObservableNames[kNPrecisionObservables] = {"yield", "fractions", "momentum"};
+
+PrecisionTargets::PrecisionTargets() : fMet(false)
+{
+  for (int i = 0; i < kNPrecisionObservables; ++i)
+  {
+    fTarget[i] = 0;
+    fAchieved[i] = std::numeric_limits<double>::infinity();
+  }
+}
+
+bool PrecisionTargets::Parse(const char *spec)
+{
+  const char *equal = std::strchr(spec, '=');
+  if (!equal)
+    return false;
+  for (int i = 0; i < kNPrecisionObservables; ++i)
+  {
+    size_t length = std::strlen(kObservableNames[i]);
+    if ((size_t)(equal - spec) == length && std::strncmp(spec, kObservableNames[i], length) == 0)
+    {
+      double target = std::atof(equal + 1);
+      if (!(target > 0))
+        return false;
+      fTarget[i] = target;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PrecisionTargets::IsEnabled() const
+{
+  for (int i = 0; i < kNPrecisionObservables; ++i)
+  {
+    if (fTarget[i] > 0)
+      return true;
+  }
+  return false;
+}
+
+bool PrecisionTargets::Update(const MonitorAccumulator &accumulator, const int *species, int nSpecies,
+                              const SignalFit *signal)
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  const long long n = accumulator.nMomentum;
+
+  // Resa della K*: errore relativo dal fit del picco
+  fAchieved[kTargetKStarYield] = infinity;
+  if (signal && signal->valid && signal->yield > 0)
+    fAchieved[kTargetKStarYield] = signal->yieldError / signal->yield;
+
+  // Frazioni delle specie: errore binomiale relativo sqrt((1 - f) / (f N)), il peggiore tra le specie
+  fAchieved[kTargetSpeciesFractions] = n > 0 ? 0 : infinity;
+  for (int i = 0; i < nSpecies && n > 0; ++i)
+  {
+    double count = (double)accumulator.speciesCounts[species[i]];
+    double relative = count > 0 ? std::sqrt((1 - count / n) / count) : infinity;
+    if (relative > fAchieved[kTargetSpeciesFractions])
+      fAchieved[kTargetSpeciesFractions] = relative;
+  }
+
+  // Quantità di moto media: errore sulla media diviso per la media
+  fAchieved[kTargetMeanMomentum] = infinity;
+  if (n > 1 && accumulator.momentumMean > 0)
+    fAchieved[kTargetMeanMomentum] = std::sqrt(accumulator.momentumM2 / (n - 1) / n) / accumulator.momentumMean;
+
+  fMet = true;
+  for (int i = 0; i < kNPrecisionObservables; ++i)
+  {
+    if (fTarget[i] > 0 && !(fAchieved[i] <= fTarget[i]))
+      fMet = false;
+  }
+  return fMet;
+}
+
+void PrecisionTargets::Print(std::ostream &out) const
+{
+  out << "[precision]";
+  for (int i = 0; i < kNPrecisionObservables; ++i)
+  {
+    if (fTarget[i] > 0)
+      out << " " << kObservableNames[i] << " " << fAchieved[i] << " (target " << fTarget[i] << ")";
+  }
+  out << (fMet ? " reached" : "") << std::endl;
+}
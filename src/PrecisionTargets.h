@@ -0,0 +1,62 @@
+#ifndef PRECISIONTARGETS_H
+#define PRECISIONTARGETS_H
+
+#include "SpeciesTable.h"
+#include <ostream>
+
+struct MonitorAccumulator;
+struct SignalFit;
+
+// Osservabili su cui si può chiedere una precisione statistica
+enum PrecisionObservable
+{
+  kTargetKStarYield,       // Resa del picco della K* (coppie pione-kaone)
+  kTargetSpeciesFractions, // Frazioni delle specie primarie (la meno precisa)
+  kTargetMeanMomentum,     // Quantità di moto media delle primarie
+  kNPrecisionObservables
+};
+
+// La classe PrecisionTargets contiene gli errori relativi richiesti sulle osservabili
+// e verifica, tra un blocco di eventi e l'altro, se sono stati raggiunti a partire
+// dallo stato unito dei thread. Permette di fermare la simulazione appena la precisione
+// richiesta è raggiunta invece di generare sempre lo stesso numero di eventi.
+
+class PrecisionTargets
+{
+private:
+  double fTarget[kNPrecisionObservables];   // Errore relativo richiesto (0 se non richiesto)
+  double fAchieved[kNPrecisionObservables]; // Errore relativo raggiunto all'ultimo aggiornamento
+  bool fMet;                                // Tutti gli obiettivi richiesti sono raggiunti
+
+public:
+  PrecisionTargets();
+
+  // Metodo per leggere un obiettivo dalla riga di comando nel formato nome=errore,
+  // con nome yield, fractions o momentum (es. "yield=0.05")
+  // spec: obiettivo da leggere
+  // return: false se il formato non è valido
+  bool Parse(const char *spec);
+
+  // Metodo per sapere se è stato richiesto almeno un obiettivo
+  bool IsEnabled() const;
+
+  // Metodo per sapere se gli obiettivi richiedono il fit del segnale della K*
+  bool NeedsSignalFit() const { return fTarget[kTargetKStarYield] > 0; }
+
+  // Metodo per aggiornare gli errori relativi raggiunti
+  // accumulator: statistiche unite dei thread
+  // species: indici delle specie primarie
+  // nSpecies: numero di specie primarie
+  // signal: fit del segnale della K* (può essere nullo se non richiesto)
+  // return: true se tutti gli obiettivi richiesti sono raggiunti
+  bool Update(const MonitorAccumulator &accumulator, const int *species, int nSpecies, const SignalFit *signal);
+
+  // Metodo per sapere se all'ultimo aggiornamento gli obiettivi erano raggiunti
+  bool IsMet() const { return fMet; }
+
+  // Metodo per stampare una riga con errori raggiunti e richiesti
+  // out: stream di uscita
+  void Print(std::ostream &out) const;
+};
+
+#endif // PRECISIONTARGETS_H
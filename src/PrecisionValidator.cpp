@@ -0,0 +1,70 @@
+#include "PrecisionValidator.h"
+#include <iostream>
+#include <cmath>
+
+PrecisionValidator::PrecisionValidator(int nBins, double min, double max)
+    : fNBins(nBins), fMin(min), fMax(max), fRef(nBins, 0.0), fTest(nBins, 0.0) {}
+
+int PrecisionValidator::FindBin(double x) const
+{
+  if (!(x >= fMin) || x >= fMax) // Esclude anche i NaN
+  {
+    return -1;
+  }
+  return (int)((x - fMin) / (fMax - fMin) * fNBins);
+}
+
+void PrecisionValidator::Fill(const double *ref, const float *test, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    int bin = FindBin(ref[i]);
+    if (bin >= 0)
+      fRef[bin] += 1;
+    bin = FindBin(test[i]);
+    if (bin >= 0)
+      fTest[bin] += 1;
+  }
+}
+
+void PrecisionValidator::Merge(const PrecisionValidator &other)
+{
+  for (int i = 0; i < fNBins; ++i)
+  {
+    fRef[i] += other.fRef[i];
+    fTest[i] += other.fTest[i];
+  }
+}
+
+double PrecisionValidator::MaxDeviation(int &bin) const
+{
+  double maxDeviation = 0;
+  bin = 0;
+  for (int i = 0; i < fNBins; ++i)
+  {
+    // Per i bin vuoti nel riferimento si usa un errore unitario
+    double error = fRef[i] > 0 ? std::sqrt(fRef[i]) : 1.0;
+    double deviation = std::fabs(fTest[i] - fRef[i]) / error;
+    if (deviation > maxDeviation)
+    {
+      maxDeviation = deviation;
+      bin = i + 1;
+    }
+  }
+  return maxDeviation;
+}
+
+void PrecisionValidator::Print() const
+{
+  int bin;
+  double maxDeviation = MaxDeviation(bin);
+  double width = (fMax - fMin) / fNBins;
+  std::cout << "Precision validation (float vs double invariant mass):"
+            << "\nMax per-bin deviation: " << maxDeviation << " sigma";
+  if (bin > 0)
+  {
+    std::cout << " (bin " << bin << ", " << fMin + (bin - 1) * width
+              << "-" << fMin + bin * width << " GeV/c^2)";
+  }
+  std::cout << std::endl;
+}
@@ -0,0 +1,49 @@
+#ifndef PRECISIONVALIDATOR_H
+#define PRECISIONVALIDATOR_H
+
+#include <vector>
+
+// La classe PrecisionValidator confronta, bin per bin, la distribuzione delle masse
+// invarianti calcolata in precisione singola con quella di riferimento in precisione doppia.
+// Usa la stessa binnatura degli istogrammi di massa invariante (1000 bin tra 0 e 3 GeV)
+// e riporta la deviazione massima in unità di errore statistico del bin di riferimento.
+
+class PrecisionValidator
+{
+private:
+  const int fNBins;           // Numero di bin
+  const double fMin, fMax;    // Estremi dell'intervallo
+  std::vector<double> fRef;   // Conteggi calcolati in precisione doppia
+  std::vector<double> fTest;  // Conteggi calcolati in precisione singola
+
+  // Metodo per trovare il bin corrispondente a un valore
+  // return: indice del bin o -1 se il valore è fuori intervallo
+  int FindBin(double x) const;
+
+public:
+  // Costruttore che definisce la binnatura del confronto
+  // nBins: numero di bin
+  // min, max: estremi dell'intervallo
+  PrecisionValidator(int nBins, double min, double max);
+
+  // Metodo per riempire entrambe le distribuzioni con le masse di un evento
+  // ref: masse calcolate in precisione doppia
+  // test: masse calcolate in precisione singola
+  // n: numero di masse
+  void Fill(const double *ref, const float *test, int n);
+
+  // Metodo per sommare i conteggi di un altro validatore con la stessa binnatura
+  // (usato per unire i risultati dei thread di generazione)
+  // other: validatore da sommare
+  void Merge(const PrecisionValidator &other);
+
+  // Metodo per calcolare la deviazione massima tra le due distribuzioni
+  // bin: bin (1-based, come in ROOT) in cui si trova la deviazione massima
+  // return: |N_float - N_double| / sqrt(N_double) massimo sui bin
+  double MaxDeviation(int &bin) const;
+
+  // Metodo per stampare il risultato del confronto
+  void Print() const;
+};
+
+#endif // PRECISIONVALIDATOR_H
@@ -0,0 +1,243 @@
+#include "PrimaryGenerator.h"
+#include "Particle.h"
+#include "FastMath.h"
+#include <cmath>
+#include "TRandom.h"
+
+void PrimaryBatch::Resize(int count)
+{
+  n = count;
+  Reserve(count);
+}
+
+void PrimaryBatch::Reserve(int count)
+{
+  if ((int)type.size() >= count)
+    return;
+  type.resize(count);
+  phi.resize(count);
+  theta.resize(count);
+  momentum.resize(count);
+  px.resize(count);
+  py.resize(count);
+  pz.resize(count);
+  polar.resize(count);
+  for (int k = 0; k < 4; ++k)
+    random[k].resize(count);
+  sinPhi.resize(count);
+  cosPhi.resize(count);
+  sinTheta.resize(count);
+  cosTheta.resize(count);
+}
+
+PrimaryGenerator::PrimaryGenerator(const PrimaryModel &model, const int *types, const double *abundance, int nTypes)
+    : fModel(model), fNTypes(nTypes)
+{
+  const SpeciesTable &species = Particle::GetSpeciesTable();
+  const double t = fModel.temperature;
+  double sum = 0;
+  for (int k = 0; k < nTypes; ++k)
+  {
+    fType[k] = types[k];
+    sum += abundance[k];
+    fCumulative[k] = sum;
+    fMass[k] = species[types[k]].mass;
+
+    // Con k = mT - m lo spettro in mT si scompone in termini Gamma(n, T):
+    // - termico:   (k + m) e^(-k/T)  -> pesi T^2 (n = 2) e m T (n = 1);
+    // - Boltzmann: (k + m)^2 e^(-k/T) -> pesi 2 T^3 (n = 3), 2 m T^2 (n = 2) e m^2 T (n = 1).
+    const double m = fMass[k];
+    double w3 = 0, w2 = 0, w1 = 0;
+    if (fModel.kinematics == kThermalKinematics)
+    {
+      w2 = t * t;
+      w1 = m * t;
+    }
+    else if (fModel.kinematics == kBoltzmannKinematics)
+    {
+      w3 = 2 * t * t * t;
+      w2 = 2 * m * t * t;
+      w1 = m * m * t;
+    }
+    const double total = w3 + w2 + w1;
+    fShapeCut[k][0] = total > 0 ? w3 / total : 0;
+    fShapeCut[k][1] = total > 0 ? (w3 + w2) / total : 0;
+  }
+}
+
+double PrimaryGenerator::SampleGamma(double shape, TRandom &random)
+{
+  // Per shape < 1: Gamma(shape) = Gamma(shape + 1) * u^(1 / shape)
+  if (shape < 1)
+    return SampleGamma(shape + 1, random) * std::pow(random.Rndm(), 1 / shape);
+
+  const double d = shape - 1.0 / 3.0;
+  const double c = 1 / std::sqrt(9 * d);
+  while (true)
+  {
+    double x = random.Gaus();
+    double v = 1 + c * x;
+    if (v <= 0)
+      continue;
+    v = v * v * v;
+    double u = random.Rndm();
+    if (std::log(u) < 0.5 * x * x + d - d * v + d * std::log(v))
+      return d * v;
+  }
+}
+
+int PrimaryGenerator::SampleMultiplicity(TRandom &random) const
+{
+  switch (fModel.multiplicity)
+  {
+  case kPoissonMultiplicity:
+    return random.Poisson(fModel.meanMultiplicity);
+  case kNegativeBinomialMultiplicity:
+  {
+    // Binomiale negativa come Poisson con media distribuita secondo una Gamma di media μ e forma k
+    const double k = fModel.negativeBinomialK;
+    return random.Poisson(SampleGamma(k, random) * fModel.meanMultiplicity / k);
+  }
+  case kFixedMultiplicity:
+  default:
+    // Nessun numero casuale estratto: la sequenza resta quella della generazione originale
+    return (int)fModel.meanMultiplicity;
+  }
+}
+
+int PrimaryGenerator::GetMultiplicityBound() const
+{
+  const double mean = fModel.meanMultiplicity;
+  switch (fModel.multiplicity)
+  {
+  case kPoissonMultiplicity:
+    return (int)(mean + 10 * std::sqrt(mean)) + 10;
+  case kNegativeBinomialMultiplicity:
+    return (int)(mean + 10 * std::sqrt(mean + mean * mean / fModel.negativeBinomialK)) + 10;
+  case kFixedMultiplicity:
+  default:
+    return (int)mean;
+  }
+}
+
+void PrimaryGenerator::Generate(TRandom &random, int n, PrimaryBatch &batch) const
+{
+  batch.Resize(n);
+  if (fModel.kinematics == kThermalKinematics || fModel.kinematics == kBoltzmannKinematics)
+    GenerateThermal(random, batch);
+  else
+    GenerateExponential(random, batch);
+}
+
+void PrimaryGenerator::GenerateExponential(TRandom &random, PrimaryBatch &batch) const
+{
+  const int n = batch.n;
+  const bool legacy = fModel.kinematics == kLegacyKinematics;
+  double *polarRandom = batch.random[0].data();
+  double *momentumRandom = batch.random[1].data();
+  double *typeRandom = batch.random[2].data();
+
+  // Estrazione dei numeri casuali nello stesso ordine della generazione particella per particella:
+  // - `phi`: angolo azimutale distribuito uniformemente tra 0 e 2π.
+  // - variabile polare: theta uniforme tra 0 e π (originale) o u uniforme con cos(theta) = 1 - 2u.
+  // - `momentum`: modulo della quantità di moto, distribuito esponenzialmente (-log u).
+  // - specie, scelta in base alle abbondanze.
+  for (int i = 0; i < n; ++i)
+  {
+    batch.phi[i] = random.Uniform(0, 2 * M_PI);
+    polarRandom[i] = legacy ? random.Uniform(0, M_PI) : random.Rndm();
+    momentumRandom[i] = random.Rndm();
+    typeRandom[i] = random.Rndm();
+  }
+
+  // Funzioni trascendenti calcolate in blocco sugli array (vettorizzate).
+  FastMath::SinCos(batch.phi.data(), batch.sinPhi.data(), batch.cosPhi.data(), n);
+  if (legacy)
+  {
+    FastMath::SinCos(polarRandom, batch.sinTheta.data(), batch.cosTheta.data(), n);
+    for (int i = 0; i < n; ++i)
+    {
+      batch.theta[i] = polarRandom[i];
+      batch.polar[i] = polarRandom[i] / M_PI;
+    }
+  }
+  else
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      double cosTheta = 1 - 2 * polarRandom[i];
+      batch.cosTheta[i] = cosTheta;
+      batch.sinTheta[i] = std::sqrt(1 - cosTheta * cosTheta);
+      batch.theta[i] = std::acos(cosTheta);
+      batch.polar[i] = polarRandom[i];
+    }
+  }
+  FastMath::Log(momentumRandom, momentumRandom, n);
+
+  for (int i = 0; i < n; ++i)
+  {
+    double momentum = -momentumRandom[i];
+    batch.momentum[i] = momentum;
+
+    // Conversione delle coordinate angolari in coordinate cartesiane (Px, Py, Pz).
+    batch.px[i] = momentum * batch.sinTheta[i] * batch.cosPhi[i];
+    batch.py[i] = momentum * batch.sinTheta[i] * batch.sinPhi[i];
+    batch.pz[i] = momentum * batch.cosTheta[i];
+    batch.type[i] = fType[SampleSlot(typeRandom[i])];
+  }
+}
+
+void PrimaryGenerator::GenerateThermal(TRandom &random, PrimaryBatch &batch) const
+{
+  const int n = batch.n;
+  const double maxRapidity = fModel.maxRapidity;
+  double *rapidityRandom = batch.random[0].data();
+  double *product = batch.random[1].data();
+  double *rapidityExp = batch.random[2].data();
+  double *mass = batch.random[3].data();
+
+  // Sette numeri casuali per particella, sempre estratti: angolo azimutale, specie, rapidità,
+  // termine dello spettro e tre uniformi il cui prodotto dà mT - m = -T log(u1 ... un) ~ Gamma(n, T).
+  // Un solo logaritmo per particella, calcolato in blocco.
+  for (int i = 0; i < n; ++i)
+  {
+    batch.phi[i] = random.Uniform(0, 2 * M_PI);
+    const int slot = SampleSlot(random.Rndm());
+    rapidityRandom[i] = random.Rndm();
+    const double term = random.Rndm();
+    const double u1 = random.Rndm();
+    const double u2 = random.Rndm();
+    const double u3 = random.Rndm();
+    batch.type[i] = fType[slot];
+    mass[i] = fMass[slot];
+    product[i] = u1 * (term < fShapeCut[slot][1] ? u2 : 1.0) * (term < fShapeCut[slot][0] ? u3 : 1.0);
+    rapidityExp[i] = maxRapidity * (2 * rapidityRandom[i] - 1);
+  }
+
+  FastMath::SinCos(batch.phi.data(), batch.sinPhi.data(), batch.cosPhi.data(), n);
+  FastMath::Log(product, product, n);
+  FastMath::Exp(rapidityExp, rapidityExp, n);
+
+  const double temperature = fModel.temperature;
+  for (int i = 0; i < n; ++i)
+  {
+    const double kinetic = -temperature * product[i]; // mT - m
+    const double mt = mass[i] + kinetic;
+    const double pt = std::sqrt(kinetic * (kinetic + 2 * mass[i]));
+    const double sinhY = 0.5 * (rapidityExp[i] - 1 / rapidityExp[i]);
+
+    batch.px[i] = pt * batch.cosPhi[i];
+    batch.py[i] = pt * batch.sinPhi[i];
+    batch.pz[i] = mt * sinhY;
+    batch.momentum[i] = std::sqrt(pt * pt + batch.pz[i] * batch.pz[i]);
+    batch.theta[i] = std::atan2(pt, batch.pz[i]);
+    batch.polar[i] = rapidityRandom[i];
+  }
+}
+
+double PrimaryGenerator::GetExpectedMeanMomentum() const
+{
+  if (fModel.kinematics == kLegacyKinematics || fModel.kinematics == kIsotropicKinematics)
+    return 1.0;
+  return 0;
+}
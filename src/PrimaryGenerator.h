@@ -0,0 +1,133 @@
+#ifndef PRIMARYGENERATOR_H
+#define PRIMARYGENERATOR_H
+
+#include "SpeciesTable.h"
+#include <vector>
+
+class TRandom;
+
+// Modelli per il numero di particelle primarie di un evento
+enum MultiplicityModel
+{
+  kFixedMultiplicity,           // Numero fisso di primarie
+  kPoissonMultiplicity,         // Poisson con media assegnata
+  kNegativeBinomialMultiplicity // Binomiale negativa (media e parametro k)
+};
+
+// Modelli per la cinematica delle particelle primarie
+enum KinematicsModel
+{
+  kLegacyKinematics,    // theta uniforme in [0, π], |p| esponenziale con media 1 GeV/c (generazione originale)
+  kIsotropicKinematics, // cos(theta) uniforme in [-1, 1], |p| esponenziale con media 1 GeV/c
+  kThermalKinematics,   // Spettro termico in pT (dN/dmT ∝ mT exp(-mT/T)), rapidità piatta
+  kBoltzmannKinematics  // Spettro di Boltzmann in pT (dN/dmT ∝ mT² exp(-mT/T)), rapidità piatta
+};
+
+// Parametri del modello di generazione delle primarie
+struct PrimaryModel
+{
+  MultiplicityModel multiplicity; // Modello di molteplicità
+  double meanMultiplicity;        // Molteplicità fissa o media
+  double negativeBinomialK;       // Parametro k della binomiale negativa
+  KinematicsModel kinematics;     // Modello cinematico
+  double temperature;             // Temperatura degli spettri termici (GeV)
+  double maxRapidity;             // Rapidità massima per la rapidità piatta
+
+  PrimaryModel()
+      : multiplicity(kFixedMultiplicity), meanMultiplicity(100), negativeBinomialK(2),
+        kinematics(kLegacyKinematics), temperature(0.16), maxRapidity(1.0) {}
+};
+
+// Particelle primarie di un evento in formato SoA, riempite in blocco dal generatore.
+// I buffer crescono fino alla molteplicità massima incontrata e poi vengono riutilizzati.
+struct PrimaryBatch
+{
+  int n;                          // Numero di primarie
+  std::vector<int> type;          // Indice della specie
+  std::vector<double> phi;        // Angolo azimutale in [0, 2π)
+  std::vector<double> theta;      // Angolo polare in [0, π]
+  std::vector<double> momentum;   // Modulo della quantità di moto
+  std::vector<double> px, py, pz; // Componenti della quantità di moto
+  std::vector<double> polar;      // Variabile polare normalizzata, uniforme in [0, 1) nel modello
+
+  // Buffer di lavoro: numeri casuali estratti in blocco e funzioni trascendenti
+  std::vector<double> random[4];
+  std::vector<double> sinPhi, cosPhi, sinTheta, cosTheta;
+
+  PrimaryBatch() : n(0) {}
+
+  // Metodo per dimensionare i buffer (la capacità non diminuisce mai)
+  // count: numero di primarie
+  void Resize(int count);
+
+  // Metodo per allocare i buffer per almeno count primarie, senza cambiare n
+  void Reserve(int count);
+};
+
+// La classe PrimaryGenerator genera in blocco le particelle primarie di un evento secondo
+// un modello di molteplicità e un modello cinematico, scegliendo la specie in base
+// alle abbondanze configurate. Tutti i modelli condividono la stessa interfaccia: i numeri
+// casuali sono estratti in array e le funzioni trascendenti sono calcolate in blocco con FastMath.
+// Il modello di default (molteplicità fissa 100, cinematica originale) consuma i numeri casuali
+// nello stesso ordine del loop per particella che sostituisce; non riproduce gli eventi della
+// generazione originale, già cambiati dall'estrazione della carica della K*, dai generatori per
+// thread e dalle approssimazioni di FastMath.
+
+class PrimaryGenerator
+{
+private:
+  PrimaryModel fModel;                           // Parametri del modello
+  int fNTypes;                                   // Numero di specie primarie
+  int fType[SpeciesTable::kMaxSpecies];          // Indici delle specie primarie
+  double fCumulative[SpeciesTable::kMaxSpecies]; // Abbondanze cumulative
+
+  double fMass[SpeciesTable::kMaxSpecies];       // Masse delle specie primarie
+  double fShapeCut[SpeciesTable::kMaxSpecies][2]; // Probabilità cumulative dei termini dello spettro termico
+
+  // Metodo per scegliere la specie a partire da un numero uniforme
+  // return: posizione della specie tra le primarie configurate
+  int SampleSlot(double u) const
+  {
+    int k = 0;
+    while (k < fNTypes - 1 && u >= fCumulative[k])
+      ++k;
+    return k;
+  }
+
+  // Metodo per estrarre da una distribuzione Gamma(shape, 1) (metodo di Marsaglia e Tsang)
+  static double SampleGamma(double shape, TRandom &random);
+
+  // Metodi di generazione della cinematica per ogni famiglia di modelli
+  void GenerateExponential(TRandom &random, PrimaryBatch &batch) const;
+  void GenerateThermal(TRandom &random, PrimaryBatch &batch) const;
+
+public:
+  // Costruttore
+  // model: parametri del modello
+  // types: indici delle specie primarie
+  // abundance: abbondanze delle specie primarie (somma 1)
+  // nTypes: numero di specie primarie
+  PrimaryGenerator(const PrimaryModel &model, const int *types, const double *abundance, int nTypes);
+
+  // Metodo per estrarre il numero di primarie di un evento
+  int SampleMultiplicity(TRandom &random) const;
+
+  // Metodo per ottenere la molteplicità per cui dimensionare in anticipo i buffer degli eventi:
+  // quella fissa, o media più 10 deviazioni standard (superata con probabilità trascurabile)
+  int GetMultiplicityBound() const;
+
+  // Metodo per generare le primarie di un evento
+  // random: generatore di numeri casuali del thread
+  // n: numero di primarie
+  // batch: primarie generate
+  void Generate(TRandom &random, int n, PrimaryBatch &batch) const;
+
+  // Metodo per ottenere la media attesa di |p| delle primarie
+  // return: media attesa, o 0 se dipende dalle masse delle specie (modelli termici)
+  double GetExpectedMeanMomentum() const;
+
+  // Metodo per accedere ai parametri del modello
+  const PrimaryModel &GetModel() const { return fModel; }
+};
+
+#endif // PRIMARYGENERATOR_H
@@ -0,0 +1,141 @@
+#include "RegressionReference.h"
+#include "HistogramComparison.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+const char RegressionReference::kMagic[5] = "RRF1";
+
+// Metodo per aggiungere un valore a 64 bit all'impronta FNV-1a
+static uint64_t CombineChecksum(uint64_t hash, uint64_t value)
+{
+  for (int k = 0; k < 8; ++k)
+  {
+    hash ^= (value >> (8 * k)) & 0xff;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+RegressionReference::RegressionReference() : fNBlocks(0) {}
+
+bool RegressionReference::AddBlock(const HistogramStore &store)
+{
+  const long long nHistograms = store.GetNHistograms();
+  if (fNBlocks == 0)
+  {
+    fHistograms.assign(nHistograms, ReferenceHistogram());
+    for (long long k = 0; k < nHistograms; ++k)
+    {
+      ReferenceHistogram &histogram = fHistograms[k];
+      histogram.name = store.GetName(store.GetEntry(k));
+      histogram.nCells = store.GetEntry(k).nCells;
+      histogram.checksum = 14695981039346656037ULL;
+      std::fill(histogram.mean, histogram.mean + ReferenceHistogram::kCoarseBins, 0.0);
+      std::fill(histogram.m2, histogram.m2 + ReferenceHistogram::kCoarseBins, 0.0);
+      // I nomi sono scritti come parole separate da spazi
+      if (histogram.name.empty() || histogram.name.find_first_of(" \t\n") != std::string::npos)
+        return false;
+    }
+  }
+  else if ((long long)fHistograms.size() != nHistograms)
+    return false;
+
+  // Aggiornamento di media e scarti quadratici di ogni bin grossolano (algoritmo di Welford)
+  ++fNBlocks;
+  for (long long k = 0; k < nHistograms; ++k)
+  {
+    const HistogramStoreEntry &entry = store.GetEntry(k);
+    ReferenceHistogram &histogram = fHistograms[k];
+    if (histogram.name != store.GetName(entry) || histogram.nCells != entry.nCells)
+      return false;
+    histogram.checksum = CombineChecksum(histogram.checksum, HistogramComparison::Checksum(store, entry));
+    const double *sumw = store.GetSumw(entry);
+    for (int bin = 0; bin < ReferenceHistogram::kCoarseBins; ++bin)
+    {
+      const uint64_t first = entry.nCells * bin / ReferenceHistogram::kCoarseBins;
+      const uint64_t last = entry.nCells * (bin + 1) / ReferenceHistogram::kCoarseBins;
+      double content = 0;
+      for (uint64_t cell = first; cell < last; ++cell)
+        content += sumw[cell];
+      const double delta = content - histogram.mean[bin];
+      histogram.mean[bin] += delta / fNBlocks;
+      histogram.m2[bin] += delta * (content - histogram.mean[bin]);
+    }
+  }
+  return true;
+}
+
+bool RegressionReference::Write(const std::string &path) const
+{
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary.c_str(), std::ios::trunc);
+    out << kMagic << ' ' << fNBlocks << ' ' << fHistograms.size() << ' ' << ReferenceHistogram::kCoarseBins << '\n';
+    char number[32];
+    for (const ReferenceHistogram &histogram : fHistograms)
+    {
+      std::snprintf(number, sizeof(number), "%016llx", (unsigned long long)histogram.checksum);
+      out << histogram.name << ' ' << histogram.nCells << ' ' << number << '\n';
+      for (int bin = 0; bin < ReferenceHistogram::kCoarseBins; ++bin)
+      {
+        std::snprintf(number, sizeof(number), "%.17g", histogram.mean[bin]);
+        out << (bin > 0 ? " " : "") << number;
+        std::snprintf(number, sizeof(number), "%.17g", GetVariance(histogram, bin));
+        out << ' ' << number;
+      }
+      out << '\n';
+    }
+    out.close();
+    if (!out)
+    {
+      std::remove(temporary.c_str());
+      return false;
+    }
+  }
+  return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool RegressionReference::Read(const std::string &path)
+{
+  fNBlocks = 0;
+  fHistograms.clear();
+  std::ifstream in(path.c_str());
+  std::string magic;
+  long long nHistograms = 0;
+  int nBlocks = 0, nCoarseBins = 0;
+  if (!(in >> magic >> nBlocks >> nHistograms >> nCoarseBins) || magic != kMagic || nBlocks < 1 ||
+      nHistograms < 0 || nCoarseBins != ReferenceHistogram::kCoarseBins)
+    return false;
+
+  std::vector<ReferenceHistogram> histograms(nHistograms);
+  for (ReferenceHistogram &histogram : histograms)
+  {
+    if (!(in >> histogram.name >> histogram.nCells >> std::hex >> histogram.checksum >> std::dec))
+      return false;
+    for (int bin = 0; bin < ReferenceHistogram::kCoarseBins; ++bin)
+    {
+      double variance = 0;
+      if (!(in >> histogram.mean[bin] >> variance) || variance < 0)
+        return false;
+      histogram.m2[bin] = variance * (nBlocks - 1);
+    }
+  }
+  for (size_t k = 1; k < histograms.size(); ++k)
+  {
+    if (!(histograms[k - 1].name < histograms[k].name))
+      return false;
+  }
+  fNBlocks = nBlocks;
+  fHistograms.swap(histograms);
+  return true;
+}
+
+const ReferenceHistogram *RegressionReference::Find(const std::string &name) const
+{
+  std::vector<ReferenceHistogram>::const_iterator it =
+      std::lower_bound(fHistograms.begin(), fHistograms.end(), name,
+                       [](const ReferenceHistogram &histogram, const std::string &key) { return histogram.name < key; });
+  return it != fHistograms.end() && it->name == name ? &*it : 0;
+}
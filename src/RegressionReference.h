@@ -0,0 +1,78 @@
+#ifndef REGRESSIONREFERENCE_H
+#define REGRESSIONREFERENCE_H
+
+#include "HistogramStore.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Riassunto di un istogramma su tutti i blocchi di un riferimento
+struct ReferenceHistogram
+{
+  static const int kCoarseBins = 10; // Bin grossolani: intervalli contigui delle celle (underflow e overflow inclusi)
+
+  std::string name;          // Nome dell'istogramma
+  uint64_t nCells;           // Numero di celle
+  uint64_t checksum;         // Impronta combinata delle impronte dei blocchi, nell'ordine dei blocchi
+  double mean[kCoarseBins];  // Media sui blocchi del contenuto di ogni bin grossolano
+  double m2[kCoarseBins];    // Somma dei quadrati degli scarti dalla media (algoritmo di Welford)
+};
+
+// La classe RegressionReference riassume gli istogrammi di una simulazione divisa in blocchi
+// indipendenti (ognuno con il proprio seme) in un riferimento piccolo e portabile: per ogni istogramma
+// l'impronta combinata dei blocchi, per il confronto esatto, e media e varianza sui blocchi del
+// contenuto di kCoarseBins intervalli contigui delle celle, per il confronto statistico. La varianza
+// è misurata dai blocchi, quindi include le correlazioni tra le entrate di uno stesso evento (coppie
+// che condividono le particelle, molteplicità comune) senza ipotesi sulla loro distribuzione.
+// Il file è di testo, con i valori scritti in modo da essere riletti senza perdita di precisione:
+//   RRF1 <blocchi> <istogrammi> <bin grossolani>
+//   <nome> <celle> <impronta esadecimale>
+//   <media> <varianza> per ogni bin grossolano
+
+class RegressionReference
+{
+public:
+  static const char kMagic[5]; // Identificatore del formato
+
+private:
+  int fNBlocks;                                 // Numero di blocchi
+  std::vector<ReferenceHistogram> fHistograms;  // Istogrammi ordinati per nome
+
+public:
+  RegressionReference();
+
+  // Metodo per aggiungere gli istogrammi di un blocco
+  // store: archivio del blocco
+  // return: false se gli istogrammi (nomi o numero di celle) sono diversi da quelli dei blocchi precedenti
+  bool AddBlock(const HistogramStore &store);
+
+  // Metodo per scrivere il riferimento
+  // path: file da scrivere
+  // return: false se il file non può essere scritto
+  bool Write(const std::string &path) const;
+
+  // Metodo per leggere un riferimento
+  // path: file da leggere
+  // return: false se il file non esiste o non è un riferimento valido
+  bool Read(const std::string &path);
+
+  // Metodi di accesso
+  int GetNBlocks() const { return fNBlocks; }
+  long long GetNHistograms() const { return (long long)fHistograms.size(); }
+  const ReferenceHistogram &GetHistogram(long long k) const { return fHistograms[k]; }
+
+  // Metodo per cercare un istogramma per nome
+  // return: istogramma o puntatore nullo se assente
+  const ReferenceHistogram *Find(const std::string &name) const;
+
+  // Metodo per calcolare la varianza sui blocchi di un bin grossolano
+  // histogram: istogramma del riferimento
+  // bin: bin grossolano
+  // return: varianza campionaria (zero con meno di due blocchi)
+  double GetVariance(const ReferenceHistogram &histogram, int bin) const
+  {
+    return fNBlocks > 1 ? histogram.m2[bin] / (fNBlocks - 1) : 0;
+  }
+};
+
+#endif // REGRESSIONREFERENCE_H
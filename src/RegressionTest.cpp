@@ -0,0 +1,295 @@
+#include "RegressionTest.h"
+#include "HistogramComparison.h"
+#include "PairCorrelations.h"
+#include "Particle.h"
+#include <cmath>
+#include "TRandom3.h"
+
+// Contatore dei controlli della cinematica, con tolleranza relativa adatta alla precisione di Real
+struct KinematicsChecks
+{
+  std::ostream &out;
+  double tolerance;
+  int nChecks, nFailures;
+
+  KinematicsChecks(std::ostream &stream)
+      : out(stream), tolerance(sizeof(Real) == sizeof(float) ? 1e-4 : 1e-9), nChecks(0), nFailures(0)
+  {
+  }
+
+  // Metodo per controllare che un valore coincida con quello atteso entro la tolleranza
+  // (relativa, o assoluta per valori attesi minori di 1)
+  void Equal(const char *name, double value, double expected)
+  {
+    ++nChecks;
+    const double scale = std::fabs(expected) > 1 ? std::fabs(expected) : 1;
+    if (std::fabs(value - expected) <= tolerance * scale)
+      return;
+    ++nFailures;
+    out << "FAIL " << name << ": " << value << " (expected " << expected << ")" << std::endl;
+  }
+
+  // Metodo per controllare una condizione
+  void True(const char *name, bool condition)
+  {
+    ++nChecks;
+    if (condition)
+      return;
+    ++nFailures;
+    out << "FAIL " << name << std::endl;
+  }
+};
+
+int RegressionTest::CheckKinematics(std::ostream &out)
+{
+  KinematicsChecks check(out);
+
+  // Energia e massa invariante, confrontate con il calcolo esplicito dei quadrivettori
+  const Particle pion("Pion+", 0.3, -0.2, 1.1);
+  const Particle kaon("Kaon-", -0.5, 0.4, 0.2);
+  const double mPion = pion.GetMass();
+  check.Equal("pion energy", pion.GetEnergy(), std::sqrt(mPion * mPion + 0.09 + 0.04 + 1.21));
+  const double energy = pion.GetEnergy() + kaon.GetEnergy();
+  check.Equal("pion-kaon invariant mass", pion.InvariantMass(kaon),
+              std::sqrt(energy * energy - (0.04 + 0.04 + 1.69)));
+  check.Equal("invariant mass symmetry", pion.InvariantMass(kaon), kaon.InvariantMass(pion));
+  check.Equal("invariant mass of equal momenta", pion.InvariantMass(Particle("Pion+", 0.3, -0.2, 1.1)), 2 * mPion);
+
+  // Quadrivettori: boost in blocco uguale a quello scalare, invarianza della massa, boost inverso,
+  // additività della rapidità per un boost lungo il fascio, pseudorapidità uguale alla rapidità a massa nulla
+  const LorentzBoost<double> boost = LorentzBoost<double>::FromVelocity(0.3, -0.5, 0.6);
+  const LorentzVector<double> vector = LorentzVector<double>::FromMass2(0.4, 1.2, -0.7, mPion * mPion);
+  LorentzVector<double> boosted = vector;
+  boosted.Boost(boost);
+  double px[1] = {vector.Px()}, py[1] = {vector.Py()}, pz[1] = {vector.Pz()}, e[1] = {vector.E()};
+  BoostArrays(boost, px, py, pz, e, 1);
+  check.Equal("batched boost px", px[0], boosted.Px());
+  check.Equal("batched boost energy", e[0], boosted.E());
+  check.Equal("boost invariance of the mass", boosted.M(), mPion);
+  LorentzVector<double> back = boosted;
+  back.Boost(LorentzBoost<double>::FromVelocity(-0.3, 0.5, -0.6));
+  check.Equal("inverse boost px", back.Px(), vector.Px());
+  check.Equal("inverse boost pz", back.Pz(), vector.Pz());
+  check.Equal("inverse boost energy", back.E(), vector.E());
+  LorentzVector<double> longitudinal = vector;
+  longitudinal.Boost(LorentzBoost<double>::FromVelocity(0, 0, 0.8));
+  check.Equal("rapidity under a longitudinal boost", longitudinal.Rapidity(), vector.Rapidity() + std::atanh(0.8));
+  const LorentzVector<double> massless = LorentzVector<double>::FromMass2(0.4, 1.2, -0.7, 0);
+  check.Equal("pseudorapidity of a massless vector", massless.Eta(), massless.Rapidity());
+  check.Equal("pseudorapidity of a null momentum", LorentzVector<double>(0, 0, 0, mPion).Eta(), 0);
+
+  // Conservazione del quadrimpulso: una particella stabile decade alla sua massa nominale,
+  // quindi somma dei quadrimpulsi e massa invariante delle figlie sono note esattamente
+  TRandom3 random(4357);
+  const Particle proton("Proton+", 0.7, -1.2, 2.5);
+  Particle d1("Pion+"), d2("Kaon-");
+  check.True("two-body decay status", proton.Decay2Body(d1, d2, random) == 0);
+  check.Equal("two-body px", d1.GetPulseX() + d2.GetPulseX(), proton.GetPulseX());
+  check.Equal("two-body py", d1.GetPulseY() + d2.GetPulseY(), proton.GetPulseY());
+  check.Equal("two-body pz", d1.GetPulseZ() + d2.GetPulseZ(), proton.GetPulseZ());
+  check.Equal("two-body energy", d1.GetEnergy() + d2.GetEnergy(), proton.GetEnergy());
+  check.Equal("two-body mass", d1.InvariantMass(d2), proton.GetMass());
+
+  Particle t1("Pion+"), t2("Pion-"), t3("Pion+");
+  check.True("three-body decay status", proton.Decay3Body(t1, t2, t3, random) == 0);
+  check.Equal("three-body px", t1.GetPulseX() + t2.GetPulseX() + t3.GetPulseX(), proton.GetPulseX());
+  check.Equal("three-body py", t1.GetPulseY() + t2.GetPulseY() + t3.GetPulseY(), proton.GetPulseY());
+  check.Equal("three-body pz", t1.GetPulseZ() + t2.GetPulseZ() + t3.GetPulseZ(), proton.GetPulseZ());
+  check.Equal("three-body energy", t1.GetEnergy() + t2.GetEnergy() + t3.GetEnergy(), proton.GetEnergy());
+
+  // Isotropia dei decadimenti a tre corpi: per la madre a riposo la direzione della terza figlia
+  // ha <cos²θ> = 1/3 (deviazione standard di cos²θ sqrt(4/45), controllo entro 5 sigma)
+  const int nIsotropy = 20000;
+  const Particle protonAtRest("Proton+");
+  double sumCos2 = 0;
+  for (int k = 0; k < nIsotropy; ++k)
+  {
+    protonAtRest.Decay3Body(t1, t2, t3, random);
+    sumCos2 += t3.GetPulseZ() * t3.GetPulseZ() /
+               (t3.GetPulseX() * t3.GetPulseX() + t3.GetPulseY() * t3.GetPulseY() + t3.GetPulseZ() * t3.GetPulseZ());
+  }
+  check.True("three-body decay isotropy",
+             std::fabs(sumCos2 / nIsotropy - 1.0 / 3) < 5 * std::sqrt(4.0 / 45 / nIsotropy));
+
+  // Boost: la K* a riposo e in moto, con la stessa sequenza casuale, estrae la stessa massa;
+  // la massa delle figlie non dipende dal boost e supera la soglia del canale
+  TRandom3 randomRest(2024), randomMoving(2024);
+  const Particle kStarRest("K*");
+  const Particle kStarMoving("K*", 1.5, 0.3, -2.0);
+  Particle r1("Pion+"), r2("Kaon-"), m1("Pion+"), m2("Kaon-");
+  check.True("resonance decay status", kStarRest.Decay2Body(r1, r2, randomRest) == 0 &&
+                                           kStarMoving.Decay2Body(m1, m2, randomMoving) == 0);
+  check.Equal("decay at rest px", r1.GetPulseX() + r2.GetPulseX(), 0);
+  check.Equal("decay at rest py", r1.GetPulseY() + r2.GetPulseY(), 0);
+  check.Equal("decay at rest pz", r1.GetPulseZ() + r2.GetPulseZ(), 0);
+  check.Equal("boosted decay px", m1.GetPulseX() + m2.GetPulseX(), kStarMoving.GetPulseX());
+  check.Equal("boosted decay py", m1.GetPulseY() + m2.GetPulseY(), kStarMoving.GetPulseY());
+  check.Equal("boosted decay pz", m1.GetPulseZ() + m2.GetPulseZ(), kStarMoving.GetPulseZ());
+  check.Equal("boost invariance of the decay mass", m1.InvariantMass(m2), r1.InvariantMass(r2));
+  check.True("decay mass above threshold", r1.InvariantMass(r2) >= r1.GetMass() + r2.GetMass());
+
+  out << "Kinematics checks: " << check.nChecks - check.nFailures << " passed, " << check.nFailures << " failed"
+      << std::endl;
+  return check.nFailures;
+}
+
+int RegressionTest::CheckCorrelations(std::ostream &out)
+{
+  // Eventi di due pioni con angoli azimutali uniformi e indipendenti: Δφ è uniforme su tutto
+  // l'angolo giro e ogni bin deve ricevere una frazione 1 / kDeltaPhiBins delle coppie
+  const int nEvents = 360000;
+  TRandom3 random(8191);
+  PairCorrelations correlations;
+  correlations.Reserve(2);
+  EventSoA<Real> ev;
+  Particle particles[2] = {Particle("Pion+"), Particle("Pion-")};
+  Real mass[1];
+  for (int k = 0; k < nEvents; ++k)
+  {
+    for (int i = 0; i < 2; ++i)
+    {
+      const double phi = random.Uniform(2 * M_PI);
+      particles[i].Set(particles[i].GetParticleTypeIndex(), std::cos(phi), std::sin(phi), random.Uniform(-1, 1));
+    }
+    ev.Load(particles, 2);
+    PairInvariantMassesRow(ev, 0, mass);
+    correlations.BeginEvent(ev, particles);
+    correlations.FillSameEventRow(0, mass, 0);
+  }
+
+  // Ogni bin entro 5 deviazioni standard della distribuzione binomiale
+  double counts[PairCorrelations::kDeltaPhiBins];
+  correlations.GetSameEventDeltaPhi(counts);
+  const double fraction = 1.0 / PairCorrelations::kDeltaPhiBins;
+  const double expected = nEvents * fraction;
+  const double sigma = std::sqrt(nEvents * fraction * (1 - fraction));
+  int nFailures = 0;
+  for (int p = 0; p < PairCorrelations::kDeltaPhiBins; ++p)
+  {
+    if (std::fabs(counts[p] - expected) <= 5 * sigma)
+      continue;
+    ++nFailures;
+    out << "FAIL delta phi bin " << p << ": " << counts[p] << " pairs (expected " << expected << " ± " << sigma << ")"
+        << std::endl;
+  }
+  out << "Correlation checks: " << PairCorrelations::kDeltaPhiBins - nFailures << " of "
+      << PairCorrelations::kDeltaPhiBins << " delta phi bins uniform" << std::endl;
+  return nFailures;
+}
+
+// Metodo per confrontare un istogramma con quello di riferimento bin grossolano per bin grossolano
+// run, golden: riassunti dei blocchi della simulazione e del riferimento
+// a, b: istogrammi della simulazione e del riferimento
+// worstBin: bin grossolano con la probabilità minima
+// worstT: valore di t del bin grossolano con la probabilità minima
+// return: probabilità dell'istogramma (minima dei bin grossolani per il loro numero)
+static double CompareCoarseBins(const RegressionReference &run, const RegressionReference &golden,
+                                const ReferenceHistogram &a, const ReferenceHistogram &b, int &worstBin,
+                                double &worstT)
+{
+  const int nRun = run.GetNBlocks(), nGolden = golden.GetNBlocks();
+  const int ndf = nRun + nGolden - 2;
+  // Contenuti senza fluttuazioni (uguali in tutti i blocchi): stessi valori entro l'arrotondamento di Real
+  const double tolerance = sizeof(Real) == sizeof(float) ? 1e-4 : 1e-9;
+  double minProb = 1;
+  worstBin = 0;
+  worstT = 0;
+  for (int bin = 0; bin < ReferenceHistogram::kCoarseBins; ++bin)
+  {
+    const double difference = a.mean[bin] - b.mean[bin];
+    const double pooledVariance = (a.m2[bin] + b.m2[bin]) / ndf;
+    const double error = std::sqrt(pooledVariance * (1.0 / nRun + 1.0 / nGolden));
+    double t = 0, prob = 1;
+    if (error > 0)
+    {
+      t = difference / error;
+      prob = HistogramComparison::StudentProb(t, ndf);
+    }
+    else if (std::fabs(difference) > tolerance * std::fmax(1.0, std::fabs(b.mean[bin])))
+    {
+      t = difference > 0 ? INFINITY : -INFINITY;
+      prob = 0;
+    }
+    if (prob < minProb)
+    {
+      minProb = prob;
+      worstBin = bin;
+      worstT = t;
+    }
+  }
+  return std::fmin(1.0, minProb * ReferenceHistogram::kCoarseBins);
+}
+
+int RegressionTest::CompareReferences(const RegressionReference &run, const RegressionReference &golden,
+                                      bool tolerance, double minProb, std::ostream &out)
+{
+  if (tolerance && (run.GetNBlocks() < 2 || golden.GetNBlocks() < 2))
+  {
+    out << "FAIL the statistical comparison needs at least two blocks (run " << run.GetNBlocks() << ", golden "
+        << golden.GetNBlocks() << ")" << std::endl;
+    return 1;
+  }
+  if (!tolerance && run.GetNBlocks() != golden.GetNBlocks())
+  {
+    out << "FAIL " << run.GetNBlocks() << " blocks (expected " << golden.GetNBlocks() << ")" << std::endl;
+    return 1;
+  }
+
+  int nFailures = 0, nMatching = 0;
+  for (long long k = 0; k < golden.GetNHistograms(); ++k)
+  {
+    const ReferenceHistogram &reference = golden.GetHistogram(k);
+    const ReferenceHistogram *histogram = run.Find(reference.name);
+    if (!histogram)
+    {
+      out << "FAIL " << reference.name << ": missing" << std::endl;
+      ++nFailures;
+      continue;
+    }
+    if (histogram->nCells != reference.nCells)
+    {
+      out << "FAIL " << reference.name << ": binning differs (" << histogram->nCells << " cells, expected "
+          << reference.nCells << ")" << std::endl;
+      ++nFailures;
+      continue;
+    }
+    if (!tolerance)
+    {
+      if (histogram->checksum != reference.checksum)
+      {
+        out << "FAIL " << reference.name << ": checksum differs" << std::endl;
+        ++nFailures;
+      }
+      else
+        ++nMatching;
+      continue;
+    }
+    int bin = 0;
+    double t = 0;
+    const double prob = CompareCoarseBins(run, golden, *histogram, reference, bin, t);
+    if (prob < minProb)
+    {
+      out << "FAIL " << reference.name << ": coarse bin " << bin << " mean " << histogram->mean[bin] << " (expected "
+          << reference.mean[bin] << ", t " << t << ", prob " << prob << ")" << std::endl;
+      ++nFailures;
+    }
+    else
+      ++nMatching;
+  }
+
+  // Istogrammi nuovi, assenti nel riferimento
+  for (long long k = 0; k < run.GetNHistograms(); ++k)
+  {
+    const std::string &name = run.GetHistogram(k).name;
+    if (!golden.Find(name))
+    {
+      out << "FAIL " << name << ": not in the golden reference" << std::endl;
+      ++nFailures;
+    }
+  }
+
+  out << "Histogram checks (" << (tolerance ? "statistical" : "exact") << ", " << run.GetNBlocks() << " and "
+      << golden.GetNBlocks() << " blocks): " << nMatching << " of " << golden.GetNHistograms() << " matching, "
+      << nFailures << " failures" << std::endl;
+  return nFailures;
+}
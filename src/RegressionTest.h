@@ -0,0 +1,52 @@
+#ifndef REGRESSIONTEST_H
+#define REGRESSIONTEST_H
+
+#include "RegressionReference.h"
+#include <ostream>
+
+// La classe RegressionTest verifica che le ottimizzazioni non cambino la fisica della simulazione:
+// - CheckKinematics controlla la cinematica di LorentzVector e di Particle: energia, massa invariante,
+//   boost (in blocco, inverso, effetto sulla rapidità), conservazione del quadrimpulso nei decadimenti
+//   a due e a tre corpi (boost compreso), isotropia dei decadimenti a tre corpi e invarianza per boost
+//   della massa delle figlie;
+// - CheckCorrelations riempie le correlazioni con coppie di angolo azimutale uniforme e controlla
+//   che tutti i bin di Δφ ricevano lo stesso numero di coppie entro le fluttuazioni statistiche;
+// - CompareReferences confronta tutti gli istogrammi di una simulazione a semi fissi, divisa in blocchi
+//   indipendenti, con quelli di un riferimento (RegressionReference): in modalità esatta le impronte
+//   combinate dei blocchi devono coincidere bit per bit; in modalità con tolleranza (precisione float,
+//   libm, più thread) le medie sui blocchi di ogni bin grossolano sono confrontate con il test t di
+//   Student a due campioni, con la varianza stimata dai blocchi (ν = K1 + K2 - 2). La varianza misurata
+//   include le correlazioni tra le entrate di uno stesso evento, quindi la stessa regola vale per gli
+//   istogrammi delle particelle e per quelli delle coppie. La probabilità di un istogramma è la minima
+//   dei suoi bin grossolani moltiplicata per il loro numero (correzione di Bonferroni).
+// Entrambi i metodi stampano i controlli falliti e un riepilogo e restituiscono il numero di fallimenti.
+
+class RegressionTest
+{
+public:
+  static constexpr double kDefaultMinProb = 1e-6; // Probabilità minima di un istogramma in modalità con tolleranza
+  static const int kBlocks = 20;                   // Blocchi indipendenti della simulazione a semi fissi
+  static const unsigned int kBlockSeedStride = 1000; // Distanza tra i semi di due blocchi (il thread w usa seme + w)
+
+  // Metodo per eseguire i controlli della cinematica (richiede le specie di default)
+  // out: stream di uscita
+  // return: numero di controlli falliti
+  static int CheckKinematics(std::ostream &out);
+
+  // Metodo per controllare la distribuzione in Δφ delle correlazioni (richiede le specie di default)
+  // out: stream di uscita
+  // return: numero di bin fuori dalle fluttuazioni attese
+  static int CheckCorrelations(std::ostream &out);
+
+  // Metodo per confrontare gli istogrammi di una simulazione con quelli di riferimento
+  // run: riassunto dei blocchi della simulazione
+  // golden: riferimento
+  // tolerance: confronto statistico invece che esatto
+  // minProb: probabilità minima di un istogramma (solo con tolleranza)
+  // out: stream di uscita
+  // return: numero di istogrammi diversi, mancanti o in più
+  static int CompareReferences(const RegressionReference &run, const RegressionReference &golden, bool tolerance,
+                               double minProb, std::ostream &out);
+};
+
+#endif // REGRESSIONTEST_H
@@ -0,0 +1,296 @@
+#include "RunMetrics.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Nomi delle cause di decadimento fallito nelle etichette delle metriche
+static const int kDecayFailureKinds[] = {kDiagDecayZeroMass, kDiagDecayBelowThreshold, kDiagDecayOverflow};
+static const char *const kDecayFailureLabels[] = {"zero_mass", "below_threshold", "capacity"};
+static const int kNDecayFailureKinds = sizeof(kDecayFailureKinds) / sizeof(kDecayFailureKinds[0]);
+
+// Tempo massimo per servire una richiesta HTTP (lettura e risposta), in millisecondi
+static const int kAnswerMilliseconds = 500;
+
+// Metodo per attendere che una connessione sia pronta entro una scadenza
+// descriptor: socket della connessione
+// events: eventi attesi (POLLIN o POLLOUT)
+// deadline: scadenza
+// return: false se la scadenza è passata o la connessione è chiusa
+static bool WaitReady(int descriptor, short events, std::chrono::steady_clock::time_point deadline)
+{
+  const long long remaining =
+      std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+  if (remaining <= 0)
+    return false;
+  pollfd fd = {descriptor, events, 0};
+  return poll(&fd, 1, (int)remaining) > 0 && (fd.revents & (events | POLLHUP | POLLERR));
+}
+
+WorkerMetrics::WorkerMetrics() : events(0), particles(0), pairs(0), busyNanoseconds(0)
+{
+}
+
+RunMetrics::RunMetrics(const std::vector<const WorkerMetrics *> &workers, long long requestedEvents,
+                       const long long *diagnosticsStart)
+    : fWorkers(workers), fRequestedEvents(requestedEvents), fHistogramBytes(0),
+      fStart(std::chrono::steady_clock::now()), fListen(-1), fPort(-1), fInterval(1), fEventRate(0), fPairRate(0),
+      fUtilisation(workers.size(), 0.0)
+{
+  for (int kind = 0; kind < kNDiagnosticKinds; ++kind)
+    fDiagnosticsStart[kind] = diagnosticsStart[kind];
+  fWakeup[0] = fWakeup[1] = -1;
+  fPrevious = Read();
+}
+
+RunMetrics::~RunMetrics()
+{
+  Stop();
+}
+
+bool RunMetrics::Start(const char *path, int port, double interval, std::ostream &err)
+{
+  fPath = path ? path : "";
+  fInterval = interval;
+  if (port >= 0)
+  {
+    fListen = socket(AF_INET, SOCK_STREAM, 0);
+    const int reuse = 1;
+    setsockopt(fListen, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)port);
+    socklen_t length = sizeof(address);
+    if (fListen < 0 || bind(fListen, (const sockaddr *)&address, sizeof(address)) != 0 || listen(fListen, 8) != 0 ||
+        getsockname(fListen, (sockaddr *)&address, &length) != 0)
+    {
+      err << "Cannot listen for metrics on 127.0.0.1:" << port << std::endl;
+      if (fListen >= 0)
+        close(fListen);
+      fListen = -1;
+      return false;
+    }
+    fPort = ntohs(address.sin_port);
+  }
+  if (pipe(fWakeup) != 0)
+  {
+    err << "Cannot start the metrics thread" << std::endl;
+    fWakeup[0] = fWakeup[1] = -1;
+    if (fListen >= 0)
+      close(fListen);
+    fListen = -1;
+    fPort = -1;
+    return false;
+  }
+  fThread = std::thread(&RunMetrics::PublisherLoop, this);
+  return true;
+}
+
+void RunMetrics::Stop()
+{
+  if (fThread.joinable())
+  {
+    const char stop = 0;
+    if (write(fWakeup[1], &stop, 1) != 1)
+      std::cerr << "Cannot wake the metrics thread" << std::endl;
+    fThread.join();
+  }
+  for (int k = 0; k < 2; ++k)
+  {
+    if (fWakeup[k] >= 0)
+      close(fWakeup[k]);
+    fWakeup[k] = -1;
+  }
+  if (fListen >= 0)
+    close(fListen);
+  fListen = -1;
+}
+
+void RunMetrics::PublisherLoop()
+{
+  std::chrono::steady_clock::time_point next =
+      std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                             std::chrono::duration<double>(fInterval));
+  for (;;)
+  {
+    const long long timeout =
+        std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count();
+    pollfd fds[2] = {{fWakeup[0], POLLIN, 0}, {fListen, POLLIN, 0}};
+    const int ready = poll(fds, fListen >= 0 ? 2 : 1, timeout > 0 ? (int)timeout : 0);
+    if (ready > 0 && fds[0].revents)
+      break;
+    if (ready > 0 && fListen >= 0 && (fds[1].revents & POLLIN))
+    {
+      const int descriptor = accept(fListen, 0, 0);
+      if (descriptor >= 0)
+      {
+        Answer(descriptor);
+        close(descriptor);
+      }
+    }
+    if (std::chrono::steady_clock::now() >= next)
+    {
+      Tick();
+      next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(fInterval));
+    }
+  }
+
+  // Ultimo aggiornamento con i totali della simulazione
+  Tick();
+}
+
+RunMetrics::Sample RunMetrics::Read() const
+{
+  Sample sample;
+  sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count();
+  sample.events = sample.particles = sample.pairs = 0;
+  sample.busy.resize(fWorkers.size());
+  for (size_t w = 0; w < fWorkers.size(); ++w)
+  {
+    sample.events += fWorkers[w]->events.load(std::memory_order_relaxed);
+    sample.particles += fWorkers[w]->particles.load(std::memory_order_relaxed);
+    sample.pairs += fWorkers[w]->pairs.load(std::memory_order_relaxed);
+    sample.busy[w] = fWorkers[w]->busyNanoseconds.load(std::memory_order_relaxed);
+  }
+  return sample;
+}
+
+void RunMetrics::Tick()
+{
+  const Sample sample = Read();
+  const double seconds = sample.seconds - fPrevious.seconds;
+  if (seconds > 0)
+  {
+    fEventRate = (sample.events - fPrevious.events) / seconds;
+    fPairRate = (sample.pairs - fPrevious.pairs) / seconds;
+    for (size_t w = 0; w < fWorkers.size(); ++w)
+      fUtilisation[w] = (sample.busy[w] - fPrevious.busy[w]) * 1e-9 / seconds;
+  }
+  fPrevious = sample;
+  if (fPath.empty())
+    return;
+
+  // Il file temporaneo sostituisce quello delle metriche con un rename atomico
+  const std::string temporary = fPath + ".tmp";
+  {
+    std::ofstream file(temporary.c_str());
+    file << Format(sample);
+    if (!file)
+      return;
+  }
+  std::rename(temporary.c_str(), fPath.c_str());
+}
+
+// Metodo per scrivere intestazione e valore di una metrica senza etichette
+static void WriteMetric(std::ostream &out, const char *name, const char *type, const char *help, double value)
+{
+  out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n' << name << ' ' << value
+      << '\n';
+}
+
+std::string RunMetrics::Format(const Sample &sample) const
+{
+  long long diagnostics[kNDiagnosticKinds];
+  Diagnostics::GetTotals(diagnostics);
+
+  std::ostringstream out;
+  out.precision(15);
+  WriteMetric(out, "particle_sim_events_total", "counter", "Events generated.", (double)sample.events);
+  WriteMetric(out, "particle_sim_events_requested", "gauge", "Events requested (maximum with precision targets).",
+              (double)fRequestedEvents);
+  WriteMetric(out, "particle_sim_events_per_second", "gauge", "Events generated per second over the last interval.",
+              fEventRate);
+  WriteMetric(out, "particle_sim_particles_total", "counter", "Particles generated, including decay products.",
+              (double)sample.particles);
+  WriteMetric(out, "particle_sim_pairs_total", "counter", "Pairs processed by the pair kernel.", (double)sample.pairs);
+  WriteMetric(out, "particle_sim_pairs_per_second", "gauge", "Pairs processed per second over the last interval.",
+              fPairRate);
+  out << "# HELP particle_sim_decay_failures_total Decays that failed or were discarded, by reason.\n"
+      << "# TYPE particle_sim_decay_failures_total counter\n";
+  for (int k = 0; k < kNDecayFailureKinds; ++k)
+  {
+    const int kind = kDecayFailureKinds[k];
+    out << "particle_sim_decay_failures_total{reason=\"" << kDecayFailureLabels[k] << "\"} "
+        << diagnostics[kind] - fDiagnosticsStart[kind] << '\n';
+  }
+  out << "# HELP particle_sim_thread_busy_seconds_total Time spent generating events, by worker thread.\n"
+      << "# TYPE particle_sim_thread_busy_seconds_total counter\n";
+  for (size_t w = 0; w < fWorkers.size(); ++w)
+    out << "particle_sim_thread_busy_seconds_total{thread=\"" << w << "\"} " << sample.busy[w] * 1e-9 << '\n';
+  out << "# HELP particle_sim_thread_utilisation Fraction of the last interval spent generating events.\n"
+      << "# TYPE particle_sim_thread_utilisation gauge\n";
+  for (size_t w = 0; w < fWorkers.size(); ++w)
+    out << "particle_sim_thread_utilisation{thread=\"" << w << "\"} " << fUtilisation[w] << '\n';
+  WriteMetric(out, "particle_sim_resident_memory_bytes", "gauge", "Resident memory of the process.",
+              (double)GetResidentBytes());
+  WriteMetric(out, "particle_sim_histogram_memory_bytes", "gauge", "Memory of the histograms of all worker threads.",
+              (double)fHistogramBytes.load(std::memory_order_relaxed));
+  WriteMetric(out, "particle_sim_elapsed_seconds", "gauge", "Time since the start of the run.", sample.seconds);
+  return out.str();
+}
+
+void RunMetrics::Answer(int descriptor)
+{
+  // Lettura e risposta non bloccanti con una scadenza complessiva: un client lento o che invia
+  // la richiesta un byte alla volta non blocca gli aggiornamenti del file per più di kAnswerMilliseconds
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(kAnswerMilliseconds);
+  fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos &&
+         request.size() < 8192)
+  {
+    if (!WaitReady(descriptor, POLLIN, deadline))
+      return;
+    const ssize_t received = recv(descriptor, buffer, sizeof(buffer), 0);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+      break;
+    if (received > 0)
+      request.append(buffer, received);
+  }
+
+  std::string status = "200 OK", body;
+  if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+    body = Format(Read());
+  else
+  {
+    status = "404 Not Found";
+    body = "Metrics are served at /metrics\n";
+  }
+  const std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\n" +
+                               "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" +
+                               body;
+  size_t sent = 0;
+  while (sent < response.size())
+  {
+    if (!WaitReady(descriptor, POLLOUT, deadline))
+      return;
+    const ssize_t count = send(descriptor, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      continue;
+    if (count <= 0)
+      break;
+    sent += count;
+  }
+}
+
+long long RunMetrics::GetResidentBytes()
+{
+  // Seconda colonna di /proc/self/statm: pagine residenti
+  std::ifstream statm("/proc/self/statm");
+  long long size = 0, resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+}
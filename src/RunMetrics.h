@@ -0,0 +1,128 @@
+#ifndef RUNMETRICS_H
+#define RUNMETRICS_H
+
+#include "Diagnostics.h"
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Contatori di avanzamento di un thread di generazione, letti da RunMetrics.
+// Ogni contatore ha un solo thread che lo scrive, con scritture relaxed: il loop degli eventi
+// non usa lock né operazioni atomiche con lock, e il thread di pubblicazione legge valori
+// coerenti per ogni contatore (non tra contatori diversi).
+struct WorkerMetrics
+{
+  std::atomic<long long> events;          // Eventi generati
+  std::atomic<long long> particles;       // Particelle generate, inclusi i prodotti di decadimento
+  std::atomic<long long> pairs;           // Coppie processate dal kernel delle coppie
+  std::atomic<long long> busyNanoseconds; // Tempo passato nella generazione degli eventi
+
+  WorkerMetrics();
+
+  // Metodo per aggiornare i contatori (solo dal thread che li possiede)
+  // nEvents, nParticles, nPairs, busy: valori totali dall'inizio della simulazione
+  void Update(long long nEvents, long long nParticles, long long nPairs, long long busy)
+  {
+    events.store(nEvents, std::memory_order_relaxed);
+    particles.store(nParticles, std::memory_order_relaxed);
+    pairs.store(nPairs, std::memory_order_relaxed);
+    busyNanoseconds.store(busy, std::memory_order_relaxed);
+  }
+};
+
+// La classe RunMetrics pubblica lo stato di una simulazione in corso nel formato testuale di
+// Prometheus: eventi generati e richiesti, eventi e coppie al secondo, decadimenti falliti,
+// utilizzo di ogni thread di generazione, memoria residente del processo e memoria degli istogrammi.
+// Un thread dedicato legge i contatori dei thread di generazione (WorkerMetrics) a ogni intervallo,
+// calcola le frequenze sull'ultimo intervallo e riscrive il file delle metriche (rinominando un file
+// temporaneo, così che un lettore non veda mai un file troncato) e/o risponde alle richieste HTTP
+// su una porta locale (127.0.0.1, GET /metrics).
+
+class RunMetrics
+{
+private:
+  // Valori letti in un istante
+  struct Sample
+  {
+    double seconds;              // Tempo dall'inizio della simulazione
+    long long events;            // Eventi generati
+    long long particles;         // Particelle generate
+    long long pairs;             // Coppie processate
+    std::vector<long long> busy; // Tempo di generazione di ogni thread, in ns
+  };
+
+  std::vector<const WorkerMetrics *> fWorkers;        // Contatori dei thread di generazione
+  long long fRequestedEvents;                         // Eventi richiesti
+  long long fDiagnosticsStart[kNDiagnosticKinds];     // Totali di Diagnostics all'inizio della simulazione
+  std::atomic<long long> fHistogramBytes;             // Memoria degli istogrammi di tutti i thread
+  std::chrono::steady_clock::time_point fStart;       // Inizio della simulazione
+  std::string fPath;                                  // File delle metriche (vuoto: nessuno)
+  int fListen;                                        // Socket HTTP in ascolto (-1: nessuno)
+  int fPort;                                          // Porta del socket HTTP
+  int fWakeup[2];                                     // Pipe per svegliare il thread alla chiusura
+  double fInterval;                                   // Secondi tra due aggiornamenti
+  std::thread fThread;                                // Thread di pubblicazione
+
+  // Stato del thread di pubblicazione: ultimo campione e frequenze sull'ultimo intervallo
+  Sample fPrevious;
+  double fEventRate, fPairRate;
+  std::vector<double> fUtilisation;
+
+  // Loop eseguito dal thread di pubblicazione
+  void PublisherLoop();
+
+  // Metodo per leggere i contatori
+  Sample Read() const;
+
+  // Metodo per aggiornare le frequenze e riscrivere il file delle metriche
+  void Tick();
+
+  // Metodo per scrivere le metriche nel formato di Prometheus
+  // sample: contatori da scrivere
+  std::string Format(const Sample &sample) const;
+
+  // Metodo per rispondere a una richiesta HTTP, con socket non bloccante e una scadenza complessiva
+  // descriptor: socket della connessione
+  void Answer(int descriptor);
+
+public:
+  // Costruttore
+  // workers: contatori dei thread di generazione, validi fino a Stop
+  // requestedEvents: eventi richiesti (massimo con obiettivi di precisione)
+  // diagnosticsStart: totali di Diagnostics all'inizio della simulazione (Diagnostics::GetTotals)
+  RunMetrics(const std::vector<const WorkerMetrics *> &workers, long long requestedEvents,
+             const long long *diagnosticsStart);
+
+  // Il distruttore chiama Stop
+  ~RunMetrics();
+
+  RunMetrics(const RunMetrics &) = delete;
+  RunMetrics &operator=(const RunMetrics &) = delete;
+
+  // Metodo per avviare la pubblicazione
+  // path: file delle metriche (nullo: nessuno)
+  // port: porta HTTP su 127.0.0.1 (0: scelta dal sistema, negativa: nessuna)
+  // interval: secondi tra due aggiornamenti
+  // err: stream per i messaggi di errore
+  // return: false se il socket non può essere aperto
+  bool Start(const char *path, int port, double interval, std::ostream &err);
+
+  // Metodo per ottenere la porta HTTP (-1 se non in ascolto)
+  int GetPort() const { return fListen >= 0 ? fPort : -1; }
+
+  // Metodo per aggiornare la memoria degli istogrammi (dal thread principale, tra un blocco e l'altro)
+  void SetHistogramBytes(long long bytes) { fHistogramBytes.store(bytes, std::memory_order_relaxed); }
+
+  // Metodo per fermare la pubblicazione, dopo un ultimo aggiornamento del file; va chiamato
+  // prima di distruggere i contatori dei thread
+  void Stop();
+
+  // Metodo per leggere la memoria residente del processo
+  // return: byte residenti (0 se non disponibile)
+  static long long GetResidentBytes();
+};
+
+#endif // RUNMETRICS_H
@@ -0,0 +1,130 @@
+#include "RunMonitor.h"
+#include "HistogramFitter.h"
+#include <cmath>
+
+MonitorAccumulator::MonitorAccumulator() : nMomentum(0), momentumMean(0), momentumM2(0)
+{
+  for (int i = 0; i < SpeciesTable::kMaxSpecies; ++i)
+    speciesCounts[i] = 0;
+  for (int i = 0; i < kUniformBins; ++i)
+  {
+    phiCounts[i] = 0;
+    polarCounts[i] = 0;
+  }
+}
+
+void MonitorAccumulator::Fill(int type, double momentum, double phi, double polar)
+{
+  ++nMomentum;
+  double delta = momentum - momentumMean;
+  momentumMean += delta / nMomentum;
+  momentumM2 += delta * (momentum - momentumMean);
+
+  if (type >= 0 && type < SpeciesTable::kMaxSpecies)
+    ++speciesCounts[type];
+
+  int phiBin = (int)(phi * (kUniformBins / (2 * M_PI)));
+  int polarBin = (int)(polar * kUniformBins);
+  if (phiBin >= 0 && phiBin < kUniformBins)
+    ++phiCounts[phiBin];
+  if (polarBin >= 0 && polarBin < kUniformBins)
+    ++polarCounts[polarBin];
+}
+
+void MonitorAccumulator::Merge(const MonitorAccumulator &other)
+{
+  if (other.nMomentum > 0)
+  {
+    long long n = nMomentum + other.nMomentum;
+    double delta = other.momentumMean - momentumMean;
+    momentumMean += delta * other.nMomentum / n;
+    momentumM2 += other.momentumM2 + delta * delta * ((double)nMomentum * other.nMomentum / n);
+    nMomentum = n;
+  }
+  for (int i = 0; i < SpeciesTable::kMaxSpecies; ++i)
+    speciesCounts[i] += other.speciesCounts[i];
+  for (int i = 0; i < kUniformBins; ++i)
+  {
+    phiCounts[i] += other.phiCounts[i];
+    polarCounts[i] += other.polarCounts[i];
+  }
+}
+
+RunMonitor::RunMonitor(const int *species, const double *abundance, int nSpecies, double expectedMomentum,
+                       double maxPull, double minProb)
+    : fNSpecies(nSpecies), fExpectedMomentum(expectedMomentum), fMaxPull(maxPull), fMinProb(minProb),
+      fNEvents(0), fMomentumMean(0), fMomentumRms(0), fMomentumPull(0), fSpeciesChi2(0), fSpeciesNdf(0),
+      fPhiChi2(0), fPolarChi2(0), fWithinTolerance(true)
+{
+  for (int i = 0; i < nSpecies; ++i)
+  {
+    fSpecies[i] = species[i];
+    fAbundance[i] = abundance[i];
+  }
+}
+
+double RunMonitor::UniformityChi2(const long long *counts, int nBins)
+{
+  long long total = 0;
+  for (int i = 0; i < nBins; ++i)
+    total += counts[i];
+  if (total == 0)
+    return 0;
+  double expected = (double)total / nBins;
+  double chi2 = 0;
+  for (int i = 0; i < nBins; ++i)
+  {
+    double residual = counts[i] - expected;
+    chi2 += residual * residual / expected;
+  }
+  return chi2;
+}
+
+bool RunMonitor::Update(const MonitorAccumulator &accumulator, long long nEvents)
+{
+  fNEvents = nEvents;
+  const long long n = accumulator.nMomentum;
+
+  // Media della quantità di moto e suo scarto dal valore atteso
+  fMomentumMean = accumulator.momentumMean;
+  fMomentumRms = n > 1 ? std::sqrt(accumulator.momentumM2 / (n - 1)) : 0;
+  double meanError = n > 1 ? fMomentumRms / std::sqrt((double)n) : 0;
+  fMomentumPull = meanError > 0 && fExpectedMomentum > 0 ? (fMomentumMean - fExpectedMomentum) / meanError : 0;
+
+  // Chi quadro dei conteggi delle specie rispetto alle abbondanze (Pearson)
+  fSpeciesChi2 = 0;
+  fSpeciesNdf = fNSpecies - 1;
+  for (int i = 0; i < fNSpecies && n > 0; ++i)
+  {
+    double expected = fAbundance[i] * n;
+    double residual = accumulator.speciesCounts[fSpecies[i]] - expected;
+    if (expected > 0)
+      fSpeciesChi2 += residual * residual / expected;
+  }
+
+  // Uniformità degli angoli
+  fPhiChi2 = UniformityChi2(accumulator.phiCounts, MonitorAccumulator::kUniformBins);
+  fPolarChi2 = UniformityChi2(accumulator.polarCounts, MonitorAccumulator::kUniformBins);
+
+  const int uniformNdf = MonitorAccumulator::kUniformBins - 1;
+  fWithinTolerance = std::fabs(fMomentumPull) <= fMaxPull &&
+                     HistogramFitter::Prob(fSpeciesChi2, fSpeciesNdf) >= fMinProb &&
+                     HistogramFitter::Prob(fPhiChi2, uniformNdf) >= fMinProb &&
+                     HistogramFitter::Prob(fPolarChi2, uniformNdf) >= fMinProb;
+  return fWithinTolerance;
+}
+
+void RunMonitor::Print(std::ostream &out) const
+{
+  const int uniformNdf = MonitorAccumulator::kUniformBins - 1;
+  out << "[monitor] eventi " << fNEvents
+      << ": <p> = " << fMomentumMean << " (rms " << fMomentumRms;
+  if (fExpectedMomentum > 0)
+    out << ", scarto " << fMomentumPull << " sigma";
+  out << ")"
+      << ", specie chi2/ndf " << fSpeciesChi2 << "/" << fSpeciesNdf
+      << " (prob " << HistogramFitter::Prob(fSpeciesChi2, fSpeciesNdf) << ")"
+      << ", phi chi2/ndf " << fPhiChi2 << "/" << uniformNdf
+      << ", polar chi2/ndf " << fPolarChi2 << "/" << uniformNdf
+      << (fWithinTolerance ? "" : " FUORI TOLLERANZA") << std::endl;
+}
@@ -0,0 +1,93 @@
+#ifndef RUNMONITOR_H
+#define RUNMONITOR_H
+
+#include "SpeciesTable.h"
+#include <ostream>
+
+// Statistiche accumulate durante la generazione per i monitor della simulazione.
+// Ogni thread di generazione riempie il proprio accumulatore senza sincronizzazione;
+// gli accumulatori vengono uniti con Merge quando il monitor viene aggiornato.
+// Sono riempite solo con le particelle primarie, le cui distribuzioni sono note.
+struct MonitorAccumulator
+{
+  static const int kUniformBins = 20; // Bin usati per il test di uniformità degli angoli
+
+  long long nMomentum;  // Numero di valori della quantità di moto
+  double momentumMean;  // Media corrente della quantità di moto (algoritmo di Welford)
+  double momentumM2;    // Somma dei quadrati degli scarti dalla media
+  long long speciesCounts[SpeciesTable::kMaxSpecies]; // Conteggi delle specie primarie
+  long long phiCounts[kUniformBins];   // Conteggi dell'angolo azimutale in [0, 2π)
+  long long polarCounts[kUniformBins]; // Conteggi della variabile polare normalizzata in [0, 1)
+
+  MonitorAccumulator();
+
+  // Metodo per aggiungere una particella primaria
+  // type: indice della specie
+  // momentum: modulo della quantità di moto
+  // phi: angolo azimutale
+  // polar: variabile polare normalizzata, uniforme in [0, 1) secondo il modello cinematico
+  //        (theta / π, (1 - cos theta) / 2 o la rapidità riscalata)
+  void Fill(int type, double momentum, double phi, double polar);
+
+  // Metodo per unire un altro accumulatore (formula di Chan per media e varianza)
+  // other: accumulatore da unire
+  void Merge(const MonitorAccumulator &other);
+};
+
+// La classe RunMonitor confronta le statistiche accumulate con la configurazione della simulazione:
+// - media della quantità di moto rispetto al valore atteso, in unità dell'errore sulla media
+//   (solo se il modello cinematico fissa il valore atteso);
+// - chi quadro dei conteggi delle specie rispetto alle abbondanze configurate;
+// - chi quadro di uniformità per l'angolo azimutale e per la variabile polare.
+// Un monitor è fuori tolleranza se lo scarto della media supera maxPull sigma
+// o se la probabilità di un chi quadro scende sotto minProb.
+
+class RunMonitor
+{
+private:
+  int fNSpecies;                                   // Numero di specie primarie
+  int fSpecies[SpeciesTable::kMaxSpecies];         // Indici delle specie primarie
+  double fAbundance[SpeciesTable::kMaxSpecies];    // Abbondanze configurate
+  double fExpectedMomentum;                        // Media attesa della quantità di moto (<= 0: non controllata)
+  double fMaxPull;                                 // Scarto massimo della media, in sigma
+  double fMinProb;                                 // Probabilità minima dei chi quadro
+
+  // Risultati dell'ultimo aggiornamento
+  long long fNEvents;          // Eventi generati
+  double fMomentumMean;        // Media della quantità di moto
+  double fMomentumRms;         // Deviazione standard della quantità di moto
+  double fMomentumPull;        // Scarto della media in unità dell'errore
+  double fSpeciesChi2;         // Chi quadro delle specie
+  int fSpeciesNdf;             // Gradi di libertà delle specie
+  double fPhiChi2, fPolarChi2; // Chi quadro di uniformità degli angoli
+  bool fWithinTolerance;       // Tutti i monitor sono entro la tolleranza
+
+  // Metodo per calcolare il chi quadro di uniformità di un istogramma di conteggi
+  static double UniformityChi2(const long long *counts, int nBins);
+
+public:
+  // Costruttore
+  // species: indici delle specie primarie
+  // abundance: abbondanze configurate (normalizzate a 1)
+  // nSpecies: numero di specie primarie
+  // expectedMomentum: media attesa della quantità di moto (<= 0 per non controllarla)
+  // maxPull: scarto massimo tollerato della media, in sigma
+  // minProb: probabilità minima tollerata dei chi quadro
+  RunMonitor(const int *species, const double *abundance, int nSpecies, double expectedMomentum,
+             double maxPull = 5.0, double minProb = 1e-6);
+
+  // Metodo per aggiornare i monitor con le statistiche accumulate
+  // accumulator: statistiche unite di tutti i thread
+  // nEvents: eventi generati finora
+  // return: true se tutti i monitor sono entro la tolleranza
+  bool Update(const MonitorAccumulator &accumulator, long long nEvents);
+
+  // Metodo per sapere se l'ultimo aggiornamento è entro la tolleranza
+  bool IsWithinTolerance() const { return fWithinTolerance; }
+
+  // Metodo per stampare una riga con lo stato dei monitor
+  // out: stream di uscita
+  void Print(std::ostream &out) const;
+};
+
+#endif // RUNMONITOR_H
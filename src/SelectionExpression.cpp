@@ -0,0 +1,449 @@
+#include "SelectionExpression.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// Nomi delle variabili nelle espressioni, nell'ordine di ParticleVariable e PairVariable
+static const char *kParticleVariableNames[kNParticleVariables] = {"pt", "p", "eta", "y", "phi", "theta", "e", "m", "charge"};
+static const char *kPairVariableNames[kNPairVariables] = {"m", "pt", "y"};
+
+// Tipo di una sottoespressione durante l'analisi
+enum SelectionValueType
+{
+  kInvalidValue, // Errore di analisi
+  kNumericValue, // Valore numerico
+  kBooleanValue  // Risultato di un confronto o di un'operazione logica
+};
+
+// Analizzatore a discesa ricorsiva che produce il programma in notazione postfissa
+class SelectionParser
+{
+private:
+  const char *fStart;                        // Inizio del testo
+  const char *fPos;                          // Posizione corrente
+  SelectionDomain fDomain;                   // Dominio delle variabili
+  std::vector<SelectionInstruction> &fProgram; // Programma prodotto
+  unsigned &fVariables;                      // Variabili usate
+  std::string &fError;                       // Messaggio di errore
+
+  void SkipSpaces()
+  {
+    while (std::isspace((unsigned char)*fPos))
+      ++fPos;
+  }
+
+  // Consuma il simbolo se è il prossimo nel testo
+  bool Match(const char *token)
+  {
+    SkipSpaces();
+    size_t length = std::strlen(token);
+    if (std::strncmp(fPos, token, length) != 0)
+      return false;
+    fPos += length;
+    return true;
+  }
+
+  SelectionValueType Fail(const std::string &message)
+  {
+    if (fError.empty())
+      fError = message + " at position " + std::to_string(fPos - fStart);
+    return kInvalidValue;
+  }
+
+  void Emit(SelectionOpcode op, int variable = -1, double constant = 0)
+  {
+    SelectionInstruction instruction;
+    instruction.op = op;
+    instruction.variable = variable;
+    instruction.constant = constant;
+    instruction.constantRhs = false;
+    fProgram.push_back(instruction);
+  }
+
+  // Emette un'operazione binaria; se il secondo operando è una costante viene incorporato
+  // nell'istruzione, così i tagli del tipo "pt > 0.2" diventano un solo loop
+  void EmitBinary(SelectionOpcode op)
+  {
+    if (!fProgram.empty() && fProgram.back().op == kOpConstant)
+    {
+      double constant = fProgram.back().constant;
+      fProgram.pop_back();
+      Emit(op, -1, constant);
+      fProgram.back().constantRhs = true;
+    }
+    else
+      Emit(op);
+  }
+
+  SelectionValueType ParsePrimary()
+  {
+    SkipSpaces();
+    if (Match("("))
+    {
+      SelectionValueType type = ParseOr();
+      if (type == kInvalidValue)
+        return type;
+      return Match(")") ? type : Fail("expected ')'");
+    }
+    if (std::isdigit((unsigned char)*fPos) || *fPos == '.')
+    {
+      char *end = 0;
+      double value = std::strtod(fPos, &end);
+      if (end == fPos)
+        return Fail("invalid number");
+      fPos = end;
+      Emit(kOpConstant, -1, value);
+      return kNumericValue;
+    }
+    if (std::isalpha((unsigned char)*fPos) || *fPos == '_')
+    {
+      const char *begin = fPos;
+      while (std::isalnum((unsigned char)*fPos) || *fPos == '_')
+        ++fPos;
+      std::string name(begin, fPos);
+      if (name == "abs" || name == "sqrt")
+      {
+        if (!Match("("))
+          return Fail("expected '(' after " + name);
+        if (ParseSum() != kNumericValue)
+          return Fail("numeric argument expected for " + name);
+        if (!Match(")"))
+          return Fail("expected ')'");
+        Emit(name == "abs" ? kOpAbs : kOpSqrt);
+        return kNumericValue;
+      }
+      const int nVariables = fDomain == kParticleSelection ? (int)kNParticleVariables : (int)kNPairVariables;
+      for (int v = 0; v < nVariables; ++v)
+      {
+        if (name == SelectionExpression::GetVariableName(fDomain, v))
+        {
+          Emit(kOpVariable, v);
+          fVariables |= 1u << v;
+          return kNumericValue;
+        }
+      }
+      fPos = begin;
+      return Fail("unknown " + std::string(fDomain == kParticleSelection ? "particle" : "pair") + " variable '" + name + "'");
+    }
+    return *fPos ? Fail(std::string("unexpected '") + *fPos + "'") : Fail("unexpected end of expression");
+  }
+
+  SelectionValueType ParseUnary()
+  {
+    if (Match("-"))
+    {
+      if (ParseUnary() != kNumericValue)
+        return Fail("numeric operand expected for '-'");
+      if (fProgram.back().op == kOpConstant)
+        fProgram.back().constant = -fProgram.back().constant;
+      else
+        Emit(kOpNegate);
+      return kNumericValue;
+    }
+    if (Match("!"))
+    {
+      // "!=" non è una negazione
+      if (*fPos == '=')
+        return Fail("unexpected '!='");
+      if (ParseUnary() != kBooleanValue)
+        return Fail("condition expected for '!'");
+      Emit(kOpNot);
+      return kBooleanValue;
+    }
+    return ParsePrimary();
+  }
+
+  SelectionValueType ParseProduct()
+  {
+    SelectionValueType type = ParseUnary();
+    while (type != kInvalidValue)
+    {
+      SelectionOpcode op;
+      if (Match("*"))
+        op = kOpMul;
+      else if (Match("/"))
+        op = kOpDiv;
+      else
+        break;
+      if (type != kNumericValue || ParseUnary() != kNumericValue)
+        return Fail("numeric operands expected");
+      EmitBinary(op);
+    }
+    return type;
+  }
+
+  SelectionValueType ParseSum()
+  {
+    SelectionValueType type = ParseProduct();
+    while (type != kInvalidValue)
+    {
+      SelectionOpcode op;
+      if (Match("+"))
+        op = kOpAdd;
+      else if (Match("-"))
+        op = kOpSub;
+      else
+        break;
+      if (type != kNumericValue || ParseProduct() != kNumericValue)
+        return Fail("numeric operands expected");
+      EmitBinary(op);
+    }
+    return type;
+  }
+
+  SelectionValueType ParseComparison()
+  {
+    SelectionValueType type = ParseSum();
+    if (type == kInvalidValue)
+      return type;
+    SelectionOpcode op;
+    if (Match("<="))
+      op = kOpLessEqual;
+    else if (Match(">="))
+      op = kOpGreaterEqual;
+    else if (Match("=="))
+      op = kOpEqual;
+    else if (Match("!="))
+      op = kOpNotEqual;
+    else if (Match("<"))
+      op = kOpLess;
+    else if (Match(">"))
+      op = kOpGreater;
+    else
+      return type;
+    if (type != kNumericValue || ParseSum() != kNumericValue)
+      return Fail("numeric operands expected for comparison");
+    EmitBinary(op);
+    return kBooleanValue;
+  }
+
+  SelectionValueType ParseAnd()
+  {
+    SelectionValueType type = ParseComparison();
+    while (type != kInvalidValue && Match("&&"))
+    {
+      if (type != kBooleanValue || ParseComparison() != kBooleanValue)
+        return Fail("conditions expected for '&&'");
+      Emit(kOpAnd);
+    }
+    return type;
+  }
+
+public:
+  SelectionParser(const char *text, SelectionDomain domain, std::vector<SelectionInstruction> &program,
+                  unsigned &variables, std::string &error)
+      : fStart(text), fPos(text), fDomain(domain), fProgram(program), fVariables(variables), fError(error) {}
+
+  SelectionValueType ParseOr()
+  {
+    SelectionValueType type = ParseAnd();
+    while (type != kInvalidValue && Match("||"))
+    {
+      if (type != kBooleanValue || ParseAnd() != kBooleanValue)
+        return Fail("conditions expected for '||'");
+      Emit(kOpOr);
+    }
+    return type;
+  }
+
+  // Metodo per analizzare tutto il testo
+  // return: true se il testo è una condizione valida
+  bool Parse()
+  {
+    SelectionValueType type = ParseOr();
+    if (type == kInvalidValue)
+      return false;
+    SkipSpaces();
+    if (*fPos)
+    {
+      Fail(std::string("unexpected '") + *fPos + "'");
+      return false;
+    }
+    if (type != kBooleanValue)
+    {
+      fError = "expression is not a condition";
+      return false;
+    }
+    return true;
+  }
+};
+
+// Loop elementari del programma: un'operazione applicata a tutte le colonne, senza rami
+template <typename Op>
+static void Apply(const double *a, double *out, int n, Op op)
+{
+  for (int i = 0; i < n; ++i)
+    out[i] = op(a[i]);
+}
+
+template <typename Op>
+static void Apply(const double *a, const double *b, double *out, int n, Op op)
+{
+  for (int i = 0; i < n; ++i)
+    out[i] = op(a[i], b[i]);
+}
+
+template <typename Op>
+static void Apply(const double *a, double b, double *out, int n, Op op)
+{
+  for (int i = 0; i < n; ++i)
+    out[i] = op(a[i], b);
+}
+
+// Applica un'operazione binaria con il secondo operando in colonna o costante
+template <typename Op>
+static void ApplyBinary(const SelectionInstruction &instruction, const double *a, const double *b, double *out, int n, Op op)
+{
+  if (instruction.constantRhs)
+    Apply(a, instruction.constant, out, n, op);
+  else
+    Apply(a, b, out, n, op);
+}
+
+SelectionExpression::SelectionExpression() : fDomain(kParticleSelection), fDepth(0), fVariables(0) {}
+
+bool SelectionExpression::Compile(const std::string &text, SelectionDomain domain, std::string &error)
+{
+  fDomain = domain;
+  fText = text;
+  fProgram.clear();
+  fVariables = 0;
+  fDepth = 0;
+  error.clear();
+
+  // Espressione vuota: nessun taglio
+  if (text.find_first_not_of(" \t") == std::string::npos)
+    return true;
+
+  SelectionParser parser(text.c_str(), domain, fProgram, fVariables, error);
+  if (!parser.Parse())
+  {
+    fProgram.clear();
+    return false;
+  }
+
+  // Profondità massima dello stack, per allocare le colonne una sola volta
+  int depth = 0;
+  for (size_t k = 0; k < fProgram.size(); ++k)
+  {
+    const SelectionInstruction &instruction = fProgram[k];
+    if (instruction.op == kOpVariable || instruction.op == kOpConstant)
+      ++depth;
+    else if (instruction.op != kOpNegate && instruction.op != kOpAbs && instruction.op != kOpSqrt &&
+             instruction.op != kOpNot && !instruction.constantRhs)
+      --depth;
+    if (depth > fDepth)
+      fDepth = depth;
+  }
+  fStack.assign(fDepth, std::vector<double>());
+  fTop.assign(fDepth, (const double *)0);
+  return true;
+}
+
+void SelectionExpression::Evaluate(const double *const *columns, int n, unsigned char *mask)
+{
+  if (fProgram.empty())
+  {
+    std::memset(mask, 1, n);
+    return;
+  }
+  if ((int)fStack[0].size() < n)
+  {
+    for (int k = 0; k < fDepth; ++k)
+      fStack[k].resize(n);
+  }
+
+  // Ogni posizione dello stack punta a una colonna delle variabili o alla propria colonna di lavoro
+  const double **top = fTop.data();
+  int sp = 0;
+  for (size_t k = 0; k < fProgram.size(); ++k)
+  {
+    const SelectionInstruction &instruction = fProgram[k];
+    if (instruction.op == kOpVariable)
+    {
+      top[sp++] = columns[instruction.variable];
+      continue;
+    }
+    if (instruction.op == kOpConstant)
+    {
+      double *out = fStack[sp].data();
+      for (int i = 0; i < n; ++i)
+        out[i] = instruction.constant;
+      top[sp++] = out;
+      continue;
+    }
+
+    // Operazioni unarie e binarie: il risultato sostituisce il primo operando
+    const bool unary = instruction.op == kOpNegate || instruction.op == kOpAbs ||
+                       instruction.op == kOpSqrt || instruction.op == kOpNot;
+    const int first = (unary || instruction.constantRhs) ? sp - 1 : sp - 2;
+    const double *a = top[first];
+    const double *b = (unary || instruction.constantRhs) ? 0 : top[sp - 1];
+    double *out = fStack[first].data();
+    switch (instruction.op)
+    {
+    case kOpNegate:
+      Apply(a, out, n, [](double x) { return -x; });
+      break;
+    case kOpAbs:
+      Apply(a, out, n, [](double x) { return std::fabs(x); });
+      break;
+    case kOpSqrt:
+      Apply(a, out, n, [](double x) { return std::sqrt(x); });
+      break;
+    case kOpNot:
+      Apply(a, out, n, [](double x) { return (double)(x == 0); });
+      break;
+    case kOpAdd:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return x + y; });
+      break;
+    case kOpSub:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return x - y; });
+      break;
+    case kOpMul:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return x * y; });
+      break;
+    case kOpDiv:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return x / y; });
+      break;
+    case kOpLess:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)(x < y); });
+      break;
+    case kOpLessEqual:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)(x <= y); });
+      break;
+    case kOpGreater:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)(x > y); });
+      break;
+    case kOpGreaterEqual:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)(x >= y); });
+      break;
+    case kOpEqual:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)(x == y); });
+      break;
+    case kOpNotEqual:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)(x != y); });
+      break;
+    case kOpAnd:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)((x != 0) & (y != 0)); });
+      break;
+    case kOpOr:
+      ApplyBinary(instruction, a, b, out, n, [](double x, double y) { return (double)((x != 0) | (y != 0)); });
+      break;
+    default:
+      break;
+    }
+    top[first] = out;
+    sp = first + 1;
+  }
+
+  const double *result = top[0];
+  for (int i = 0; i < n; ++i)
+    mask[i] = (unsigned char)(result[i] != 0);
+}
+
+const char *SelectionExpression::GetVariableName(SelectionDomain domain, int variable)
+{
+  return domain == kParticleSelection ? kParticleVariableNames[variable] : kPairVariableNames[variable];
+}
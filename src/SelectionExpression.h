@@ -0,0 +1,125 @@
+#ifndef SELECTIONEXPRESSION_H
+#define SELECTIONEXPRESSION_H
+
+#include <string>
+#include <vector>
+
+// Oggetti a cui si applica un'espressione di selezione
+enum SelectionDomain
+{
+  kParticleSelection, // Singole particelle
+  kPairSelection      // Coppie di particelle
+};
+
+// Variabili delle particelle utilizzabili nelle espressioni (nomi tra parentesi)
+enum ParticleVariable
+{
+  kVarPt,       // Quantità di moto trasversale (pt)
+  kVarMomentum, // Modulo della quantità di moto (p)
+  kVarEta,      // Pseudorapidità (eta)
+  kVarRapidity, // Rapidità (y)
+  kVarPhi,      // Angolo azimutale in [0, 2π) (phi)
+  kVarTheta,    // Angolo polare (theta)
+  kVarEnergy,   // Energia (e)
+  kVarMass,     // Massa (m)
+  kVarCharge,   // Carica (charge)
+  kNParticleVariables
+};
+
+// Variabili delle coppie utilizzabili nelle espressioni (nomi tra parentesi)
+enum PairVariable
+{
+  kVarPairMass,     // Massa invariante (m)
+  kVarPairPt,       // Quantità di moto trasversale della coppia (pt)
+  kVarPairRapidity, // Rapidità della coppia (y)
+  kNPairVariables
+};
+
+// Operazioni del programma compilato, eseguite su colonne di valori
+enum SelectionOpcode
+{
+  kOpVariable, // Carica una colonna
+  kOpConstant, // Carica una costante
+  kOpNegate,
+  kOpAbs,
+  kOpSqrt,
+  kOpAdd,
+  kOpSub,
+  kOpMul,
+  kOpDiv,
+  kOpLess,
+  kOpLessEqual,
+  kOpGreater,
+  kOpGreaterEqual,
+  kOpEqual,
+  kOpNotEqual,
+  kOpAnd,
+  kOpOr,
+  kOpNot
+};
+
+// Istruzione del programma compilato
+struct SelectionInstruction
+{
+  SelectionOpcode op; // Operazione
+  int variable;       // Variabile caricata (kOpVariable)
+  double constant;    // Costante caricata (kOpConstant) o secondo operando costante
+  bool constantRhs;   // Il secondo operando dell'operazione binaria è la costante
+};
+
+// La classe SelectionExpression compila un'espressione di selezione, ad esempio
+// "pt > 0.2 && abs(eta) < 0.8", in un programma a stack che lavora su colonne intere:
+// ogni istruzione è un loop senza rami su tutte le particelle (o le coppie) dell'evento,
+// vettorizzabile dal compilatore, e il risultato è una maschera di selezione.
+// L'espressione è analizzata una sola volta in fase di configurazione.
+//
+// Grammatica (precedenze come in C):
+//   espressione: confronti combinati con &&, || e !
+//   confronto:   aritmetica (<, <=, >, >=, ==, !=) aritmetica
+//   aritmetica:  numeri, variabili, +, -, *, /, abs(...), sqrt(...) e parentesi
+
+class SelectionExpression
+{
+private:
+  SelectionDomain fDomain;                         // Oggetti a cui si applica
+  std::string fText;                               // Testo dell'espressione
+  std::vector<SelectionInstruction> fProgram;      // Programma compilato (notazione postfissa)
+  int fDepth;                                      // Profondità massima dello stack
+  unsigned fVariables;                             // Maschera di bit delle variabili usate
+  std::vector<std::vector<double> > fStack;        // Colonne di lavoro dello stack di valutazione
+  std::vector<const double *> fTop;                // Colonna corrente di ogni posizione dello stack
+
+public:
+  SelectionExpression();
+
+  // Metodo per compilare un'espressione; un'espressione vuota accetta tutto
+  // text: testo dell'espressione
+  // domain: particelle o coppie (determina le variabili disponibili)
+  // error: messaggio di errore se la compilazione fallisce
+  // return: false se l'espressione non è valida
+  bool Compile(const std::string &text, SelectionDomain domain, std::string &error);
+
+  // Metodo per sapere se l'espressione accetta tutto (nessun taglio)
+  bool IsEmpty() const { return fProgram.empty(); }
+
+  // Metodo per sapere se l'espressione usa una variabile
+  // variable: indice della variabile nel dominio dell'espressione
+  bool UsesVariable(int variable) const { return (fVariables >> variable) & 1u; }
+
+  // Metodo per ottenere il testo dell'espressione
+  const std::string &GetText() const { return fText; }
+
+  // Metodo per valutare l'espressione su n oggetti
+  // columns: colonne delle variabili del dominio, indicizzate come ParticleVariable o PairVariable
+  //          (servono solo quelle usate dall'espressione)
+  // n: numero di oggetti
+  // mask: maschera di uscita (1 se l'oggetto è selezionato, 0 altrimenti)
+  void Evaluate(const double *const *columns, int n, unsigned char *mask);
+
+  // Metodo per ottenere il nome di una variabile
+  // domain: particelle o coppie
+  // variable: indice della variabile
+  static const char *GetVariableName(SelectionDomain domain, int variable);
+};
+
+#endif // SELECTIONEXPRESSION_H
@@ -0,0 +1,88 @@
+#include "SignalExtractor.h"
+#include <cmath>
+#include "TH1F.h"
+#include "TF1.h"
+#include "TString.h"
+
+SignalExtractor::SignalExtractor(double min, double max) : fMin(min), fMax(max) {}
+
+TH1F *SignalExtractor::Subtract(const TH1F *oppositeCharge, const TH1F *sameCharge, const char *name, const char *title) const
+{
+  TH1F *subtracted = (TH1F *)oppositeCharge->Clone(name);
+  subtracted->SetDirectory(0);
+  subtracted->SetTitle(title);
+  subtracted->Add(sameCharge, -1);
+  return subtracted;
+}
+
+SignalFit SignalExtractor::Fit(TH1F *subtracted) const
+{
+  // Bin con il centro nella finestra del fit (come in ROOT)
+  FitData data;
+  for (int i = 1; i <= subtracted->GetNbinsX(); ++i)
+  {
+    double center = subtracted->GetBinCenter(i);
+    if (center >= fMin && center <= fMax)
+      data.AddBin(center, subtracted->GetBinContent(i), subtracted->GetBinError(i));
+  }
+
+  HistogramFitter fitter(kFitGaussian);
+  FitOutput output = fitter.Fit(data);
+
+  SignalFit fit;
+  fit.mass = output.par[1];
+  fit.massError = output.err[1];
+  fit.width = output.par[2];
+  fit.widthError = output.err[2];
+  fit.chi2 = output.chi2;
+  fit.ndf = output.ndf;
+
+  // Resa: integrale della gaussiana diviso per la larghezza dei bin, Y = A * sigma * sqrt(2π) / w;
+  // l'errore include la correlazione tra ampiezza e sigma
+  const double binWidth = subtracted->GetXaxis()->GetBinWidth(1);
+  const double norm = std::sqrt(2 * M_PI) / binWidth;
+  const int nPar = output.nPar;
+  double dA = output.par[2] * norm;
+  double dSigma = output.par[0] * norm;
+  double variance = dA * dA * output.cov[0] + dSigma * dSigma * output.cov[2 * nPar + 2] +
+                    2 * dA * dSigma * output.cov[2];
+  fit.yield = output.par[0] * output.par[2] * norm;
+  fit.yieldError = variance > 0 ? std::sqrt(variance) : 0;
+  fit.valid = output.converged && output.ndf > 0 && fit.massError > 0;
+
+  // Funzione di fit associata all'istogramma per i grafici e per il file di output
+  TF1 *function = new TF1(TString::Format("%sFit", subtracted->GetName()), HistogramFitter::GetFormula(kFitGaussian), fMin, fMax);
+  function->SetParameters(output.par);
+  function->SetParErrors(output.err);
+  function->SetChisquare(output.chi2);
+  function->SetNDF(output.ndf);
+  function->SetLineColor(kRed);
+  subtracted->GetListOfFunctions()->Add(function);
+  return fit;
+}
+
+void SignalExtractor::Write(const SignalFit &fit, const char *name)
+{
+  TH1F summary(name, "K* signal: mass, width, yield, chi2/ndf", 4, 0, 4);
+  summary.SetDirectory(0);
+  summary.GetXaxis()->SetBinLabel(1, "mass");
+  summary.GetXaxis()->SetBinLabel(2, "width");
+  summary.GetXaxis()->SetBinLabel(3, "yield");
+  summary.GetXaxis()->SetBinLabel(4, "chi2/ndf");
+  summary.SetBinContent(1, fit.mass);
+  summary.SetBinError(1, fit.massError);
+  summary.SetBinContent(2, fit.width);
+  summary.SetBinError(2, fit.widthError);
+  summary.SetBinContent(3, fit.yield);
+  summary.SetBinError(3, fit.yieldError);
+  summary.SetBinContent(4, fit.ndf > 0 ? fit.chi2 / fit.ndf : 0);
+  summary.Write();
+}
+
+void SignalExtractor::Print(std::ostream &out, const char *label, const SignalFit &fit)
+{
+  out << "K* signal (" << label << "): mass " << fit.mass << " ± " << fit.massError
+      << " GeV/c^2, width " << fit.width << " ± " << fit.widthError
+      << " GeV/c^2, yield " << fit.yield << " ± " << fit.yieldError
+      << ", chi2/ndf " << fit.chi2 << "/" << fit.ndf << (fit.valid ? "" : " (fit not converged)") << std::endl;
+}
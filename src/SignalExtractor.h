@@ -0,0 +1,62 @@
+#ifndef SIGNALEXTRACTOR_H
+#define SIGNALEXTRACTOR_H
+
+#include "HistogramFitter.h"
+#include <ostream>
+
+class TH1F;
+
+// Risultato dell'estrazione del segnale della K*
+struct SignalFit
+{
+  double mass, massError;   // Massa del picco (media della gaussiana)
+  double width, widthError; // Larghezza del picco (sigma della gaussiana)
+  double yield, yieldError; // Numero di coppie di segnale (integrale della gaussiana)
+  double chi2;              // Chi quadro del fit
+  int ndf;                  // Gradi di libertà
+  bool valid;               // Fit convergente con errori definiti
+};
+
+// La classe SignalExtractor estrae il picco della K* in memoria, come le macro
+// analyze_invariant_mass e plot_invariant_mass: sottrae alla distribuzione di massa invariante
+// delle coppie di carica opposta quella delle coppie della stessa carica e fitta il risultato
+// con una gaussiana nella finestra del picco usando il fitter nativo.
+
+class SignalExtractor
+{
+private:
+  double fMin, fMax; // Finestra del fit
+
+public:
+  // Costruttore
+  // min, max: finestra del fit (default 0.75-1.05 GeV/c^2, come nelle macro)
+  SignalExtractor(double min = 0.75, double max = 1.05);
+
+  // Metodo per sottrarre il fondo combinatorio
+  // oppositeCharge: massa invariante delle coppie di carica opposta
+  // sameCharge: massa invariante delle coppie della stessa carica
+  // name: nome dell'istogramma sottratto
+  // title: titolo dell'istogramma sottratto
+  // return: nuovo istogramma non associato ad alcuna directory (di proprietà del chiamante)
+  TH1F *Subtract(const TH1F *oppositeCharge, const TH1F *sameCharge, const char *name, const char *title) const;
+
+  // Metodo per fittare il picco; la funzione risultante viene associata all'istogramma
+  // e scritta su file insieme a esso
+  // subtracted: istogramma sottratto
+  // return: parametri del picco
+  SignalFit Fit(TH1F *subtracted) const;
+
+  // Metodo per scrivere i risultati come istogramma riassuntivo nella directory corrente di ROOT
+  // (bin etichettati: massa, larghezza, resa, chi2/ndf, con i rispettivi errori)
+  // fit: risultato dell'estrazione
+  // name: nome dell'istogramma riassuntivo
+  static void Write(const SignalFit &fit, const char *name);
+
+  // Metodo per stampare i risultati
+  // out: stream di uscita
+  // label: descrizione del campione
+  // fit: risultato dell'estrazione
+  static void Print(std::ostream &out, const char *label, const SignalFit &fit);
+};
+
+#endif // SIGNALEXTRACTOR_H
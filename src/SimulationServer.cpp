@@ -0,0 +1,541 @@
+#include "SimulationServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <streambuf>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Buffer di uno stream che invia i dati al socket di un client a ogni flush (std::endl)
+class SocketStreamBuffer : public std::streambuf
+{
+private:
+  std::function<void(const char *, size_t)> fSend; // Invio dei dati
+  char fBuffer[4096];
+
+  int Drain()
+  {
+    const size_t size = pptr() - pbase();
+    if (size > 0)
+      fSend(pbase(), size);
+    setp(fBuffer, fBuffer + sizeof(fBuffer));
+    return 0;
+  }
+
+protected:
+  int overflow(int c) override
+  {
+    Drain();
+    if (c != traits_type::eof())
+    {
+      *pptr() = (char)c;
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override { return Drain(); }
+
+public:
+  explicit SocketStreamBuffer(const std::function<void(const char *, size_t)> &send) : fSend(send)
+  {
+    setp(fBuffer, fBuffer + sizeof(fBuffer));
+  }
+};
+
+// Metodo per riempire l'indirizzo di un socket Unix
+// return: false se il percorso è troppo lungo
+static bool MakeAddress(const char *path, sockaddr_un &address)
+{
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (std::strlen(path) >= sizeof(address.sun_path))
+    return false;
+  std::strcpy(address.sun_path, path);
+  return true;
+}
+
+// Metodo per rendere non bloccante un descrittore
+static bool SetNonBlocking(int descriptor)
+{
+  const int flags = fcntl(descriptor, F_GETFL, 0);
+  return flags >= 0 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Metodo per scrivere tutti i dati su un socket bloccante (lato client)
+static bool SendAll(int descriptor, const char *data, size_t size)
+{
+  while (size > 0)
+  {
+    const ssize_t written = send(descriptor, data, size, MSG_NOSIGNAL);
+    if (written <= 0)
+      return false;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+SimulationServer::Client::~Client()
+{
+  close(fd);
+}
+
+SimulationServer::SimulationServer() : fListen(-1), fRunning(false), fStop(false), fClosing(false)
+{
+  fWakeup[0] = fWakeup[1] = -1;
+}
+
+SimulationServer::~SimulationServer()
+{
+  if (fListen >= 0)
+  {
+    close(fListen);
+    unlink(fPath.c_str());
+  }
+  if (fWakeup[0] >= 0)
+  {
+    close(fWakeup[0]);
+    close(fWakeup[1]);
+  }
+}
+
+bool SimulationServer::Listen(const char *path)
+{
+  sockaddr_un address;
+  if (!MakeAddress(path, address) || pipe(fWakeup) != 0 || !SetNonBlocking(fWakeup[0]) || !SetNonBlocking(fWakeup[1]))
+    return false;
+  fListen = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fListen < 0)
+    return false;
+  unlink(path);
+
+  // Il socket è creato con permessi 0600: le richieste scrivono file e usano le CPU del servizio,
+  // quindi solo l'utente che lo esegue può connettersi
+  const mode_t mask = umask(0177);
+  const bool bound = bind(fListen, (const sockaddr *)&address, sizeof(address)) == 0;
+  umask(mask);
+  if (!bound || listen(fListen, 16) != 0)
+  {
+    close(fListen);
+    fListen = -1;
+    return false;
+  }
+  fPath = path;
+  return true;
+}
+
+void SimulationServer::Send(Client &client, const char *data, size_t size)
+{
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(client.writeMutex);
+    if (client.closed)
+      return;
+
+    // Un client che non legge da più di kMaxOutput byte è scartato; un singolo messaggio più grande
+    // (l'archivio degli istogrammi) è comunque accodato
+    if (client.output.size() > kMaxOutput)
+    {
+      Drop(client);
+      return;
+    }
+    const bool idle = client.output.empty();
+    client.output.append(data, size);
+    if (!FlushOutput(client))
+    {
+      Drop(client);
+      return;
+    }
+    wake = idle && !client.output.empty();
+  }
+  if (wake)
+    Wake();
+}
+
+bool SimulationServer::FlushOutput(Client &client)
+{
+  size_t sent = 0;
+  bool ok = true;
+  while (sent < client.output.size())
+  {
+    const ssize_t written =
+        send(client.fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (written > 0)
+      sent += written;
+    else if (written < 0 && errno == EINTR)
+      continue;
+    else
+    {
+      ok = written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+  }
+  client.output.erase(0, sent);
+  return ok;
+}
+
+void SimulationServer::Drop(Client &client)
+{
+  client.closed = true;
+  std::string().swap(client.output);
+  shutdown(client.fd, SHUT_RDWR);
+}
+
+void SimulationServer::Wake()
+{
+  // La pipe non è bloccante: se è piena il thread di ricezione ha già un risveglio in attesa
+  const char wake = 0;
+  if (write(fWakeup[1], &wake, 1) != 1)
+    return;
+}
+
+long long SimulationServer::GetQueuePosition(const std::shared_ptr<Client> &client) const
+{
+  // La nuova richiesta è eseguita al turno numero backlog del client (contando da 0), e a ogni
+  // turno ogni client con richieste in attesa ne esegue una nell'ordine di fReady; un client
+  // senza richieste in attesa entra in fondo ai turni
+  const size_t backlog = client->pending.size();
+  const size_t index = std::find(fReady.begin(), fReady.end(), client) - fReady.begin();
+  long long position = (fRunning ? 1 : 0) + (long long)backlog;
+  for (size_t k = 0; k < fReady.size(); ++k)
+  {
+    if (k == index)
+      continue;
+    const size_t other = fReady[k]->pending.size();
+    position += (long long)std::min(other, backlog) + (k < index && other > backlog ? 1 : 0);
+  }
+  return position;
+}
+
+void SimulationServer::ParseLines(const std::shared_ptr<Client> &client)
+{
+  size_t newline;
+  while ((newline = client->buffer.find('\n')) != std::string::npos)
+  {
+    const std::string line = client->buffer.substr(0, newline);
+    client->buffer.erase(0, newline + 1);
+    if (client->reading)
+    {
+      if (!line.empty() && client->partial.size() >= kMaxRequestLines)
+      {
+        const std::string reply = "@error too many options in the request\n";
+        Send(*client, reply.data(), reply.size());
+        std::lock_guard<std::mutex> lock(client->writeMutex);
+        Drop(*client);
+        return;
+      }
+      if (!line.empty())
+      {
+        client->partial.push_back(line);
+        continue;
+      }
+      // Richiesta completa: in coda, e il client entra nei turni se non ha altre richieste in attesa
+      client->reading = false;
+      std::string reply;
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fStop)
+          reply = "@error the service is shutting down\n";
+        else if (client->pending.size() >= kMaxPendingRequests)
+          reply = "@error too many pending requests (at most " + std::to_string(kMaxPendingRequests) + ")\n";
+        else
+        {
+          reply = "@queued " + std::to_string(GetQueuePosition(client)) + "\n";
+          client->pending.push_back(client->partial);
+          if (client->pending.size() == 1)
+            fReady.push_back(client);
+        }
+      }
+      fAvailable.notify_one();
+      Send(*client, reply.data(), reply.size());
+    }
+    else if (line == "run")
+    {
+      client->reading = true;
+      client->partial.clear();
+    }
+    else if (line == "shutdown")
+    {
+      {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fStop = true;
+      }
+      fAvailable.notify_one();
+    }
+    else
+    {
+      const std::string reply = "@error unknown command: " + line.substr(0, 256) + "\n";
+      Send(*client, reply.data(), reply.size());
+    }
+  }
+
+  // Riga incompleta troppo lunga: il client è scartato invece di accumulare dati senza limite
+  if (client->buffer.size() > kMaxLineLength)
+  {
+    const std::string reply = "@error line too long\n";
+    Send(*client, reply.data(), reply.size());
+    std::lock_guard<std::mutex> lock(client->writeMutex);
+    Drop(*client);
+  }
+}
+
+void SimulationServer::ReceiveLoop()
+{
+  std::vector<pollfd> fds;
+  std::vector<std::shared_ptr<Client>> polled;
+  char data[4096];
+  std::chrono::steady_clock::time_point deadline;
+  bool closing = false;
+  for (;;)
+  {
+    // Alla chiusura si attende l'invio delle risposte in attesa, al più kDrainSeconds secondi
+    if (!closing)
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      closing = fClosing;
+      deadline = std::chrono::steady_clock::now() + std::chrono::seconds(kDrainSeconds);
+    }
+    fds.clear();
+    polled.clear();
+    pollfd listenFd = {fListen, (short)(closing ? 0 : POLLIN), 0};
+    pollfd wakeupFd = {fWakeup[0], POLLIN, 0};
+    fds.push_back(listenFd);
+    fds.push_back(wakeupFd);
+    bool pendingOutput = false;
+    for (std::map<int, std::shared_ptr<Client>>::iterator it = fClients.begin(); it != fClients.end(); ++it)
+    {
+      bool hasOutput;
+      {
+        std::lock_guard<std::mutex> lock(it->second->writeMutex);
+        hasOutput = !it->second->output.empty();
+      }
+      pendingOutput = pendingOutput || hasOutput;
+      pollfd clientFd = {it->first, (short)(POLLIN | (hasOutput ? POLLOUT : 0)), 0};
+      fds.push_back(clientFd);
+      polled.push_back(it->second);
+    }
+    if (closing && (!pendingOutput || std::chrono::steady_clock::now() >= deadline))
+      return;
+    if (poll(fds.data(), fds.size(), closing ? 100 : -1) < 0)
+      continue;
+    if (fds[1].revents)
+    {
+      while (read(fWakeup[0], data, sizeof(data)) > 0)
+        ;
+    }
+    if (fds[0].revents & POLLIN)
+    {
+      const int descriptor = accept(fListen, 0, 0);
+      if (descriptor >= 0 && SetNonBlocking(descriptor))
+        fClients[descriptor] = std::make_shared<Client>(descriptor);
+      else if (descriptor >= 0)
+        close(descriptor);
+    }
+    for (size_t k = 0; k < polled.size(); ++k)
+    {
+      const short events = fds[k + 2].revents;
+      if (!events)
+        continue;
+      const std::shared_ptr<Client> &client = polled[k];
+      if (events & POLLOUT)
+      {
+        std::lock_guard<std::mutex> lock(client->writeMutex);
+        if (!client->closed && !FlushOutput(*client))
+          Drop(*client);
+      }
+      if (!(events & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      const ssize_t received = recv(client->fd, data, sizeof(data), 0);
+      if (received > 0)
+      {
+        client->buffer.append(data, received);
+        ParseLines(client);
+        continue;
+      }
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        continue;
+
+      // Connessione chiusa: le richieste in attesa del client sono scartate
+      {
+        std::lock_guard<std::mutex> lock(client->writeMutex);
+        client->closed = true;
+        std::string().swap(client->output);
+      }
+      std::lock_guard<std::mutex> lock(fMutex);
+      client->pending.clear();
+      fReady.erase(std::remove(fReady.begin(), fReady.end(), client), fReady.end());
+      fClients.erase(client->fd);
+    }
+  }
+}
+
+void SimulationServer::Serve(const Runner &runner, std::ostream &log)
+{
+  std::thread receiver(&SimulationServer::ReceiveLoop, this);
+  const std::string storePath = fPath + ".result.hst";
+  long long nRequests = 0;
+  for (;;)
+  {
+    std::shared_ptr<Client> client;
+    std::vector<std::string> args;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fAvailable.wait(lock, [this]() { return fStop || !fReady.empty(); });
+      if (fStop)
+        break;
+
+      // Turno del primo client: una richiesta, poi in fondo ai turni se ne ha altre
+      client = fReady.front();
+      fReady.pop_front();
+      args = client->pending.front();
+      client->pending.pop_front();
+      if (!client->pending.empty())
+        fReady.push_back(client);
+      fRunning = true;
+    }
+
+    // Esecuzione con l'uscita inviata al client riga per riga
+    ++nRequests;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Client *target = client.get();
+    SocketStreamBuffer buffer([this, target](const char *data, size_t size) { Send(*target, data, size); });
+    std::ostream out(&buffer);
+    std::remove(storePath.c_str());
+    const int rc = runner(args, storePath, out);
+    out.flush();
+
+    // Risultato: codice di uscita e archivio degli istogrammi
+    std::string store;
+    std::ifstream in(storePath, std::ios::binary);
+    if (rc == 0 && in)
+      store.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    in.close();
+    std::remove(storePath.c_str());
+    const std::string header = "@result " + std::to_string(rc) + " " + std::to_string(store.size()) + "\n";
+    Send(*client, header.data(), header.size());
+    Send(*client, store.data(), store.size());
+    log << "Request " << nRequests << " (client " << client->fd << "): exit code " << rc << ", "
+        << store.size() << " bytes in "
+        << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+    std::lock_guard<std::mutex> lock(fMutex);
+    fRunning = false;
+  }
+
+  // Chiusura: il thread di ricezione invia le risposte in attesa e termina, poi le connessioni sono chiuse
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fClosing = true;
+  }
+  Wake();
+  receiver.join();
+  fClients.clear();
+  fReady.clear();
+}
+
+int SimulationServer::Request(const char *path, const std::vector<std::string> &args, const char *storePath,
+                              std::ostream &out, std::ostream &err)
+{
+  sockaddr_un address;
+  if (!MakeAddress(path, address))
+  {
+    err << "Invalid socket path: " << path << std::endl;
+    return 1;
+  }
+  const int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (descriptor < 0 || connect(descriptor, (const sockaddr *)&address, sizeof(address)) != 0)
+  {
+    err << "Cannot connect to " << path << std::endl;
+    if (descriptor >= 0)
+      close(descriptor);
+    return 1;
+  }
+
+  // Invio della richiesta
+  std::string request;
+  if (args.size() == 1 && args[0] == "--shutdown")
+    request = "shutdown\n";
+  else
+  {
+    request = "run\n";
+    for (size_t k = 0; k < args.size(); ++k)
+    {
+      if (args[k].empty() || args[k].find('\n') != std::string::npos)
+      {
+        err << "Invalid option for a request: \"" << args[k] << "\"" << std::endl;
+        close(descriptor);
+        return 1;
+      }
+      request += args[k] + "\n";
+    }
+    request += "\n";
+  }
+  Client client(descriptor); // Chiude il socket all'uscita
+  if (!SendAll(descriptor, request.data(), request.size()))
+  {
+    err << "Cannot send the request to " << path << std::endl;
+    return 1;
+  }
+  if (request == "shutdown\n")
+    return 0;
+
+  // Ricezione delle righe di uscita e del risultato
+  std::string buffer;
+  char data[4096];
+  long long storeSize = -1;
+  int rc = 1;
+  for (;;)
+  {
+    size_t newline;
+    while (storeSize < 0 && (newline = buffer.find('\n')) != std::string::npos)
+    {
+      const std::string line = buffer.substr(0, newline);
+      buffer.erase(0, newline + 1);
+      if (line.compare(0, 8, "@queued ") == 0)
+        out << "Queued behind " << line.substr(8) << " requests" << std::endl;
+      else if (line.compare(0, 8, "@result ") == 0)
+      {
+        if (std::sscanf(line.c_str() + 8, "%d %lld", &rc, &storeSize) != 2 || storeSize < 0)
+        {
+          err << "Invalid reply: " << line << std::endl;
+          return 1;
+        }
+      }
+      else if (line.compare(0, 7, "@error ") == 0)
+        err << line.substr(7) << std::endl;
+      else
+        out << line << std::endl;
+    }
+    if (storeSize >= 0 && (long long)buffer.size() >= storeSize)
+      break;
+    const ssize_t received = recv(descriptor, data, sizeof(data), 0);
+    if (received <= 0)
+    {
+      err << "Connection to " << path << " closed before the result" << std::endl;
+      return 1;
+    }
+    buffer.append(data, received);
+  }
+
+  if (storeSize > 0)
+  {
+    std::ofstream store(storePath, std::ios::binary);
+    store.write(buffer.data(), storeSize);
+    if (!store)
+    {
+      err << "Cannot write " << storePath << std::endl;
+      return 1;
+    }
+    out << "Histogram store received: " << storeSize << " bytes saved to " << storePath << std::endl;
+  }
+  return rc;
+}
@@ -0,0 +1,139 @@
+#ifndef SIMULATIONSERVER_H
+#define SIMULATIONSERVER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// La classe SimulationServer esegue particle_sim come servizio: accetta richieste di simulazione
+// su un socket Unix locale e le esegue una alla volta nello stesso processo, che mantiene thread pool,
+// tabelle delle specie e inizializzazione di ROOT tra una richiesta e l'altra.
+//
+// Protocollo (testo, una riga per elemento):
+//   client → servizio: "run", poi un'opzione della simulazione per riga (come sulla riga di comando),
+//                      poi una riga vuota; più richieste possono seguire sulla stessa connessione.
+//                      "shutdown" chiude il servizio dopo la simulazione in corso.
+//   servizio → client: "@queued <n>" (richieste eseguite prima di questa, compresa quella in corso,
+//                      secondo i turni al momento dell'accodamento), le righe di uscita della
+//                      simulazione man mano che sono prodotte, poi "@result <codice> <byte>" seguita
+//                      dall'archivio nativo degli istogrammi (HistogramStore) di <byte> byte;
+//                      "@error <messaggio>" se la richiesta è rifiutata.
+// Le righe che iniziano con '@' sono riservate al protocollo.
+// Le richieste in attesa sono servite a turno tra i client connessi (una per client per turno),
+// così che un client con molte richieste non blocchi gli altri; ogni client ha al più
+// kMaxPendingRequests richieste in attesa, le altre sono rifiutate.
+// Il socket è accessibile solo all'utente del servizio. I socket dei client non sono bloccanti:
+// le risposte sono accodate per client e inviate dal thread di ricezione quando il client legge,
+// e un client che accumula più di kMaxOutput byte non letti, o invia una riga più lunga di
+// kMaxLineLength o una richiesta con più di kMaxRequestLines opzioni, è disconnesso.
+
+class SimulationServer
+{
+public:
+  // Funzione che esegue una simulazione
+  // args: opzioni della simulazione ricevute dal client
+  // storePath: archivio degli istogrammi da scrivere e restituire al client
+  // out: stream per le righe di uscita, inviate al client
+  // return: codice di uscita della simulazione
+  typedef std::function<int(const std::vector<std::string> &args, const std::string &storePath, std::ostream &out)>
+      Runner;
+
+  static const size_t kMaxLineLength = 64 << 10;  // Lunghezza massima di una riga ricevuta
+  static const size_t kMaxRequestLines = 1024;     // Opzioni massime di una richiesta
+  static const size_t kMaxPendingRequests = 16;    // Richieste in attesa massime per client
+  static const size_t kMaxOutput = 16 << 20;       // Byte non letti oltre i quali un client è disconnesso
+  static const int kDrainSeconds = 5;              // Attesa massima dell'invio delle risposte alla chiusura
+
+private:
+  // Connessione di un client
+  struct Client
+  {
+    int fd;                                       // Descrittore del socket
+    std::mutex writeMutex;                        // Protegge uscita in attesa e stato della connessione
+    std::string output;                           // Dati in attesa di invio
+    bool closed;                                  // Connessione chiusa o scartata: l'uscita è ignorata
+    std::deque<std::vector<std::string>> pending; // Richieste in attesa
+    std::vector<std::string> partial;             // Richiesta in lettura
+    bool reading;                                 // Tra "run" e la riga vuota
+    std::string buffer;                           // Dati ricevuti non ancora divisi in righe
+
+    explicit Client(int descriptor) : fd(descriptor), closed(false), reading(false) {}
+    ~Client();
+  };
+
+  std::string fPath;                                     // Percorso del socket
+  int fListen;                                           // Socket in ascolto
+  std::mutex fMutex;                                     // Protegge coda e stato
+  std::condition_variable fAvailable;                    // Segnala una richiesta o la chiusura
+  std::map<int, std::shared_ptr<Client>> fClients;       // Client connessi, per descrittore
+  std::deque<std::shared_ptr<Client>> fReady;            // Client con richieste in attesa, nell'ordine dei turni
+  bool fRunning;                                         // Una richiesta è in esecuzione
+  bool fStop;                                            // Richiesta di chiusura: nessuna nuova richiesta
+  bool fClosing;                                         // Simulazioni finite: il thread di ricezione termina
+  int fWakeup[2];                                        // Pipe per svegliare il thread di ricezione
+
+  // Loop del thread di ricezione: accetta connessioni e legge le richieste
+  void ReceiveLoop();
+
+  // Metodo per interpretare le righe ricevute da un client
+  void ParseLines(const std::shared_ptr<Client> &client);
+
+  // Metodo per accodare dati per un client e inviarne quanti il socket accetta senza attendere;
+  // il resto è inviato dal thread di ricezione (errori ignorati: il client può essersi disconnesso)
+  void Send(Client &client, const char *data, size_t size);
+
+  // Metodo per inviare l'uscita in attesa di un client senza attendere (con writeMutex acquisito)
+  // return: false se la connessione non è più utilizzabile
+  static bool FlushOutput(Client &client);
+
+  // Metodo per scartare un client (con writeMutex acquisito): l'uscita è ignorata e il thread di
+  // ricezione vede la connessione chiusa
+  static void Drop(Client &client);
+
+  // Metodo per svegliare il thread di ricezione, per esempio per inviare nuova uscita
+  void Wake();
+
+  // Metodo per contare le richieste eseguite prima di una nuova richiesta di un client (con fMutex
+  // acquisito): quella in corso, le precedenti del client e quelle degli altri client nei turni
+  // fino a quello della nuova richiesta
+  // client: client che accoda la richiesta (prima di aggiungerla a pending)
+  long long GetQueuePosition(const std::shared_ptr<Client> &client) const;
+
+public:
+  SimulationServer();
+
+  // Il distruttore chiude il socket e lo rimuove
+  ~SimulationServer();
+
+  SimulationServer(const SimulationServer &) = delete;
+  SimulationServer &operator=(const SimulationServer &) = delete;
+
+  // Metodo per aprire il socket in ascolto (un file esistente con lo stesso nome è sostituito),
+  // accessibile solo all'utente del processo
+  // path: percorso del socket
+  // return: false se il socket non può essere creato
+  bool Listen(const char *path);
+
+  // Metodo per servire le richieste fino a "shutdown"
+  // runner: funzione che esegue una simulazione
+  // log: stream per i messaggi del servizio
+  void Serve(const Runner &runner, std::ostream &log);
+
+  // Metodo per inviare una richiesta a un servizio e riceverne il risultato (client di prova)
+  // path: percorso del socket
+  // args: opzioni della simulazione ("--shutdown" per chiudere il servizio)
+  // storePath: file in cui salvare l'archivio degli istogrammi ricevuto
+  // out, err: stream per l'uscita della simulazione e per gli errori
+  // return: codice di uscita della simulazione, o 1 se il servizio non è raggiungibile
+  static int Request(const char *path, const std::vector<std::string> &args, const char *storePath,
+                     std::ostream &out, std::ostream &err);
+};
+
+#endif // SIMULATIONSERVER_H
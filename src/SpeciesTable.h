@@ -0,0 +1,43 @@
+#ifndef SPECIESTABLE_H
+#define SPECIESTABLE_H
+
+// Tabella piatta delle proprietà delle specie di particelle, letta dai percorsi caldi
+// (generazione, decadimenti, loop delle coppie) senza indirezioni né RTTI.
+// Ogni record occupa 16 byte (massa in doppia precisione, come nel calcolo originale dell'energia,
+// più carica, flag e canali di decadimento), quindi quattro specie condividono una linea di cache;
+// la tabella è allineata a 64 byte e le 7 specie di default occupano 2 linee. La massa al quadrato
+// è ricalcolata dove serve e la larghezza, usata solo per costruire le forme di riga, resta in
+// ResonanceType: ParticleType e ResonanceType restano come viste usate in fase di configurazione.
+
+// Flag che descrivono una specie
+enum SpeciesFlag
+{
+  kResonance = 1 << 0 // La specie è una risonanza e può decadere
+};
+
+struct SpeciesProperties
+{
+  double mass;                // Massa della specie
+  signed char charge;         // Carica elettrica
+  unsigned char flags;        // Combinazione di SpeciesFlag
+  unsigned char firstChannel; // Indice del primo canale di decadimento
+  unsigned char nChannels;    // Numero di canali di decadimento
+};
+
+static_assert(sizeof(SpeciesProperties) == 16, "four species per cache line");
+
+struct alignas(64) SpeciesTable
+{
+  static const int kMaxSpecies = 10;    // Numero massimo di specie registrabili
+  SpeciesProperties data[kMaxSpecies]; // Proprietà delle specie, indicizzate come i tipi di particella
+  int size;                             // Numero di specie registrate
+
+  // Metodo per accedere alle proprietà di una specie
+  // index: indice della specie (deve essere valido)
+  const SpeciesProperties &operator[](int index) const { return data[index]; }
+
+  // Metodo per sapere se una specie è una risonanza
+  bool IsResonance(int index) const { return (data[index].flags & kResonance) != 0; }
+};
+
+#endif // SPECIESTABLE_H
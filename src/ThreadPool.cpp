@@ -0,0 +1,161 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <sched.h>
+
+ThreadPool::ThreadPool(int nThreads) : fNWorkerTasks(0), fRunning(0), fStop(false)
+{
+  if (nThreads <= 0)
+  {
+    nThreads = (int)std::thread::hardware_concurrency();
+    if (nThreads <= 0)
+      nThreads = 1;
+  }
+  fCpus.assign(nThreads, -1);
+  StartWorkers();
+}
+
+ThreadPool::ThreadPool(const std::vector<int> &cpus) : fCpus(cpus), fNWorkerTasks(0), fRunning(0), fStop(false)
+{
+  StartWorkers();
+}
+
+void ThreadPool::StartWorkers()
+{
+  fWorkerTasks.resize(fCpus.size());
+  for (size_t i = 0; i < fCpus.size(); ++i)
+  {
+    fWorkers.push_back(std::thread(&ThreadPool::WorkerLoop, this, (int)i));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fTaskAvailable.notify_all();
+  for (size_t i = 0; i < fWorkers.size(); ++i)
+  {
+    fWorkers[i].join();
+  }
+}
+
+void ThreadPool::Submit(const std::function<void()> &task)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fTasks.push(task);
+  }
+  fTaskAvailable.notify_one();
+}
+
+void ThreadPool::SubmitTo(int worker, const std::function<void()> &task)
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fWorkerTasks[worker].push(task);
+    ++fNWorkerTasks;
+  }
+  fTaskAvailable.notify_all(); // Il thread destinatario non è noto alla condition variable
+}
+
+void ThreadPool::Wait()
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  fAllDone.wait(lock, [this]() { return fTasks.empty() && fNWorkerTasks == 0 && fRunning == 0; });
+}
+
+void ThreadPool::WorkerLoop(int index)
+{
+  // Il thread è fissato alla propria CPU prima di eseguire compiti, così che la memoria
+  // che tocca per prima sia allocata sul nodo NUMA locale
+  if (fCpus[index] >= 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(fCpus[index], &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+
+  std::queue<std::function<void()>> &own = fWorkerTasks[index];
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fTaskAvailable.wait(lock, [this, &own]() { return fStop || !own.empty() || !fTasks.empty(); });
+      if (!own.empty())
+      {
+        task = own.front();
+        own.pop();
+        --fNWorkerTasks;
+      }
+      else if (!fTasks.empty())
+      {
+        task = fTasks.front();
+        fTasks.pop();
+      }
+      else
+        return;
+      ++fRunning;
+    }
+
+    task();
+
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      --fRunning;
+      if (fTasks.empty() && fNWorkerTasks == 0 && fRunning == 0)
+        fAllDone.notify_all();
+    }
+  }
+}
+
+int TaskGraph::AddTask(const std::function<void()> &work, const std::vector<int> &dependencies)
+{
+  Task task;
+  task.work = work;
+  task.nDependencies = (int)dependencies.size();
+  int index = (int)fTasks.size();
+  fTasks.push_back(task);
+  for (size_t i = 0; i < dependencies.size(); ++i)
+  {
+    fTasks[dependencies[i]].dependents.push_back(index);
+  }
+  return index;
+}
+
+void TaskGraph::Run(ThreadPool &pool)
+{
+  // Contatori delle dipendenze ancora da soddisfare, decrementati dai compiti che terminano
+  const int nTasks = (int)fTasks.size();
+  std::unique_ptr<std::atomic<int>[]> pending(new std::atomic<int>[nTasks]);
+  for (int i = 0; i < nTasks; ++i)
+  {
+    pending[i] = fTasks[i].nDependencies;
+  }
+
+  // Ogni compito, al termine, inserisce nella coda i dipendenti rimasti senza dipendenze
+  std::function<void(int)> launch = [&](int index) {
+    pool.Submit([&, index]() {
+      fTasks[index].work();
+      const std::vector<int> &dependents = fTasks[index].dependents;
+      for (size_t d = 0; d < dependents.size(); ++d)
+      {
+        if (--pending[dependents[d]] == 0)
+          launch(dependents[d]);
+      }
+    });
+  };
+
+  for (int i = 0; i < nTasks; ++i)
+  {
+    if (fTasks[i].nDependencies == 0)
+      launch(i);
+  }
+  pool.Wait();
+}
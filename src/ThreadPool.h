@@ -0,0 +1,93 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// La classe ThreadPool mantiene un insieme di thread di lavoro che eseguono
+// i compiti inseriti in una coda condivisa. I thread possono essere fissati a CPU scelte
+// (posizionamento NUMA) e ogni thread ha anche una propria coda, per i compiti che devono
+// essere eseguiti da un thread preciso (es. allocazioni sul nodo locale).
+
+class ThreadPool
+{
+private:
+  std::vector<std::thread> fWorkers;             // Thread di lavoro
+  std::queue<std::function<void()>> fTasks;      // Coda dei compiti da eseguire
+  std::vector<std::queue<std::function<void()>>> fWorkerTasks; // Coda propria di ogni thread
+  std::vector<int> fCpus;                        // CPU di ogni thread (-1: non fissato)
+  int fNWorkerTasks;                             // Compiti nelle code dei thread
+  std::mutex fMutex;                             // Protegge la coda e i contatori
+  std::condition_variable fTaskAvailable;        // Segnala un nuovo compito o la chiusura
+  std::condition_variable fAllDone;              // Segnala che la coda è vuota e nessun compito è in corso
+  int fRunning;                                  // Numero di compiti in esecuzione
+  bool fStop;                                    // Richiesta di chiusura dei thread
+
+  // Loop eseguito da ogni thread di lavoro
+  // index: indice del thread
+  void WorkerLoop(int index);
+
+  // Metodo per avviare i thread di lavoro
+  void StartWorkers();
+
+public:
+  // Costruttore che avvia i thread di lavoro
+  // nThreads: numero di thread (0 per usare il numero di core disponibili)
+  explicit ThreadPool(int nThreads = 0);
+
+  // Costruttore che avvia un thread di lavoro fissato a ogni CPU indicata
+  // cpus: CPU di ogni thread (vedi NumaTopology::AssignCpus)
+  explicit ThreadPool(const std::vector<int> &cpus);
+
+  // Il distruttore attende la fine dei compiti in coda e chiude i thread
+  ~ThreadPool();
+
+  // Metodo per inserire un compito nella coda
+  void Submit(const std::function<void()> &task);
+
+  // Metodo per inserire un compito nella coda di un thread preciso
+  // worker: indice del thread
+  void SubmitTo(int worker, const std::function<void()> &task);
+
+  // Metodo per attendere che tutti i compiti inseriti siano terminati
+  void Wait();
+
+  // Metodo per ottenere il numero di thread di lavoro
+  int GetNThreads() const { return (int)fWorkers.size(); }
+
+  // Metodo per sapere se i thread sono fissati a CPU
+  bool IsPinned() const { return !fCpus.empty() && fCpus[0] >= 0; }
+};
+
+// La classe TaskGraph descrive un insieme di compiti con dipendenze e li esegue
+// su un ThreadPool: un compito parte appena tutti quelli da cui dipende sono terminati.
+
+class TaskGraph
+{
+private:
+  struct Task
+  {
+    std::function<void()> work; // Lavoro da eseguire
+    std::vector<int> dependents; // Compiti che dipendono da questo
+    int nDependencies;           // Numero di dipendenze dichiarate
+  };
+
+  std::vector<Task> fTasks; // Compiti del grafo, nell'ordine di inserimento
+
+public:
+  // Metodo per aggiungere un compito al grafo
+  // work: lavoro da eseguire
+  // dependencies: indici dei compiti che devono terminare prima di questo
+  // return: indice del compito
+  int AddTask(const std::function<void()> &work, const std::vector<int> &dependencies = std::vector<int>());
+
+  // Metodo per eseguire tutti i compiti rispettando le dipendenze
+  // pool: thread pool su cui eseguire i compiti
+  void Run(ThreadPool &pool);
+};
+
+#endif // THREADPOOL_H
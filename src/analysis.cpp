@@ -0,0 +1,466 @@
+#include "HistogramFitter.h"
+#include "HistogramStore.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "TFile.h"
+#include "TH1F.h"
+#include "TF1.h"
+#include "TCanvas.h"
+#include "TStyle.h"
+#include "TString.h"
+#include "TMath.h"
+#include "TROOT.h"
+#include "Math/MinimizerOptions.h"
+
+// Programma di analisi compilato che sostituisce le macro in root/utils
+// (verify_particle_distribution, check_momentum_distribution, check_angular_distributions,
+// analyze_invariant_mass, plot_distributions, plot_invariant_mass, save_histograms).
+// Il file ParticleAnalysis.root viene aperto una sola volta e ogni istogramma letto una sola volta;
+// verifiche e fit sono eseguiti come grafo di compiti su un thread pool, i grafici vengono
+// disegnati alla fine (la grafica di ROOT non è thread-safe) e i risultati sono scritti
+// in formato JSON in root/data/AnalysisResults.json.
+//
+// Uso (dalla cartella src, come le macro):
+//   ./particle_analysis [--threads N] [--no-charts] [--root-fit] [--compare-root] [--store <file>]
+//
+// Con --store gli istogrammi sono letti dall'archivio nativo scritto dalla simulazione con
+// --store-file (HistogramStore, mappato in memoria) invece che dal file ROOT.
+// I fit sono eseguiti dal fitter nativo (HistogramFitter); con --root-fit si usa TH1::Fit
+// e con --compare-root si eseguono entrambi e si verifica che i risultati coincidano.
+
+// Nomi degli istogrammi prodotti dalla simulazione
+static const char *kHistNames[] = {
+    "hParticleTypes", "hAzimuthalAngle", "hPolarAngle", "hMomentum",
+    "hTransverseMomentum", "hEnergy", "hInvariantMass", "hInvMassOppositeCharge",
+    "hInvMassSameCharge", "hInvMassPionKaon", "hInvMassPionKaonSC", "hInvMassDecayProducts"};
+static const int kNHists = sizeof(kHistNames) / sizeof(kHistNames[0]);
+
+// Proporzioni teoriche attese per ogni tipo di particella (in percentuale)
+static const double kExpectedProportions[] = {40.0, 40.0, 5.0, 5.0, 4.5, 4.5, 1.0};
+static const int kNParticleTypes = sizeof(kExpectedProportions) / sizeof(kExpectedProportions[0]);
+
+// Tolleranze del confronto tra il fitter nativo e TH1::Fit (opzione --compare-root):
+// differenza dei parametri in unità dell'errore e differenza relativa degli errori
+static const double kParameterTolerance = 0.05;
+static const double kErrorTolerance = 0.05;
+
+// Risultato di un fit, salvato nel file dei risultati
+struct FitResult
+{
+  std::string histogram;           // Nome dell'istogramma
+  std::string model;               // Modello usato nel fit
+  double min, max;                 // Intervallo del fit
+  int nPar;                        // Numero di parametri
+  double par[FitOutput::kMaxPar];  // Valori dei parametri
+  double err[FitOutput::kMaxPar];  // Errori dei parametri
+  double chi2;                     // Chi quadro
+  int ndf;                         // Gradi di libertà
+  double prob;                     // Probabilità del chi quadro
+};
+
+// Opzioni dei fit scelte da riga di comando
+struct FitOptions
+{
+  bool useRoot; // Fit con TH1::Fit invece che con il fitter nativo
+  bool compare; // Esegue entrambi i fit e confronta i risultati
+};
+
+// Estrazione dei bin di un istogramma con il centro nell'intervallo del fit (come in ROOT)
+static FitData MakeFitData(const TH1F *hist, double min, double max)
+{
+  FitData data;
+  for (int i = 1; i <= hist->GetNbinsX(); ++i)
+  {
+    double center = hist->GetBinCenter(i);
+    if (center >= min && center <= max)
+      data.AddBin(center, hist->GetBinContent(i), hist->GetBinError(i));
+  }
+  return data;
+}
+
+// Fit di un istogramma; la funzione risultante resta associata all'istogramma
+// per essere disegnata nei grafici.
+// hist: istogramma (una copia privata del compito)
+// model: modello del fit
+// name: nome della funzione di fit
+// min, max: intervallo del fit
+// options: scelta del fitter e confronto con ROOT
+static FitResult FitHistogram(TH1F *hist, FitModel model, const char *name, double min, double max, const FitOptions &options)
+{
+  static const char *kModelNames[] = {"constant", "exponential", "gaussian", "gaussian+pol2"};
+  const int nPar = HistogramFitter::GetNPar(model);
+  FitData data = MakeFitData(hist, min, max);
+  HistogramFitter fitter(model);
+
+  FitOutput output;
+  FitOutput rootOutput;
+  if (options.useRoot || options.compare)
+  {
+    // Fit di ROOT (Minuit2) a partire dagli stessi parametri iniziali del fitter nativo
+    double initial[FitOutput::kMaxPar];
+    fitter.InitialParameters(data, initial);
+    TF1 function(name, HistogramFitter::GetFormula(model), min, max);
+    function.SetParameters(initial);
+    function.SetLineColor(kRed);
+    hist->Fit(&function, options.useRoot ? "RQ" : "RQN");
+    rootOutput.nPar = nPar;
+    for (int i = 0; i < nPar; ++i)
+    {
+      rootOutput.par[i] = function.GetParameter(i);
+      rootOutput.err[i] = function.GetParError(i);
+    }
+    rootOutput.chi2 = function.GetChisquare();
+    rootOutput.ndf = function.GetNDF();
+    rootOutput.prob = function.GetProb();
+    output = rootOutput;
+  }
+  if (!options.useRoot)
+  {
+    output = fitter.Fit(data);
+    if (!output.converged)
+      std::cerr << "Attenzione: il fit di " << hist->GetName() << " non converge" << std::endl;
+    TF1 *function = new TF1(name, HistogramFitter::GetFormula(model), min, max);
+    function->SetParameters(output.par);
+    function->SetParErrors(output.err);
+    function->SetChisquare(output.chi2);
+    function->SetNDF(output.ndf);
+    function->SetLineColor(kRed);
+    hist->GetListOfFunctions()->Add(function); // L'istogramma diventa proprietario della funzione
+  }
+  if (options.compare)
+  {
+    double maxParDeviation = 0, maxErrDeviation = 0;
+    for (int i = 0; i < nPar; ++i)
+    {
+      double scale = rootOutput.err[i] > 0 ? rootOutput.err[i] : 1.0;
+      double parDeviation = std::fabs(output.par[i] - rootOutput.par[i]) / scale;
+      double errDeviation = rootOutput.err[i] > 0 ? std::fabs(output.err[i] / rootOutput.err[i] - 1) : 0;
+      if (parDeviation > maxParDeviation)
+        maxParDeviation = parDeviation;
+      if (errDeviation > maxErrDeviation)
+        maxErrDeviation = errDeviation;
+    }
+    bool agree = maxParDeviation <= kParameterTolerance && maxErrDeviation <= kErrorTolerance;
+    std::cout << "Confronto con ROOT per " << name << ": parametri " << maxParDeviation << " sigma, errori "
+              << maxErrDeviation * 100 << "%" << (agree ? " (compatibili)" : " (NON compatibili)") << std::endl;
+  }
+
+  FitResult result;
+  result.histogram = hist->GetName();
+  result.model = kModelNames[model];
+  result.min = min;
+  result.max = max;
+  result.nPar = nPar;
+  for (int i = 0; i < nPar; ++i)
+  {
+    result.par[i] = output.par[i];
+    result.err[i] = output.err[i];
+  }
+  result.chi2 = output.chi2;
+  result.ndf = output.ndf;
+  result.prob = output.prob;
+  return result;
+}
+
+// Copia di un istogramma scollegata da qualsiasi file
+static TH1F *CloneHistogram(const TH1F *hist, const char *name)
+{
+  TH1F *clone = (TH1F *)hist->Clone(name);
+  clone->SetDirectory(0);
+  return clone;
+}
+
+// Scrittura di un fit in formato JSON
+static void WriteFit(std::ofstream &out, const char *key, const FitResult &fit, bool last)
+{
+  out << "    \"" << key << "\": {\"histogram\": \"" << fit.histogram << "\", \"model\": \"" << fit.model
+      << "\", \"range\": [" << fit.min << ", " << fit.max << "], \"parameters\": [";
+  for (int i = 0; i < fit.nPar; ++i)
+    out << (i ? ", " : "") << fit.par[i];
+  out << "], \"errors\": [";
+  for (int i = 0; i < fit.nPar; ++i)
+    out << (i ? ", " : "") << fit.err[i];
+  out << "], \"chi2\": " << fit.chi2 << ", \"ndf\": " << fit.ndf << ", \"prob\": " << fit.prob << "}"
+      << (last ? "\n" : ",\n");
+}
+
+// Salvataggio di un istogramma (con le eventuali funzioni di fit) in un file PDF
+static void SaveChart(TH1F *hist, const char *path, const char *option)
+{
+  TCanvas canvas(path, path, 800, 600);
+  hist->Draw(option);
+  canvas.SaveAs(path);
+}
+
+int main(int argc, char **argv)
+{
+  int nThreads = 0;
+  bool charts = true;
+  FitOptions fitOptions = {false, false};
+  const char *storePath = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      nThreads = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--no-charts") == 0)
+      charts = false;
+    else if (std::strcmp(argv[i], "--root-fit") == 0)
+      fitOptions.useRoot = true;
+    else if (std::strcmp(argv[i], "--compare-root") == 0)
+      fitOptions.compare = true;
+    else if (std::strcmp(argv[i], "--store") == 0 && i + 1 < argc)
+      storePath = argv[++i];
+    else
+    {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+
+  // Abilitazione dell'uso di ROOT da più thread; Minuit2 non usa stato globale nei fit
+  ROOT::EnableThreadSafety();
+  ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+  TH1::AddDirectory(false);
+
+  // **Lettura di tutti gli istogrammi con una sola apertura del file**
+  TH1F *hists[kNHists];
+  if (storePath)
+  {
+    // Archivio nativo: apertura con mmap, ricerca binaria per nome e copia diretta dei bin
+    HistogramStore store;
+    if (!store.Open(storePath))
+    {
+      std::cerr << "Errore nell'apertura dell'archivio " << storePath << std::endl;
+      return 1;
+    }
+    for (int i = 0; i < kNHists; ++i)
+    {
+      hists[i] = store.MakeTH1F(kHistNames[i]);
+      if (!hists[i])
+      {
+        std::cerr << "Istogramma " << kHistNames[i] << " non trovato nell'archivio!" << std::endl;
+        for (int k = 0; k < i; ++k)
+          delete hists[k];
+        return 1;
+      }
+      if (hists[i]->GetSumw2N() == 0)
+        hists[i]->Sumw2();
+    }
+  }
+  else
+  {
+    TFile *file = TFile::Open("root/data/ParticleAnalysis.root");
+    if (!file || file->IsZombie())
+    {
+      std::cerr << "Errore nell'apertura del file ParticleAnalysis.root" << std::endl;
+      return 1;
+    }
+    for (int i = 0; i < kNHists; ++i)
+    {
+      TH1F *hist = (TH1F *)file->Get(kHistNames[i]);
+      if (!hist)
+      {
+        std::cerr << "Istogramma " << kHistNames[i] << " non trovato nel file!" << std::endl;
+        file->Close();
+        return 1;
+      }
+      hists[i] = CloneHistogram(hist, kHistNames[i]);
+      hists[i]->Sumw2();
+    }
+    file->Close();
+    delete file;
+  }
+
+  TH1F *hParticleTypes = hists[0];
+  TH1F *hAzimuthalAngle = hists[1];
+  TH1F *hPolarAngle = hists[2];
+  TH1F *hMomentum = hists[3];
+  TH1F *hInvMassOppositeCharge = hists[7];
+  TH1F *hInvMassSameCharge = hists[8];
+  TH1F *hInvMassPionKaon = hists[9];
+  TH1F *hInvMassPionKaonSC = hists[10];
+  TH1F *hInvMassDecayProducts = hists[11];
+
+  Clock::time_point loaded = Clock::now();
+
+  // **Costruzione del grafo dei compiti**
+  // Ogni compito lavora su copie private degli istogrammi e scrive in una propria variabile.
+  TaskGraph graph;
+
+  // Copie degli istogrammi usate dai fit (ognuna è modificata da un solo compito)
+  TH1F *hMomentumCheck = CloneHistogram(hMomentum, "hMomentumCheck");
+  TH1F *hMomentumFull = CloneHistogram(hMomentum, "hMomentumFull");
+  TH1F *hAzimuthalFit = CloneHistogram(hAzimuthalAngle, "hAzimuthalFit");
+  TH1F *hPolarFit = CloneHistogram(hPolarAngle, "hPolarFit");
+  TH1F *hDecayProductsFit = CloneHistogram(hInvMassDecayProducts, "hDecayProductsFit");
+  TH1F *hSubtractedAll = CloneHistogram(hInvMassOppositeCharge, "hSubtractedAll");
+  TH1F *hSubtractedPionKaon = CloneHistogram(hInvMassPionKaon, "hSubtractedPionKaon");
+
+  // 1) Proporzioni delle specie (verify_particle_distribution)
+  double observedProportions[kNParticleTypes];
+  double proportionErrors[kNParticleTypes];
+  graph.AddTask([&]() {
+    double total = hParticleTypes->GetEntries();
+    for (int i = 0; i < kNParticleTypes; ++i)
+    {
+      observedProportions[i] = hParticleTypes->GetBinContent(i + 1) / total * 100;
+      proportionErrors[i] = hParticleTypes->GetBinError(i + 1) / total * 100;
+    }
+  });
+
+  // 2) Fit esponenziale dell'impulso tra 0.5 e 5 GeV (check_momentum_distribution)
+  FitResult momentumCheckFit;
+  graph.AddTask([&]() {
+    momentumCheckFit = FitHistogram(hMomentumCheck, kFitExponential, "expFitCheck", 0.5, 5, fitOptions);
+  });
+
+  // 3) Fit esponenziale dell'impulso tra 0 e 5 GeV (plot_distributions)
+  FitResult momentumFullFit;
+  graph.AddTask([&]() {
+    momentumFullFit = FitHistogram(hMomentumFull, kFitExponential, "expFitFull", 0, 5, fitOptions);
+  });
+
+  // 4) Fit costanti delle distribuzioni angolari (check_angular_distributions, plot_distributions)
+  FitResult azimuthalFit, polarFit;
+  graph.AddTask([&]() {
+    azimuthalFit = FitHistogram(hAzimuthalFit, kFitConstant, "uniformFitPhi", 0, 2 * TMath::Pi(), fitOptions);
+  });
+  graph.AddTask([&]() {
+    polarFit = FitHistogram(hPolarFit, kFitConstant, "uniformFitTheta", 0, TMath::Pi(), fitOptions);
+  });
+
+  // 5) Sottrazioni e fit gaussiani del picco della K* (analyze_invariant_mass, plot_invariant_mass)
+  FitResult subtractedAllFit, subtractedPionKaonFit, decayProductsFit;
+  int subtractAll = graph.AddTask([&]() {
+    hSubtractedAll->SetTitle("Invariant Mass (Opposite Charge - Same Charge)");
+    hSubtractedAll->Add(hInvMassSameCharge, -1);
+  });
+  int subtractPionKaon = graph.AddTask([&]() {
+    hSubtractedPionKaon->SetTitle("Invariant Mass Pion-Kaon (Opposite Charge - Same Charge)");
+    hSubtractedPionKaon->Add(hInvMassPionKaonSC, -1);
+  });
+  graph.AddTask([&]() {
+    subtractedAllFit = FitHistogram(hSubtractedAll, kFitGaussian, "gausFitAll", 0.75, 1.05, fitOptions);
+  }, std::vector<int>(1, subtractAll));
+  graph.AddTask([&]() {
+    subtractedPionKaonFit = FitHistogram(hSubtractedPionKaon, kFitGaussian, "gausFitPionKaon", 0.75, 1.05, fitOptions);
+  }, std::vector<int>(1, subtractPionKaon));
+  graph.AddTask([&]() {
+    decayProductsFit = FitHistogram(hDecayProductsFit, kFitGaussian, "gausFitDecay", 0.75, 1.05, fitOptions);
+  });
+
+  ThreadPool pool(nThreads);
+  graph.Run(pool);
+
+  Clock::time_point computed = Clock::now();
+
+  // **Stampa dei risultati**
+  std::cout << "Numero totale di particelle generate: " << hParticleTypes->GetEntries() << std::endl;
+  for (int i = 0; i < kNParticleTypes; ++i)
+  {
+    std::cout << "Particella tipo " << i << ": " << observedProportions[i] << " ± " << proportionErrors[i]
+              << "% (attesa " << kExpectedProportions[i] << "%)" << std::endl;
+  }
+  std::cout << "Media dell'impulso (fit 0.5-5 GeV): " << momentumCheckFit.par[1] << " ± " << momentumCheckFit.err[1]
+            << (std::fabs(momentumCheckFit.par[1] - 1.0) <= momentumCheckFit.err[1] ? " (consistente" : " (NON consistente")
+            << " con 1 GeV)" << std::endl;
+  std::cout << "Chi2/NDF azimutale: " << azimuthalFit.chi2 << "/" << azimuthalFit.ndf
+            << ", polare: " << polarFit.chi2 << "/" << polarFit.ndf << std::endl;
+  const FitResult *peakFits[] = {&subtractedAllFit, &subtractedPionKaonFit, &decayProductsFit};
+  for (int i = 0; i < 3; ++i)
+  {
+    std::cout << "Picco K* in " << peakFits[i]->histogram << ": massa " << peakFits[i]->par[1] << " ± " << peakFits[i]->err[1]
+              << ", sigma " << peakFits[i]->par[2] << " ± " << peakFits[i]->err[2]
+              << ", Chi2/NDF " << peakFits[i]->chi2 << "/" << peakFits[i]->ndf << std::endl;
+  }
+
+  // **Scrittura dei risultati in formato JSON**
+  std::ofstream out("root/data/AnalysisResults.json");
+  out.precision(10);
+  out << "{\n  \"entries\": {";
+  for (int i = 0; i < kNHists; ++i)
+    out << (i ? ", " : "") << "\"" << kHistNames[i] << "\": " << hists[i]->GetEntries();
+  out << "},\n  \"species\": [";
+  for (int i = 0; i < kNParticleTypes; ++i)
+  {
+    out << (i ? ", " : "") << "{\"index\": " << i << ", \"observed\": " << observedProportions[i]
+        << ", \"error\": " << proportionErrors[i] << ", \"expected\": " << kExpectedProportions[i] << "}";
+  }
+  out << "],\n  \"fits\": {\n";
+  WriteFit(out, "momentum", momentumCheckFit, false);
+  WriteFit(out, "momentumFullRange", momentumFullFit, false);
+  WriteFit(out, "azimuthalAngle", azimuthalFit, false);
+  WriteFit(out, "polarAngle", polarFit, false);
+  WriteFit(out, "subtractedAll", subtractedAllFit, false);
+  WriteFit(out, "subtractedPionKaon", subtractedPionKaonFit, false);
+  WriteFit(out, "decayProducts", decayProductsFit, true);
+  out << "  }\n}\n";
+  out.close();
+
+  // **Grafici**, disegnati in sequenza sul thread principale
+  if (charts)
+  {
+    // save_histograms: tutti gli istogrammi come PDF
+    for (int i = 0; i < kNHists; ++i)
+    {
+      SaveChart(hists[i], TString::Format("charts/%s.pdf", kHistNames[i]), "");
+    }
+
+    // check_momentum_distribution e check_angular_distributions
+    SaveChart(hMomentumCheck, "charts/check-momentum-distribution/hMomentum_fit.pdf", "E");
+    SaveChart(hAzimuthalFit, "charts/check-angular-distributions/hAzimuthalAngle_fit.pdf", "E");
+    SaveChart(hPolarFit, "charts/check-angular-distributions/hPolarAngle_fit.pdf", "E");
+
+    // analyze_invariant_mass
+    SaveChart(hInvMassDecayProducts, "charts/analyze-invariant-mass/hInvMassDecayProducts.pdf", "");
+    SaveChart(hSubtractedAll, "charts/analyze-invariant-mass/hSubtractedAll_fit.pdf", "");
+    SaveChart(hSubtractedPionKaon, "charts/analyze-invariant-mass/hSubtractedPionKaon_fit.pdf", "");
+    SaveChart(hDecayProductsFit, "charts/analyze-invariant-mass/hInvMassDecayProducts_fit.pdf", "");
+
+    gStyle->SetOptFit(1111);
+
+    // plot_distributions: abbondanze, impulso e angoli su 4 pad
+    TCanvas cDistributions("cDistributions", "Distributions", 1200, 800);
+    cDistributions.Divide(2, 2);
+    cDistributions.cd(1);
+    hParticleTypes->Draw("E");
+    cDistributions.cd(2);
+    hMomentumFull->Draw("E");
+    cDistributions.cd(3);
+    hPolarFit->Draw("E");
+    cDistributions.cd(4);
+    hAzimuthalFit->Draw("E");
+    cDistributions.SaveAs("charts/plot-distributions/distributions.pdf");
+
+    // plot_invariant_mass: picchi della K* su 3 pad
+    TCanvas cInvariantMass("cInvariantMass", "Invariant Mass Distributions", 1200, 900);
+    cInvariantMass.Divide(1, 3);
+    cInvariantMass.cd(1);
+    hDecayProductsFit->Draw("E");
+    cInvariantMass.cd(2);
+    hSubtractedAll->Draw("E");
+    cInvariantMass.cd(3);
+    hSubtractedPionKaon->Draw("E");
+    cInvariantMass.SaveAs("charts/plot-invariant-mass/invariant_mass_distributions.pdf");
+  }
+
+  Clock::time_point end = Clock::now();
+  typedef std::chrono::duration<double, std::milli> Milliseconds;
+  std::cout << "Lettura: " << Milliseconds(loaded - start).count() << " ms, analisi ("
+            << pool.GetNThreads() << " thread): " << Milliseconds(computed - loaded).count() << " ms, grafici: "
+            << Milliseconds(end - computed).count() << " ms" << std::endl;
+  std::cout << "Risultati salvati in root/data/AnalysisResults.json" << std::endl;
+
+  return 0;
+}
@@ -1,24 +1,334 @@
 #include "ParticleType.h"
 #include "ResonanceType.h"
 #include "Particle.h"
+#include "FastMath.h"
+#include "EventGenerator.h"
+#include "HistogramSet.h"
+#include "RunMonitor.h"
+#include "SignalExtractor.h"
+#include "PrecisionTargets.h"
+#include "ThreadPool.h"
+#include "PairCorrelations.h"
+#include "OutputWriter.h"
+#include "HistogramStoreWriter.h"
+#include "AllocationTracker.h"
+#include "Diagnostics.h"
+#include "SimulationServer.h"
+#include "RunMetrics.h"
+#include "NumaTopology.h"
+#include "RegressionTest.h"
+#include "EquivalenceChecker.h"
+#include <algorithm>
 #include <iostream>
+#include <fstream>
 #include <vector>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
 #include "TH1F.h"
 #include "TFile.h"
-#include "TRandom.h"
-#include "TCanvas.h"
+#include "TROOT.h"
+#include "Compression.h"
 
 // Questo programma simula eventi di collisione tra particelle, generando casualmente le loro proprietà
 // (come angoli, quantità di moto e tipi) e calcola proprietà derivate come energia e massa invariante.
 // Utilizza ROOT per la visualizzazione e l'analisi statistica dei risultati mediante istogrammi.
 // La simulazione include il decadimento di particelle risonanti (come K*),
 // con conservazione della quantità di moto e generazione di prodotti di decadimento.
+//
+// Opzioni:
+//   --validate-precision  confronta le masse invarianti calcolate in float e in double
+//                         e riporta la deviazione massima per bin in unità di errore statistico
+//   --line-shape <forma>  forma di riga della massa della K*: gauss (default), bw, rbw
+//   --libm                usa libm invece delle approssimazioni polinomiali di FastMath
+//   --events <n>          numero di eventi da generare (default 100000); con --target è il massimo
+//   --seed <s>            seme dei numeri casuali (default 12345; il thread w usa s + w)
+//   --multiplicity <m>    numero di primarie per evento: fixed:N (default fixed:100), poisson:MEDIA
+//                         o nbd:MEDIA:K (binomiale negativa)
+//   --kinematics <k>      cinematica delle primarie: legacy (default, theta uniforme), isotropic
+//                         (cos theta uniforme), thermal:T o boltzmann:T (spettro in pT con
+//                         temperatura T in GeV e rapidità piatta)
+//   --max-rapidity <y>    rapidità massima per thermal e boltzmann (default 1)
+//   --cut <espr>          taglio sulle particelle per gli istogrammi principali (es. "pt > 0.2 && abs(eta) < 0.8");
+//                         variabili: pt, p, eta, y, phi, theta, e, m, charge
+//   --pair-cut <espr>     taglio sulle coppie per gli istogrammi principali; variabili: m, pt, y
+//   --selection <nome>:<espr>[:<espr coppie>]  insieme di tagli aggiuntivo con istogrammi propri
+//                         (suffisso _<nome>), riempito nello stesso passaggio; ripetibile
+//   --correlations        riempie le correlazioni (Δφ, Δη) e q_inv delle coppie degli istogrammi principali,
+//                         con la normalizzazione da eventi mescolati, nello stesso loop delle coppie
+//   --mixing-stride <k>   una particella ogni k dell'evento è mescolata con l'evento precedente (default 8)
+//   --variation <nome>:<par>=<fattore>[,...]  variazione dei parametri delle primarie applicata come
+//                         peso per primaria (ereditato dai prodotti di decadimento, prodotto dei due pesi
+//                         per le coppie), con istogrammi pesati propri (suffisso _<nome>); <par> è il
+//                         nome di una specie primaria (fattore sull'abbondanza, poi rinormalizzata)
+//                         o slope (fattore su impulso medio o temperatura); ripetibile
+//   --target <oss>=<err>  obiettivo di errore relativo su un'osservabile (yield: resa della K*,
+//                         fractions: frazioni delle specie, momentum: impulso medio); ripetibile.
+//                         La simulazione si ferma appena tutti gli obiettivi sono raggiunti
+//   --threads <n>         numero di thread di generazione (default 1, 0 per tutti i core)
+//   --numa                fissa i thread alle CPU distribuendoli tra i nodi NUMA, crea generatori e istogrammi
+//                         dal proprio thread (memoria sul nodo locale), copia le tabelle delle specie e dei
+//                         decadimenti su ogni nodo e somma gli istogrammi prima per nodo e poi tra i nodi;
+//                         con --threads 0 usa tutte le CPU dei nodi scelti
+//   --numa-nodes <n>      con --numa usa solo i primi n nodi NUMA
+//   --monitor-interval <n> eventi tra due aggiornamenti dei monitor (default 10000, 0 per disattivarli)
+//   --monitor-file <file> scrive le righe dei monitor anche nel file indicato
+//   --metrics-file <file> riscrive periodicamente il file indicato con le metriche della simulazione in corso
+//                         (eventi, eventi e coppie al secondo, decadimenti falliti, utilizzo dei thread,
+//                         memoria) nel formato testuale di Prometheus
+//   --metrics-port <p>    pubblica le stesse metriche su http://127.0.0.1:<p>/metrics (0: porta scelta dal sistema)
+//   --metrics-interval <s> secondi tra due aggiornamenti delle metriche (default 1)
+//   --nd-file <file>      scrive anche gli istogrammi a più dimensioni nel formato nativo
+//   --store-file <file>   scrive anche tutti gli istogrammi in un archivio nativo mappabile in memoria,
+//                         per l'avvio rapido dell'analisi (analysis --store <file>)
+//   --root-file <file>    file ROOT degli istogrammi (default root/data/ParticleAnalysis.root)
+//   --no-root-file        non scrive il file ROOT (--checkpoint e --compression sono ignorati)
+//   --compression <c>     compressione del file ROOT: none, zlib, lz4 o zstd, con livello opzionale
+//                         (es. zstd:5; default quella di ROOT)
+//   --checkpoint          scrive il file ROOT anche dopo ogni blocco di eventi, in un thread dedicato
+//   --abort-on-monitor    interrompe la simulazione quando un monitor esce dalla tolleranza
+//   --check-allocations <n> conta le allocazioni dinamiche del loop degli eventi dopo i primi n eventi
+//                         di ogni thread, le riporta per fase e termina con errore se ce ne sono
+//                         (esclusa la crescita per raddoppi degli istogrammi sparsi)
+//                         (solo nelle build di debug con -DPARTICLE_SIM_TRACK_ALLOCATIONS)
+//   --kstar-fit           sottrae il fondo della stessa carica e fitta il picco della K* a ogni
+//                         aggiornamento dei monitor e a fine simulazione, salvando i risultati nel file
+//   --kstar-mass-target <e> come --kstar-fit, e interrompe la simulazione quando l'errore sulla
+//                         massa della K* (coppie pione-kaone) scende sotto e GeV/c^2
+//
+// Modalità servizio (SimulationServer):
+//   --serve <socket> [--threads <n>]  resta in esecuzione e serve le richieste di simulazione ricevute
+//                         sul socket Unix indicato, con thread pool, tabelle delle specie e ROOT
+//                         inizializzati una sola volta; ogni richiesta accetta le opzioni sopra
+//                         (--threads ignorato) tranne quelle che scrivono file o aprono porte
+//                         (--monitor-file, --metrics-file, --metrics-port, --metrics-interval, --nd-file,
+//                         --store-file, --root-file) e riceve l'uscita e l'archivio degli istogrammi; il socket è
+//                         accessibile solo all'utente del servizio
+//   --client <socket> [--output <file>] <opzioni>  invia una richiesta al servizio, ne stampa l'uscita
+//                         e salva l'archivio ricevuto (default root/data/ParticleAnalysis.hst);
+//                         --client <socket> --shutdown chiude il servizio
+//
+// Confronto del posizionamento NUMA:
+//   --numa-benchmark <opzioni>  esegue la simulazione sui primi 1, 2 e 4 nodi NUMA (quelli riportati da Linux),
+//                         con un thread per CPU dei nodi, senza e con --numa, e stampa gli eventi al secondo
+//                         di ogni configurazione; le opzioni sono quelle della simulazione (--threads escluso),
+//                         senza scrivere il file ROOT
+//
+// Test di regressione (RegressionTest):
+//   --regression-test <riferimento> [--write-golden] [--tolerance] <opzioni>  controlla la cinematica
+//                         (energia, massa invariante, conservazione del quadrimpulso nei decadimenti, boost),
+//                         poi esegue una simulazione a semi fissi in 20 blocchi (--events 100 --threads 1 per
+//                         blocco, modificabili con le opzioni; il seme del blocco k è 12345 + 1000 k) e ne
+//                         confronta tutti gli istogrammi con il riferimento (RegressionReference): impronte
+//                         identiche bit per bit, o con --tolerance test t di Student sulle medie dei blocchi
+//                         di ogni bin grossolano (per --libm, più thread o la precisione float); --write-golden
+//                         scrive invece il riferimento. Il file ROOT non è scritto. Il riferimento incluso,
+//                         root/data/RegressionReference.txt, è per il confronto con --tolerance
+//                         Termina con errore se un controllo fallisce
+//
+// Verifica di equivalenza statistica (EquivalenceChecker):
+//   --equivalence <opzioni> [--candidate <opzioni candidato>]  esegue la simulazione di riferimento con le
+//                         opzioni comuni e quella candidata con le opzioni comuni, quelle dopo --candidate e
+//                         un altro seme, ne confronta tutti gli istogrammi con i test del chi quadro e di
+//                         Kolmogorov-Smirnov e i parametri del fit della K* (massa, larghezza, resa) e stampa
+//                         il resoconto, la velocità delle due configurazioni e l'esito. --seed tra le opzioni
+//                         comuni vale solo per il riferimento (default 12345), dopo --candidate solo per il
+//                         candidato (default 54321); i due semi devono essere diversi. Le simulazioni non
+//                         scrivono il file ROOT e gli archivi temporanei in root/data sono rimossi dopo il confronto
+//   --equivalence-stores <riferimento.hst> <candidato.hst>  confronta due archivi già scritti con --store-file,
+//                         per i modi scelti in compilazione (es. -DPARTICLE_SIM_FLOAT)
+//   --min-prob <p>        probabilità minima dei test sugli istogrammi (default 1e-6)
+//   --max-pull <k>        massima differenza dei parametri della K* in deviazioni standard (default 5)
 
-int main()
+// Eventi per blocco tra due aggiornamenti dei monitor e degli obiettivi di precisione
+static const long long kDefaultBatchSize = 10000;
+
+// Risultati di una simulazione usati dal confronto NUMA
+struct RunStatistics
+{
+  long long events; // Eventi generati
+  long long pairs;  // Coppie processate
+  double seconds;   // Tempo di generazione
+};
+
+// Metodo per leggere il modello di molteplicità dalla riga di comando
+// spec: fixed:N, poisson:MEDIA o nbd:MEDIA:K
+// model: modello da aggiornare
+// return: false se il formato non è valido
+static bool ParseMultiplicity(const char *spec, PrimaryModel &model)
+{
+  double mean = 0, k = 0;
+  if (std::sscanf(spec, "fixed:%lf", &mean) == 1 && mean >= 1)
+    model.multiplicity = kFixedMultiplicity;
+  else if (std::sscanf(spec, "poisson:%lf", &mean) == 1 && mean > 0)
+    model.multiplicity = kPoissonMultiplicity;
+  else if (std::sscanf(spec, "nbd:%lf:%lf", &mean, &k) == 2 && mean > 0 && k > 0)
+  {
+    model.multiplicity = kNegativeBinomialMultiplicity;
+    model.negativeBinomialK = k;
+  }
+  else
+    return false;
+  model.meanMultiplicity = mean;
+  return true;
+}
+
+// Metodo per compilare un insieme di tagli dalla riga di comando
+// cut: insieme di tagli da compilare
+// particleText, pairText: espressioni sulle particelle e sulle coppie (possono essere vuote)
+// err: stream per i messaggi di errore
+// return: false se un'espressione non è valida
+static bool CompileCut(SelectionCut &cut, const std::string &particleText, const std::string &pairText,
+                       std::ostream &err)
+{
+  std::string error;
+  if (!cut.particle.Compile(particleText, kParticleSelection, error))
+  {
+    err << "Invalid particle cut \"" << particleText << "\": " << error << std::endl;
+    return false;
+  }
+  if (!cut.pair.Compile(pairText, kPairSelection, error))
+  {
+    err << "Invalid pair cut \"" << pairText << "\": " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Metodo per leggere una variazione dei parametri dalla riga di comando
+// spec: nome:par=fattore[,par=fattore...], con par nome di una specie primaria o slope
+// names: nomi delle specie primarie
+// nTypes: numero di specie primarie
+// variation: variazione da riempire
+// return: false se il formato non è valido
+static bool ParseVariation(const std::string &spec, const char *const *names, int nTypes, ParameterVariation &variation)
+{
+  size_t colon = spec.find(':');
+  if (colon == std::string::npos || colon == 0 || colon + 1 == spec.size())
+    return false;
+  variation.name = spec.substr(0, colon);
+  size_t begin = colon + 1;
+  while (begin <= spec.size())
+  {
+    size_t end = spec.find(',', begin);
+    if (end == std::string::npos)
+      end = spec.size();
+    const std::string item = spec.substr(begin, end - begin);
+    const size_t equal = item.find('=');
+    if (equal == std::string::npos)
+      return false;
+    const std::string parameter = item.substr(0, equal);
+    char *last = 0;
+    const double factor = std::strtod(item.c_str() + equal + 1, &last);
+    if (*last != '\0' || !(factor > 0))
+      return false;
+    if (parameter == "slope")
+      variation.slopeScale = factor;
+    else
+    {
+      int k = 0;
+      while (k < nTypes && parameter != names[k])
+        ++k;
+      if (k == nTypes)
+        return false;
+      variation.abundanceScale[k] = factor;
+    }
+    begin = end + 1;
+  }
+  return true;
+}
+
+// Metodo per leggere il modello cinematico dalla riga di comando
+// spec: legacy, isotropic, thermal:T o boltzmann:T
+// model: modello da aggiornare
+// return: false se il formato non è valido
+static bool ParseKinematics(const char *spec, PrimaryModel &model)
+{
+  double temperature = 0;
+  if (std::strcmp(spec, "legacy") == 0)
+    model.kinematics = kLegacyKinematics;
+  else if (std::strcmp(spec, "isotropic") == 0)
+    model.kinematics = kIsotropicKinematics;
+  else if (std::sscanf(spec, "thermal:%lf", &temperature) == 1 && temperature > 0)
+    model.kinematics = kThermalKinematics;
+  else if (std::sscanf(spec, "boltzmann:%lf", &temperature) == 1 && temperature > 0)
+    model.kinematics = kBoltzmannKinematics;
+  else
+    return false;
+  if (temperature > 0)
+    model.temperature = temperature;
+  return true;
+}
+
+// Somma di un istogramma su tutti i thread di generazione
+// generators: generatori dei thread
+// index: indice dell'istogramma
+// return: nuovo istogramma non associato ad alcuna directory
+static TH1F *MergeHistogram(const std::vector<std::unique_ptr<EventGenerator>> &generators, int index)
+{
+  TH1F *merged = (TH1F *)generators[0]->GetHistograms()[index]->Clone();
+  merged->SetDirectory(0);
+  for (size_t w = 1; w < generators.size(); ++w)
+    merged->Add(generators[w]->GetHistograms()[index]);
+  return merged;
+}
+
+// Metodo per calcolare la memoria degli istogrammi di tutti i thread
+// generators: generatori dei thread (fermi)
+// return: byte occupati dai bin
+static long long GetHistogramBytes(const std::vector<std::unique_ptr<EventGenerator>> &generators)
+{
+  long long bytes = 0;
+  for (size_t w = 0; w < generators.size(); ++w)
+  {
+    for (int set = 0; set < generators[w]->GetNHistogramSets(); ++set)
+      bytes += generators[w]->GetHistograms(set).GetMemoryBytes();
+  }
+  return bytes;
+}
+
+// Metodo per preparare un'istantanea dei risultati durante la simulazione: gli istogrammi dei thread
+// sono sommati in copie di proprietà dell'istantanea, così che la generazione possa proseguire
+// mentre il thread di scrittura le salva
+// generators: generatori dei thread
+// correlations: include le correlazioni a due particelle
+// return: funzione che scrive le copie nella directory corrente di ROOT
+static std::function<void()> MergeSnapshot(const std::vector<std::unique_ptr<EventGenerator>> &generators,
+                                           bool correlations)
+{
+  std::vector<std::shared_ptr<HistogramSet>> sets;
+  for (int set = 0; set < generators[0]->GetNHistogramSets(); ++set)
+  {
+    const HistogramSet &first = generators[0]->GetHistograms(set);
+    std::shared_ptr<HistogramSet> merged(new HistogramSet(first.GetSelection(), first.IsWeighted()));
+    for (size_t w = 0; w < generators.size(); ++w)
+      merged->Add(generators[w]->GetHistograms(set));
+    sets.push_back(merged);
+  }
+  std::shared_ptr<PairCorrelations> pairCorrelations;
+  if (correlations)
+  {
+    pairCorrelations.reset(new PairCorrelations(generators[0]->GetCorrelations()));
+    for (size_t w = 1; w < generators.size(); ++w)
+      pairCorrelations->Add(generators[w]->GetCorrelations());
+  }
+  return [sets, pairCorrelations]()
+  {
+    for (size_t set = 0; set < sets.size(); ++set)
+      sets[set]->Write();
+    if (pairCorrelations)
+      pairCorrelations->Write();
+  };
+}
+
+// Metodo per definire i tipi di particelle e i canali di decadimento, una sola volta per processo
+static void InitParticleTypes()
 {
-  // Inizializzazione del generatore di numeri casuali e dei tipi di particelle con proprietà fisiche
-  gRandom->SetSeed(12345);
+  // Inizializzazione dei tipi di particelle con proprietà fisiche
   Particle::AddParticleType("Pion+", 0.13957, 1);
   Particle::AddParticleType("Pion-", 0.13957, -1);
   Particle::AddParticleType("Kaon+", 0.49367, 1);
@@ -27,240 +337,998 @@ int main()
   Particle::AddParticleType("Proton-", 0.93827, -1);
   Particle::AddParticleType("K*", 0.89166, 0, 0.050);
 
-  // Creazione degli istogrammi per le proprietà delle particelle
-  TH1F *hParticleTypes = new TH1F("hParticleTypes", "Particle Types", 7, 0, 7);
-  TH1F *hAzimuthalAngle = new TH1F("hAzimuthalAngle", "Azimuthal Angle Distribution", 100, 0, 2 * M_PI);
-  TH1F *hPolarAngle = new TH1F("hPolarAngle", "Polar Angle Distribution", 100, 0, M_PI);
-  TH1F *hMomentum = new TH1F("hMomentum", "Momentum Distribution", 100, 0, 5);
-  TH1F *hTransverseMomentum = new TH1F("hTransverseMomentum", "Transverse Momentum Distribution", 100, 0, 5);
-  TH1F *hEnergy = new TH1F("hEnergy", "Energy Distribution", 100, 0, 5);
-
-  // Istogrammi per le masse invarianti
-  TH1F *hInvariantMass = new TH1F("hInvariantMass", "Invariant Mass Distribution (All Pairs)", 1000, 0, 3);
-  TH1F *hInvMassOppositeCharge = new TH1F("hInvMassOppositeCharge", "Invariant Mass Opposite Charge", 1000, 0, 3);
-  TH1F *hInvMassSameCharge = new TH1F("hInvMassSameCharge", "Invariant Mass Same Charge", 1000, 0, 3);
-  TH1F *hInvMassPionKaon = new TH1F("hInvMassPionKaon", "Invariant Mass Pion-Kaon (Opposite Charge)", 1000, 0, 3);
-  TH1F *hInvMassPionKaonSC = new TH1F("hInvMassPionKaonSC", "Invariant Mass Pion-Kaon (Same Charge)", 1000, 0, 3);
-  TH1F *hInvMassDecayProducts = new TH1F("hInvMassDecayProducts", "Invariant Mass Decay Products (K* daughters)", 1000, 0, 3);
-
-  // Configurazione degli assi per gli istogrammi
-  hParticleTypes->GetXaxis()->SetTitle("Particle Type Index");
-  hParticleTypes->GetYaxis()->SetTitle("Counts");
-
-  hAzimuthalAngle->GetXaxis()->SetTitle("Azimuthal Angle (rad)");
-  hAzimuthalAngle->GetYaxis()->SetTitle("Counts");
-
-  hPolarAngle->GetXaxis()->SetTitle("Polar Angle (rad)");
-  hPolarAngle->GetYaxis()->SetTitle("Counts");
-
-  hMomentum->GetXaxis()->SetTitle("Momentum (GeV/c)");
-  hMomentum->GetYaxis()->SetTitle("Counts");
-
-  hTransverseMomentum->GetXaxis()->SetTitle("Transverse Momentum (GeV/c)");
-  hTransverseMomentum->GetYaxis()->SetTitle("Counts");
-
-  hEnergy->GetXaxis()->SetTitle("Energy (GeV)");
-  hEnergy->GetYaxis()->SetTitle("Counts");
-
-  hInvariantMass->GetXaxis()->SetTitle("Invariant Mass (GeV/c^{2})");
-  hInvariantMass->GetYaxis()->SetTitle("Counts");
-
-  hInvMassOppositeCharge->GetXaxis()->SetTitle("Invariant Mass (GeV/c^{2})");
-  hInvMassOppositeCharge->GetYaxis()->SetTitle("Counts");
-
-  hInvMassSameCharge->GetXaxis()->SetTitle("Invariant Mass (GeV/c^{2})");
-  hInvMassSameCharge->GetYaxis()->SetTitle("Counts");
-
-  hInvMassPionKaon->GetXaxis()->SetTitle("Invariant Mass (GeV/c^{2})");
-  hInvMassPionKaon->GetYaxis()->SetTitle("Counts");
-
-  hInvMassPionKaonSC->GetXaxis()->SetTitle("Invariant Mass (GeV/c^{2})");
-  hInvMassPionKaonSC->GetYaxis()->SetTitle("Counts");
-
-  hInvMassDecayProducts->GetXaxis()->SetTitle("Invariant Mass (GeV/c^{2})");
-  hInvMassDecayProducts->GetYaxis()->SetTitle("Counts");
-
-  // Abilitazione della somma dei pesi al quadrato per gli istogrammi di massa invariante
-  hInvariantMass->Sumw2();
-  hInvMassOppositeCharge->Sumw2();
-  hInvMassSameCharge->Sumw2();
-  hInvMassPionKaon->Sumw2();
-  hInvMassPionKaonSC->Sumw2();
-  hInvMassDecayProducts->Sumw2();
-
-  // Array per memorizzare tutte le particelle generate in un evento.
-  // La dimensione è 120 per consentire l'aggiunta di particelle derivate
-  // dai decadimenti delle risonanze, che possono aggiungere fino a 20 particelle extra.
-  Particle EventParticles[120];
-
-  // Generazione di 100.000 eventi di collisione, ciascuno contenente 100 particelle iniziali.
-  for (int event = 0; event < 100000; ++event)
-  {
-    // Conta il numero di particelle totali nell'evento, inizialmente 100.
-    // Questo contatore aumenta con l'aggiunta di prodotti di decadimento.
-    int particleCount = 100;
-
-    // Loop per generare le 100 particelle iniziali in ogni evento.
-    for (int i = 0; i < 100; ++i)
-    {
-      // Generazione casuale di angoli e quantità di moto:
-      // - `phi`: angolo azimutale distribuito uniformemente tra 0 e 2π.
-      // - `theta`: angolo polare distribuito uniformemente tra 0 e π.
-      // - `momentum`: modulo della quantità di moto, distribuito esponenzialmente.
-      double phi = gRandom->Uniform(0, 2 * M_PI);
-      double theta = gRandom->Uniform(0, M_PI);
-      double momentum = gRandom->Exp(1);
-
-      // Conversione delle coordinate angolari in coordinate cartesiane (Px, Py, Pz).
-      double px = momentum * sin(theta) * cos(phi);
-      double py = momentum * sin(theta) * sin(phi);
-      double pz = momentum * cos(theta);
-
-      // Determinazione casuale del tipo di particella in base a probabilità prefissate.
-      double randType = gRandom->Rndm();
-      if (randType < 0.4)
-        EventParticles[i].SetParticleTypeIndex("Pion+"); // 40% probabilità
-      else if (randType < 0.8)
-        EventParticles[i].SetParticleTypeIndex("Pion-"); // 40% probabilità
-      else if (randType < 0.85)
-        EventParticles[i].SetParticleTypeIndex("Kaon+"); // 5% probabilità
-      else if (randType < 0.9)
-        EventParticles[i].SetParticleTypeIndex("Kaon-"); // 5% probabilità
-      else if (randType < 0.945)
-        EventParticles[i].SetParticleTypeIndex("Proton+"); // 4.5% probabilità
-      else if (randType < 0.99)
-        EventParticles[i].SetParticleTypeIndex("Proton-"); // 4.5% probabilità
+  // Canali di decadimento delle risonanze con i relativi rapporti di decadimento
+  Particle::AddDecayChannel("K*", 0.5, "Pion+", "Kaon-");
+  Particle::AddDecayChannel("K*", 0.5, "Pion-", "Kaon+");
+}
+
+// Metodo per eseguire una simulazione
+// argc, argv: opzioni della simulazione, come sulla riga di comando (argv[0] è ignorato)
+// sharedPool: thread pool di generazione (nullo: ne è creato uno con --threads)
+// out, err: stream per i messaggi e per gli errori
+// statistics: risultati della generazione da riempire (nullo: nessuno)
+// return: codice di uscita (0: successo, 1: errore, 2: simulazione interrotta dai monitor)
+static int RunSimulation(int argc, char **argv, ThreadPool *sharedPool, std::ostream &out, std::ostream &err,
+                         RunStatistics *statistics = 0)
+{
+  // Lettura delle opzioni da linea di comando; le impostazioni globali tornano ai valori di default,
+  // perché in modalità servizio più simulazioni si susseguono nello stesso processo
+  FastMath::SetEnabled(true);
+  bool validatePrecision = false;
+  int nThreads = 1;
+  bool numa = false;
+  int numaNodes = 0;
+  long long nEvents = 100000;
+  unsigned int seed = 12345;
+  long long monitorInterval = kDefaultBatchSize;
+  PrecisionTargets targets;
+  const char *monitorPath = 0;
+  const char *metricsPath = 0;
+  int metricsPort = -1;
+  double metricsInterval = 1;
+  const char *ndPath = 0;
+  const char *storePath = 0;
+  const char *rootPath = "root/data/ParticleAnalysis.root";
+  int compression = ROOT::RCompressionSetting::EDefaults::kUseCompiledDefault;
+  bool checkpoint = false;
+  bool abortOnMonitor = false;
+  long long allocationWarmUp = -1;
+  bool kStarFit = false;
+  double kStarMassTarget = 0;
+  LineShapeKind kStarLineShape = kGaussian;
+  PrimaryModel primaryModel;
+  std::string particleCut, pairCut;
+  std::vector<std::string> selectionSpecs;
+  std::vector<std::string> variationSpecs;
+  bool correlations = false;
+  int mixingStride = 8;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--validate-precision") == 0)
+      validatePrecision = true;
+    else if (std::strcmp(argv[i], "--libm") == 0)
+      FastMath::SetEnabled(false);
+    else if (std::strcmp(argv[i], "--events") == 0 && i + 1 < argc)
+      nEvents = std::atoll(argv[++i]);
+    else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      seed = (unsigned int)std::strtoul(argv[++i], 0, 10);
+    else if (std::strcmp(argv[i], "--multiplicity") == 0 && i + 1 < argc)
+    {
+      if (!ParseMultiplicity(argv[++i], primaryModel))
+      {
+        err << "Invalid multiplicity model: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--kinematics") == 0 && i + 1 < argc)
+    {
+      if (!ParseKinematics(argv[++i], primaryModel))
+      {
+        err << "Invalid kinematics model: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--max-rapidity") == 0 && i + 1 < argc)
+    {
+      primaryModel.maxRapidity = std::atof(argv[++i]);
+      if (!(primaryModel.maxRapidity > 0))
+      {
+        err << "Invalid maximum rapidity: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--cut") == 0 && i + 1 < argc)
+      particleCut = argv[++i];
+    else if (std::strcmp(argv[i], "--pair-cut") == 0 && i + 1 < argc)
+      pairCut = argv[++i];
+    else if (std::strcmp(argv[i], "--selection") == 0 && i + 1 < argc)
+      selectionSpecs.push_back(argv[++i]);
+    else if (std::strcmp(argv[i], "--correlations") == 0)
+      correlations = true;
+    else if (std::strcmp(argv[i], "--mixing-stride") == 0 && i + 1 < argc)
+    {
+      mixingStride = std::atoi(argv[++i]);
+      if (mixingStride < 1)
+      {
+        err << "Invalid mixing stride: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--variation") == 0 && i + 1 < argc)
+      variationSpecs.push_back(argv[++i]);
+    else if (std::strcmp(argv[i], "--target") == 0 && i + 1 < argc)
+    {
+      if (!targets.Parse(argv[++i]))
+      {
+        err << "Invalid precision target: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      nThreads = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--numa") == 0)
+      numa = true;
+    else if (std::strcmp(argv[i], "--numa-nodes") == 0 && i + 1 < argc)
+      numaNodes = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--monitor-interval") == 0 && i + 1 < argc)
+      monitorInterval = std::atoll(argv[++i]);
+    else if (std::strcmp(argv[i], "--monitor-file") == 0 && i + 1 < argc)
+      monitorPath = argv[++i];
+    else if (std::strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc)
+      metricsPath = argv[++i];
+    else if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+    {
+      metricsPort = std::atoi(argv[++i]);
+      if (metricsPort < 0 || metricsPort > 65535)
+      {
+        err << "Invalid metrics port: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc)
+    {
+      metricsInterval = std::atof(argv[++i]);
+      if (!(metricsInterval > 0))
+      {
+        err << "Invalid metrics interval: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--nd-file") == 0 && i + 1 < argc)
+      ndPath = argv[++i];
+    else if (std::strcmp(argv[i], "--store-file") == 0 && i + 1 < argc)
+      storePath = argv[++i];
+    else if (std::strcmp(argv[i], "--root-file") == 0 && i + 1 < argc)
+      rootPath = argv[++i];
+    else if (std::strcmp(argv[i], "--no-root-file") == 0)
+      rootPath = 0;
+    else if (std::strcmp(argv[i], "--compression") == 0 && i + 1 < argc)
+    {
+      if (!OutputWriter::ParseCompression(argv[++i], compression))
+      {
+        err << "Invalid compression (expected none, zlib, lz4 or zstd[:level]): " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--checkpoint") == 0)
+      checkpoint = true;
+    else if (std::strcmp(argv[i], "--abort-on-monitor") == 0)
+      abortOnMonitor = true;
+    else if (std::strcmp(argv[i], "--check-allocations") == 0 && i + 1 < argc)
+    {
+      allocationWarmUp = std::atoll(argv[++i]);
+      if (!AllocationTracker::kEnabled || allocationWarmUp < 0)
+      {
+        AllocationTracker::Print(err);
+        err << "Invalid --check-allocations: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--kstar-fit") == 0)
+      kStarFit = true;
+    else if (std::strcmp(argv[i], "--kstar-mass-target") == 0 && i + 1 < argc)
+    {
+      kStarFit = true;
+      kStarMassTarget = std::atof(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--line-shape") == 0 && i + 1 < argc)
+    {
+      ++i;
+      if (std::strcmp(argv[i], "gauss") == 0)
+        kStarLineShape = kGaussian;
+      else if (std::strcmp(argv[i], "bw") == 0)
+        kStarLineShape = kBreitWigner;
+      else if (std::strcmp(argv[i], "rbw") == 0)
+        kStarLineShape = kRelativisticBreitWigner;
       else
       {
-        // Caso in cui si genera una risonanza K* (1% probabilità).
-        EventParticles[i].SetParticleTypeIndex("K*");
-        EventParticles[i].SetPulse(px, py, pz);
-
-        // Creazione delle particelle figlie (pione e kaone) per il decadimento della risonanza.
-        Particle pion;
-        Particle kaon;
-
-        // Assegnazione casuale della carica al pione e al kaone.
-        if (gRandom->Rndm() < 0.5)
-        {
-          pion.SetParticleTypeIndex("Pion+");
-          kaon.SetParticleTypeIndex("Kaon-");
-        }
-        else
-        {
-          pion.SetParticleTypeIndex("Pion-");
-          kaon.SetParticleTypeIndex("Kaon+");
-        }
-
-        // Esecuzione del decadimento della K* in pion e kaon.
-        // Se il decadimento è riuscito, i prodotti sono aggiunti all'array di particelle.
-        if (EventParticles[i].Decay2Body(pion, kaon) == 0)
-        {
-          EventParticles[particleCount++] = pion;
-          EventParticles[particleCount++] = kaon;
-        }
-
-        // Passa alla particella successiva poiché la risonanza è già decaduta.
-        // continue;
+        err << "Unknown line shape: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else
+    {
+      err << "Unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  // Forma di riga della K* scelta per questa simulazione
+  Particle::SetLineShape("K*", kStarLineShape);
+
+  // Specie primarie e abbondanze con cui vengono generate
+  static const char *kPrimaryNames[] = {"Pion+", "Pion-", "Kaon+", "Kaon-", "Proton+", "Proton-", "K*"};
+  static const double kPrimaryAbundances[] = {0.40, 0.40, 0.05, 0.05, 0.045, 0.045, 0.01};
+  GeneratorConfig config;
+  config.nPrimaryTypes = sizeof(kPrimaryAbundances) / sizeof(kPrimaryAbundances[0]);
+  for (int i = 0; i < config.nPrimaryTypes; ++i)
+  {
+    config.primaryType[i] = Particle::FindParticleType(kPrimaryNames[i]);
+    config.abundance[i] = kPrimaryAbundances[i];
+  }
+  config.validatePrecision = validatePrecision;
+  config.primaries = primaryModel;
+  config.correlations = correlations;
+  config.mixingStride = mixingStride;
+  config.allocationWarmUp = allocationWarmUp;
+  if (allocationWarmUp >= 0)
+    AllocationTracker::Reset();
+  long long diagnosticsStart[kNDiagnosticKinds];
+  Diagnostics::GetTotals(diagnosticsStart);
+
+  // Insiemi di tagli: il primo per gli istogrammi principali, poi quelli con nome.
+  // Le espressioni sono compilate qui una sola volta e copiate in ogni generatore.
+  config.selections.resize(1 + selectionSpecs.size());
+  if (!CompileCut(config.selections[0], particleCut, pairCut, err))
+    return 1;
+  for (size_t k = 0; k < selectionSpecs.size(); ++k)
+  {
+    const std::string &spec = selectionSpecs[k];
+    size_t colon = spec.find(':');
+    size_t pairColon = colon == std::string::npos ? colon : spec.find(':', colon + 1);
+    SelectionCut &cut = config.selections[k + 1];
+    cut.name = spec.substr(0, colon);
+    if (colon == std::string::npos || cut.name.empty())
+    {
+      err << "Invalid selection (expected name:cut[:pair cut]): " << spec << std::endl;
+      return 1;
+    }
+    std::string pairText = pairColon == std::string::npos ? "" : spec.substr(pairColon + 1);
+    if (!CompileCut(cut, spec.substr(colon + 1, pairColon == std::string::npos ? std::string::npos : pairColon - colon - 1), pairText, err))
+      return 1;
+  }
+
+  // Variazioni dei parametri delle primarie, riempite come insiemi di istogrammi pesati.
+  // I nomi devono essere distinti tra loro e da quelli degli insiemi di tagli, perché diventano suffissi degli istogrammi.
+  config.variations.resize(variationSpecs.size());
+  for (size_t v = 0; v < variationSpecs.size(); ++v)
+  {
+    ParameterVariation &variation = config.variations[v];
+    if (!ParseVariation(variationSpecs[v], kPrimaryNames, config.nPrimaryTypes, variation))
+    {
+      err << "Invalid variation (expected name:parameter=factor[,...]): " << variationSpecs[v] << std::endl;
+      return 1;
+    }
+    for (size_t k = 1; k < config.selections.size(); ++k)
+    {
+      if (config.selections[k].name == variation.name)
+      {
+        err << "Variation name already used by a selection: " << variation.name << std::endl;
+        return 1;
+      }
+    }
+    for (size_t k = 0; k < v; ++k)
+    {
+      if (config.variations[k].name == variation.name)
+      {
+        err << "Variation name used twice: " << variation.name << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // Un generatore per thread, ciascuno con il proprio seme, istogrammi e accumulatori.
+  // Gli istogrammi dei thread non sono associati a directory di ROOT e vengono sommati alla fine.
+  // Il file di uscita è scritto da un thread dedicato anche con un solo thread di generazione.
+  // Con --numa i thread sono fissati alle CPU dei nodi scelti (thread w sul nodo w % nodi): ogni nodo
+  // riceve una copia delle tabelle di sola lettura, creata dal suo primo thread, e ogni generatore
+  // è creato dal proprio thread, così che buffer dell'evento e istogrammi siano sul nodo locale.
+  std::unique_ptr<ThreadPool> ownPool;
+  int nNodes = 1;
+  if (numa)
+  {
+    if (sharedPool)
+    {
+      err << "--numa is not available in service mode" << std::endl;
+      return 1;
+    }
+    NumaTopology topology;
+    if (numaNodes > 0 && !topology.Restrict(numaNodes))
+    {
+      err << "Invalid --numa-nodes " << numaNodes << ": " << topology.GetNNodes() << " NUMA nodes available"
+          << std::endl;
+      return 1;
+    }
+    if (nThreads <= 0)
+      nThreads = topology.GetNCpus();
+    topology.Print(out);
+    ownPool.reset(new ThreadPool(topology.AssignCpus(nThreads)));
+    nNodes = std::min(topology.GetNNodes(), nThreads);
+  }
+  else if (!sharedPool)
+    ownPool.reset(new ThreadPool(nThreads));
+  if (!sharedPool)
+    sharedPool = ownPool.get();
+  ThreadPool &pool = *sharedPool;
+  const int nWorkers = pool.GetNThreads();
+  std::vector<std::unique_ptr<EventGenerator>> generators(nWorkers); // Distrutti a ogni uscita, anche in caso di errore
+  std::vector<std::unique_ptr<NodeTables, NodeTables::Deleter>> nodeTables(numa ? nNodes : 0);
+  for (int node = 0; node < (int)nodeTables.size(); ++node)
+    pool.SubmitTo(node, [&nodeTables, node]() { nodeTables[node].reset(NodeTables::Create()); });
+  pool.Wait();
+  for (int w = 0; w < nWorkers; ++w)
+  {
+    if (numa)
+    {
+      const NodeTables *tables = nodeTables[w % nNodes].get();
+      pool.SubmitTo(w, [&generators, &config, seed, w, tables]()
+                    { generators[w].reset(new EventGenerator(config, seed + w, &tables->species, &tables->decays)); });
+    }
+    else
+      generators[w].reset(new EventGenerator(config, seed + w));
+  }
+  pool.Wait();
+
+  // Monitor delle distribuzioni delle particelle primarie; la media della quantità di moto
+  // è controllata solo per i modelli esponenziali (media 1 GeV/c)
+  PrimaryGenerator primaryGenerator(primaryModel, config.primaryType, config.abundance, config.nPrimaryTypes);
+  RunMonitor monitor(config.primaryType, config.abundance, config.nPrimaryTypes,
+                     primaryGenerator.GetExpectedMeanMomentum());
+  SignalExtractor signalExtractor;
+  std::unique_ptr<OutputWriter> writer;
+  if (rootPath)
+    writer.reset(new OutputWriter(rootPath, compression));
+  std::ofstream monitorFile;
+  if (monitorPath)
+  {
+    monitorFile.open(monitorPath);
+    if (!monitorFile)
+    {
+      err << "Cannot open monitor file: " << monitorPath << std::endl;
+      return 1;
+    }
+  }
+
+  // Metriche della simulazione in corso, lette dai contatori dei generatori da un thread dedicato
+  std::vector<const WorkerMetrics *> workerMetrics;
+  for (int w = 0; w < nWorkers; ++w)
+    workerMetrics.push_back(&generators[w]->GetMetrics());
+  RunMetrics metrics(workerMetrics, nEvents, diagnosticsStart);
+  if (metricsPath || metricsPort >= 0)
+  {
+    if (!metrics.Start(metricsPath, metricsPort, metricsInterval, err))
+    {
+      return 1;
+    }
+    if (metrics.GetPort() >= 0)
+      out << "Metrics published on http://127.0.0.1:" << metrics.GetPort() << "/metrics" << std::endl;
+  }
+
+  // Generazione di nEvents eventi di collisione (default 100.000), ciascuno contenente 100 particelle
+  // iniziali o un numero variabile secondo il modello di molteplicità. Gli eventi sono prodotti a blocchi, divisi tra i thread; dopo ogni blocco gli accumulatori
+  // dei thread vengono uniti, i monitor aggiornati e gli obiettivi di precisione verificati.
+  // Con obiettivi di precisione nEvents è il numero massimo di eventi.
+  long long batchSize = nEvents;
+  if (monitorInterval > 0)
+    batchSize = monitorInterval;
+  else if (targets.IsEnabled() || kStarMassTarget > 0)
+    batchSize = kDefaultBatchSize;
+  // Memoria degli istogrammi di tutti i thread, aggiornata dopo ogni blocco perché le tabelle sparse
+  // crescono con le celle riempite
+  metrics.SetHistogramBytes(GetHistogramBytes(generators));
+  long long generated = 0;
+  bool aborted = false;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while (generated < nEvents)
+  {
+    long long block = nEvents - generated;
+    if (block > batchSize)
+      block = batchSize;
+    for (int w = 0; w < nWorkers; ++w)
+    {
+      int share = (int)(block / nWorkers + (w < block % nWorkers ? 1 : 0));
+      EventGenerator *generator = generators[w].get();
+      if (numa)
+        pool.SubmitTo(w, [generator, share]() { generator->Generate(share); });
+      else
+        pool.Submit([generator, share]() { generator->Generate(share); });
+    }
+    pool.Wait();
+    generated += block;
+    metrics.SetHistogramBytes(GetHistogramBytes(generators));
+
+    MonitorAccumulator merged;
+    for (int w = 0; w < nWorkers; ++w)
+      merged.Merge(generators[w]->GetMonitor());
+    monitor.Update(merged, generated);
+    if (monitorInterval > 0)
+    {
+      monitor.Print(out);
+      if (monitorFile.is_open())
+        monitor.Print(monitorFile);
+    }
+    if (abortOnMonitor && !monitor.IsWithinTolerance())
+    {
+      aborted = true;
+      break;
+    }
+
+    // Istantanea dei risultati parziali, scritta in background mentre prosegue la generazione
+    if (writer && checkpoint && generated < nEvents)
+      writer->Submit(MergeSnapshot(generators, correlations), generated);
+    if (writer)
+      writer->PrintReports(out);
+
+    // Estrazione periodica del segnale della K* dal campione pione-kaone, usata anche
+    // dagli obiettivi di precisione sulla resa
+    SignalFit fit;
+    const bool fitSignal = (kStarFit && generated < nEvents) || targets.NeedsSignalFit();
+    if (fitSignal)
+    {
+      TH1F *pionKaon = MergeHistogram(generators, kHInvMassPionKaon);
+      TH1F *pionKaonSC = MergeHistogram(generators, kHInvMassPionKaonSC);
+      TH1F *subtracted = signalExtractor.Subtract(pionKaon, pionKaonSC, "hInvMassPionKaonSubtracted", "");
+      fit = signalExtractor.Fit(subtracted);
+      SignalExtractor::Print(out, ("pion-kaon, " + std::to_string(generated) + " events").c_str(), fit);
+      delete subtracted;
+      delete pionKaonSC;
+      delete pionKaon;
+    }
+
+    // Arresto quando l'errore sulla massa della K* raggiunge l'obiettivo
+    if (kStarMassTarget > 0 && fitSignal && fit.valid && fit.massError <= kStarMassTarget)
+    {
+      out << "K* mass uncertainty target reached after " << generated << " events" << std::endl;
+      break;
+    }
+
+    // Arresto quando tutti gli errori relativi richiesti sono raggiunti
+    if (targets.IsEnabled())
+    {
+      targets.Update(merged, config.primaryType, config.nPrimaryTypes, fitSignal ? &fit : 0);
+      targets.Print(out);
+      if (targets.IsMet())
+        break;
+    }
+  }
+
+  // Ultimo aggiornamento delle metriche con i totali della generazione
+  metrics.Stop();
+
+  // Tempo di generazione e numero di particelle e coppie processate, per confrontare
+  // il costo del kernel delle coppie al variare della molteplicità
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  long long nParticles = 0, nPairs = 0;
+  for (int w = 0; w < nWorkers; ++w)
+  {
+    nParticles += generators[w]->GetNParticles();
+    nPairs += generators[w]->GetNPairs();
+  }
+  out << "Generated " << generated << " events (" << nParticles << " particles, " << nPairs
+            << " pairs) in " << elapsed << " s";
+  if (elapsed > 0)
+    out << ", " << nPairs / elapsed << " pairs/s";
+  out << std::endl;
+  if (statistics)
+  {
+    statistics->events = generated;
+    statistics->pairs = nPairs;
+    statistics->seconds = elapsed;
+  }
+
+  // Totali degli errori segnalati dal nucleo (decadimenti falliti o scartati, specie non valide)
+  Diagnostics::Flush();
+  Diagnostics::PrintSummary(out, diagnosticsStart);
+
+  if (targets.IsEnabled())
+  {
+    out << (targets.IsMet() ? "Precision targets reached after " : "Precision targets not reached within ")
+              << generated << " events" << std::endl;
+  }
+
+  // Somma degli istogrammi (di tutti gli insiemi di tagli e delle variazioni), dei validatori e delle correlazioni
+  // dei thread nel primo generatore. Con --numa gli istogrammi sono sommati prima nel primo thread di ogni nodo,
+  // dal thread stesso e quindi senza traffico tra i nodi, poi tra i primi thread dei nodi.
+  HistogramSet &histograms = generators[0]->GetHistograms();
+  PrecisionValidator precisionValidator = generators[0]->GetPrecisionValidator();
+  PairCorrelations pairCorrelations = generators[0]->GetCorrelations();
+  const int nSets = generators[0]->GetNHistogramSets();
+  for (int node = 0; node < nNodes; ++node)
+  {
+    pool.SubmitTo(node, [&generators, node, nNodes, nWorkers, nSets]()
+                  {
+                    for (int w = node + nNodes; w < nWorkers; w += nNodes)
+                    {
+                      for (int set = 0; set < nSets; ++set)
+                        generators[node]->GetHistograms(set).Add(generators[w]->GetHistograms(set));
+                    }
+                  });
+  }
+  pool.Wait();
+  for (int w = 1; w < nWorkers; ++w)
+  {
+    if (w < nNodes)
+    {
+      for (int set = 0; set < nSets; ++set)
+        generators[0]->GetHistograms(set).Add(generators[w]->GetHistograms(set));
+    }
+    precisionValidator.Merge(generators[w]->GetPrecisionValidator());
+    pairCorrelations.Add(generators[w]->GetCorrelations());
+  }
+
+  // Peso medio e numero effettivo (Σw)^2 / Σw^2 delle primarie di ogni variazione: un numero effettivo
+  // molto minore delle primarie generate indica che la variazione è troppo lontana dal campione nominale
+  long long nPrimaries = 0;
+  for (int w = 0; w < nWorkers; ++w)
+    nPrimaries += generators[w]->GetNPrimaries();
+  for (int v = 0; v < (int)config.variations.size(); ++v)
+  {
+    double sumWeights = 0, sumWeights2 = 0;
+    for (int w = 0; w < nWorkers; ++w)
+    {
+      sumWeights += generators[w]->GetSumWeights(v);
+      sumWeights2 += generators[w]->GetSumWeights2(v);
+    }
+    out << "Variation " << config.variations[v].name << ": mean weight " << (nPrimaries > 0 ? sumWeights / nPrimaries : 0)
+              << ", effective primaries " << (sumWeights2 > 0 ? sumWeights * sumWeights / sumWeights2 : 0) << " of "
+              << nPrimaries << std::endl;
+  }
+
+  // Estrazione finale del segnale della K*: tutte le coppie e coppie pione-kaone
+  TH1F *subtractedAll = 0;
+  TH1F *subtractedPionKaon = 0;
+  SignalFit fitAll, fitPionKaon;
+  if (kStarFit)
+  {
+    subtractedAll = signalExtractor.Subtract(histograms[kHInvMassOppositeCharge], histograms[kHInvMassSameCharge],
+                                             "hInvMassSubtracted", "Invariant Mass (Opposite Charge - Same Charge)");
+    subtractedPionKaon = signalExtractor.Subtract(histograms[kHInvMassPionKaon], histograms[kHInvMassPionKaonSC],
+                                                  "hInvMassPionKaonSubtracted", "Invariant Mass Pion-Kaon (Opposite Charge - Same Charge)");
+    fitAll = signalExtractor.Fit(subtractedAll);
+    fitPionKaon = signalExtractor.Fit(subtractedPionKaon);
+    SignalExtractor::Print(out, "all pairs", fitAll);
+    SignalExtractor::Print(out, "pion-kaon", fitPionKaon);
+  }
+
+  // Salvataggio degli istogrammi su file ROOT per analisi, insieme ai risultati del segnale della K*.
+  // L'istantanea finale sostituisce quella parziale eventualmente in attesa; gli oggetti restano
+  // validi fino alla fine della scrittura.
+  bool written = true;
+  if (writer)
+  {
+    EventGenerator *first = generators[0].get();
+    writer->Submit([first, nSets, correlations, &pairCorrelations, kStarFit, subtractedAll, subtractedPionKaon,
+                    &fitAll, &fitPionKaon]()
+                   {
+                     for (int set = 0; set < nSets; ++set)
+                       first->GetHistograms(set).Write();
+                     if (correlations)
+                       pairCorrelations.Write();
+                     if (kStarFit)
+                     {
+                       subtractedAll->Write();
+                       subtractedPionKaon->Write();
+                       SignalExtractor::Write(fitAll, "hKStarSignal");
+                       SignalExtractor::Write(fitPionKaon, "hKStarSignalPionKaon");
+                     }
+                   },
+                   generated);
+    written = writer->Wait();
+    writer->PrintReports(out);
+  }
+  delete subtractedAll;
+  delete subtractedPionKaon;
+  if (!written)
+  {
+    err << "Cannot write " << rootPath << std::endl;
+    return 1;
+  }
+  if (rootPath)
+    out << "Histograms saved to " << rootPath << std::endl;
+
+  // Salvataggio degli istogrammi a più dimensioni nel formato nativo, senza passare da ROOT
+  if (ndPath)
+  {
+    std::ofstream ndFile(ndPath, std::ios::binary);
+    for (int set = 0; set < nSets; ++set)
+      generators[0]->GetHistograms(set).WriteNative(ndFile);
+    if (!ndFile)
+    {
+      err << "Cannot write " << ndPath << std::endl;
+      return 1;
+    }
+    out << "Multi-dimensional histograms saved to " << ndPath << std::endl;
+  }
+
+  // Salvataggio di tutti gli istogrammi nell'archivio nativo, letto dall'analisi senza ROOT I/O
+  if (storePath)
+  {
+    HistogramStoreWriter store;
+    for (int set = 0; set < nSets; ++set)
+      generators[0]->GetHistograms(set).WriteStore(store);
+    if (!store.Write(storePath))
+    {
+      err << "Cannot write " << storePath << std::endl;
+      return 1;
+    }
+    out << "Histogram store saved to " << storePath << std::endl;
+  }
+
+  if (validatePrecision)
+  {
+    precisionValidator.Print();
+  }
+
+  if (aborted)
+  {
+    err << "Run aborted after " << generated << " events: monitor out of tolerance" << std::endl;
+    return 2;
+  }
+
+  // Verifica che il loop degli eventi non abbia allocato memoria dopo il riscaldamento
+  if (allocationWarmUp >= 0)
+  {
+    // La crescita delle tabelle sparse è per raddoppi, quindi limitata, ed è solo riportata
+    AllocationTracker::Print(out);
+    if (AllocationTracker::GetTotal() - AllocationTracker::GetCount(kAllocHistogramGrowth) > 0)
+    {
+      err << "Allocation check failed: the event loop allocated after " << allocationWarmUp
+                << " warm-up events" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+// Opzioni accettate nelle richieste al servizio, con il numero di argomenti. Le opzioni che scrivono
+// file scelti dal client (--monitor-file, --metrics-file, --nd-file, --store-file, --root-file) o aprono
+// porte (--metrics-port) non sono accettate: l'archivio degli istogrammi è già restituito al client
+// e il file ROOT non è scritto.
+struct RequestOption
+{
+  const char *name;
+  int nArguments;
+};
+
+static const RequestOption kRequestOptions[] = {
+    {"--validate-precision", 0}, {"--line-shape", 1},   {"--libm", 0},          {"--events", 1},
+    {"--seed", 1},               {"--multiplicity", 1}, {"--kinematics", 1},    {"--max-rapidity", 1},
+    {"--cut", 1},                {"--pair-cut", 1},     {"--selection", 1},     {"--correlations", 0},
+    {"--mixing-stride", 1},      {"--variation", 1},    {"--target", 1},        {"--threads", 1},
+    {"--monitor-interval", 1},   {"--compression", 1},  {"--checkpoint", 0},    {"--abort-on-monitor", 0},
+    {"--check-allocations", 1},  {"--kstar-fit", 0},    {"--kstar-mass-target", 1}};
+
+// Metodo per controllare le opzioni di una richiesta al servizio
+// args: opzioni della richiesta
+// err: stream per l'errore
+// return: false se un'opzione non è accettata o manca il suo argomento
+static bool CheckRequestOptions(const std::vector<std::string> &args, std::ostream &err)
+{
+  for (size_t k = 0; k < args.size(); ++k)
+  {
+    const RequestOption *option = 0;
+    for (const RequestOption &candidate : kRequestOptions)
+    {
+      if (args[k] == candidate.name)
+        option = &candidate;
+    }
+    if (!option)
+    {
+      err << "Option not allowed in a request: " << args[k] << std::endl;
+      return false;
+    }
+    if (k + option->nArguments >= args.size())
+    {
+      err << "Missing argument for " << args[k] << std::endl;
+      return false;
+    }
+    k += option->nArguments;
+  }
+  return true;
+}
+
+// Metodo per eseguire il servizio di simulazione
+// argc, argv: --serve <socket> [--threads <n>]
+// return: codice di uscita
+static int Serve(int argc, char **argv)
+{
+  int nThreads = 1;
+  for (int i = 3; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      nThreads = std::atoi(argv[++i]);
+    else
+    {
+      std::cerr << "Unknown service option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  SimulationServer server;
+  if (!server.Listen(argv[2]))
+  {
+    std::cerr << "Cannot listen on " << argv[2] << std::endl;
+    return 1;
+  }
+  ThreadPool pool(nThreads);
+  std::cout << "Serving on " << argv[2] << " with " << pool.GetNThreads() << " threads" << std::endl;
+  server.Serve([&pool](const std::vector<std::string> &args, const std::string &storePath, std::ostream &out)
+               {
+                 if (!CheckRequestOptions(args, out))
+                   return 1;
+                 std::vector<char *> runArgv(1, const_cast<char *>("particle_sim"));
+                 for (size_t k = 0; k < args.size(); ++k)
+                 {
+                   if (args[k] == "--threads" && k + 1 < args.size())
+                   {
+                     ++k; // Il thread pool del servizio è condiviso da tutte le richieste
+                     continue;
+                   }
+                   runArgv.push_back(const_cast<char *>(args[k].c_str()));
+                 }
+                 runArgv.push_back(const_cast<char *>("--store-file"));
+                 runArgv.push_back(const_cast<char *>(storePath.c_str()));
+                 runArgv.push_back(const_cast<char *>("--no-root-file"));
+                 return RunSimulation((int)runArgv.size(), runArgv.data(), &pool, out, out);
+               },
+               std::cout);
+  std::cout << "Service stopped" << std::endl;
+  return 0;
+}
+
+// Metodo per confrontare la generazione con e senza posizionamento NUMA
+// argc, argv: --numa-benchmark seguito dalle opzioni della simulazione
+// return: codice di uscita
+static int RunNumaBenchmark(int argc, char **argv)
+{
+  const NumaTopology topology;
+  topology.Print(std::cout);
+  std::ostream discard(0); // Uscita delle simulazioni non stampata
+  static const int kNodeCounts[] = {1, 2, 4};
+  for (int k = 0; k < 3 && kNodeCounts[k] <= topology.GetNNodes(); ++k)
+  {
+    NumaTopology nodes = topology;
+    nodes.Restrict(kNodeCounts[k]);
+    const std::string threads = std::to_string(nodes.GetNCpus());
+    const std::string nodeCount = std::to_string(kNodeCounts[k]);
+    double rate[2] = {0, 0};
+    for (int pinned = 0; pinned < 2; ++pinned)
+    {
+      std::vector<char *> runArgv(1, argv[0]);
+      for (int i = 2; i < argc; ++i)
+        runArgv.push_back(argv[i]);
+      runArgv.push_back(const_cast<char *>("--threads"));
+      runArgv.push_back(const_cast<char *>(threads.c_str()));
+      if (pinned)
+      {
+        runArgv.push_back(const_cast<char *>("--numa"));
+        runArgv.push_back(const_cast<char *>("--numa-nodes"));
+        runArgv.push_back(const_cast<char *>(nodeCount.c_str()));
       }
+      runArgv.push_back(const_cast<char *>("--no-root-file"));
+      RunStatistics statistics = {0, 0, 0};
+      if (RunSimulation((int)runArgv.size(), runArgv.data(), 0, discard, std::cerr, &statistics) != 0)
+        return 1;
+      rate[pinned] = statistics.seconds > 0 ? statistics.events / statistics.seconds : 0;
+    }
+    std::cout << kNodeCounts[k] << (kNodeCounts[k] == 1 ? " node, " : " nodes, ") << threads << " threads: unpinned "
+              << rate[0] << " events/s, numa " << rate[1] << " events/s";
+    if (rate[0] > 0)
+      std::cout << " (x" << rate[1] / rate[0] << ")";
+    std::cout << std::endl;
+  }
+  return 0;
+}
 
-      // Imposta la quantità di moto della particella generata.
-      EventParticles[i].SetPulse(px, py, pz);
+// Metodo per eseguire il test di regressione
+// argc, argv: --regression-test <riferimento> [--write-golden] [--tolerance] seguito dalle opzioni della simulazione
+// return: 0 se tutti i controlli passano, 1 altrimenti
+static int RunRegressionTest(int argc, char **argv)
+{
+  const std::string goldenPath = argv[2];
+  bool writeGolden = false;
+  bool tolerance = false;
+  int first = 3;
+  for (; first < argc; ++first)
+  {
+    if (std::strcmp(argv[first], "--write-golden") == 0)
+      writeGolden = true;
+    else if (std::strcmp(argv[first], "--tolerance") == 0)
+      tolerance = true;
+    else
+      break;
+  }
 
-      // Riempimento degli istogrammi con le proprietà della particella generata.
-      hParticleTypes->Fill(EventParticles[i].GetParticleTypeIndex());
-      hAzimuthalAngle->Fill(phi);
-      hPolarAngle->Fill(theta);
-      hMomentum->Fill(momentum);
-      hTransverseMomentum->Fill(sqrt(px * px + py * py)); // Momento trasversale
-      hEnergy->Fill(EventParticles[i].GetEnergy());       // Energia totale
+  int nFailures = RegressionTest::CheckKinematics(std::cout);
+  nFailures += RegressionTest::CheckCorrelations(std::cout);
+
+  // Simulazione a semi fissi in blocchi indipendenti: le opzioni dell'utente seguono quelle fisse e le
+  // sostituiscono, tranne il seme, l'archivio e il file ROOT di ogni blocco
+  const std::string runPath = goldenPath + ".run.hst";
+  RegressionReference run;
+  for (int block = 0; block < RegressionTest::kBlocks; ++block)
+  {
+    const std::string seed = std::to_string(12345 + block * RegressionTest::kBlockSeedStride);
+    std::vector<char *> runArgv(1, argv[0]);
+    static const char *const kFixedOptions[] = {"--events", "100", "--threads", "1", "--monitor-interval", "0"};
+    for (int k = 0; k < 6; ++k)
+      runArgv.push_back(const_cast<char *>(kFixedOptions[k]));
+    for (int i = first; i < argc; ++i)
+      runArgv.push_back(argv[i]);
+    runArgv.push_back(const_cast<char *>("--seed"));
+    runArgv.push_back(const_cast<char *>(seed.c_str()));
+    runArgv.push_back(const_cast<char *>("--store-file"));
+    runArgv.push_back(const_cast<char *>(runPath.c_str()));
+    runArgv.push_back(const_cast<char *>("--no-root-file"));
+    std::ostream discard(0); // Uscita della simulazione non stampata
+    if (RunSimulation((int)runArgv.size(), runArgv.data(), 0, discard, std::cerr) != 0)
+    {
+      std::remove(runPath.c_str());
+      return 1;
+    }
+    HistogramStore store;
+    const bool added = store.Open(runPath.c_str()) && run.AddBlock(store);
+    store.Close();
+    std::remove(runPath.c_str());
+    if (!added)
+    {
+      std::cerr << "Cannot read the histograms of block " << block << " of the regression run" << std::endl;
+      return 1;
     }
+  }
 
-    // Numero totale di particelle nell'evento, incluse quelle da decadimenti.
-    int totalParticles = particleCount;
+  if (writeGolden)
+  {
+    if (!run.Write(goldenPath))
+    {
+      std::cerr << "Cannot write the golden reference " << goldenPath << std::endl;
+      return 1;
+    }
+    std::cout << "Golden reference written to " << goldenPath << std::endl;
+    return nFailures > 0 ? 1 : 0;
+  }
 
-    // Riempimento degli istogrammi per le particelle aggiunte dopo i decadimenti.
-    for (int i = 100; i < totalParticles; ++i)
+  RegressionReference golden;
+  if (!golden.Read(goldenPath))
+  {
+    std::cerr << "Cannot read the golden reference " << goldenPath << std::endl;
+    return 1;
+  }
+  nFailures += RegressionTest::CompareReferences(run, golden, tolerance, RegressionTest::kDefaultMinProb, std::cout);
+
+  std::cout << (nFailures == 0 ? "Regression test passed" : "Regression test FAILED") << std::endl;
+  return nFailures == 0 ? 0 : 1;
+}
+
+// Metodo per eseguire la verifica di equivalenza statistica
+// argc, argv: --equivalence o --equivalence-stores seguito dalle opzioni descritte sopra
+// return: 0 se le configurazioni sono equivalenti, 1 altrimenti
+static int RunEquivalenceCheck(int argc, char **argv)
+{
+  const bool storesOnly = std::strcmp(argv[1], "--equivalence-stores") == 0;
+  double minProb = EquivalenceChecker::kDefaultMinProb;
+  double maxPull = EquivalenceChecker::kDefaultMaxPull;
+  static const char *const kRunOptions[] = {"--monitor-interval", "0"};
+  std::vector<char *> referenceArgv(1, argv[0]);
+  std::vector<char *> candidateArgv(1, argv[0]);
+  for (int k = 0; k < 2; ++k)
+  {
+    referenceArgv.push_back(const_cast<char *>(kRunOptions[k]));
+    candidateArgv.push_back(const_cast<char *>(kRunOptions[k]));
+  }
+  std::vector<const char *> storePaths;
+  bool candidateOnly = false;
+  const char *referenceSeed = "12345";
+  const char *candidateSeed = "54321";
+  for (int i = 2; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--min-prob") == 0 && i + 1 < argc)
+      minProb = std::atof(argv[++i]);
+    else if (std::strcmp(argv[i], "--max-pull") == 0 && i + 1 < argc)
+      maxPull = std::atof(argv[++i]);
+    else if (storesOnly)
+      storePaths.push_back(argv[i]);
+    else if (std::strcmp(argv[i], "--candidate") == 0)
+      candidateOnly = true;
+    else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+    {
+      // Il seme delle opzioni comuni vale solo per il riferimento: il candidato ha sempre il proprio
+      (candidateOnly ? candidateSeed : referenceSeed) = argv[++i];
+    }
+    else
     {
-      hParticleTypes->Fill(EventParticles[i].GetParticleTypeIndex());
-      double px = EventParticles[i].GetPulseX();
-      double py = EventParticles[i].GetPulseY();
-      double pz = EventParticles[i].GetPulseZ();
-      double momentum = sqrt(px * px + py * py + pz * pz);
-      double pt = sqrt(px * px + py * py);
-      hMomentum->Fill(momentum);                    // Quantità di moto
-      hTransverseMomentum->Fill(pt);                // Quantità di moto trasversale
-      hEnergy->Fill(EventParticles[i].GetEnergy()); // Energia
+      if (!candidateOnly)
+        referenceArgv.push_back(argv[i]);
+      candidateArgv.push_back(argv[i]);
     }
+  }
 
-    // Calcolo delle masse invarianti tra tutte le coppie di particelle dell'evento.
-    for (int i = 0; i < totalParticles; ++i)
+  if (storesOnly && storePaths.size() != 2)
+  {
+    std::cerr << "Usage: --equivalence-stores <reference.hst> <candidate.hst> [--min-prob <p>] [--max-pull <k>]"
+              << std::endl;
+    return 1;
+  }
+  if (!storesOnly)
+  {
+    if ((unsigned int)std::strtoul(referenceSeed, 0, 10) == (unsigned int)std::strtoul(candidateSeed, 0, 10))
+    {
+      std::cerr << "The reference and candidate runs need different seeds (both " << referenceSeed << ")"
+                << std::endl;
+      return 1;
+    }
+
+    // Simulazioni di riferimento e candidata, con la velocità di generazione di ciascuna; il seme
+    // di ciascuna è l'ultima opzione, così che nessuna opzione comune lo sostituisca
+    storePaths.push_back("root/data/EquivalenceReference.hst");
+    storePaths.push_back("root/data/EquivalenceCandidate.hst");
+    std::vector<char *> *runArgv[2] = {&referenceArgv, &candidateArgv};
+    const char *const seeds[2] = {referenceSeed, candidateSeed};
+    const char *const labels[2] = {"Reference", "Candidate"};
+    double rate[2] = {0, 0};
+    std::ostream discard(0); // Uscita delle simulazioni non stampata
+    for (int run = 0; run < 2; ++run)
     {
-      for (int j = i + 1; j < totalParticles; ++j)
+      runArgv[run]->push_back(const_cast<char *>("--store-file"));
+      runArgv[run]->push_back(const_cast<char *>(storePaths[run]));
+      runArgv[run]->push_back(const_cast<char *>("--no-root-file"));
+      runArgv[run]->push_back(const_cast<char *>("--seed"));
+      runArgv[run]->push_back(const_cast<char *>(seeds[run]));
+      RunStatistics statistics = {0, 0, 0};
+      if (RunSimulation((int)runArgv[run]->size(), runArgv[run]->data(), 0, discard, std::cerr, &statistics) != 0)
       {
-        double invMass = EventParticles[i].InvariantMass(EventParticles[j]);
-
-        // Riempimento dell'istogramma per tutte le masse invarianti.
-        hInvariantMass->Fill(invMass);
-
-        const ParticleType *particleTypeI = Particle::GetParticleType(EventParticles[i].GetParticleTypeIndex());
-        const ParticleType *particleTypeJ = Particle::GetParticleType(EventParticles[j].GetParticleTypeIndex());
-
-        if (particleTypeI && particleTypeJ)
-        {
-          // Se la coppia ha carica opposta.
-          if (particleTypeI->GetCharge() * particleTypeJ->GetCharge() < 0)
-            hInvMassOppositeCharge->Fill(invMass);
-
-          // Se la coppia ha la stessa carica.
-          if (particleTypeI->GetCharge() * particleTypeJ->GetCharge() > 0)
-            hInvMassSameCharge->Fill(invMass);
-
-          // Masse invarianti tra Pion+/Kaon- e Pion-/Kaon+.
-          if ((particleTypeI->GetName() == "Pion+" && particleTypeJ->GetName() == "Kaon-") ||
-              (particleTypeI->GetName() == "Pion-" && particleTypeJ->GetName() == "Kaon+"))
-          {
-            hInvMassPionKaon->Fill(invMass);
-          }
-
-          // Masse invarianti tra Pion+/Kaon+ e Pion-/Kaon-.
-          if ((particleTypeI->GetName() == "Pion+" && particleTypeJ->GetName() == "Kaon+") ||
-              (particleTypeI->GetName() == "Pion-" && particleTypeJ->GetName() == "Kaon-"))
-          {
-            hInvMassPionKaonSC->Fill(invMass);
-          }
-
-          // Masse invarianti tra prodotti di decadimento della stessa K*.
-          if (i >= 100 && j == i + 1)
-          {
-            if ((particleTypeI->GetName() == "Pion+" && particleTypeJ->GetName() == "Kaon-") ||
-                (particleTypeI->GetName() == "Pion-" && particleTypeJ->GetName() == "Kaon+"))
-            {
-              hInvMassDecayProducts->Fill(invMass);
-            }
-          }
-        }
+        for (int k = 0; k <= run; ++k)
+          std::remove(storePaths[k]);
+        return 1;
       }
+      rate[run] = statistics.seconds > 0 ? statistics.events / statistics.seconds : 0;
+      std::cout << labels[run] << " run: " << statistics.events << " events, " << rate[run] << " events/s"
+                << std::endl;
     }
+    if (rate[0] > 0)
+      std::cout << "Candidate speed-up: x" << rate[1] / rate[0] << std::endl;
+  }
+
+  HistogramStore reference, candidate;
+  bool equivalent = false;
+  if (!reference.Open(storePaths[0]))
+    std::cerr << "Cannot open the store " << storePaths[0] << std::endl;
+  else if (!candidate.Open(storePaths[1]))
+    std::cerr << "Cannot open the store " << storePaths[1] << std::endl;
+  else
+  {
+    const EquivalenceChecker checker(minProb, maxPull);
+    equivalent = checker.Check(reference, candidate, std::cout);
+  }
+  reference.Close();
+  candidate.Close();
+
+  // Gli archivi scritti dalle due simulazioni servono solo al confronto
+  if (!storesOnly)
+  {
+    for (int run = 0; run < 2; ++run)
+      std::remove(storePaths[run]);
   }
+  return equivalent ? 0 : 1;
+}
 
-  // Salvataggio degli istogrammi su file ROOT per analisi
-  TFile file("root/data/ParticleAnalysis.root", "RECREATE");
-  hParticleTypes->Write();
-  hAzimuthalAngle->Write();
-  hPolarAngle->Write();
-  hMomentum->Write();
-  hTransverseMomentum->Write();
-  hEnergy->Write();
-  hInvariantMass->Write();
-  hInvMassOppositeCharge->Write();
-  hInvMassSameCharge->Write();
-  hInvMassPionKaon->Write();
-  hInvMassPionKaonSC->Write();
-  hInvMassDecayProducts->Write();
-  file.Close();
+int main(int argc, char **argv)
+{
+  InitParticleTypes();
 
-  std::cout << "Histograms saved to ParticleAnalysis.root" << std::endl;
+  // Uso di ROOT da più thread (generazione e scrittura); gli istogrammi non sono associati a directory
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(false);
 
-  return 0;
-}
\ No newline at end of file
+  if (argc > 2 && std::strcmp(argv[1], "--serve") == 0)
+    return Serve(argc, argv);
+  if (argc > 1 && std::strcmp(argv[1], "--numa-benchmark") == 0)
+    return RunNumaBenchmark(argc, argv);
+  if (argc > 2 && std::strcmp(argv[1], "--regression-test") == 0)
+    return RunRegressionTest(argc, argv);
+  if (argc > 1 && (std::strcmp(argv[1], "--equivalence") == 0 || std::strcmp(argv[1], "--equivalence-stores") == 0))
+    return RunEquivalenceCheck(argc, argv);
+  if (argc > 2 && std::strcmp(argv[1], "--client") == 0)
+  {
+    const char *output = "root/data/ParticleAnalysis.hst";
+    int first = 3;
+    if (argc > 4 && std::strcmp(argv[3], "--output") == 0)
+    {
+      output = argv[4];
+      first = 5;
+    }
+    return SimulationServer::Request(argv[2], std::vector<std::string>(argv + first, argv + argc), output, std::cout,
+                                     std::cerr);
+  }
+  return RunSimulation(argc, argv, 0, std::cout, std::cerr);
+}